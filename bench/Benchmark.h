@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lore {
+namespace bench {
+
+struct Options {
+    int warmup = 2;
+    int repetitions = 10;
+
+    /**
+     * Minimum duration of a single repetition in seconds. Fast workloads are run several times per repetition.
+     */
+    double minimumTime = 0.01;
+
+    /**
+     * Only benchmarks whose name contains this string are run.
+     */
+    std::string filter;
+};
+
+/**
+ * Throughput of a single benchmark over all repetitions.
+ */
+struct Result {
+    std::string name;
+    std::string lens;
+    std::string unit;
+
+    int repetitions = 0;
+    int64_t iterations = 0;
+
+    double mean = 0;
+    double median = 0;
+    double stddev = 0;
+    double min = 0;
+    double max = 0;
+
+    /**
+     * Mean wall time of a single iteration in seconds.
+     */
+    double seconds = 0;
+};
+
+/**
+ * Prevents the compiler from discarding the results of a workload.
+ */
+inline volatile double sink;
+
+template<typename T>
+void keep(const T &value) {
+    sink = sink + double(value);
+}
+
+/**
+ * Runs workload repeatedly and reports units / second, where every invocation of the workload processes the given
+ * number of units. The number of invocations per repetition is calibrated during warmup.
+ */
+inline Result measure(
+    const Options &options,
+    const std::string &name,
+    const std::string &lens,
+    const std::string &unit,
+    double units,
+    const std::function<void()> &workload
+) {
+    using Clock = std::chrono::steady_clock;
+    auto time = [&](int64_t iterations) {
+        const auto begin = Clock::now();
+        for (int64_t i = 0; i < iterations; i++) {
+            workload();
+        }
+        return std::chrono::duration<double>(Clock::now() - begin).count();
+    };
+
+    int64_t iterations = 1;
+    while (true) {
+        const double elapsed = time(iterations);
+        if (elapsed >= options.minimumTime || iterations >= (int64_t(1) << 40)) {
+            break;
+        }
+        const double factor = elapsed > 0 ? options.minimumTime / elapsed * 1.2 : 10;
+        iterations = std::max(iterations + 1, int64_t(double(iterations) * std::min(factor, 10.0)));
+    }
+    for (int i = 0; i < options.warmup; i++) {
+        time(iterations);
+    }
+
+    const int repetitions = std::max(1, options.repetitions);
+    std::vector<double> throughput(repetitions);
+    double totalTime = 0;
+    for (int i = 0; i < repetitions; i++) {
+        const double elapsed = time(iterations);
+        totalTime += elapsed;
+        throughput[i] = units * double(iterations) / elapsed;
+    }
+
+    Result result;
+    result.name = name;
+    result.lens = lens;
+    result.unit = unit;
+    result.repetitions = repetitions;
+    result.iterations = iterations;
+    result.seconds = totalTime / double(repetitions * iterations);
+
+    double sum = 0;
+    for (const double value : throughput) {
+        sum += value;
+    }
+    result.mean = sum / repetitions;
+
+    double squares = 0;
+    for (const double value : throughput) {
+        squares += (value - result.mean) * (value - result.mean);
+    }
+    result.stddev = repetitions > 1 ? std::sqrt(squares / (repetitions - 1)) : 0;
+
+    std::sort(throughput.begin(), throughput.end());
+    result.min = throughput.front();
+    result.max = throughput.back();
+    result.median = repetitions % 2
+        ? throughput[repetitions / 2]
+        : (throughput[repetitions / 2 - 1] + throughput[repetitions / 2]) / 2;
+    return result;
+}
+
+inline void writeString(std::ostream &os, const std::string &text) {
+    os << '"';
+    for (const char c : text) {
+        switch (c) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            default: os << c; break;
+        }
+    }
+    os << '"';
+}
+
+inline void writeJson(std::ostream &os, const Options &options, const std::vector<Result> &results) {
+    os << "{\n  \"options\": { \"warmup\": " << options.warmup
+       << ", \"repetitions\": " << options.repetitions
+       << ", \"minimumTime\": " << options.minimumTime << " },\n";
+    os << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        os << (i ? ",\n" : "\n") << "    { \"name\": ";
+        writeString(os, result.name);
+        os << ", \"lens\": ";
+        writeString(os, result.lens);
+        os << ", \"unit\": ";
+        writeString(os, result.unit);
+        os << ", \"repetitions\": " << result.repetitions
+           << ", \"iterations\": " << result.iterations
+           << ", \"mean\": " << result.mean
+           << ", \"median\": " << result.median
+           << ", \"stddev\": " << result.stddev
+           << ", \"min\": " << result.min
+           << ", \"max\": " << result.max
+           << ", \"seconds\": " << result.seconds << " }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/LensSchema.h>
+#include <lore/rt/Ray.h>
+#include <lore/rt/RayGenerator.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef LORE_DATA_DIR
+#define LORE_DATA_DIR "data"
+#endif
+
+namespace lore {
+namespace bench {
+
+inline std::string readFile(const std::filesystem::path &path) {
+    std::ifstream file { path, std::ios::binary };
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/**
+ * Regular files of a directory with the given extension, sorted by name.
+ */
+inline std::vector<std::filesystem::path> listFiles(const std::filesystem::path &directory, const std::string &extension) {
+    std::vector<std::filesystem::path> result;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == extension) {
+            result.push_back(entry.path());
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/**
+ * Rays through a square grid of pupil points inside the unit disk, at the given relative fields.
+ */
+template<typename Float>
+std::vector<rt::Ray<Float>> generateRays(
+    const LensSchema<float> &schema,
+    int gridSize = 16,
+    std::initializer_list<double> fields = { 0.0, 0.7, 1.0 }
+) {
+    const rt::RayGenerator<Float> generator { schema };
+    std::vector<rt::Ray<Float>> rays;
+    for (const double field : fields) {
+        for (int iy = 0; iy < gridSize; iy++) {
+            for (int ix = 0; ix < gridSize; ix++) {
+                const double px = (ix + 0.5) / gridSize * 2 - 1;
+                const double py = (iy + 0.5) / gridSize * 2 - 1;
+                if (px * px + py * py <= 1) {
+                    rays.push_back(generator(Float(field), Float(px), Float(py)));
+                }
+            }
+        }
+    }
+    return rays;
+}
+
+}
+}
@@ -0,0 +1,390 @@
+#include "Benchmark.h"
+#include "Data.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Paraxial.h>
+#include <lore/analysis/VariantBatch.h>
+#include <lore/io/BinaryLens.h>
+#include <lore/io/LensReader.h>
+#include <lore/io/LensWriter.h>
+#include <lore/lens/CompactLens.h>
+#include <lore/lens/GlassCatalog.h>
+#include <lore/lens/LensArchive.h>
+#include <lore/optim/FADFloat.h>
+#include <lore/optim/MeritFunction.h>
+#include <lore/rt/ABCD.h>
+#include <lore/rt/CompactTrace.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/SequentialTrace.h>
+
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lore;
+namespace fs = std::filesystem;
+using bench::listFiles;
+using bench::readFile;
+using bench::generateRays;
+
+template<typename Float>
+static bench::Result benchmarkTrace(
+    const bench::Options &options,
+    const std::string &name,
+    const std::string &lensName,
+    const LensSchema<float> &schema
+) {
+    using Intersector = rt::GeometricalIntersector<Float>;
+
+    const Lens<Float> lens = schema.lens<Float>();
+    const Intersector intersector {};
+    const Float wavelength = Float(schema.wavelengths.empty() ? 0.5876f : schema.wavelengths.front().wavelength);
+    const rt::SequentialTrace<Float, Intersector> trace { lens, intersector, wavelength };
+    const std::vector<rt::Ray<Float>> rays = generateRays<Float>(schema);
+
+    return bench::measure(options, name, lensName, "rays/s", double(rays.size()), [&]() {
+        int valid = 0;
+        for (const rt::Ray<Float> &initial : rays) {
+            rt::Ray<Float> ray = initial;
+            if (trace(ray)) {
+                valid++;
+            }
+        }
+        bench::keep(valid);
+    });
+}
+
+/**
+ * Variants of a lens with slightly perturbed thicknesses, as kept resident during design-space sweeps.
+ */
+static std::vector<Lens<float>> generateVariants(const Lens<float> &lens, int numVariants) {
+    std::vector<Lens<float>> variants(numVariants, lens);
+    for (int v = 0; v < numVariants; v++) {
+        for (size_t i = 1; i < lens.surfaces.size(); i++) {
+            variants[v].surfaces[i].thickness *= 1 + 1e-5f * float((v * 7 + int(i)) % 13);
+        }
+    }
+    return variants;
+}
+
+/**
+ * Traces a few rays through each of many lens variants, whose combined size exceeds the caches, in either the
+ * Lens or the CompactLens layout.
+ */
+template<bool Compact>
+static bench::Result benchmarkSweep(
+    const bench::Options &options,
+    const std::string &name,
+    const std::string &lensName,
+    const LensSchema<float> &schema
+) {
+    using Intersector = rt::GeometricalIntersector<float>;
+    const int numVariants = 16384;
+
+    const float wavelength = schema.wavelengths.empty() ? 0.5876f : schema.wavelengths.front().wavelength;
+    const std::vector<Lens<float>> variants = generateVariants(schema.lens<float>(), numVariants);
+    std::vector<CompactLens<float>> compactVariants;
+    if (Compact) {
+        compactVariants.reserve(variants.size());
+        for (const Lens<float> &variant : variants) {
+            compactVariants.emplace_back(variant, wavelength);
+        }
+    }
+    const std::vector<rt::Ray<float>> rays = generateRays<float>(schema, 3, { 0.0, 0.7 });
+
+    const Intersector intersector {};
+    return bench::measure(options, name, lensName, "rays/s", double(rays.size()) * numVariants, [&]() {
+        int valid = 0;
+        // every ray visits all variants before the next one starts, as in an outer loop over field points
+        for (const rt::Ray<float> &initial : rays) {
+            for (int v = 0; v < numVariants; v++) {
+                rt::Ray<float> ray = initial;
+                if constexpr (Compact) {
+                    valid += rt::CompactTrace<float>(compactVariants[v])(ray);
+                } else {
+                    valid += rt::SequentialTrace<float, Intersector>(variants[v], intersector, wavelength)(ray);
+                }
+            }
+        }
+        bench::keep(valid);
+    });
+}
+
+/**
+ * Computes the focal length and a spot size of many variants of a lens, either as individual Lens copies or as a
+ * VariantBatch. The variants perturb all thicknesses like generateVariants.
+ */
+template<bool Batched>
+static bench::Result benchmarkVariants(
+    const bench::Options &options,
+    const std::string &name,
+    const std::string &lensName,
+    const LensSchema<float> &schema
+) {
+    const int numVariants = 4096;
+    const float wavelength = schema.wavelengths.empty() ? 0.5876f : schema.wavelengths.front().wavelength;
+    const Lens<float> lens = schema.lens<float>();
+
+    std::vector<LensParameter> parameters;
+    for (int i = 1; i < int(lens.surfaces.size()); i++) {
+        parameters.push_back({ LensParameter::THICKNESS, i });
+    }
+    VariantBatch<float> batch(lens, parameters);
+    batch.reserve(numVariants);
+    std::vector<float> deltas(parameters.size());
+    for (int v = 0; v < numVariants; v++) {
+        for (size_t p = 0; p < parameters.size(); p++) {
+            const int surface = parameters[p].surface;
+            deltas[p] = lens.surfaces[surface].thickness * 1e-5f * float((v * 7 + surface) % 13);
+        }
+        batch.add(deltas);
+    }
+
+    std::vector<Lens<float>> variants;
+    if (!Batched) {
+        variants.reserve(numVariants);
+        for (int v = 0; v < numVariants; v++) {
+            variants.push_back(batch.variant(v));
+        }
+    }
+
+    optim::MeritFunction mf;
+    mf.add(optim::Operand::spotRms(0.7, 0, 5));
+    const optim::MeritProgram program = mf.compile(schema);
+    const rt::RayGenerator<float> generator = program.generator.cast<float>();
+
+    return bench::measure(options, name, lensName, "variants/s", numVariants, [&]() {
+        float sum = 0;
+        if constexpr (Batched) {
+            const auto paraxial = batch.paraxial(wavelength);
+            const auto spots = batch.spotRms(generator, 0.7f, wavelength, 5);
+            for (int v = 0; v < numVariants; v++) {
+                sum += paraxial.efl[v] + spots[v];
+            }
+        } else {
+            for (const Lens<float> &variant : variants) {
+                sum += ParaxialAnalysis<float>(variant, wavelength).efl + program.evaluate(variant, false).values[0];
+            }
+        }
+        bench::keep(sum);
+    });
+}
+
+static void printUsage() {
+    std::cerr
+        << "usage: lore-bench [options]\n"
+        << "  --data <dir>          directory containing lenses/ and glass/ (default: " << LORE_DATA_DIR << ")\n"
+        << "  --json <file>         write results as JSON ('-' for stdout, moving the table to stderr)\n"
+        << "  --filter <text>       only run benchmarks whose name contains text\n"
+        << "  --repetitions <n>     measured repetitions per benchmark (default: 10)\n"
+        << "  --warmup <n>          discarded repetitions per benchmark (default: 2)\n"
+        << "  --min-time <seconds>  minimum duration of a repetition (default: 0.01)\n";
+}
+
+int main(int argc, char **argv) {
+    bench::Options options;
+    fs::path dataDirectory = LORE_DATA_DIR;
+    std::string jsonPath;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (argument == "--data" && hasValue) {
+            dataDirectory = argv[++i];
+        } else if (argument == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if (argument == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (argument == "--repetitions" && hasValue) {
+            options.repetitions = std::stoi(argv[++i]);
+        } else if (argument == "--warmup" && hasValue) {
+            options.warmup = std::stoi(argv[++i]);
+        } else if (argument == "--min-time" && hasValue) {
+            options.minimumTime = std::stod(argv[++i]);
+        } else {
+            printUsage();
+            return argument == "--help" ? 0 : 1;
+        }
+    }
+
+    const fs::path glassDirectory = dataDirectory / "glass";
+    const fs::path lensDirectory = dataDirectory / "lenses";
+    if (!fs::is_directory(glassDirectory) || !fs::is_directory(lensDirectory)) {
+        std::cerr << "data directory '" << dataDirectory.string() << "' not found" << std::endl;
+        return 1;
+    }
+
+    // catalogs log every read, which would clutter the results
+    static std::ostream discard(nullptr);
+    Logger::shared = std::make_shared<AsyncLogger>(discard, std::cerr);
+
+    // the table moves to stderr when the JSON goes to stdout, so that the latter stays parseable
+    std::ostream &table = jsonPath == "-" ? std::cerr : std::cout;
+
+    std::vector<bench::Result> results;
+    auto run = [&](const std::string &name, auto &&benchmark) {
+        if (name.find(options.filter) == std::string::npos) {
+            return;
+        }
+        bench::Result result = benchmark();
+        table
+            << std::left << std::setw(28) << result.name
+            << std::setw(24) << result.lens
+            << std::right << std::setw(14) << std::setprecision(4) << result.median << " " << result.unit
+            << "  (+/- " << std::setprecision(2) << (result.mean > 0 ? 100 * result.stddev / result.mean : 0) << "%)"
+            << std::endl;
+        results.push_back(result);
+    };
+
+    GlassCatalog catalog;
+    for (const fs::path &path : listFiles(glassDirectory, ".glc")) {
+        const double megabytes = double(fs::file_size(path)) / 1e6;
+        run("glass/load", [&]() {
+            return bench::measure(options, "glass/load", path.stem().string(), "MB/s", megabytes, [&]() {
+                GlassCatalog local;
+                bench::keep(local.read(path.string()));
+            });
+        });
+        catalog.read(path.string());
+    }
+
+    const io::LensReader reader { catalog };
+    std::vector<std::string> parsable;
+    for (const fs::path &path : listFiles(lensDirectory, ".len")) {
+        const std::string lensName = path.stem().string();
+        const std::string contents = readFile(path);
+
+        std::vector<LensSchema<float>> schemas;
+        try {
+            std::istringstream stream(contents);
+            schemas = reader.read(stream);
+        } catch (const std::exception &e) {
+            std::cerr << "skipping " << lensName << ": " << e.what() << std::endl;
+            continue;
+        }
+        if (schemas.empty()) {
+            continue;
+        }
+        const LensSchema<float> &schema = schemas.front();
+        parsable.push_back(contents);
+
+        run("len/parse", [&]() {
+            return bench::measure(options, "len/parse", lensName, "MB/s", double(contents.size()) / 1e6, [&]() {
+                std::istringstream stream(contents);
+                bench::keep(reader.read(stream).size());
+            });
+        });
+
+        run("abcd/full", [&]() {
+            const Lens<double> lens = schema.lens<double>();
+            return bench::measure(options, "abcd/full", lensName, "evaluations/s", 1, [&]() {
+                bench::keep(abcd::full(lens, 0.5876)(1, 0));
+            });
+        });
+
+        run("trace/float", [&]() {
+            return benchmarkTrace<float>(options, "trace/float", lensName, schema);
+        });
+        run("trace/double", [&]() {
+            return benchmarkTrace<double>(options, "trace/double", lensName, schema);
+        });
+        run("trace/fad<double,4>", [&]() {
+            return benchmarkTrace<optim::FADFloat<double, 4>>(options, "trace/fad<double,4>", lensName, schema);
+        });
+        run("sweep/lens", [&]() {
+            return benchmarkSweep<false>(options, "sweep/lens", lensName, schema);
+        });
+        run("sweep/compact", [&]() {
+            return benchmarkSweep<true>(options, "sweep/compact", lensName, schema);
+        });
+        run("variants/lens", [&]() {
+            return benchmarkVariants<false>(options, "variants/lens", lensName, schema);
+        });
+        run("variants/batch", [&]() {
+            return benchmarkVariants<true>(options, "variants/batch", lensName, schema);
+        });
+    }
+
+    // loading an archive of many designs, simulated by parsing all shipped lenses repeatedly
+    const int numCopies = 64;
+    double bulkMegabytes = 0;
+    for (const std::string &contents : parsable) {
+        bulkMegabytes += double(contents.size()) * numCopies / 1e6;
+    }
+    run("bulk/schemas", [&]() {
+        return bench::measure(options, "bulk/schemas", "all", "MB/s", bulkMegabytes, [&]() {
+            std::vector<LensSchema<float>> lenses;
+            for (int copy = 0; copy < numCopies; copy++) {
+                for (const std::string &contents : parsable) {
+                    std::istringstream stream(contents);
+                    for (LensSchema<float> &lens : reader.read(stream)) {
+                        lenses.push_back(std::move(lens));
+                    }
+                }
+            }
+            bench::keep(lenses.size());
+        });
+    });
+    run("bulk/archive", [&]() {
+        return bench::measure(options, "bulk/archive", "all", "MB/s", bulkMegabytes, [&]() {
+            LensArchive archive;
+            for (int copy = 0; copy < numCopies; copy++) {
+                for (const std::string &contents : parsable) {
+                    std::istringstream stream(contents);
+                    reader.read(stream, archive);
+                }
+            }
+            bench::keep(archive.size());
+        });
+    });
+
+    run("bulk/binary", [&]() {
+        LensArchive archive;
+        for (int copy = 0; copy < numCopies; copy++) {
+            for (const std::string &contents : parsable) {
+                std::istringstream stream(contents);
+                reader.read(stream, archive);
+            }
+        }
+
+        const fs::path binaryPath = fs::temp_directory_path() / "lore-bench.lbin";
+        {
+            std::ofstream file { binaryPath, std::ios::binary };
+            io::LensWriter().writeBinary(file, archive);
+        }
+
+        // throughput relative to the text it replaces, including mapping the file and touching every surface
+        bench::Result result = bench::measure(options, "bulk/binary", "all", "MB/s", bulkMegabytes, [&]() {
+            const io::BinaryLensFile file = io::BinaryLensFile::open(binaryPath.string());
+            float sum = 0;
+            for (size_t i = 0; i < file.size(); i++) {
+                for (const io::binary::SurfaceRecord &surface : file[i].surfaces()) {
+                    sum += surface.thickness;
+                }
+            }
+            bench::keep(sum);
+        });
+        fs::remove(binaryPath);
+        return result;
+    });
+
+    if (!jsonPath.empty()) {
+        if (jsonPath == "-") {
+            bench::writeJson(std::cout, options, results);
+        } else {
+            std::ofstream file { jsonPath };
+            bench::writeJson(file, options, results);
+            if (!file) {
+                std::cerr << "could not write '" << jsonPath << "'" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
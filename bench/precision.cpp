@@ -0,0 +1,255 @@
+#include "Benchmark.h"
+#include "Data.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Statistics.h>
+#include <lore/io/LensReader.h>
+#include <lore/lens/GlassCatalog.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/MixedPrecisionTrace.h>
+#include <lore/rt/SequentialTrace.h>
+
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lore;
+namespace fs = std::filesystem;
+
+/**
+ * Deviation of image plane positions from the double precision reference.
+ */
+struct ErrorReport {
+    SampleStatistics error;
+
+    /**
+     * Rays whose validity (vignetted, missed or totally reflected) differs from the reference.
+     */
+    int mismatched = 0;
+
+    void add(bool valid, const rt::Ray<double> &ray, bool referenceValid, const rt::Ray<double> &reference) {
+        if (valid != referenceValid) {
+            mismatched++;
+            return;
+        }
+        if (valid) {
+            error.add(std::hypot(ray.origin.x() - reference.origin.x(), ray.origin.y() - reference.origin.y()));
+        }
+    }
+
+    void writeJson(std::ostream &os) const {
+        os << "{ \"mismatched\": " << mismatched
+           << ", \"median\": " << error.percentile(50)
+           << ", \"p99\": " << error.percentile(99)
+           << ", \"max\": " << (error.moments.count ? error.moments.max : 0) << " }";
+    }
+};
+
+struct LensReport {
+    std::string lens;
+    int rays = 0;
+    int retraced = 0;
+    ErrorReport single;
+    ErrorReport mixed;
+    bench::Result singleThroughput;
+    bench::Result mixedThroughput;
+    bench::Result doubleThroughput;
+};
+
+static void printUsage() {
+    std::cerr
+        << "usage: lore-precision [options]\n"
+        << "  --data <dir>          directory containing lenses/ and glass/ (default: " << LORE_DATA_DIR << ")\n"
+        << "  --json <file>         write results as JSON ('-' for stdout, moving the table to stderr)\n"
+        << "  --grid <n>            pupil samples per axis (default: 16)\n"
+        << "  --tolerance <value>   largest acceptable relative intersection error in float (default: 1e-4)\n";
+}
+
+int main(int argc, char **argv) {
+    fs::path dataDirectory = LORE_DATA_DIR;
+    std::string jsonPath;
+    int gridSize = 16;
+    float tolerance = 1e-4f;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (argument == "--data" && hasValue) {
+            dataDirectory = argv[++i];
+        } else if (argument == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if (argument == "--grid" && hasValue) {
+            gridSize = std::stoi(argv[++i]);
+        } else if (argument == "--tolerance" && hasValue) {
+            tolerance = std::stof(argv[++i]);
+        } else {
+            printUsage();
+            return argument == "--help" ? 0 : 1;
+        }
+    }
+
+    const fs::path glassDirectory = dataDirectory / "glass";
+    const fs::path lensDirectory = dataDirectory / "lenses";
+    if (!fs::is_directory(glassDirectory) || !fs::is_directory(lensDirectory)) {
+        std::cerr << "data directory '" << dataDirectory.string() << "' not found" << std::endl;
+        return 1;
+    }
+
+    static std::ostream discard(nullptr);
+    Logger::shared = std::make_shared<AsyncLogger>(discard, std::cerr);
+
+    GlassCatalog catalog;
+    for (const fs::path &path : bench::listFiles(glassDirectory, ".glc")) {
+        catalog.read(path.string());
+    }
+
+    bench::Options throughputOptions;
+    throughputOptions.warmup = 1;
+    throughputOptions.repetitions = 3;
+
+    // the table moves to stderr when the JSON goes to stdout, so that the latter stays parseable
+    std::ostream &table = jsonPath == "-" ? std::cerr : std::cout;
+    table
+        << std::left << std::setw(22) << "lens" << std::right
+        << std::setw(7) << "rays"
+        << std::setw(12) << "float p50"
+        << std::setw(12) << "float max"
+        << std::setw(6) << "bad"
+        << std::setw(10) << "retraced"
+        << std::setw(12) << "mixed max"
+        << std::setw(6) << "bad"
+        << std::setw(12) << "float r/s"
+        << std::setw(12) << "mixed r/s"
+        << std::setw(12) << "double r/s" << std::endl;
+
+    const io::LensReader reader { catalog };
+    std::vector<LensReport> reports;
+    for (const fs::path &path : bench::listFiles(lensDirectory, ".len")) {
+        LensReport report;
+        report.lens = path.stem().string();
+
+        std::vector<LensSchema<float>> schemas;
+        try {
+            std::ifstream file { path };
+            schemas = reader.read(file);
+        } catch (const std::exception &e) {
+            std::cerr << "skipping " << report.lens << ": " << e.what() << std::endl;
+            continue;
+        }
+        if (schemas.empty()) {
+            continue;
+        }
+
+        const LensSchema<float> &schema = schemas.front();
+        const Lens<double> lens = schema.lens<double>();
+        const double wavelength = schema.wavelengths.empty() ? 0.5876 : schema.wavelengths.front().wavelength;
+        const std::vector<rt::Ray<double>> rays = bench::generateRays<double>(schema, gridSize, { 0.0, 0.5, 0.7, 1.0 });
+        report.rays = int(rays.size());
+
+        using DoubleIntersector = rt::GeometricalIntersector<double>;
+        using SingleIntersector = rt::GeometricalIntersector<float>;
+        const Lens<float> singleLens = lens.cast<float>();
+        const DoubleIntersector doubleIntersector {};
+        const SingleIntersector singleIntersector {};
+        const rt::SequentialTrace<double, DoubleIntersector> doubleTrace { lens, doubleIntersector, wavelength };
+        const rt::SequentialTrace<float, SingleIntersector> singleTrace {
+            singleLens, singleIntersector, float(wavelength)
+        };
+        const rt::MixedPrecisionTrace mixedTrace { lens, wavelength, tolerance };
+
+        for (const rt::Ray<double> &initial : rays) {
+            rt::Ray<double> reference = initial;
+            const bool referenceValid = doubleTrace(reference);
+
+            rt::Ray<float> single = initial.cast<float>();
+            const bool singleValid = singleTrace(single);
+            report.single.add(singleValid, single.cast<double>(), referenceValid, reference);
+
+            rt::Ray<double> mixed = initial;
+            bool retraced = false;
+            const bool mixedValid = mixedTrace(mixed, &retraced);
+            report.mixed.add(mixedValid, mixed, referenceValid, reference);
+            if (retraced) {
+                report.retraced++;
+            }
+        }
+
+        const double numRays = double(rays.size());
+        report.doubleThroughput = bench::measure(throughputOptions, "double", report.lens, "rays/s", numRays, [&]() {
+            for (const rt::Ray<double> &initial : rays) {
+                rt::Ray<double> ray = initial;
+                bench::keep(doubleTrace(ray));
+            }
+        });
+        report.singleThroughput = bench::measure(throughputOptions, "float", report.lens, "rays/s", numRays, [&]() {
+            for (const rt::Ray<double> &initial : rays) {
+                rt::Ray<float> ray = initial.cast<float>();
+                bench::keep(singleTrace(ray));
+            }
+        });
+        report.mixedThroughput = bench::measure(throughputOptions, "mixed", report.lens, "rays/s", numRays, [&]() {
+            for (const rt::Ray<double> &initial : rays) {
+                rt::Ray<double> ray = initial;
+                bench::keep(mixedTrace(ray));
+            }
+        });
+
+        const auto maximum = [](const ErrorReport &errors) {
+            return errors.error.moments.count ? errors.error.moments.max : 0.0;
+        };
+        table
+            << std::left << std::setw(22) << report.lens << std::right
+            << std::setw(7) << report.rays
+            << std::scientific << std::setprecision(2)
+            << std::setw(12) << report.single.error.percentile(50)
+            << std::setw(12) << maximum(report.single)
+            << std::setw(6) << report.single.mismatched
+            << std::fixed << std::setprecision(1)
+            << std::setw(9) << 100.0 * report.retraced / std::max(1, report.rays) << "%"
+            << std::scientific << std::setprecision(2)
+            << std::setw(12) << maximum(report.mixed)
+            << std::setw(6) << report.mixed.mismatched
+            << std::setw(12) << report.singleThroughput.median
+            << std::setw(12) << report.mixedThroughput.median
+            << std::setw(12) << report.doubleThroughput.median
+            << std::defaultfloat << std::endl;
+
+        reports.push_back(std::move(report));
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream file;
+        if (jsonPath != "-") {
+            file.open(jsonPath);
+        }
+        std::ostream &os = jsonPath == "-" ? std::cout : file;
+
+        os << "{\n  \"tolerance\": " << tolerance << ",\n  \"grid\": " << gridSize << ",\n  \"lenses\": [";
+        for (size_t i = 0; i < reports.size(); i++) {
+            const LensReport &report = reports[i];
+            os << (i ? ",\n" : "\n") << "    { \"lens\": ";
+            bench::writeString(os, report.lens);
+            os << ", \"rays\": " << report.rays << ", \"retraced\": " << report.retraced << ",\n      \"float\": ";
+            report.single.writeJson(os);
+            os << ",\n      \"mixed\": ";
+            report.mixed.writeJson(os);
+            os << ",\n      \"throughput\": { \"float\": " << report.singleThroughput.median
+               << ", \"mixed\": " << report.mixedThroughput.median
+               << ", \"double\": " << report.doubleThroughput.median << " } }";
+        }
+        os << "\n  ]\n}\n";
+
+        if (!os) {
+            std::cerr << "could not write '" << jsonPath << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Lens.h>
+#include <lore/analysis/Sensitivity.h>
+#include <lore/optim/FADFloat.h>
+#include <lore/optim/MeritFunction.h>
+#include <lore/profiling/Profiler.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Symmetric n x n matrix that only stores its lower triangle, packed row by row.
+ */
+template<typename Float>
+struct SymmetricMatrix {
+    int n;
+    std::vector<Float> el;
+
+    SymmetricMatrix() : n(0) {}
+    explicit SymmetricMatrix(int n) : n(n), el(size_t(n) * (n + 1) / 2, Float(0)) {}
+
+    int size() const {
+        return n;
+    }
+
+    Float &operator()(int i, int j) {
+        return el[index(i, j)];
+    }
+
+    const Float &operator()(int i, int j) const {
+        return el[index(i, j)];
+    }
+
+    std::vector<Float> operator*(const std::vector<Float> &v) const {
+        std::vector<Float> result(n, Float(0));
+        for (int i = 0; i < n; i++) {
+            const Float *row = el.data() + size_t(i) * (i + 1) / 2;
+            for (int j = 0; j < i; j++) {
+                result[i] += row[j] * v[j];
+                result[j] += row[j] * v[i];
+            }
+            result[i] += row[i] * v[i];
+        }
+        return result;
+    }
+
+private:
+    static size_t index(int i, int j) {
+        if (i < j) {
+            std::swap(i, j);
+        }
+        return size_t(i) * (i + 1) / 2 + j;
+    }
+};
+
+/**
+ * Second derivatives of the total merit of a program with respect to lens parameters, computed by nested
+ * forward-mode differentiation (a FADFloat whose scalar type is a FADFloat).
+ */
+template<int Width = 4>
+struct MeritHessian {
+    const Lens<double> &lens;
+    const optim::MeritProgram &program;
+
+    MeritHessian(const Lens<double> &lens, const optim::MeritProgram &program)
+    : lens(lens), program(program) {}
+
+    /**
+     * Computes the full Hessian. Parameters are split into blocks of Width, and each pair of blocks (I, J) with
+     * I >= J is evaluated once with block I seeded into the outer and block J into the inner derivative lanes, so
+     * that only the lower triangle is traced.
+     */
+    SymmetricMatrix<double> compute(const std::vector<LensParameter> &parameters) const {
+        LORE_PROFILE_SCOPE("MeritHessian::compute");
+        using Inner = optim::FADFloat<double, Width>;
+        using FAD = optim::FADFloat<Inner, Width>;
+        validate(parameters);
+
+        const int numParameters = int(parameters.size());
+        const FAD wavelength = FAD(program.wavelengths.front());
+        SymmetricMatrix<double> hessian(numParameters);
+
+        optim::MeritProgram::Workspace<FAD> workspace;
+        optim::MeritResult<FAD> result;
+        for (int outer = 0; outer < numParameters; outer += Width) {
+            for (int inner = 0; inner <= outer; inner += Width) {
+                Lens<FAD> seeded = lens.template cast<FAD>();
+                for (int parameter = inner; parameter < std::min(inner + Width, numParameters); parameter++) {
+                    if (parameter < outer) {
+                        FAD delta = FAD(0);
+                        delta.V.dVd(parameter - inner) = 1;
+                        parameters[parameter].apply(seeded, delta, wavelength);
+                    }
+                }
+                for (int parameter = outer; parameter < std::min(outer + Width, numParameters); parameter++) {
+                    FAD delta = FAD(0);
+                    delta.dVd(parameter - outer) = Inner(1);
+                    if (inner == outer) {
+                        delta.V.dVd(parameter - inner) = 1;
+                    }
+                    parameters[parameter].apply(seeded, delta, wavelength);
+                }
+
+                program.evaluate(seeded, workspace, result);
+
+                for (int i = outer; i < std::min(outer + Width, numParameters); i++) {
+                    for (int j = inner; j < std::min(inner + Width, i + 1); j++) {
+                        hessian(i, j) = result.merit.dVd(i - outer).dVd(j - inner);
+                    }
+                }
+            }
+        }
+
+        return hessian;
+    }
+
+    /**
+     * Computes the product of the Hessian with a direction v (and the gradient as a by-product) without forming the
+     * Hessian, by seeding v into a single inner derivative lane.
+     */
+    std::vector<double> product(
+        const std::vector<LensParameter> &parameters,
+        const std::vector<double> &v,
+        std::vector<double> *gradient = nullptr
+    ) const {
+        LORE_PROFILE_SCOPE("MeritHessian::product");
+        using Inner = optim::FADFloat<double, 1>;
+        using FAD = optim::FADFloat<Inner, Width>;
+        validate(parameters);
+        if (v.size() != parameters.size()) {
+            throw std::invalid_argument("direction does not match the number of parameters");
+        }
+
+        const int numParameters = int(parameters.size());
+        const FAD wavelength = FAD(program.wavelengths.front());
+        std::vector<double> result(numParameters);
+        if (gradient) {
+            gradient->resize(numParameters);
+        }
+
+        optim::MeritProgram::Workspace<FAD> workspace;
+        optim::MeritResult<FAD> evaluation;
+        for (int chunk = 0; chunk < numParameters; chunk += Width) {
+            Lens<FAD> seeded = lens.template cast<FAD>();
+            for (int parameter = 0; parameter < numParameters; parameter++) {
+                FAD delta = FAD(0);
+                delta.V.dVd(0) = v[parameter];
+                if (parameter >= chunk && parameter < chunk + Width) {
+                    delta.dVd(parameter - chunk) = Inner(1);
+                }
+                parameters[parameter].apply(seeded, delta, wavelength);
+            }
+
+            program.evaluate(seeded, workspace, evaluation);
+
+            for (int i = chunk; i < std::min(chunk + Width, numParameters); i++) {
+                result[i] = evaluation.merit.dVd(i - chunk).dVd(0);
+                if (gradient) {
+                    (*gradient)[i] = evaluation.merit.dVd(i - chunk).V;
+                }
+            }
+        }
+
+        return result;
+    }
+
+private:
+    void validate(const std::vector<LensParameter> &parameters) const {
+        for (const LensParameter &parameter : parameters) {
+            if (parameter.surface < 1 || parameter.surface >= int(lens.surfaces.size())) {
+                throw std::invalid_argument("parameter references unknown surface " + std::to_string(parameter.surface));
+            }
+        }
+    }
+};
+
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/analysis/PointSpread.h>
+#include <lore/analysis/Wavefront.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/LensSchema.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/Ray.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/sampling/PupilSampler.h>
+
+#include <cmath>
+#include <complex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Polychromatic modulation transfer function of one field point.
+ */
+struct ModulationTransfer {
+    double field = 0;
+
+    /**
+     * Spatial frequencies in cycles per lens unit.
+     */
+    std::vector<double> frequencies;
+
+    /**
+     * Modulation of line patterns along x, which is perpendicular to the meridional plane.
+     */
+    std::vector<double> sagittal;
+
+    /**
+     * Modulation of line patterns along y, which lies in the meridional plane.
+     */
+    std::vector<double> tangential;
+};
+
+/**
+ * Computes modulation transfer functions for the sagittal and tangential directions.
+ *
+ * Each field point is traced once per wavelength, and all frequencies are evaluated from that trace: the diffraction
+ * method projects the point spread function onto the x and y axes and Fourier transforms the resulting line spread
+ * functions, while the geometric method transforms the spot diagram of a pupil sampler. The optical transfer
+ * functions of all wavelengths are referred to a common image point and summed by their weights and transmissions,
+ * such that lateral color lowers the polychromatic modulation.
+ */
+template<typename Float>
+class MTFAnalysis {
+public:
+    enum Method {
+        DIFFRACTION,
+        GEOMETRIC
+    };
+
+    struct Options {
+        Method method = DIFFRACTION;
+
+        /**
+         * Number of pupil samples along each axis and padding of the point spread functions (diffraction only).
+         * The extent of the point spread functions, pupilSamples * wavelength / (2 NA), has to exceed the spot, and
+         * a padding of at least two is required to sample frequencies up to the diffraction cutoff.
+         */
+        int pupilSamples = 64;
+        int padding = 2;
+
+        /**
+         * Spot diagram rays per field point and wavelength (geometric only).
+         */
+        int rays = 4096;
+        sampling::PupilSampler sampler = sampling::PupilSampler::sobol();
+
+        /**
+         * Whether fields, wavelengths and the work within them are distributed over all cores.
+         */
+        bool parallel = true;
+    };
+
+    MTFAnalysis(
+        const Lens<Float> &lens,
+        const rt::RayGenerator<Float> &generator,
+        int stopIndex,
+        const std::vector<WeightedWavelength<double>> &wavelengths,
+        const Options &options = Options {}
+    ) : wavelengths(wavelengths),
+        options(options),
+        psfs(lens, generator, stopIndex, psfOptions(options)) {
+        if (wavelengths.empty()) {
+            throw std::invalid_argument("modulation transfer requires at least one wavelength");
+        }
+        if (options.method == DIFFRACTION && options.padding < 2) {
+            throw std::invalid_argument("diffraction modulation transfer requires a padding of at least two");
+        }
+        if (options.method == GEOMETRIC && options.rays <= 0) {
+            throw std::invalid_argument("geometric modulation transfer requires rays");
+        }
+    }
+
+    template<typename SFloat>
+    explicit MTFAnalysis(const LensSchema<SFloat> &schema, const Options &options = Options {})
+    : MTFAnalysis(schema.template lens<Float>(), rt::RayGenerator<Float>(schema), schema.stopIndex,
+        weightedWavelengths(schema), options) {}
+
+    /**
+     * @param field Relative field coordinate along y.
+     * @param frequencies Spatial frequencies in cycles per lens unit.
+     */
+    ModulationTransfer operator()(double field, std::span<const double> frequencies) const {
+        const double fields[] = { field };
+        return std::move((*this)(fields, frequencies).front());
+    }
+
+    /**
+     * Computes the modulation transfer functions of several field points, distributing all field and wavelength
+     * combinations over all cores when parallel is set.
+     */
+    std::vector<ModulationTransfer> operator()(
+        std::span<const double> fields,
+        std::span<const double> frequencies
+    ) const {
+        LORE_PROFILE_SCOPE("MTFAnalysis::compute");
+
+        const int numWavelengths = int(wavelengths.size());
+        const int count = int(fields.size()) * numWavelengths;
+        std::vector<Transfer> transfers(count);
+        auto compute = [&](int i) {
+            const double field = fields[i / numWavelengths];
+            const double wavelength = wavelengths[i % numWavelengths].wavelength;
+            transfers[i] = options.method == DIFFRACTION ?
+                diffraction(field, wavelength, frequencies) :
+                geometric(field, wavelength, frequencies);
+        };
+
+        if (options.parallel) {
+            parallel::parallelFor(0, count, compute);
+        } else {
+            for (int i = 0; i < count; i++) {
+                compute(i);
+            }
+        }
+
+        std::vector<ModulationTransfer> results(fields.size());
+        for (size_t f = 0; f < fields.size(); f++) {
+            results[f] = combine(fields[f], frequencies,
+                std::span<const Transfer>(transfers).subspan(f * numWavelengths, numWavelengths));
+        }
+        return results;
+    }
+
+private:
+    using Complex = std::complex<double>;
+
+    /**
+     * Optical transfer function of one wavelength, normalized to one at zero frequency and referred to center.
+     */
+    struct Transfer {
+        Vector2<double> center;
+        double transmission = 0;
+        std::vector<Complex> sagittal;
+        std::vector<Complex> tangential;
+    };
+
+    template<typename SFloat>
+    static std::vector<WeightedWavelength<double>> weightedWavelengths(const LensSchema<SFloat> &schema) {
+        std::vector<WeightedWavelength<double>> result;
+        for (const auto &weighted : schema.wavelengths) {
+            result.emplace_back(double(weighted.wavelength), double(weighted.weight));
+        }
+        return result;
+    }
+
+    static typename PointSpreadAnalysis<Float>::Options psfOptions(const Options &options) {
+        typename PointSpreadAnalysis<Float>::Options result;
+        result.pupilSamples = options.pupilSamples;
+        result.padding = options.padding;
+        result.parallel = options.parallel;
+        return result;
+    }
+
+    /**
+     * Fourier transform of samples of a distribution at the given positions relative to its reference point.
+     */
+    static std::vector<Complex> transform(
+        std::span<const double> positions,
+        std::span<const double> weights,
+        std::span<const double> frequencies
+    ) {
+        std::vector<Complex> result(frequencies.size());
+        double total = 0;
+        for (const double weight : weights) {
+            total += weight;
+        }
+        if (total <= 0) {
+            return result;
+        }
+
+        for (size_t k = 0; k < frequencies.size(); k++) {
+            Complex sum;
+            for (size_t i = 0; i < positions.size(); i++) {
+                sum += weights[i] * std::polar(1.0, -2 * M_PI * frequencies[k] * positions[i]);
+            }
+            result[k] = sum / total;
+        }
+        return result;
+    }
+
+    Transfer diffraction(double field, double wavelength, std::span<const double> frequencies) const {
+        const Wavefront wavefront =
+            psfs.wavefrontAnalysis()(field, wavelength, options.pupilSamples, options.parallel);
+        const PointSpreadFunction psf = psfs(wavefront);
+
+        // line spread functions, which are the projections of the point spread function onto either axis
+        const int m = psf.size;
+        std::vector<double> positions(m), lineX(m), lineY(m);
+        for (int i = 0; i < m; i++) {
+            positions[i] = psf.spacing * (i - m / 2);
+        }
+        for (int iy = 0; iy < m; iy++) {
+            for (int ix = 0; ix < m; ix++) {
+                lineX[ix] += psf(ix, iy);
+                lineY[iy] += psf(ix, iy);
+            }
+        }
+
+        Transfer result;
+        result.center = psf.center;
+        result.transmission = wavefront.transmission();
+        result.sagittal = transform(positions, lineX, frequencies);
+        result.tangential = transform(positions, lineY, frequencies);
+
+        // the spectra of the sampled line spread functions repeat at multiples of 1 / spacing, and the required
+        // padding of at least two places the diffraction cutoff at or below the Nyquist frequency
+        const double nyquist = 0.5 / psf.spacing;
+        for (size_t k = 0; k < frequencies.size(); k++) {
+            if (std::abs(frequencies[k]) >= nyquist) {
+                result.sagittal[k] = result.tangential[k] = Complex();
+            }
+        }
+        return result;
+    }
+
+    Transfer geometric(double field, double wavelength, std::span<const double> frequencies) const {
+        using Intersector = rt::GeometricalIntersector<Float>;
+        const Intersector intersector {};
+        const WavefrontAnalysis<Float> &setup = psfs.wavefrontAnalysis();
+        const rt::SequentialTrace<Float, Intersector> trace { setup.tracedLens(), intersector, Float(wavelength) };
+        const sampling::PupilSamples<double> samples = options.sampler(options.rays);
+
+        std::vector<double> x, y;
+        x.reserve(samples.size());
+        y.reserve(samples.size());
+        Vector2<double> centroid;
+        for (size_t i = 0; i < samples.size(); i++) {
+            rt::Ray<Float> ray = setup.rayGenerator()(Float(field), Float(samples.x[i]), Float(samples.y[i]));
+            if (trace(ray)) {
+                x.push_back(double(ray.origin.x()));
+                y.push_back(double(ray.origin.y()));
+                centroid += Vector2<double> { x.back(), y.back() };
+            }
+        }
+
+        Transfer result;
+        result.transmission = double(x.size()) / double(samples.size());
+        if (x.empty()) {
+            result.sagittal.resize(frequencies.size());
+            result.tangential.resize(frequencies.size());
+            return result;
+        }
+
+        result.center = centroid / double(x.size());
+        for (size_t i = 0; i < x.size(); i++) {
+            x[i] -= result.center.x();
+            y[i] -= result.center.y();
+        }
+        const std::vector<double> weights(x.size(), 1.0);
+        result.sagittal = transform(x, weights, frequencies);
+        result.tangential = transform(y, weights, frequencies);
+        return result;
+    }
+
+    ModulationTransfer combine(
+        double field,
+        std::span<const double> frequencies,
+        std::span<const Transfer> transfers
+    ) const {
+        ModulationTransfer result;
+        result.field = field;
+        result.frequencies.assign(frequencies.begin(), frequencies.end());
+
+        // the image point of the first wavelength serves as the common reference
+        const Vector2<double> reference = transfers.front().center;
+        std::vector<Complex> sagittal(frequencies.size()), tangential(frequencies.size());
+        double total = 0;
+        for (size_t w = 0; w < transfers.size(); w++) {
+            const Transfer &transfer = transfers[w];
+            const double weight = wavelengths[w].weight * transfer.transmission;
+            const Vector2<double> offset = transfer.center - reference;
+            for (size_t k = 0; k < frequencies.size(); k++) {
+                const double phase = -2 * M_PI * frequencies[k];
+                sagittal[k] += weight * transfer.sagittal[k] * std::polar(1.0, phase * offset.x());
+                tangential[k] += weight * transfer.tangential[k] * std::polar(1.0, phase * offset.y());
+            }
+            total += weight;
+        }
+
+        result.sagittal.resize(frequencies.size());
+        result.tangential.resize(frequencies.size());
+        if (total > 0) {
+            for (size_t k = 0; k < frequencies.size(); k++) {
+                result.sagittal[k] = std::abs(sagittal[k]) / total;
+                result.tangential[k] = std::abs(tangential[k]) / total;
+            }
+        }
+        return result;
+    }
+
+    std::vector<WeightedWavelength<double>> wavelengths;
+    Options options;
+    PointSpreadAnalysis<Float> psfs;
+};
+
+}
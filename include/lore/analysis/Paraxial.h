@@ -1,8 +1,11 @@
 #pragma once
 
 #include <lore/lore.h>
+#include <lore/analysis/ResultCache.h>
 #include <lore/rt/ABCD.h>
 
+#include <vector>
+
 namespace lore {
 
 template<typename Float>
@@ -11,13 +14,30 @@ struct ParaxialAnalysis {
     Float focalShift;
 
     ParaxialAnalysis(const Lens<Float> &lens, Float wavelength)
-    : efl(0), focalShift(0) {
-        const Matrix2x2<Float> rt = abcd::full(lens, wavelength);
-        efl = Float(1) / -rt(1, 0);
-        focalShift = rt(0, 0) / -rt(1, 0);
+    : ParaxialAnalysis(abcd::full(lens, wavelength)) {}
+
+    /**
+     * Analyzes the system matrix of a lens, as computed by abcd::full.
+     */
+    explicit ParaxialAnalysis(const Matrix2x2<Float> &rt)
+    : efl(Float(1) / -rt(1, 0)), focalShift(rt(0, 0) / -rt(1, 0)) {
         // | h/h h/s |
         // | s/h s/s |
     }
+
+    /**
+     * Looks up the analysis in a result cache and only computes it on a miss.
+     */
+    ParaxialAnalysis(const Lens<Float> &lens, Float wavelength, ResultCache &cache)
+    : efl(0), focalShift(0) {
+        const ResultCache::Key key = ResultCache::key(lens, "paraxial/1", { double(wavelength) });
+        const std::vector<double> values = cache.get(key, 2, [&]() {
+            const ParaxialAnalysis analysis(lens, wavelength);
+            return std::vector<double> { double(analysis.efl), double(analysis.focalShift) };
+        });
+        efl = Float(values[0]);
+        focalShift = Float(values[1]);
+    }
 };
 
 }
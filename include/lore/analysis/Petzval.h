@@ -1,8 +1,11 @@
 #pragma once
 
 #include <lore/lore.h>
+#include <lore/analysis/ResultCache.h>
 #include <lore/lens/Lens.h>
 
+#include <vector>
+
 namespace lore {
 
 template<typename Float>
@@ -24,4 +27,16 @@ Float petzvalRadius(const Lens<Float> &lens, Float wavelength) {
     return 1 / petzvalCurvature(lens, wavelength);
 }
 
+/**
+ * Looks up the Petzval radius in a result cache and only computes it on a miss.
+ */
+template<typename Float>
+Float petzvalRadius(const Lens<Float> &lens, Float wavelength, ResultCache &cache) {
+    const ResultCache::Key key = ResultCache::key(lens, "petzval/1", { double(wavelength) });
+    const std::vector<double> values = cache.get(key, 1, [&]() {
+        return std::vector<double> { double(petzvalRadius(lens, wavelength)) };
+    });
+    return Float(values[0]);
+}
+
 }
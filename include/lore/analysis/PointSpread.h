@@ -0,0 +1,200 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/analysis/Wavefront.h>
+#include <lore/fourier/FFT.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/LensSchema.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+#include <lore/rt/RayGenerator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Diffraction point spread function on a square grid in the image plane.
+ */
+struct PointSpreadFunction {
+    /**
+     * Number of samples along each axis. Sample (ix, iy) is at the image position
+     * center + spacing * (ix - size / 2, iy - size / 2) and stored at index iy * size + ix.
+     */
+    int size = 0;
+
+    /**
+     * Distance between neighboring samples in lens units.
+     */
+    double spacing = 0;
+
+    /**
+     * Image point of the chief ray.
+     */
+    Vector2<double> center;
+
+    /**
+     * Wavelength in micrometers.
+     */
+    double wavelength = 0;
+
+    /**
+     * Intensities relative to the peak of an aberration-free pupil of the same transmitted area, such that the
+     * central value approximates the Strehl ratio.
+     */
+    std::vector<double> intensity;
+
+    double operator()(int ix, int iy) const {
+        return intensity[size_t(iy) * size + ix];
+    }
+
+    /**
+     * Intensity at the chief ray image point.
+     */
+    double strehl() const {
+        return (*this)(size / 2, size / 2);
+    }
+
+    double peak() const {
+        return intensity.empty() ? 0 : *std::max_element(intensity.begin(), intensity.end());
+    }
+};
+
+/**
+ * Computes point spread functions as the squared magnitude of the Fourier transform of the pupil function
+ * exp(2 pi i W) of a sampled wavefront W.
+ *
+ * The pupil grid is zero-padded by the padding factor, which sets the sample spacing to
+ * wavelength / (2 NA padding) and the extent of the function to size * spacing. Padding by two samples the
+ * intensity at its Nyquist rate.
+ */
+template<typename Float>
+class PointSpreadAnalysis {
+public:
+    struct Options {
+        /**
+         * Number of pupil samples along each axis.
+         */
+        int pupilSamples = 64;
+
+        int padding = 2;
+
+        /**
+         * Whether wavefronts and transforms are distributed over all cores.
+         */
+        bool parallel = true;
+    };
+
+    PointSpreadAnalysis(const Lens<Float> &lens, const rt::RayGenerator<Float> &generator, int stopIndex)
+    : PointSpreadAnalysis(lens, generator, stopIndex, Options {}) {}
+
+    PointSpreadAnalysis(
+        const Lens<Float> &lens,
+        const rt::RayGenerator<Float> &generator,
+        int stopIndex,
+        const Options &options
+    ) : wavefronts(lens, generator, stopIndex), options(options) {
+        if (options.pupilSamples <= 0 || options.padding < 1) {
+            throw std::invalid_argument("point spread functions require pupil samples and a padding of at least one");
+        }
+    }
+
+    template<typename SFloat>
+    explicit PointSpreadAnalysis(const LensSchema<SFloat> &schema, const Options &options = Options {})
+    : PointSpreadAnalysis(schema.template lens<Float>(), rt::RayGenerator<Float>(schema), schema.stopIndex, options) {}
+
+    /**
+     * @param field Relative field coordinate along y.
+     * @param wavelength Wavelength in micrometers.
+     */
+    PointSpreadFunction operator()(double field, double wavelength) const {
+        return (*this)(wavefronts(field, wavelength, options.pupilSamples, options.parallel));
+    }
+
+    /**
+     * Computes the point spread function of a sampled wavefront.
+     */
+    PointSpreadFunction operator()(const Wavefront &wavefront) const {
+        LORE_PROFILE_SCOPE("PointSpreadAnalysis::compute");
+        using Complex = std::complex<double>;
+
+        const int n = wavefront.size;
+        const int m = n * options.padding;
+        std::vector<Complex> pupil(size_t(m) * m);
+        int valid = 0;
+        for (int iy = 0; iy < n; iy++) {
+            for (int ix = 0; ix < n; ix++) {
+                const double opd = wavefront.opd[size_t(iy) * n + ix];
+                if (!std::isnan(opd)) {
+                    const double phase = 2 * M_PI * opd;
+                    pupil[size_t(iy) * m + ix] = Complex(std::cos(phase), std::sin(phase));
+                    valid++;
+                }
+            }
+        }
+
+        PointSpreadFunction result;
+        result.size = m;
+        result.wavelength = wavefront.wavelength;
+        result.center = wavefront.chief;
+        result.spacing = wavefront.wavelength * WavefrontAnalysis<Float>::MillimetersPerMicrometer /
+            (2 * wavefront.numericalAperture * options.padding);
+        result.intensity.resize(pupil.size());
+        if (valid == 0) {
+            return result;
+        }
+
+        const fourier::FFT2D<double> transform(m, m);
+        transform(pupil, fourier::Direction::FORWARD, options.parallel);
+
+        const double normalization = 1 / sqr(double(valid));
+        for (size_t i = 0; i < pupil.size(); i++) {
+            result.intensity[i] = std::norm(pupil[i]) * normalization;
+        }
+        fourier::fftshift(result.intensity, m, m);
+        return result;
+    }
+
+    /**
+     * Computes the point spread functions of all combinations of fields and wavelengths, stored at
+     * index field * wavelengths.size() + wavelength.
+     */
+    std::vector<PointSpreadFunction> operator()(
+        std::span<const double> fields,
+        std::span<const double> wavelengths
+    ) const {
+        const int count = int(fields.size() * wavelengths.size());
+        std::vector<PointSpreadFunction> results(count);
+        auto compute = [&](int i) {
+            results[i] = (*this)(fields[i / wavelengths.size()], wavelengths[i % wavelengths.size()]);
+        };
+
+        if (options.parallel) {
+            parallel::parallelFor(0, count, compute);
+        } else {
+            for (int i = 0; i < count; i++) {
+                compute(i);
+            }
+        }
+        return results;
+    }
+
+    /**
+     * The analysis that samples the wavefronts of operator()(field, wavelength).
+     */
+    const WavefrontAnalysis<Float> &wavefrontAnalysis() const {
+        return wavefronts;
+    }
+
+private:
+    WavefrontAnalysis<Float> wavefronts;
+    Options options;
+};
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/LensHash.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Thread-safe least-recently-used cache of analysis results, keyed by the content hash of a lens and a hash of the
+ * query (the name of the analysis and its parameters). Since keys are derived from the complete content of a lens,
+ * changing any surface yields a different key and entries never have to be invalidated explicitly; stale entries
+ * are simply evicted once the cache is full.
+ * Results are stored as short vectors of doubles, which analyses convert from and to their own types.
+ */
+class ResultCache {
+public:
+    struct Key {
+        uint64_t lens;
+        uint64_t query;
+
+        bool operator==(const Key &other) const {
+            return lens == other.lens && query == other.query;
+        }
+    };
+
+    struct Statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    static ResultCache shared;
+
+    explicit ResultCache(size_t capacity = 4096);
+
+    ResultCache(const ResultCache &) = delete;
+    ResultCache &operator=(const ResultCache &) = delete;
+
+    /**
+     * Builds the key of an analysis of a lens.
+     * @param analysis Name of the analysis, which should carry a version suffix (e.g. "paraxial/1") that is bumped
+     *                 whenever the analysis changes its results, so that persisted entries are not reused.
+     */
+    template<typename Float>
+    static Key key(const Lens<Float> &lens, std::string_view analysis, std::initializer_list<double> parameters = {}) {
+        return key(contentHash(lens), analysis, parameters);
+    }
+
+    static Key key(uint64_t lensHash, std::string_view analysis, std::initializer_list<double> parameters = {}) {
+        ContentHasher hasher;
+        hasher.add(analysis);
+        for (const double parameter : parameters) {
+            hasher.add(parameter);
+        }
+        return { lensHash, hasher.value() };
+    }
+
+    /**
+     * Looks up a result and marks it as most recently used.
+     */
+    std::optional<std::vector<double>> find(const Key &key);
+
+    /**
+     * Looks up a result with the given number of values. Entries of a different size, e.g. loaded from a file written
+     * by an incompatible version, count as misses.
+     */
+    std::optional<std::vector<double>> find(const Key &key, size_t count);
+
+    /**
+     * Inserts or replaces a result, evicting the least recently used entry if the cache is full.
+     */
+    void insert(const Key &key, std::vector<double> values);
+
+    /**
+     * Returns the cached result of count values for the key, or computes it and replaces the entry.
+     * The computation runs without holding the lock, so concurrent misses of the same key may compute it twice.
+     */
+    template<typename Compute>
+    std::vector<double> get(const Key &key, size_t count, Compute &&compute) {
+        if (auto values = find(key, count)) {
+            return std::move(*values);
+        }
+
+        std::vector<double> values = compute();
+        insert(key, values);
+        return values;
+    }
+
+    void clear();
+
+    size_t size() const;
+
+    size_t capacity() const;
+
+    /**
+     * Changes the maximum number of entries, evicting the least recently used entries if necessary.
+     */
+    void setCapacity(size_t capacity);
+
+    Statistics statistics() const;
+
+    /**
+     * Writes all entries to a file, from least to most recently used. The file is replaced atomically.
+     * @return Whether the file could be written.
+     */
+    bool save(const std::string &path) const;
+
+    /**
+     * Inserts all entries of a file written by save(). Missing, foreign or corrupt files are ignored with a warning,
+     * so a cache file never has to be trusted.
+     * @return The number of entries that were loaded.
+     */
+    size_t load(const std::string &path);
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return size_t(key.lens ^ (key.query * 0x9e3779b97f4a7c15ull));
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<double> values;
+    };
+
+    std::optional<std::vector<double>> findLocked(const Key &key, std::optional<size_t> count);
+    void insertLocked(const Key &key, std::vector<double> values);
+    void evictLocked();
+
+    mutable std::mutex mutex;
+    size_t maxEntries;
+    Statistics counters;
+
+    /**
+     * Entries from most to least recently used.
+     */
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+};
+
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Lens.h>
+#include <lore/optim/FADFloat.h>
+#include <lore/optim/MeritFunction.h>
+#include <lore/optim/SparseFADFloat.h>
+#include <lore/profiling/Profiler.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lore {
+
+/**
+ * A scalar design parameter of a lens.
+ */
+struct LensParameter {
+    enum Type {
+        RADIUS,
+        THICKNESS,
+        /// Refractive index of the material following the surface at the primary wavelength.
+        INDEX,
+    };
+
+    Type type;
+    int surface;
+
+    /**
+     * Adds delta to this parameter of the given lens.
+     */
+    template<typename Float>
+    void apply(Lens<Float> &lens, Float delta, Float wavelength) const {
+        Surface<Float> &target = lens.surfaces[surface];
+        switch (type) {
+            case RADIUS:
+                target.radius += delta;
+                break;
+            case THICKNESS:
+                target.thickness += delta;
+                break;
+            case INDEX:
+                target.glass = target.glass.withIndexOffset(delta, wavelength);
+                break;
+        }
+    }
+
+    /**
+     * Lists all curved radii, the thicknesses between the first and the image surface, and the indices of all
+     * non-air materials of a lens.
+     */
+    template<typename Float>
+    static std::vector<LensParameter> enumerate(const Lens<Float> &lens) {
+        std::vector<LensParameter> result;
+        for (int i = 1; i + 1 < int(lens.surfaces.size()); i++) {
+            const Surface<Float> &surface = lens.surfaces[i];
+            if (!surface.isFlat()) {
+                result.push_back({ RADIUS, i });
+            }
+            result.push_back({ THICKNESS, i });
+            if (!surface.glass.isAir()) {
+                result.push_back({ INDEX, i });
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * First-order derivatives of every operand of a merit program (and of the total merit) with respect to a list of
+ * lens parameters.
+ */
+struct SensitivityTable {
+    std::vector<LensParameter> parameters;
+
+    /**
+     * Nominal operand values.
+     */
+    std::vector<double> values;
+
+    /**
+     * Row-major matrix of d(operand) / d(parameter).
+     */
+    std::vector<double> derivatives;
+
+    /**
+     * d(merit) / d(parameter).
+     */
+    std::vector<double> merit;
+
+    int numOperands() const {
+        return int(values.size());
+    }
+
+    int numParameters() const {
+        return int(parameters.size());
+    }
+
+    double operator()(int operand, int parameter) const {
+        return derivatives[operand * numParameters() + parameter];
+    }
+};
+
+/**
+ * Computes sensitivity tables by forward-mode differentiation.
+ * Parameters are seeded into the derivative lanes of FADFloat<double, Width> in chunks of Width, so every ray of the
+ * merit program is traced once per chunk (in parallel) instead of twice per parameter as with finite differences.
+ */
+template<int Width = 8>
+struct SensitivityAnalysis {
+    using FAD = optim::FADFloat<double, Width>;
+
+    const Lens<double> &lens;
+    const optim::MeritProgram &program;
+
+    SensitivityAnalysis(const Lens<double> &lens, const optim::MeritProgram &program)
+    : lens(lens), program(program) {}
+
+    SensitivityTable compute(const std::vector<LensParameter> &parameters) const {
+        LORE_PROFILE_SCOPE("SensitivityAnalysis::compute");
+        validate(parameters);
+
+        SensitivityTable table = allocate(parameters);
+        const int numOperands = table.numOperands();
+        const int numParameters = table.numParameters();
+        const FAD wavelength = FAD(program.wavelengths.front());
+
+        optim::MeritProgram::Workspace<FAD> workspace;
+        optim::MeritResult<FAD> result;
+        for (int chunk = 0; chunk < numParameters; chunk += Width) {
+            Lens<FAD> seeded = lens.template cast<FAD>();
+            const int chunkSize = std::min(Width, numParameters - chunk);
+            for (int lane = 0; lane < chunkSize; lane++) {
+                FAD delta = FAD(0);
+                delta.dVd(lane) = 1;
+                parameters[chunk + lane].apply(seeded, delta, wavelength);
+            }
+
+            program.evaluate(seeded, workspace, result);
+
+            for (int lane = 0; lane < chunkSize; lane++) {
+                for (int operand = 0; operand < numOperands; operand++) {
+                    table.derivatives[operand * numParameters + chunk + lane] = result.values[operand].dVd(lane);
+                }
+                table.merit[chunk + lane] = result.merit.dVd(lane);
+            }
+
+            if (chunk == 0) {
+                for (int operand = 0; operand < numOperands; operand++) {
+                    table.values[operand] = result.values[operand].V;
+                }
+            }
+        }
+
+        if (numParameters == 0) {
+            const auto nominal = program.evaluate(lens);
+            table.values = nominal.values;
+        }
+
+        return table;
+    }
+
+    /**
+     * Computes the table in a single sequential evaluation with SparseFADFloat, where parameter i is seeded into
+     * derivative i. Rays only carry derivatives of the surfaces they have already passed, so listing the parameters in
+     * surface order (as enumerate does) keeps the gradients short.
+     */
+    SensitivityTable computeSparse(const std::vector<LensParameter> &parameters) const {
+        LORE_PROFILE_SCOPE("SensitivityAnalysis::computeSparse");
+        using Sparse = optim::SparseFADFloat<double>;
+        validate(parameters);
+
+        SensitivityTable table = allocate(parameters);
+        const int numOperands = table.numOperands();
+        const int numParameters = table.numParameters();
+
+        const optim::SparseFADScope<double> scope;
+        const Sparse wavelength = Sparse(program.wavelengths.front());
+        Lens<Sparse> seeded = lens.template cast<Sparse>();
+        for (int parameter = 0; parameter < numParameters; parameter++) {
+            parameters[parameter].apply(seeded, Sparse::variable(0, parameter), wavelength);
+        }
+
+        const optim::MeritResult<Sparse> result = program.evaluate(seeded);
+        for (int operand = 0; operand < numOperands; operand++) {
+            table.values[operand] = result.values[operand].V;
+            for (int parameter = 0; parameter < numParameters; parameter++) {
+                table.derivatives[operand * numParameters + parameter] = result.values[operand].dVd(parameter);
+            }
+        }
+        for (int parameter = 0; parameter < numParameters; parameter++) {
+            table.merit[parameter] = result.merit.dVd(parameter);
+        }
+
+        return table;
+    }
+
+    /**
+     * Reference implementation using central finite differences with step size h.
+     */
+    SensitivityTable centralDifferences(const std::vector<LensParameter> &parameters, double h = 1e-5) const {
+        LORE_PROFILE_SCOPE("SensitivityAnalysis::centralDifferences");
+        validate(parameters);
+
+        SensitivityTable table = allocate(parameters);
+        const int numOperands = table.numOperands();
+        const int numParameters = table.numParameters();
+        const double wavelength = program.wavelengths.front();
+
+        table.values = program.evaluate(lens).values;
+
+        Lens<double> perturbed = lens;
+        optim::MeritProgram::Workspace<double> workspace;
+        optim::MeritResult<double> plus, minus;
+        for (int parameter = 0; parameter < numParameters; parameter++) {
+            perturbed.surfaces = lens.surfaces;
+            parameters[parameter].apply(perturbed, +h, wavelength);
+            program.evaluate(perturbed, workspace, plus);
+
+            perturbed.surfaces = lens.surfaces;
+            parameters[parameter].apply(perturbed, -h, wavelength);
+            program.evaluate(perturbed, workspace, minus);
+
+            for (int operand = 0; operand < numOperands; operand++) {
+                table.derivatives[operand * numParameters + parameter] =
+                    (plus.values[operand] - minus.values[operand]) / (2 * h);
+            }
+            table.merit[parameter] = (plus.merit - minus.merit) / (2 * h);
+        }
+
+        return table;
+    }
+
+private:
+    void validate(const std::vector<LensParameter> &parameters) const {
+        for (const LensParameter &parameter : parameters) {
+            if (parameter.surface < 1 || parameter.surface >= int(lens.surfaces.size())) {
+                throw std::invalid_argument("parameter references unknown surface " + std::to_string(parameter.surface));
+            }
+        }
+    }
+
+    SensitivityTable allocate(const std::vector<LensParameter> &parameters) const {
+        SensitivityTable table;
+        table.parameters = parameters;
+        table.values.resize(program.instructions.size());
+        table.derivatives.resize(program.instructions.size() * parameters.size());
+        table.merit.resize(parameters.size());
+        return table;
+    }
+};
+
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/analysis/Statistics.h>
+#include <lore/lens/Lens.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/Ray.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/sampling/PupilSampler.h>
+#include <lore/sampling/Random.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace lore {
+
+/**
+ * RMS spot radius of one field point together with the uncertainty of the estimate.
+ */
+struct SpotEstimate {
+    /**
+     * RMS radius of the spot about its centroid.
+     */
+    double rms = 0;
+
+    /**
+     * Half width of the confidence interval of rms.
+     */
+    double halfWidth = std::numeric_limits<double>::infinity();
+
+    Vector2<double> centroid;
+
+    /**
+     * Fraction of the entrance pupil whose rays pass all checked apertures.
+     */
+    double transmission = 0;
+
+    int rays = 0;
+    int strata = 0;
+
+    /**
+     * Whether the requested confidence interval was reached before the ray budget was exhausted.
+     */
+    bool converged = false;
+};
+
+/**
+ * Estimates RMS spot radii by tracing rays in batches until the confidence interval of the estimate is narrow enough,
+ * so that well-corrected field points stop after a few hundred rays while difficult ones receive more.
+ *
+ * The entrance pupil is divided into equal-area polar strata, each sampled with its own Owen-scrambled Sobol
+ * sequence. The spot variance is estimated from the stratified means of the hit coordinates of unvignetted rays,
+ * and its uncertainty from the per-stratum variance of its linearization (delta method). Every batch is allocated
+ * greedily to the strata where one more ray reduces the variance of the estimate the most (Neyman allocation), and
+ * strata that contain both vignetted and unvignetted rays are split into four, which concentrates rays along the
+ * boundaries of checked apertures.
+ */
+template<typename Float>
+class AdaptiveSpotEstimator {
+public:
+    struct Options {
+        /**
+         * Target half width of the confidence interval relative to the RMS radius.
+         */
+        double relativeTolerance = 0.01;
+
+        /**
+         * Target half width of the confidence interval in lens units, which ends the estimation of nearly perfect
+         * spots whose relative tolerance cannot be reached.
+         */
+        double absoluteTolerance = 0;
+
+        /**
+         * Probability that the true RMS radius lies within the confidence interval.
+         */
+        double confidence = 0.95;
+
+        int radialStrata = 4;
+        int angularStrata = 8;
+
+        /**
+         * Rays traced in every stratum before adapting, which must be at least two to estimate variances.
+         */
+        int initialSamples = 4;
+
+        int batchSize = 64;
+        int maxRays = 1 << 16;
+
+        /**
+         * Number of times a stratum on a vignetting boundary can be split.
+         */
+        int maxRefinements = 4;
+
+        uint64_t seed = 0;
+    };
+
+    AdaptiveSpotEstimator(
+        const Lens<Float> &lens,
+        const rt::RayGenerator<Float> &generator,
+        Float wavelength,
+        const Options &options = Options {}
+    ) : lens(lens), generator(generator), wavelength(wavelength), options(options),
+        quantile(normalQuantile(options.confidence)) {
+        if (options.radialStrata <= 0 || options.angularStrata <= 0) {
+            throw std::invalid_argument("spot estimation requires at least one stratum");
+        }
+        if (options.initialSamples < 2) {
+            throw std::invalid_argument("spot estimation requires at least two initial samples per stratum");
+        }
+    }
+
+    /**
+     * @param field Relative field coordinate along y.
+     */
+    SpotEstimate operator()(double field) const {
+        LORE_PROFILE_SCOPE("AdaptiveSpotEstimator::estimate");
+        using Intersector = rt::GeometricalIntersector<Float>;
+
+        const Intersector intersector {};
+        const rt::SequentialTrace<Float, Intersector> trace { lens, intersector, wavelength };
+
+        int rays = 0;
+        uint64_t nextId = 0;
+        auto makeStratum = [&](double r2Begin, double r2End, double turnsBegin, double turnsEnd, int depth) {
+            const sampling::Philox::Counter seed = sampling::Philox(options.seed).block(nextId++, 0);
+            return Stratum {
+                r2Begin, r2End, turnsBegin, turnsEnd, depth, 0,
+                sampling::SobolSequence(uint64_t(seed[0]) | uint64_t(seed[1]) << 32), {}
+            };
+        };
+        auto sample = [&](Stratum &stratum, int count) {
+            for (int i = 0; i < count; i++) {
+                const Vector2<double> u = stratum.sequence(stratum.next++);
+                const double r2 = stratum.r2Begin + u.x() * (stratum.r2End - stratum.r2Begin);
+                const double turns = stratum.turnsBegin + u.y() * (stratum.turnsEnd - stratum.turnsBegin);
+                const Vector2<double> pupil = polar(turns, std::sqrt(r2));
+
+                rt::Ray<Float> ray = generator(Float(field), Float(pupil.x()), Float(pupil.y()));
+                const bool valid = trace(ray);
+                stratum.samples.push_back({ r2, turns, double(ray.origin.x()), double(ray.origin.y()), valid });
+            }
+            rays += count;
+        };
+
+        std::vector<Stratum> strata;
+        strata.reserve(size_t(options.radialStrata) * options.angularStrata);
+        for (int i = 0; i < options.radialStrata; i++) {
+            for (int j = 0; j < options.angularStrata; j++) {
+                strata.push_back(makeStratum(
+                    double(i) / options.radialStrata, double(i + 1) / options.radialStrata,
+                    double(j) / options.angularStrata, double(j + 1) / options.angularStrata, 0
+                ));
+                sample(strata.back(), options.initialSamples);
+            }
+        }
+
+        while (true) {
+            SpotEstimate estimate = evaluate(strata);
+            estimate.rays = rays;
+            estimate.strata = int(strata.size());
+            if (estimate.converged || rays >= options.maxRays) {
+                return estimate;
+            }
+
+            refine(strata, options.maxRays - rays, makeStratum, sample);
+            if (rays < options.maxRays) {
+                allocate(strata, std::min(options.batchSize, options.maxRays - rays), sample);
+            }
+        }
+    }
+
+    /**
+     * Estimates the spots of several field points, distributing them over all cores when parallel is set.
+     */
+    std::vector<SpotEstimate> operator()(std::span<const double> fields, bool parallel = true) const {
+        std::vector<SpotEstimate> results(fields.size());
+        auto estimate = [&](int i) {
+            results[i] = (*this)(fields[i]);
+        };
+
+        if (parallel) {
+            parallel::parallelFor(0, int(fields.size()), estimate);
+        } else {
+            for (int i = 0; i < int(fields.size()); i++) {
+                estimate(i);
+            }
+        }
+        return results;
+    }
+
+private:
+    /**
+     * Weight of the pooled variance in the variance of every stratum, in samples.
+     */
+    static constexpr double PriorSamples = 2;
+
+    struct Sample {
+        double r2;
+        double turns;
+        double x;
+        double y;
+        bool valid;
+    };
+
+    /**
+     * Polar cell of the unit pupil, spanning a range of squared radii and a range of angles in turns.
+     */
+    struct Stratum {
+        double r2Begin, r2End;
+        double turnsBegin, turnsEnd;
+        int depth;
+        uint32_t next;
+        sampling::SobolSequence sequence;
+        std::vector<Sample> samples;
+
+        /**
+         * Sample variance of the linearized spot variance, as computed by evaluate().
+         */
+        double variance = 0;
+
+        double area() const {
+            return (r2End - r2Begin) * (turnsEnd - turnsBegin);
+        }
+    };
+
+    /**
+     * Computes the stratified estimate and the per-stratum variances of its linearization.
+     * With s = mean(v r^2) / mean(v) - |mean(v h) / mean(v)|^2 for the hit h of a ray and v = 1 for unvignetted rays,
+     * the linearization of s in the contribution of a ray is v / mean(v) * (|h - centroid|^2 - s).
+     */
+    SpotEstimate evaluate(std::vector<Stratum> &strata) const {
+        double t = 0, sumX = 0, sumY = 0, sumR2 = 0;
+        for (const Stratum &stratum : strata) {
+            double st = 0, sx = 0, sy = 0, sr2 = 0;
+            for (const Sample &s : stratum.samples) {
+                if (s.valid) {
+                    st += 1;
+                    sx += s.x;
+                    sy += s.y;
+                    sr2 += sqr(s.x) + sqr(s.y);
+                }
+            }
+            const double weight = stratum.area() / double(stratum.samples.size());
+            t += weight * st;
+            sumX += weight * sx;
+            sumY += weight * sy;
+            sumR2 += weight * sr2;
+        }
+
+        SpotEstimate result;
+        result.transmission = t;
+        if (t == 0) {
+            // everything is vignetted, which no number of rays in these strata will change
+            result.halfWidth = 0;
+            result.converged = true;
+            return result;
+        }
+
+        result.centroid = { sumX / t, sumY / t };
+        const double spotVariance = std::max(0.0, sumR2 / t - sqr(result.centroid.x()) - sqr(result.centroid.y()));
+        result.rms = std::sqrt(spotVariance);
+
+        double pooledVariance = 0;
+        for (Stratum &stratum : strata) {
+            RunningStatistics linearized;
+            for (const Sample &s : stratum.samples) {
+                const double r2 = sqr(s.x - result.centroid.x()) + sqr(s.y - result.centroid.y());
+                linearized.add(s.valid ? (r2 - spotVariance) / t : 0);
+            }
+            stratum.variance = linearized.variance();
+            pooledVariance += stratum.area() * stratum.variance;
+        }
+
+        // A stratum whose few rays all happen to be vignetted (or all pass) shows no variance and would never be
+        // sampled again, although a vignetting boundary may cross it. Shrinking towards the pooled variance keeps
+        // such strata sampled and the confidence interval honest.
+        double estimateVariance = 0;
+        for (Stratum &stratum : strata) {
+            const double n = double(stratum.samples.size());
+            stratum.variance = (n * stratum.variance + PriorSamples * pooledVariance) / (n + PriorSamples);
+            estimateVariance += sqr(stratum.area()) * stratum.variance / n;
+        }
+
+        // delta method once more for the square root
+        if (result.rms > 0) {
+            result.halfWidth = quantile * std::sqrt(estimateVariance) / (2 * result.rms);
+        } else {
+            result.halfWidth = 0;
+        }
+        result.converged = result.halfWidth <= std::max(options.absoluteTolerance, options.relativeTolerance * result.rms);
+        return result;
+    }
+
+    /**
+     * Splits strata that contain both vignetted and unvignetted rays into four, tracing additional rays in children
+     * with fewer than the initial number of samples as long as the budget allows.
+     */
+    template<typename MakeStratum, typename SampleStratum>
+    void refine(std::vector<Stratum> &strata, int budget, MakeStratum &makeStratum, SampleStratum &sample) const {
+        const size_t numStrata = strata.size();
+        for (size_t i = 0; i < numStrata; i++) {
+            const Stratum &stratum = strata[i];
+            if (stratum.depth >= options.maxRefinements || budget < 4 * options.initialSamples) {
+                continue;
+            }
+
+            const auto valid = std::count_if(stratum.samples.begin(), stratum.samples.end(), [](const Sample &s) {
+                return s.valid;
+            });
+            if (valid == 0 || valid == std::ptrdiff_t(stratum.samples.size())) {
+                continue;
+            }
+
+            const double r2Mid = 0.5 * (stratum.r2Begin + stratum.r2End);
+            const double turnsMid = 0.5 * (stratum.turnsBegin + stratum.turnsEnd);
+            Stratum children[] = {
+                makeStratum(stratum.r2Begin, r2Mid, stratum.turnsBegin, turnsMid, stratum.depth + 1),
+                makeStratum(stratum.r2Begin, r2Mid, turnsMid, stratum.turnsEnd, stratum.depth + 1),
+                makeStratum(r2Mid, stratum.r2End, stratum.turnsBegin, turnsMid, stratum.depth + 1),
+                makeStratum(r2Mid, stratum.r2End, turnsMid, stratum.turnsEnd, stratum.depth + 1),
+            };
+            for (const Sample &s : stratum.samples) {
+                children[(s.r2 >= r2Mid ? 2 : 0) + (s.turns >= turnsMid ? 1 : 0)].samples.push_back(s);
+            }
+            for (Stratum &child : children) {
+                const int missing = std::max(0, options.initialSamples - int(child.samples.size()));
+                sample(child, missing);
+                budget -= missing;
+            }
+
+            strata[i] = std::move(children[0]);
+            for (int c = 1; c < 4; c++) {
+                strata.push_back(std::move(children[c]));
+            }
+        }
+    }
+
+    /**
+     * Distributes count rays one at a time to the stratum whose contribution to the variance of the estimate is
+     * reduced the most by one more ray.
+     */
+    template<typename SampleStratum>
+    void allocate(std::vector<Stratum> &strata, int count, SampleStratum &sample) const {
+        auto reduction = [&](size_t i, int additional) {
+            const double n = double(strata[i].samples.size() + additional);
+            return sqr(strata[i].area()) * strata[i].variance / (n * (n + 1));
+        };
+
+        std::vector<int> additional(strata.size(), 0);
+        std::priority_queue<std::pair<double, size_t>> queue;
+        for (size_t i = 0; i < strata.size(); i++) {
+            queue.push({ reduction(i, 0), i });
+        }
+        for (int k = 0; k < count; k++) {
+            const size_t i = queue.top().second;
+            queue.pop();
+            additional[i]++;
+            queue.push({ reduction(i, additional[i]), i });
+        }
+
+        for (size_t i = 0; i < strata.size(); i++) {
+            if (additional[i] > 0) {
+                sample(strata[i], additional[i]);
+            }
+        }
+    }
+
+    /**
+     * Two-sided quantile of the standard normal distribution for the given confidence level.
+     */
+    static double normalQuantile(double confidence) {
+        if (!(confidence > 0 && confidence < 1)) {
+            throw std::invalid_argument("confidence must be in (0, 1)");
+        }
+
+        double low = 0, high = 40;
+        for (int i = 0; i < 100; i++) {
+            const double mid = 0.5 * (low + high);
+            (std::erf(mid / std::sqrt(2.0)) < confidence ? low : high) = mid;
+        }
+        return 0.5 * (low + high);
+    }
+
+    Lens<Float> lens;
+    rt::RayGenerator<Float> generator;
+    Float wavelength;
+    Options options;
+    double quantile;
+};
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <lore/lore.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+
+namespace lore {
+
+/**
+ * Streaming mean, variance and range using Welford's algorithm.
+ * Partial results from different threads can be combined with merge().
+ */
+struct RunningStatistics {
+    uint64_t count = 0;
+    double mean = 0;
+    double m2 = 0;
+    double min = +std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void add(double value) {
+        count++;
+        const double delta = value - mean;
+        mean += delta / double(count);
+        m2 += delta * (value - mean);
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void merge(const RunningStatistics &other) {
+        if (other.count == 0) {
+            return;
+        }
+
+        const uint64_t total = count + other.count;
+        const double delta = other.mean - mean;
+        mean += delta * double(other.count) / double(total);
+        m2 += other.m2 + delta * delta * double(count) * double(other.count) / double(total);
+        count = total;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    double variance() const {
+        return count > 1 ? m2 / double(count - 1) : 0;
+    }
+
+    double stddev() const {
+        return std::sqrt(variance());
+    }
+};
+
+/**
+ * Mergeable histogram with logarithmically spaced buckets, used to estimate quantiles of a stream without storing
+ * its samples. Every bucket spans a relative width of 1 / SubBuckets, which bounds the relative error of quantiles.
+ */
+struct QuantileSketch {
+    static constexpr int SubBuckets = 128;
+
+    uint64_t count = 0;
+    double min = +std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    std::map<int64_t, uint64_t> buckets;
+
+    void add(double value) {
+        count++;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        buckets[bucket(value)]++;
+    }
+
+    void merge(const QuantileSketch &other) {
+        count += other.count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        for (const auto &[key, bucketCount] : other.buckets) {
+            buckets[key] += bucketCount;
+        }
+    }
+
+    /**
+     * Returns an estimate of the q-quantile for q in [0, 1].
+     */
+    double quantile(double q) const {
+        if (count == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        const uint64_t rank = uint64_t(std::round(q * double(count - 1)));
+        uint64_t seen = 0;
+        for (const auto &[key, bucketCount] : buckets) {
+            seen += bucketCount;
+            if (seen > rank) {
+                return std::min(max, std::max(min, representative(key)));
+            }
+        }
+        return max;
+    }
+
+private:
+    static constexpr int ExponentBias = 1100;
+
+    static int64_t bucket(double value) {
+        if (value == 0 || std::isnan(value)) {
+            return 0;
+        }
+
+        int exponent;
+        const double mantissa = std::frexp(std::abs(value), &exponent);
+        const int64_t sub = std::min(SubBuckets - 1, int((mantissa - 0.5) * 2 * SubBuckets));
+        const int64_t key = (int64_t(exponent) + ExponentBias) * SubBuckets + sub;
+        return value > 0 ? key : -key;
+    }
+
+    static double representative(int64_t key) {
+        if (key == 0) {
+            return 0;
+        }
+
+        const int64_t magnitude = key > 0 ? key : -key;
+        const int exponent = int(magnitude / SubBuckets) - ExponentBias;
+        const double mantissa = 0.5 + (double(magnitude % SubBuckets) + 0.5) / (2 * SubBuckets);
+        const double value = std::ldexp(mantissa, exponent);
+        return key > 0 ? value : -value;
+    }
+};
+
+/**
+ * Moments and quantile estimates of a stream of samples.
+ */
+struct SampleStatistics {
+    RunningStatistics moments;
+    QuantileSketch distribution;
+
+    void add(double value) {
+        moments.add(value);
+        distribution.add(value);
+    }
+
+    void merge(const SampleStatistics &other) {
+        moments.merge(other.moments);
+        distribution.merge(other.distribution);
+    }
+
+    /**
+     * @param p Percentile in [0, 100].
+     */
+    double percentile(double p) const {
+        return distribution.quantile(p / 100);
+    }
+};
+
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Lens.h>
+#include <lore/analysis/Statistics.h>
+#include <lore/optim/MeritFunction.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+#include <lore/sampling/Random.h>
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Manufacturing tolerance of a single lens parameter.
+ */
+struct Tolerance {
+    enum Parameter {
+        /// Absolute change of the radius of curvature. Flat surfaces are left unchanged.
+        RADIUS,
+        /// Absolute change of the axial thickness following the surface.
+        THICKNESS,
+        /// Change of the refractive index of the material following the surface at the primary wavelength.
+        INDEX,
+    };
+
+    enum Distribution {
+        /// Uniformly distributed in [-limit, +limit].
+        UNIFORM,
+        /// Normally distributed with a standard deviation of limit / 2, truncated to [-limit, +limit].
+        GAUSSIAN,
+    };
+
+    Parameter parameter;
+    int surface;
+    double limit;
+    Distribution distribution = UNIFORM;
+
+    static Tolerance radius(int surface, double limit, Distribution distribution = UNIFORM) {
+        return { RADIUS, surface, limit, distribution };
+    }
+
+    static Tolerance thickness(int surface, double limit, Distribution distribution = UNIFORM) {
+        return { THICKNESS, surface, limit, distribution };
+    }
+
+    static Tolerance index(int surface, double limit, Distribution distribution = UNIFORM) {
+        return { INDEX, surface, limit, distribution };
+    }
+
+    double sample(const sampling::Philox &rng, uint64_t sample, uint32_t dimension) const {
+        switch (distribution) {
+            case UNIFORM:
+                return (2 * rng.uniform(sample, dimension) - 1) * limit;
+            case GAUSSIAN: {
+                const double value = rng.normal(sample, dimension) * limit / 2;
+                return std::min(limit, std::max(-limit, value));
+            }
+        }
+        return 0;
+    }
+};
+
+struct ToleranceResult {
+    uint64_t samples = 0;
+
+    /**
+     * Number of samples whose merit did not exceed the acceptance threshold.
+     */
+    uint64_t passed = 0;
+
+    SampleStatistics merit;
+
+    /**
+     * Statistics of every operand of the merit program.
+     */
+    std::vector<SampleStatistics> operands;
+
+    /**
+     * Number of vignetted or failed rays per sample.
+     */
+    RunningStatistics failedRays;
+
+    double yield() const {
+        return samples > 0 ? double(passed) / double(samples) : 0;
+    }
+
+    void merge(const ToleranceResult &other) {
+        samples += other.samples;
+        passed += other.passed;
+        merit.merge(other.merit);
+        operands.resize(std::max(operands.size(), other.operands.size()));
+        for (size_t i = 0; i < other.operands.size(); i++) {
+            operands[i].merge(other.operands[i]);
+        }
+        failedRays.merge(other.failedRays);
+    }
+};
+
+/**
+ * Monte Carlo tolerance analysis of a nominal lens against a compiled merit program.
+ * Sample i is always perturbed with the same random numbers (derived from the seed, the sample index and the
+ * tolerance index), and partial statistics are merged in a fixed order, so results are independent of the number of
+ * threads.
+ */
+template<typename Float>
+struct MonteCarloTolerancing {
+    struct Options {
+        uint64_t samples = 1000;
+        uint64_t seed = 0;
+
+        /**
+         * Samples with a merit above this threshold count as failed for the yield.
+         */
+        double maximumMerit = std::numeric_limits<double>::infinity();
+
+        /**
+         * Number of consecutive samples evaluated with the same scratch buffers.
+         */
+        int blockSize = 64;
+    };
+
+    const Lens<Float> &nominal;
+    const optim::MeritProgram &program;
+    std::vector<Tolerance> tolerances;
+
+    MonteCarloTolerancing(
+        const Lens<Float> &nominal,
+        const optim::MeritProgram &program,
+        const std::vector<Tolerance> &tolerances
+    ) : nominal(nominal), program(program), tolerances(tolerances) {
+        for (const Tolerance &tolerance : tolerances) {
+            if (tolerance.surface < 1 || tolerance.surface >= int(nominal.surfaces.size())) {
+                throw std::invalid_argument("tolerance references unknown surface " + std::to_string(tolerance.surface));
+            }
+        }
+    }
+
+    /**
+     * Overwrites lens with the nominal design perturbed for the given sample.
+     * The lens must have the same number of surfaces as the nominal lens, so that no memory is reallocated.
+     */
+    void perturb(const sampling::Philox &rng, uint64_t sample, Lens<Float> &lens) const {
+        for (size_t i = 0; i < nominal.surfaces.size(); i++) {
+            lens.surfaces[i] = nominal.surfaces[i];
+        }
+
+        const Float wavelength = Float(program.wavelengths.front());
+        for (size_t i = 0; i < tolerances.size(); i++) {
+            const Tolerance &tolerance = tolerances[i];
+            const Float delta = Float(tolerance.sample(rng, sample, uint32_t(i)));
+
+            Surface<Float> &surface = lens.surfaces[tolerance.surface];
+            switch (tolerance.parameter) {
+                case Tolerance::RADIUS:
+                    if (!surface.isFlat()) {
+                        surface.radius += delta;
+                    }
+                    break;
+                case Tolerance::THICKNESS:
+                    surface.thickness += delta;
+                    break;
+                case Tolerance::INDEX:
+                    surface.glass = surface.glass.withIndexOffset(delta, wavelength);
+                    break;
+            }
+        }
+    }
+
+    ToleranceResult run(const Options &options) const {
+        LORE_PROFILE_SCOPE("MonteCarloTolerancing::run");
+        const sampling::Philox rng { options.seed };
+        const int blockSize = std::max(1, options.blockSize);
+        const int numBlocks = int((options.samples + blockSize - 1) / blockSize);
+        const int numOperands = int(program.instructions.size());
+
+        std::vector<ToleranceResult> partial(numBlocks);
+        parallel::parallelFor(0, numBlocks, [&](int block) {
+            Lens<Float> lens = nominal;
+            optim::MeritProgram::Workspace<Float> workspace;
+            optim::MeritResult<Float> evaluation;
+
+            ToleranceResult &result = partial[block];
+            result.operands.resize(numOperands);
+
+            const uint64_t begin = uint64_t(block) * blockSize;
+            const uint64_t end = std::min(options.samples, begin + blockSize);
+            for (uint64_t sample = begin; sample < end; sample++) {
+                perturb(rng, sample, lens);
+                program.evaluate(lens, workspace, evaluation, false);
+
+                const double merit = double(detach(evaluation.merit));
+                result.samples++;
+                if (merit <= options.maximumMerit) {
+                    result.passed++;
+                }
+                result.merit.add(merit);
+                for (int i = 0; i < numOperands; i++) {
+                    result.operands[i].add(double(detach(evaluation.values[i])));
+                }
+                result.failedRays.add(evaluation.failedRays);
+            }
+        });
+
+        ToleranceResult result;
+        result.operands.resize(numOperands);
+        for (const ToleranceResult &block : partial) {
+            result.merge(block);
+        }
+        return result;
+    }
+};
+
+}
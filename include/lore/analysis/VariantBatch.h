@@ -0,0 +1,361 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/analysis/Paraxial.h>
+#include <lore/analysis/Sensitivity.h>
+#include <lore/lens/Lens.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+#include <lore/rt/ABCD.h>
+#include <lore/rt/Ray.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/rt/TraceStatistics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Many variants of one base lens that differ only in a few radii and thicknesses, as evaluated in design-space
+ * sweeps. The base lens is stored once and the deltas of each parameter are stored in one contiguous array indexed
+ * by variant (structure of arrays), so that a variant costs one Float per parameter instead of a full Lens.
+ *
+ * The evaluators process Lanes consecutive variants at a time, tracing the same ray through all of them in lockstep
+ * (variant-coherent rather than ray-coherent). Everything that does not depend on the variant, such as refractive
+ * indices, apertures and the rays entering the lens, is computed once per batch, while the radii and thicknesses of
+ * a chunk are only loaded once for all of its rays. The lanes are advanced together by abcd::MatrixLanes and
+ * rt::RayLanes, whose branch-free loops over lanes are vectorized. Chunks of variants are distributed over all cores.
+ * Results match evaluating each variant() separately with ParaxialAnalysis and the SPOT_RMS operand of a
+ * MeritProgram.
+ */
+template<typename Float>
+class VariantBatch {
+public:
+    static_assert(std::is_floating_point_v<Float>, "variants are evaluated in plain floating point");
+
+    /**
+     * Number of variants evaluated together, which fills a 256-bit vector register.
+     */
+    static constexpr int Lanes = int(32 / sizeof(Float));
+
+    struct ParaxialResults {
+        std::vector<Float> efl;
+        std::vector<Float> focalShift;
+    };
+
+    /**
+     * @param parameters Radii and thicknesses that vary between variants. Index parameters are not supported, as
+     *                   they would make the refractive indices differ between lanes.
+     */
+    VariantBatch(const Lens<Float> &base, std::vector<LensParameter> parameters)
+    : baseLens(base), variedParameters(std::move(parameters)), columns(variedParameters.size()),
+      radiusParameters(base.surfaces.size()), thicknessParameters(base.surfaces.size()) {
+        for (int p = 0; p < int(variedParameters.size()); p++) {
+            const LensParameter &parameter = variedParameters[p];
+            if (parameter.surface < 1 || parameter.surface >= int(base.surfaces.size())) {
+                throw std::invalid_argument("parameter references unknown surface " + std::to_string(parameter.surface));
+            }
+
+            switch (parameter.type) {
+                case LensParameter::RADIUS:
+                    radiusParameters[parameter.surface].push_back(p);
+                    break;
+                case LensParameter::THICKNESS:
+                    thicknessParameters[parameter.surface].push_back(p);
+                    break;
+                case LensParameter::INDEX:
+                    throw std::invalid_argument("variant batches do not support index parameters");
+            }
+        }
+    }
+
+    const Lens<Float> &base() const {
+        return baseLens;
+    }
+
+    const std::vector<LensParameter> &parameters() const {
+        return variedParameters;
+    }
+
+    size_t size() const {
+        return numVariants;
+    }
+
+    void reserve(size_t capacity) {
+        for (auto &column : columns) {
+            column.reserve(capacity);
+        }
+    }
+
+    /**
+     * Appends a variant given by one delta per parameter, in the order of parameters().
+     * @return The index of the variant.
+     */
+    size_t add(std::span<const Float> deltas) {
+        if (deltas.size() != columns.size()) {
+            throw std::invalid_argument("variant needs one delta per parameter");
+        }
+        for (size_t p = 0; p < columns.size(); p++) {
+            columns[p].push_back(deltas[p]);
+        }
+        return numVariants++;
+    }
+
+    size_t add(std::initializer_list<Float> deltas) {
+        return add(std::span<const Float>(deltas.begin(), deltas.size()));
+    }
+
+    Float delta(size_t variant, int parameter) const {
+        return columns[parameter][variant];
+    }
+
+    /**
+     * Deltas of one parameter for all variants.
+     */
+    std::span<const Float> deltas(int parameter) const {
+        return columns[parameter];
+    }
+
+    /**
+     * Materializes a single variant as a full lens.
+     */
+    Lens<Float> variant(size_t index) const {
+        Lens<Float> result = baseLens;
+        for (size_t p = 0; p < columns.size(); p++) {
+            variedParameters[p].apply(result, columns[p][index], Float(0));
+        }
+        return result;
+    }
+
+    /**
+     * Computes the effective focal length and focal shift of every variant, like ParaxialAnalysis.
+     */
+    ParaxialResults paraxial(Float wavelength, bool parallel = true) const {
+        LORE_PROFILE_SCOPE("VariantBatch::paraxial");
+        const int numSurfaces = int(baseLens.surfaces.size());
+        const std::vector<Float> iors = indices(wavelength);
+
+        ParaxialResults results;
+        results.efl.resize(numVariants);
+        results.focalShift.resize(numVariants);
+
+        forEachChunk(parallel, [&](size_t first, int count) {
+            Float radius[Lanes], thickness[Lanes];
+            abcd::MatrixLanes<Float, Lanes> matrices;
+            for (int i = 1; i < numSurfaces; i++) {
+                loadLanes(first, count, i, radius, thickness);
+                matrices.transfer(radius, thickness, iors[i - 1], iors[i]);
+            }
+
+            for (int l = 0; l < count; l++) {
+                const ParaxialAnalysis<Float> analysis(matrices[l]);
+                results.efl[first + l] = analysis.efl;
+                results.focalShift[first + l] = analysis.focalShift;
+            }
+        });
+
+        return results;
+    }
+
+    /**
+     * Computes the RMS spot radius about the centroid for one field point of every variant, sampling the pupil on
+     * the same grid as the SPOT_RMS operand of a MeritFunction.
+     * @param generator Ray generator of the base design, which is shared by all variants.
+     */
+    std::vector<Float> spotRms(
+        const rt::RayGenerator<Float> &generator,
+        Float field,
+        Float wavelength,
+        int samples,
+        bool parallel = true
+    ) const {
+        LORE_PROFILE_SCOPE("VariantBatch::spotRms");
+        if (samples <= 0) {
+            throw std::invalid_argument("spot size requires at least one pupil sample");
+        }
+
+        const int numSurfaces = int(baseLens.surfaces.size());
+        const std::vector<Float> iors = indices(wavelength);
+
+        // the rays entering the lens are the same for all variants
+        std::vector<rt::Ray<Float>> rays;
+        for (int iy = 0; iy < samples; iy++) {
+            for (int ix = 0; ix < samples; ix++) {
+                const double px = 2 * (ix + 0.5) / samples - 1;
+                const double py = 2 * (iy + 0.5) / samples - 1;
+                if (sqr(px) + sqr(py) <= 1) {
+                    rays.push_back(generator(field, Float(px), Float(py)));
+                }
+            }
+        }
+        const int numRays = int(rays.size());
+
+        std::vector<Float> results(numVariants);
+        forEachChunk(parallel, [&](size_t first, int count) {
+            std::vector<Float> radii(size_t(numSurfaces) * Lanes), thicknesses(size_t(numSurfaces) * Lanes);
+            for (int i = 1; i < numSurfaces; i++) {
+                loadLanes(first, count, i, &radii[size_t(i) * Lanes], &thicknesses[size_t(i) * Lanes]);
+            }
+
+            std::vector<Float> hitsX(size_t(numRays) * Lanes), hitsY(size_t(numRays) * Lanes);
+            std::vector<char> valid(size_t(numRays) * Lanes);
+            for (int r = 0; r < numRays; r++) {
+                trace(rays[r], iors, radii.data(), thicknesses.data(),
+                    &hitsX[size_t(r) * Lanes], &hitsY[size_t(r) * Lanes], &valid[size_t(r) * Lanes]);
+            }
+
+            for (int l = 0; l < count; l++) {
+                results[first + l] = rms(hitsX.data() + l, hitsY.data() + l, valid.data() + l, numRays);
+            }
+        });
+
+        return results;
+    }
+
+private:
+    std::vector<Float> indices(Float wavelength) const {
+        std::vector<Float> result(baseLens.surfaces.size());
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = baseLens.surfaces[i].ior(wavelength);
+        }
+        return result;
+    }
+
+    /**
+     * Invokes body(first, count) for every chunk of Lanes consecutive variants.
+     */
+    template<typename Body>
+    void forEachChunk(bool parallel, Body &&body) const {
+        const int numChunks = int((numVariants + Lanes - 1) / Lanes);
+        auto chunk = [&](int index) {
+            const size_t first = size_t(index) * Lanes;
+            body(first, int(std::min<size_t>(Lanes, numVariants - first)));
+        };
+
+        if (parallel) {
+            parallel::parallelFor(0, numChunks, chunk, 16);
+        } else {
+            for (int i = 0; i < numChunks; i++) {
+                chunk(i);
+            }
+        }
+    }
+
+    /**
+     * Fills the radius and thickness of a surface for a chunk of variants. Lanes past the last variant hold the
+     * base lens.
+     */
+    void loadLanes(size_t first, int count, int surface, Float *radius, Float *thickness) const {
+        const Surface<Float> &base = baseLens.surfaces[surface];
+        for (int l = 0; l < Lanes; l++) {
+            radius[l] = base.radius;
+            thickness[l] = base.thickness;
+        }
+
+        // added in parameter order, like variant()
+        for (const int p : radiusParameters[surface]) {
+            const Float *column = columns[p].data() + first;
+            for (int l = 0; l < count; l++) {
+                radius[l] += column[l];
+            }
+        }
+        for (const int p : thicknessParameters[surface]) {
+            const Float *column = columns[p].data() + first;
+            for (int l = 0; l < count; l++) {
+                thickness[l] += column[l];
+            }
+        }
+    }
+
+    /**
+     * Traces one ray through a chunk of variants, with the same steps as SequentialTrace with the
+     * GeometricalIntersector.
+     * @param radii Radii of the chunk, indexed by surface * Lanes + lane, and likewise thicknesses.
+     */
+    void trace(
+        const rt::Ray<Float> &ray,
+        const std::vector<Float> &iors,
+        const Float *radii,
+        const Float *thicknesses,
+        Float *hitX,
+        Float *hitY,
+        char *valid
+    ) const {
+        rt::RayLanes<Float, Lanes> lanes(ray);
+        const int numSurfaces = int(baseLens.surfaces.size());
+        for (int i = 1; i < numSurfaces; i++) {
+            const Surface<Float> &surface = baseLens.surfaces[i];
+            const Float *radius = radii + size_t(i) * Lanes;
+            lanes.propagate(radius, surface.aperture, surface.checkAperture);
+            lanes.refract(radius, Float(iors[i - 1] / iors[i]));
+            lanes.transfer(thicknesses + size_t(i) * Lanes);
+        }
+
+        for (int l = 0; l < Lanes; l++) {
+            hitX[l] = lanes.ox[l];
+            hitY[l] = lanes.oy[l];
+            valid[l] = lanes.alive[l];
+        }
+    }
+
+    /**
+     * RMS distance of the valid hits of one lane from their centroid, see MeritProgram.
+     */
+    static Float rms(const Float *hitsX, const Float *hitsY, const char *valid, int numRays) {
+        int count = 0;
+        Float centroidX = 0, centroidY = 0;
+        for (int r = 0; r < numRays; r++) {
+            LORE_TRACE_STAT(traced(valid[size_t(r) * Lanes]));
+            if (valid[size_t(r) * Lanes]) {
+                centroidX += hitsX[size_t(r) * Lanes];
+                centroidY += hitsY[size_t(r) * Lanes];
+                count++;
+            }
+        }
+        if (count == 0) {
+            return Float(0);
+        }
+
+        const Float inverseCount = Float(1) / Float(count);
+        centroidX *= inverseCount;
+        centroidY *= inverseCount;
+
+        Float sum = 0;
+        for (int r = 0; r < numRays; r++) {
+            if (valid[size_t(r) * Lanes]) {
+                sum += sqr(hitsX[size_t(r) * Lanes] - centroidX) + sqr(hitsY[size_t(r) * Lanes] - centroidY);
+            }
+        }
+        if (sum == Float(0)) {
+            return Float(0);
+        }
+        return std::sqrt(sum / Float(count));
+    }
+
+    Lens<Float> baseLens;
+    std::vector<LensParameter> variedParameters;
+
+    /**
+     * Deltas of each parameter, indexed by variant.
+     */
+    std::vector<std::vector<Float>> columns;
+    size_t numVariants = 0;
+
+    /**
+     * Indices of the parameters that vary the radius and thickness of each surface.
+     */
+    std::vector<std::vector<int>> radiusParameters;
+    std::vector<std::vector<int>> thicknessParameters;
+};
+
+}
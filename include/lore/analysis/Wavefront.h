@@ -0,0 +1,304 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/LensSchema.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+#include <lore/rt/ABCD.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/Ray.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Optical path differences over a square grid of normalized entrance pupil coordinates.
+ */
+struct Wavefront {
+    /**
+     * Number of samples along each pupil axis. Sample (ix, iy) is at the pupil coordinate
+     * (2 (ix + 0.5) / size - 1, 2 (iy + 0.5) / size - 1) and stored at index iy * size + ix.
+     */
+    int size = 0;
+
+    /**
+     * Optical path difference in waves relative to the chief ray, measured at the exit pupil reference sphere. Samples
+     * outside the unit pupil or whose rays are vignetted are NaN.
+     */
+    std::vector<double> opd;
+
+    /**
+     * Wavelength in micrometers.
+     */
+    double wavelength = 0;
+
+    /**
+     * Image point of the chief ray, which is the center of the reference sphere.
+     */
+    Vector2<double> chief;
+
+    /**
+     * Radius of the reference sphere, i.e. the distance from the exit pupil to the image point.
+     */
+    double referenceRadius = 0;
+
+    /**
+     * Image-space numerical aperture of the paraxial marginal ray, which determines the scale of the point spread
+     * function.
+     */
+    double numericalAperture = 0;
+
+    bool valid(int index) const {
+        return !std::isnan(opd[index]);
+    }
+
+    /**
+     * Fraction of the samples within the unit pupil whose rays pass the lens.
+     */
+    double transmission() const;
+
+    /**
+     * Root mean square of the optical path difference about its mean (piston removed), in waves.
+     */
+    double rms() const;
+
+    double peakToValley() const;
+};
+
+inline double Wavefront::transmission() const {
+    int inside = 0, passed = 0;
+    for (int iy = 0; iy < size; iy++) {
+        for (int ix = 0; ix < size; ix++) {
+            const double px = 2 * (ix + 0.5) / size - 1;
+            const double py = 2 * (iy + 0.5) / size - 1;
+            if (sqr(px) + sqr(py) <= 1) {
+                inside++;
+                passed += valid(iy * size + ix) ? 1 : 0;
+            }
+        }
+    }
+    return inside > 0 ? double(passed) / inside : 0;
+}
+
+inline double Wavefront::rms() const {
+    double sum = 0, sumSqr = 0;
+    int count = 0;
+    for (const double value : opd) {
+        if (!std::isnan(value)) {
+            sum += value;
+            sumSqr += sqr(value);
+            count++;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+    const double mean = sum / count;
+    return std::sqrt(std::max(0.0, sumSqr / count - sqr(mean)));
+}
+
+inline double Wavefront::peakToValley() const {
+    double low = std::numeric_limits<double>::infinity(), high = -std::numeric_limits<double>::infinity();
+    for (const double value : opd) {
+        if (!std::isnan(value)) {
+            low = std::min(low, value);
+            high = std::max(high, value);
+        }
+    }
+    return high >= low ? high - low : 0;
+}
+
+/**
+ * Computes optical path differences at the exit pupil by tracing a grid of rays with optical path lengths.
+ *
+ * The exit pupil is the paraxial image of the stop. The reference sphere is centered on the image point of the chief
+ * ray (the ray through the center of the entrance pupil) and passes through the point where the chief ray crosses
+ * the exit pupil plane. Each ray is extended from the image plane back to the reference sphere, and its optical path
+ * is compared to the one of the chief ray. For infinite conjugates, optical paths are measured from a plane
+ * perpendicular to the incoming rays, i.e. from a plane incoming wavefront.
+ * @note Lens units are taken to be millimeters, so that optical path differences can be expressed in waves of a
+ * wavelength in micrometers.
+ */
+template<typename Float>
+class WavefrontAnalysis {
+public:
+    static constexpr double MillimetersPerMicrometer = 1e-3;
+
+    WavefrontAnalysis(const Lens<Float> &lens, const rt::RayGenerator<Float> &generator, int stopIndex)
+    : lens(lens), generator(generator), stopIndex(stopIndex) {
+        if (stopIndex < 1 || stopIndex + 1 >= int(lens.surfaces.size())) {
+            throw std::invalid_argument("stop references unknown surface " + std::to_string(stopIndex));
+        }
+    }
+
+    template<typename SFloat>
+    explicit WavefrontAnalysis(const LensSchema<SFloat> &schema)
+    : WavefrontAnalysis(schema.template lens<Float>(), rt::RayGenerator<Float>(schema), schema.stopIndex) {}
+
+    /**
+     * The lens and the generator of its incoming rays, e.g. for analyses that trace further rays of the same setup.
+     */
+    const Lens<Float> &tracedLens() const {
+        return lens;
+    }
+
+    const rt::RayGenerator<Float> &rayGenerator() const {
+        return generator;
+    }
+
+    /**
+     * Position of the exit pupil along the axis relative to the image plane, which is negative for exit pupils in
+     * front of the image.
+     */
+    double exitPupilPosition(double wavelength) const {
+        // paraxial ray leaving the center of the stop, followed to the image plane and extended back to the axis
+        const Matrix2x2<Float> m = toImage(stopIndex + 1, wavelength) *
+            abcd::propagation(lens.surfaces[stopIndex].thickness);
+        if (m(1, 1) == Float(0)) {
+            throw std::invalid_argument("exit pupil is at infinity");
+        }
+        return -double(m(0, 1)) / double(m(1, 1));
+    }
+
+    /**
+     * Image-space numerical aperture of the paraxial marginal ray of the on-axis object point.
+     */
+    double numericalAperture(double wavelength) const {
+        const Matrix2x2<Float> m = toImage(1, wavelength);
+        // the marginal ray passes the edge of the entrance pupil, which lies entrancePupilPosition behind surface 1
+        const double radius = double(generator.entranceBeamRadius);
+        const double pupil = double(generator.entrancePupilPosition);
+        const double u = generator.infinite ? 0 : radius / (double(generator.objectDistance) + pupil);
+        const double h = generator.infinite ? radius : radius - u * pupil;
+        const double image = double(m(1, 0)) * h + double(m(1, 1)) * u;
+        return imageIndex(wavelength) * std::sin(std::atan(std::abs(image)));
+    }
+
+    /**
+     * @param field Relative field coordinate along y.
+     * @param wavelength Wavelength in micrometers.
+     * @param samples Number of pupil samples along each axis.
+     */
+    Wavefront operator()(double field, double wavelength, int samples, bool parallel = true) const {
+        LORE_PROFILE_SCOPE("WavefrontAnalysis::compute");
+        if (samples <= 0) {
+            throw std::invalid_argument("wavefront requires at least one pupil sample");
+        }
+
+        Wavefront result;
+        result.size = samples;
+        result.wavelength = wavelength;
+        result.numericalAperture = numericalAperture(wavelength);
+        result.opd.assign(size_t(samples) * samples, std::numeric_limits<double>::quiet_NaN());
+
+        const double n = imageIndex(wavelength);
+        const double waveLength = wavelength * MillimetersPerMicrometer;
+
+        Traced chief;
+        if (!trace(field, 0, 0, wavelength, chief)) {
+            throw std::invalid_argument("chief ray does not pass the lens");
+        }
+        result.chief = { chief.position.x(), chief.position.y() };
+
+        // the exit pupil center on the chief ray
+        const double pupilZ = exitPupilPosition(wavelength);
+        const double toPupil = (pupilZ - chief.position.z()) / chief.direction.z();
+        const Vector3<double> center = chief.position;
+        result.referenceRadius = std::abs(toPupil);
+        const double side = toPupil < 0 ? -1 : 1;
+
+        // optical path from the start of a ray to the reference sphere
+        auto referencePath = [&](const Traced &ray) {
+            const Vector3<double> v = ray.position - center;
+            const double b = v.dot(ray.direction);
+            const double disc = sqr(b) - v.lengthSquared() + sqr(result.referenceRadius);
+            if (disc < 0) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            return ray.path + n * (-b + side * std::sqrt(disc));
+        };
+        const double chiefPath = referencePath(chief);
+
+        auto traceRow = [&](int iy) {
+            const double py = 2 * (iy + 0.5) / samples - 1;
+            for (int ix = 0; ix < samples; ix++) {
+                const double px = 2 * (ix + 0.5) / samples - 1;
+                Traced ray;
+                if (sqr(px) + sqr(py) <= 1 && trace(field, px, py, wavelength, ray)) {
+                    result.opd[size_t(iy) * samples + ix] = (referencePath(ray) - chiefPath) / waveLength;
+                }
+            }
+        };
+
+        if (parallel) {
+            parallel::parallelFor(0, samples, traceRow, 4);
+        } else {
+            for (int iy = 0; iy < samples; iy++) {
+                traceRow(iy);
+            }
+        }
+        return result;
+    }
+
+private:
+    /**
+     * Paraxial transfer from the vertex plane of surface first to the image plane, without refraction at the image.
+     */
+    Matrix2x2<Float> toImage(int first, double wavelength) const {
+        Matrix2x2<Float> result = Matrix2x2<Float>::Identity();
+        for (size_t i = first; i + 1 < lens.surfaces.size(); i++) {
+            const auto &surface = lens.surfaces[i];
+            result = abcd::refraction(lens.surfaces[i - 1].ior(Float(wavelength)), surface.ior(Float(wavelength)),
+                surface.curvature()) * result;
+            result = abcd::propagation(surface.thickness) * result;
+        }
+        return result;
+    }
+
+    double imageIndex(double wavelength) const {
+        return double(lens.surfaces[lens.surfaces.size() - 2].ior(Float(wavelength)));
+    }
+
+    struct Traced {
+        Vector3<double> position;
+        Vector3<double> direction;
+        double path = 0;
+    };
+
+    bool trace(double field, double px, double py, double wavelength, Traced &traced) const {
+        using Intersector = rt::GeometricalIntersector<Float>;
+        const Intersector intersector {};
+        const rt::SequentialTrace<Float, Intersector> sequential { lens, intersector, Float(wavelength) };
+
+        rt::Ray<Float> ray = generator(Float(field), Float(px), Float(py));
+        Float path = Float(0);
+        if (generator.infinite) {
+            // distance from the plane through the vertex of the first surface perpendicular to the incoming rays
+            path = lens.surfaces.front().ior(Float(wavelength)) * ray.origin.dot(ray.direction);
+        }
+        if (!sequential(ray, path)) {
+            return false;
+        }
+
+        traced.position = { double(ray.origin.x()), double(ray.origin.y()), double(ray.origin.z()) };
+        traced.direction = { double(ray.direction.x()), double(ray.direction.y()), double(ray.direction.z()) };
+        traced.path = double(path);
+        return true;
+    }
+
+    Lens<Float> lens;
+    rt::RayGenerator<Float> generator;
+    int stopIndex;
+};
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/analysis/Wavefront.h>
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace lore {
+namespace zernike {
+
+/**
+ * Radial order n and azimuthal frequency m of a Zernike polynomial, where negative m denote sine terms.
+ */
+struct Index {
+    int n;
+    int m;
+};
+
+/**
+ * Converts a single index in Noll's ordering, starting at 1 for piston, to radial and azimuthal orders.
+ */
+Index noll(int j);
+
+/**
+ * Radial polynomial R_n^|m| at the normalized radius rho.
+ */
+double radial(int n, int m, double rho);
+
+/**
+ * Zernike polynomial j (Noll) at pupil coordinates (x, y) within the unit disk. Polynomials are normalized to unit
+ * RMS over the disk, such that fitted coefficients are the RMS contributions of their terms.
+ */
+double evaluate(int j, double x, double y);
+
+}
+
+/**
+ * Least-squares fit of Zernike polynomials to wavefront samples at a fixed set of pupil coordinates.
+ *
+ * The basis is evaluated and the normal equations are Cholesky-factorized once when the fit is constructed, which
+ * yields a projection matrix from samples to coefficients. Fitting a wavefront is then a single matrix-vector product,
+ * so that one fit can be shared by all field points and wavelengths that use the same sample pattern. Wavefronts with
+ * vignetted samples fall back to solving the normal equations of their valid samples.
+ */
+class ZernikeFit {
+public:
+    /**
+     * Fits the first terms Noll polynomials to samples at the given pupil coordinates.
+     */
+    ZernikeFit(int terms, std::span<const double> x, std::span<const double> y);
+
+    /**
+     * Fits the first terms Noll polynomials to the samples of Wavefront grids of the given size that lie within the
+     * unit pupil.
+     */
+    ZernikeFit(int terms, int gridSize);
+
+    int terms() const {
+        return numTerms;
+    }
+
+    size_t samples() const {
+        return x.size();
+    }
+
+    /**
+     * Projects values at the sample coordinates onto the coefficients. The value type may differ from double, e.g. to
+     * propagate derivatives.
+     */
+    template<typename T>
+    void operator()(std::span<const T> values, std::span<T> coefficients) const {
+        if (values.size() != samples() || coefficients.size() != size_t(numTerms)) {
+            throw std::invalid_argument("sample or coefficient count does not match the fit");
+        }
+
+        for (int t = 0; t < numTerms; t++) {
+            coefficients[t] = T(0);
+        }
+        // projection is stored by sample, so that every value is read once and the terms are accessed contiguously
+        for (size_t i = 0; i < values.size(); i++) {
+            const double *row = &projection[i * numTerms];
+            for (int t = 0; t < numTerms; t++) {
+                coefficients[t] += T(row[t]) * values[i];
+            }
+        }
+    }
+
+    /**
+     * Coefficients in waves of a wavefront of the grid size this fit was constructed for.
+     */
+    std::vector<double> operator()(const Wavefront &wavefront) const;
+
+    /**
+     * Fits several wavefronts, e.g. the field points and wavelengths of a lens, distributing them over all cores when
+     * parallel is set.
+     */
+    std::vector<std::vector<double>> operator()(std::span<const Wavefront> wavefronts, bool parallel = true) const;
+
+    /**
+     * Value of the fitted polynomials at a pupil coordinate.
+     */
+    static double evaluate(std::span<const double> coefficients, double x, double y);
+
+private:
+    void factorize();
+
+    /**
+     * Solves the normal equations of the samples selected by mask.
+     */
+    std::vector<double> solve(std::span<const double> values, const std::vector<char> &mask) const;
+
+    int numTerms;
+    int gridSize = 0;
+    std::vector<double> x;
+    std::vector<double> y;
+
+    /**
+     * Indices into Wavefront::opd of the samples (grid fits only).
+     */
+    std::vector<int> gridIndices;
+
+    /**
+     * Basis values and rows of the projection matrix, samples x terms.
+     */
+    std::vector<double> basis;
+    std::vector<double> projection;
+};
+
+}
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/parallel/ScratchArena.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace lore {
+namespace fourier {
+
+enum class Direction {
+    /// exp(-2 pi i jk / n)
+    FORWARD,
+    /// exp(+2 pi i jk / n), without the 1 / n normalization.
+    INVERSE
+};
+
+/**
+ * Precomputed mixed-radix fast Fourier transform of complex sequences of a fixed length.
+ * The length is factored into radices of 4 and 2 (with specialized butterflies) and any remaining prime factors
+ * (generic butterflies), and transformed by recursive decimation in time. Lengths with large prime factors are
+ * supported, but cost O(n p) for the largest prime factor p.
+ * Plans are immutable and can be shared between threads.
+ */
+template<typename Float>
+class FFT {
+public:
+    static_assert(std::is_floating_point_v<Float>, "transforms are computed in plain floating point");
+
+    using Complex = std::complex<Float>;
+
+    explicit FFT(int n)
+    : n(n) {
+        if (n <= 0) {
+            throw std::invalid_argument("transform length must be positive");
+        }
+
+        int remaining = n;
+        for (const int radix : { 4, 2 }) {
+            while (remaining % radix == 0) {
+                factors.push_back(radix);
+                remaining /= radix;
+            }
+        }
+        for (int p = 3; remaining > 1; p += 2) {
+            if (p * p > remaining) {
+                p = remaining;
+            }
+            while (remaining % p == 0) {
+                factors.push_back(p);
+                remaining /= p;
+            }
+        }
+        if (factors.empty()) {
+            factors.push_back(1);
+        }
+        maxRadix = *std::max_element(factors.begin(), factors.end());
+
+        twiddles.resize(n);
+        for (int k = 0; k < n; k++) {
+            const double phase = -2 * M_PI * double(k) / double(n);
+            twiddles[k] = Complex(Float(std::cos(phase)), Float(std::sin(phase)));
+        }
+    }
+
+    int size() const {
+        return n;
+    }
+
+    /**
+     * Transforms n elements read with the given stride from in into out, which must not overlap.
+     */
+    void operator()(const Complex *in, Complex *out, Direction direction, int stride = 1) const {
+        parallel::ScratchArena &arena = parallel::ScratchArena::local();
+        parallel::ScratchArena::Scope scope(arena);
+        Complex *scratch = arena.allocate<Complex>(maxRadix).data();
+
+        if (n == 1) {
+            out[0] = in[0];
+            return;
+        }
+        transform(out, in, 1, stride, 0, direction, scratch);
+    }
+
+    /**
+     * Transforms n contiguous elements in place.
+     */
+    void operator()(Complex *data, Direction direction) const {
+        parallel::ScratchArena &arena = parallel::ScratchArena::local();
+        parallel::ScratchArena::Scope scope(arena);
+        const std::span<Complex> copy = arena.allocate<Complex>(n);
+        std::copy(data, data + n, copy.data());
+        (*this)(copy.data(), data, direction);
+    }
+
+private:
+    Complex twiddle(int index, Direction direction) const {
+        return direction == Direction::FORWARD ? twiddles[index] : std::conj(twiddles[index]);
+    }
+
+    /**
+     * Computes the transform of the n / (product of the factors before level) elements of in at the given stride.
+     */
+    void transform(
+        Complex *out,
+        const Complex *in,
+        int twiddleStride,
+        int inStride,
+        size_t level,
+        Direction direction,
+        Complex *scratch
+    ) const {
+        const int p = factors[level];
+        const int m = n / (twiddleStride * p);
+
+        if (m == 1) {
+            for (int q = 0; q < p; q++) {
+                out[q] = in[size_t(q) * twiddleStride * inStride];
+            }
+        } else {
+            // p interleaved subsequences of length m, each transformed into its own contiguous block
+            for (int q = 0; q < p; q++) {
+                transform(out + size_t(q) * m, in + size_t(q) * twiddleStride * inStride, twiddleStride * p, inStride,
+                    level + 1, direction, scratch);
+            }
+        }
+
+        switch (p) {
+            case 2:
+                butterfly2(out, twiddleStride, m, direction);
+                break;
+            case 4:
+                butterfly4(out, twiddleStride, m, direction);
+                break;
+            default:
+                butterfly(out, twiddleStride, m, p, direction, scratch);
+                break;
+        }
+    }
+
+    void butterfly2(Complex *out, int twiddleStride, int m, Direction direction) const {
+        for (int k = 0; k < m; k++) {
+            const Complex t = out[m + k] * twiddle(k * twiddleStride, direction);
+            out[m + k] = out[k] - t;
+            out[k] += t;
+        }
+    }
+
+    void butterfly4(Complex *out, int twiddleStride, int m, Direction direction) const {
+        // multiplication by -i for the forward and +i for the inverse transform
+        const Float sign = direction == Direction::FORWARD ? Float(1) : Float(-1);
+        for (int k = 0; k < m; k++) {
+            const Complex s0 = out[k + m] * twiddle(k * twiddleStride, direction);
+            const Complex s1 = out[k + 2 * m] * twiddle(2 * k * twiddleStride, direction);
+            const Complex s2 = out[k + 3 * m] * twiddle(3 * k * twiddleStride, direction);
+
+            const Complex s3 = s0 + s2;
+            const Complex s4 = s0 - s2;
+            const Complex s5 = out[k] - s1;
+            out[k] += s1;
+            out[k + 2 * m] = out[k] - s3;
+            out[k] += s3;
+
+            const Complex rotated(sign * s4.imag(), -sign * s4.real());
+            out[k + m] = s5 + rotated;
+            out[k + 3 * m] = s5 - rotated;
+        }
+    }
+
+    void butterfly(Complex *out, int twiddleStride, int m, int p, Direction direction, Complex *scratch) const {
+        for (int u = 0; u < m; u++) {
+            for (int q = 0; q < p; q++) {
+                scratch[q] = out[u + q * m];
+            }
+
+            for (int q = 0; q < p; q++) {
+                const int k = u + q * m;
+                const int step = twiddleStride * k % n;
+                int index = 0;
+                Complex sum = scratch[0];
+                for (int j = 1; j < p; j++) {
+                    index += step;
+                    if (index >= n) {
+                        index -= n;
+                    }
+                    sum += scratch[j] * twiddle(index, direction);
+                }
+                out[k] = sum;
+            }
+        }
+    }
+
+    int n;
+    int maxRadix = 1;
+    std::vector<int> factors;
+    std::vector<Complex> twiddles;
+};
+
+/**
+ * Two-dimensional transform of a row-major array, computed as one-dimensional transforms of all rows, a transpose,
+ * transforms of all former columns and a transpose back. The transposes work on square tiles that fit into the L1
+ * cache, so that neither pass strides through memory, and rows are distributed over all cores.
+ */
+template<typename Float>
+class FFT2D {
+public:
+    using Complex = std::complex<Float>;
+
+    /**
+     * Edge length of the square tiles of the transposes. Two tiles of double-precision complex numbers take 32 KiB.
+     */
+    static constexpr int TileSize = 32;
+
+    FFT2D(int rows, int columns)
+    : rowTransform(columns), columnTransform(rows) {}
+
+    int rows() const {
+        return columnTransform.size();
+    }
+
+    int columns() const {
+        return rowTransform.size();
+    }
+
+    /**
+     * Transforms rows() * columns() elements in place.
+     */
+    void operator()(Complex *data, Direction direction, bool parallel = true) const {
+        const int numRows = rows();
+        const int numColumns = columns();
+        parallel::ScratchArena &arena = parallel::ScratchArena::local();
+        parallel::ScratchArena::Scope scope(arena);
+        Complex *transposed = arena.allocate<Complex>(size_t(numRows) * numColumns).data();
+
+        transformRows(rowTransform, data, numRows, direction, parallel);
+        transpose(data, transposed, numRows, numColumns, parallel);
+        transformRows(columnTransform, transposed, numColumns, direction, parallel);
+        transpose(transposed, data, numColumns, numRows, parallel);
+    }
+
+    void operator()(std::vector<Complex> &data, Direction direction, bool parallel = true) const {
+        if (data.size() != size_t(rows()) * columns()) {
+            throw std::invalid_argument("array size does not match the transform");
+        }
+        (*this)(data.data(), direction, parallel);
+    }
+
+    /**
+     * Copies the rows x columns array in to the columns x rows array out, one tile at a time.
+     */
+    static void transpose(const Complex *in, Complex *out, int rows, int columns, bool parallel = true) {
+        const int numTileRows = (rows + TileSize - 1) / TileSize;
+        auto transposeTileRow = [&](int tileRow) {
+            const int rowBegin = tileRow * TileSize;
+            const int rowEnd = std::min(rows, rowBegin + TileSize);
+            for (int columnBegin = 0; columnBegin < columns; columnBegin += TileSize) {
+                const int columnEnd = std::min(columns, columnBegin + TileSize);
+                for (int r = rowBegin; r < rowEnd; r++) {
+                    for (int c = columnBegin; c < columnEnd; c++) {
+                        out[size_t(c) * rows + r] = in[size_t(r) * columns + c];
+                    }
+                }
+            }
+        };
+
+        if (parallel) {
+            parallel::parallelFor(0, numTileRows, transposeTileRow);
+        } else {
+            for (int t = 0; t < numTileRows; t++) {
+                transposeTileRow(t);
+            }
+        }
+    }
+
+private:
+    static void transformRows(const FFT<Float> &transform, Complex *data, int numRows, Direction direction, bool parallel) {
+        const int length = transform.size();
+        auto transformRow = [&](int row) {
+            transform(data + size_t(row) * length, direction);
+        };
+
+        if (parallel) {
+            // rows of a few hundred elements take microseconds, so that several are grouped per chunk
+            parallel::parallelFor(0, numRows, transformRow, std::max(1, 4096 / length));
+        } else {
+            for (int row = 0; row < numRows; row++) {
+                transformRow(row);
+            }
+        }
+    }
+
+    FFT<Float> rowTransform;
+    FFT<Float> columnTransform;
+};
+
+/**
+ * Swaps the quadrants of a row-major array, such that the zero frequency moves from the first element to the
+ * center element (rows / 2, columns / 2).
+ */
+template<typename T>
+void fftshift(std::vector<T> &data, int rows, int columns) {
+    std::vector<T> shifted(data.size());
+    for (int r = 0; r < rows; r++) {
+        const int sr = (r + rows / 2) % rows;
+        for (int c = 0; c < columns; c++) {
+            const int sc = (c + columns / 2) % columns;
+            shifted[size_t(sr) * columns + sc] = data[size_t(r) * columns + c];
+        }
+    }
+    data.swap(shifted);
+}
+
+}
+}
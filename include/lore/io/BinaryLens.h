@@ -0,0 +1,261 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Glass.h>
+#include <lore/lens/GlassCatalog.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/LensSchema.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lore {
+namespace io {
+
+/**
+ * Layout of binary lens files.
+ * A file consists of a header followed by tables of fixed-size records (lenses, surfaces, wavelengths, glasses,
+ * sources) and a blob of string data, all in host byte order and aligned to eight bytes. Surfaces refer to their
+ * glass by index into the glass table, which stores each glass name and dispersion formula once, so files can be
+ * used without a glass catalog. The source table is sorted by name and maps e.g. the path of each ingested file to
+ * its range of lenses.
+ * Version 1 files end their header before the source table fields and have no sources.
+ */
+namespace binary {
+
+constexpr char Magic[8] = { 'L', 'O', 'R', 'E', 'L', 'E', 'N', 'S' };
+constexpr uint32_t Version = 2;
+constexpr uint32_t ByteOrderMark = 0x01020304;
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+
+    uint32_t numLenses;
+    uint32_t numSurfaces;
+    uint32_t numWavelengths;
+    uint32_t numGlasses;
+
+    uint64_t lensOffset;
+    uint64_t surfaceOffset;
+    uint64_t wavelengthOffset;
+    uint64_t glassOffset;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+
+    // since version 2
+    uint64_t sourceOffset;
+    uint32_t numSources;
+    uint32_t reserved;
+};
+
+constexpr size_t HeaderSizeV1 = 80;
+
+struct LensRecord {
+    StringRef name;
+    StringRef description;
+    float fieldAngle;
+    float entranceBeamRadius;
+    int32_t stopIndex;
+    uint32_t firstSurface;
+    uint32_t numSurfaces;
+    uint32_t firstWavelength;
+    uint32_t numWavelengths;
+    uint32_t reserved;
+};
+
+struct SurfaceRecord {
+    enum Flags : uint32_t {
+        CHECK_APERTURE = 1,
+    };
+
+    float radius;
+    float thickness;
+    float aperture;
+    uint32_t glass;
+    uint32_t flags;
+};
+
+struct WavelengthRecord {
+    float wavelength;
+    float weight;
+};
+
+struct SourceRecord {
+    StringRef name;
+    uint32_t firstLens;
+    uint32_t numLenses;
+};
+
+struct GlassRecord {
+    StringRef name;
+
+    /**
+     * Glass<float>::IORType.
+     */
+    uint32_t type;
+
+    /**
+     * B1..3 and C1..3 for Sellmeier glasses, A0..5 for Laurent glasses.
+     */
+    float coefficients[6];
+};
+
+static_assert(sizeof(Header) == 96, "unexpected header layout");
+static_assert(sizeof(LensRecord) == 48, "unexpected lens record layout");
+static_assert(sizeof(SurfaceRecord) == 20, "unexpected surface record layout");
+static_assert(sizeof(WavelengthRecord) == 8, "unexpected wavelength record layout");
+static_assert(sizeof(GlassRecord) == 36, "unexpected glass record layout");
+static_assert(sizeof(SourceRecord) == 16, "unexpected source record layout");
+
+Glass<float> toGlass(const GlassRecord &record);
+GlassRecord fromGlass(const Glass<float> &glass, StringRef name);
+
+}
+
+class BinaryLensException : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Read-only access to a binary lens file, either memory-mapped or held in a buffer.
+ * Opening only validates the header and table bounds; lenses are read in place through views, without parsing or
+ * copying.
+ */
+class BinaryLensFile {
+public:
+    class LensView {
+    public:
+        LensView(const BinaryLensFile &file, const binary::LensRecord &record)
+        : file(&file), record(&record) {}
+
+        std::string_view name() const { return file->string(record->name); }
+        std::string_view description() const { return file->string(record->description); }
+        float fieldAngle() const { return record->fieldAngle; }
+        float entranceBeamRadius() const { return record->entranceBeamRadius; }
+        int stopIndex() const { return record->stopIndex; }
+
+        std::span<const binary::SurfaceRecord> surfaces() const {
+            return file->surfaces.subspan(record->firstSurface, record->numSurfaces);
+        }
+
+        std::span<const binary::WavelengthRecord> wavelengths() const {
+            return file->wavelengths.subspan(record->firstWavelength, record->numWavelengths);
+        }
+
+        std::string_view glassName(int surface) const {
+            return file->string(file->glasses[surfaces()[surface].glass].name);
+        }
+
+        Surface<float> surface(int index) const {
+            const binary::SurfaceRecord &surface = surfaces()[index];
+            return Surface<float>(
+                surface.radius,
+                surface.thickness,
+                surface.aperture,
+                (surface.flags & binary::SurfaceRecord::CHECK_APERTURE) != 0,
+                binary::toGlass(file->glasses[surface.glass])
+            );
+        }
+
+        template<typename LFloat>
+        Lens<LFloat> lens() const {
+            Lens<LFloat> result;
+            result.surfaces.reserve(record->numSurfaces);
+            for (int i = 0; i < int(record->numSurfaces); i++) {
+                result.surfaces.push_back(surface(i).template cast<LFloat>());
+            }
+            return result;
+        }
+
+        /**
+         * Copies the lens into a LensSchema. Glass identifiers are looked up by name in the catalog if one is
+         * given and are Air otherwise, while the dispersion formulas are always taken from the file.
+         */
+        LensSchema<float> schema(const GlassCatalog *catalog = nullptr) const;
+
+    private:
+        const BinaryLensFile *file;
+        const binary::LensRecord *record;
+    };
+
+    /**
+     * Maps the file into memory.
+     */
+    static BinaryLensFile open(const std::string &path);
+
+    /**
+     * Takes ownership of a buffer containing a binary lens file.
+     */
+    static BinaryLensFile fromBuffer(std::vector<std::byte> buffer);
+
+    BinaryLensFile(BinaryLensFile &&) noexcept;
+    BinaryLensFile &operator=(BinaryLensFile &&) noexcept;
+    ~BinaryLensFile();
+
+    size_t size() const {
+        return lenses.size();
+    }
+
+    LensView operator[](size_t index) const {
+        return LensView(*this, lenses[index]);
+    }
+
+    std::vector<LensSchema<float>> schemas(const GlassCatalog *catalog = nullptr) const;
+
+    struct Range {
+        size_t first;
+        size_t count;
+    };
+
+    size_t numSources() const {
+        return sources.size();
+    }
+
+    std::string_view sourceName(size_t index) const {
+        return string(sources[index].name);
+    }
+
+    Range sourceRange(size_t index) const {
+        return { sources[index].firstLens, sources[index].numLenses };
+    }
+
+    /**
+     * Looks up the lenses of a source by binary search. If a name occurs repeatedly, the first range is returned.
+     */
+    std::optional<Range> find(std::string_view source) const;
+
+private:
+    struct Storage;
+
+    explicit BinaryLensFile(std::unique_ptr<Storage> storage);
+
+    std::string_view string(binary::StringRef ref) const {
+        return std::string_view(strings.data() + ref.offset, ref.length);
+    }
+
+    std::unique_ptr<Storage> storage;
+    std::span<const binary::LensRecord> lenses;
+    std::span<const binary::SurfaceRecord> surfaces;
+    std::span<const binary::WavelengthRecord> wavelengths;
+    std::span<const binary::GlassRecord> glasses;
+    std::span<const binary::SourceRecord> sources;
+    std::span<const char> strings;
+};
+
+}
+}
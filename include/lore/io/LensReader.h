@@ -1,15 +1,32 @@
 #pragma once
 
 #include <lore/lore.h>
+#include <lore/lens/LensArchive.h>
 #include <lore/lens/LensSchema.h>
 #include <lore/lens/GlassCatalog.h>
 
 #include <istream>
+#include <string>
 #include <vector>
 
 namespace lore {
 namespace io {
 
+/**
+ * A problem that was found, and logged, while reading a lens file without aborting it.
+ */
+struct ParseDiagnostic {
+    enum Severity {
+        WARNING,
+        ERROR
+    };
+
+    Severity severity;
+    int line;
+    int column;
+    std::string message;
+};
+
 class LensReader {
 public:
     const GlassCatalog &glassCatalog;
@@ -17,7 +34,17 @@ public:
     LensReader() : glassCatalog(GlassCatalog::shared) {}
     LensReader(const GlassCatalog &glassCatalog) : glassCatalog(glassCatalog) {}
 
-    std::vector<LensSchema<float>> read(std::istream &is) const;
+    /**
+     * Reads all lenses in the stream. Syntax errors throw, while unknown commands and glasses (which are replaced by
+     * air) are logged and, if diagnostics is given, also appended to it.
+     */
+    std::vector<LensSchema<float>> read(std::istream &is, std::vector<ParseDiagnostic> *diagnostics = nullptr) const;
+
+    /**
+     * Appends all lenses in the stream to the archive, which can be shared by many files to intern their strings
+     * together. If parsing fails, the lenses completed before the error are kept.
+     */
+    void read(std::istream &is, LensArchive &archive, std::vector<ParseDiagnostic> *diagnostics = nullptr) const;
 };
 
 }
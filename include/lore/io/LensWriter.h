@@ -0,0 +1,38 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/LensArchive.h>
+#include <lore/lens/LensSchema.h>
+
+#include <ostream>
+#include <vector>
+
+namespace lore {
+namespace io {
+
+class LensWriter {
+public:
+    /**
+     * Writes lenses in the text .len format understood by LensReader.
+     * Numbers are written in their shortest form that reads back to the same float.
+     * Lenses with a non-finite radius, thickness or aperture are rejected with std::invalid_argument.
+     */
+    void write(std::ostream &os, const LensSchema<float> &lens) const;
+    void write(std::ostream &os, const std::vector<LensSchema<float>> &lenses) const;
+
+    /**
+     * Writes lenses in the binary format read by BinaryLensFile (see BinaryLens.h).
+     * Lenses that BinaryLensFile would reject, e.g. because their stop index is out of range or a dimension is
+     * non-finite, are rejected with std::invalid_argument before anything is written.
+     */
+    void writeBinary(std::ostream &os, const LensArchive &archive) const;
+    void writeBinary(std::ostream &os, const std::vector<LensSchema<float>> &lenses) const;
+
+    /**
+     * Whether writeBinary accepts a lens, e.g. to leave out invalid designs when building a bundle.
+     */
+    static bool canWriteBinary(const LensArchive::LensView &lens);
+};
+
+}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/lens/Glass.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/Surface.h>
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace lore {
+
+/**
+ * The part of a surface that a tracer reads for every ray.
+ */
+template<typename Float = float>
+struct CompactSurface {
+    Float radius;
+    Float thickness;
+
+    /**
+     * Squared aperture radius, or infinity if the aperture is not checked.
+     */
+    Float apertureSqr;
+
+    /**
+     * Ratio of the refractive indices before and after the surface at the wavelength of the lens.
+     */
+    Float eta;
+};
+
+/**
+ * Lens layout for tracing, split into hot and cold data.
+ * Everything a tracer reads per ray is packed into one array of CompactSurface (16 bytes per surface in single
+ * precision, compared to 44 for Surface), so that the surfaces of a lens share few cache lines and thousands of lens
+ * variants stay resident during design-space sweeps. Dispersion coefficients and the original aperture radii are
+ * kept in separate arrays, which are only read when the wavelength changes or when converting back to a Lens.
+ * @note The refractive index ratios are only valid for the wavelength most recently passed to setWavelength.
+ */
+template<typename Float = float>
+struct CompactLens {
+    std::vector<CompactSurface<Float>> geometry;
+
+    std::vector<Glass<Float>> glasses;
+    std::vector<Float> apertures;
+    Float wavelength;
+
+    CompactLens()
+    : wavelength(0) {}
+
+    CompactLens(const Lens<Float> &lens, Float wavelength) {
+        const size_t numSurfaces = lens.surfaces.size();
+        geometry.resize(numSurfaces);
+        glasses.reserve(numSurfaces);
+        apertures.reserve(numSurfaces);
+        for (size_t i = 0; i < numSurfaces; i++) {
+            const Surface<Float> &surface = lens.surfaces[i];
+            geometry[i].radius = surface.radius;
+            geometry[i].thickness = surface.thickness;
+            geometry[i].apertureSqr = surface.checkAperture
+                ? sqr(surface.aperture)
+                : std::numeric_limits<Float>::infinity();
+            glasses.push_back(surface.glass);
+            apertures.push_back(surface.aperture);
+        }
+        setWavelength(wavelength);
+    }
+
+    int size() const {
+        return int(geometry.size());
+    }
+
+    /**
+     * Re-evaluates the refractive index ratios for a new wavelength.
+     */
+    void setWavelength(Float wavelength) {
+        this->wavelength = wavelength;
+        if (geometry.empty()) {
+            return;
+        }
+
+        Float n1 = glasses.front().ior(wavelength);
+        geometry.front().eta = 1;
+        for (size_t i = 1; i < geometry.size(); i++) {
+            const Float n2 = glasses[i].ior(wavelength);
+            geometry[i].eta = Float(n1 / n2);
+            n1 = n2;
+        }
+    }
+
+    bool checksAperture(int surface) const {
+        return geometry[surface].apertureSqr != std::numeric_limits<Float>::infinity();
+    }
+
+    Lens<Float> lens() const {
+        Lens<Float> result;
+        result.surfaces.reserve(geometry.size());
+        for (int i = 0; i < size(); i++) {
+            result.surfaces.push_back(Surface<Float>(
+                geometry[i].radius,
+                geometry[i].thickness,
+                apertures[i],
+                checksAperture(i),
+                glasses[i]
+            ));
+        }
+        return result;
+    }
+
+    /**
+     * Size of the data that is read per ray.
+     */
+    size_t hotBytes() const {
+        return geometry.size() * sizeof(CompactSurface<Float>);
+    }
+};
+
+}
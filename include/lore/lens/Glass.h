@@ -170,6 +170,33 @@ struct Glass {
         return 1;
     }
 
+    /**
+     * Returns a copy of this glass whose refractive index at the given wavelength is offset by dn.
+     * For Sellmeier glasses the oscillator strengths are scaled uniformly, for Laurent glasses the constant term
+     * of the series is shifted.
+     */
+    Glass withIndexOffset(Float dn, Float wavelength) const {
+        Glass result = *this;
+        const Float n = ior(wavelength);
+        const Float nSqr = sqr(n + dn);
+        switch (type) {
+            case SELL3T:
+                if (sell3t.isAir()) {
+                    result.sell3t.B[0] = nSqr - Float(1);
+                } else {
+                    const Float scale = (nSqr - Float(1)) / (sqr(n) - Float(1));
+                    for (int i = 0; i < 3; i++) {
+                        result.sell3t.B[i] *= scale;
+                    }
+                }
+                break;
+            case SCHOTT2X4:
+                result.schott2x4.A[0] += nSqr - sqr(n);
+                break;
+        }
+        return result;
+    }
+
     static Glass air() {
         return Glass(SellmeierIOR<3, Float>::air());
     }
@@ -4,15 +4,31 @@
 #include <lore/lens/Glass.h>
 #include <lore/logging.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <fstream>
+#include <vector>
 
 namespace lore {
 
+/**
+ * Stable index of a glass within a GlassCatalog. Identifiers are only meaningful for the catalog that issued them.
+ */
+using GlassId = uint32_t;
+
 struct GlassCatalog {
     static GlassCatalog shared;
 
+    /**
+     * Every catalog starts out with air, which is also the fallback for unknown glasses.
+     */
+    static constexpr GlassId Air = 0;
+
     struct Entry {
         std::string name;
         float ior;
@@ -24,25 +40,81 @@ struct GlassCatalog {
         float cost;
         int hardness;
         int chemical;
-
-        Glass<float> glass;
     };
 
-    std::unordered_map<std::string, std::vector<std::string>> byCatalog = {};
-    std::unordered_map<std::string, Entry> data = {};
+    /**
+     * Glass metadata, indexed by GlassId. A glass that is read again under the same name keeps its identifier.
+     */
+    std::vector<Entry> entries;
+
+    /**
+     * Dispersion formulas, indexed by GlassId and stored separately from the metadata so that lookups during
+     * optimization stay within a small contiguous table.
+     */
+    std::vector<Glass<float>> glasses;
+
+    std::unordered_map<std::string, std::vector<GlassId>> byCatalog = {};
+
+    GlassCatalog();
 
     int read(const std::string &path);
     int read(std::ifstream &is);
 
-    Glass<float> glass(const std::string &name) const {
-        auto result = data.find(name);
-        if (result == data.end()) {
+    size_t size() const {
+        return entries.size();
+    }
+
+    /**
+     * Returns the identifier of the glass with the given name, if it exists.
+     */
+    std::optional<GlassId> find(std::string_view name) const {
+        const auto result = ids.find(name);
+        if (result == ids.end()) {
+            return std::nullopt;
+        }
+        return result->second;
+    }
+
+    /**
+     * Returns the identifier of the glass with the given name, or Air (with an error message) if it is unknown.
+     */
+    GlassId id(std::string_view name) const {
+        const std::optional<GlassId> result = find(name);
+        if (!result) {
             log::error() << "unknown glass '" << name << "'" << std::flush;
-            return Glass<float>::air();
+            return Air;
         }
+        return *result;
+    }
+
+    const Glass<float> &glass(GlassId id) const {
+        return glasses[id];
+    }
+
+    const Entry &entry(GlassId id) const {
+        return entries[id];
+    }
+
+    const std::string &name(GlassId id) const {
+        return entries[id].name;
+    }
 
-        return result->second.glass;
+    Glass<float> glass(const std::string &name) const {
+        return glasses[id(name)];
     }
+
+private:
+    struct NameHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>()(name);
+        }
+    };
+
+    GlassId insert(const Entry &entry, const Glass<float> &glass);
+
+    std::unordered_map<std::string, GlassId, NameHash, std::equal_to<>> ids;
 };
 
 }
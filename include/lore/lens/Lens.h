@@ -58,6 +58,18 @@ namespace lore {
 template<typename Float = float>
 struct Lens {
     std::vector<Surface<Float>> surfaces;
+
+#ifndef __METAL__
+    template<typename LFloat>
+    Lens<LFloat> cast() const {
+        Lens<LFloat> result;
+        result.surfaces.reserve(surfaces.size());
+        for (const auto &surface : surfaces) {
+            result.surfaces.push_back(surface.template cast<LFloat>());
+        }
+        return result;
+    }
+#endif
 };
 
 }
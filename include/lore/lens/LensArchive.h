@@ -0,0 +1,269 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Glass.h>
+#include <lore/lens/GlassCatalog.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/LensSchema.h>
+#include <lore/lens/Surface.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lore {
+
+/**
+ * Stores each distinct string once and identifies it by a small integer.
+ * Characters are appended to large blocks that are never moved, so the views handed out stay valid for the lifetime
+ * of the pool.
+ */
+class StringPool {
+public:
+    using Id = uint32_t;
+
+    static constexpr size_t BlockSize = size_t(1) << 16;
+
+    StringPool();
+
+    StringPool(StringPool &&) = default;
+    StringPool &operator=(StringPool &&) = default;
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+
+    /**
+     * Returns the id of the given string, adding it to the pool if it is new.
+     * The empty string always has id zero.
+     */
+    Id intern(std::string_view string);
+
+    std::string_view operator[](Id id) const {
+        return strings[id];
+    }
+
+    /**
+     * Number of distinct strings.
+     */
+    size_t size() const {
+        return strings.size();
+    }
+
+    /**
+     * Heap memory held by the pool.
+     */
+    size_t memoryUsage() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::string_view store(std::string_view string);
+
+    std::vector<Block> blocks;
+    size_t used = 0;
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::string_view, Id> index;
+};
+
+/**
+ * A surface as stored in a LensArchive, which refers to its glass by index into the glass table of the archive.
+ */
+struct ArchivedSurface {
+    float radius;
+    float thickness;
+    float aperture;
+    uint32_t glass : 31;
+    uint32_t checkAperture : 1;
+};
+
+/**
+ * An entry of the glass table of a LensArchive.
+ */
+struct ArchivedGlass {
+    StringPool::Id name;
+    GlassId id;
+    Glass<float> glass;
+};
+
+/**
+ * Collection of lens designs for bulk loading, in which all surfaces and wavelengths of all lenses are stored in one
+ * contiguous array each, all strings are interned in a shared StringPool and every distinct glass is stored once.
+ * Compared to one LensSchema per design this needs a handful of allocations in total instead of several per lens
+ * and surface, and shrinks a surface from 80 to 16 bytes.
+ * Lenses are accessed through lightweight views, which can be converted to LensSchema where needed.
+ */
+class LensArchive {
+public:
+    struct Record {
+        StringPool::Id name;
+        StringPool::Id description;
+        float fieldAngle;
+        float entranceBeamRadius;
+        int stopIndex;
+        uint32_t firstSurface;
+        uint32_t numSurfaces;
+        uint32_t firstWavelength;
+        uint32_t numWavelengths;
+    };
+
+    /**
+     * Range of lenses that were appended from one source, such as a file.
+     */
+    struct Source {
+        StringPool::Id name;
+        uint32_t firstLens;
+        uint32_t numLenses;
+    };
+
+    class LensView {
+    public:
+        LensView(const LensArchive &archive, size_t index)
+        : archive(&archive), record(&archive.records[index]) {}
+
+        std::string_view name() const { return archive->strings[record->name]; }
+        std::string_view description() const { return archive->strings[record->description]; }
+        float fieldAngle() const { return record->fieldAngle; }
+        float entranceBeamRadius() const { return record->entranceBeamRadius; }
+        int stopIndex() const { return record->stopIndex; }
+
+        std::span<const ArchivedSurface> surfaces() const {
+            return { archive->surfaces.data() + record->firstSurface, record->numSurfaces };
+        }
+
+        std::span<const WeightedWavelength<float>> wavelengths() const {
+            return { archive->wavelengths.data() + record->firstWavelength, record->numWavelengths };
+        }
+
+        std::string_view glassName(int index) const {
+            return archive->strings[archive->glasses[surfaces()[index].glass].name];
+        }
+
+        GlassId glassId(int index) const {
+            return archive->glasses[surfaces()[index].glass].id;
+        }
+
+        Surface<float> surface(int index) const {
+            return archive->surface(surfaces()[index]);
+        }
+
+        template<typename LFloat>
+        Lens<LFloat> lens() const {
+            Lens<LFloat> result;
+            result.surfaces.reserve(record->numSurfaces);
+            for (const ArchivedSurface &surface : surfaces()) {
+                result.surfaces.push_back(archive->surface(surface).template cast<LFloat>());
+            }
+            return result;
+        }
+
+        /**
+         * Copies the lens into a standalone LensSchema.
+         */
+        LensSchema<float> schema() const;
+
+        const Record &data() const {
+            return *record;
+        }
+
+    private:
+        const LensArchive *archive;
+        const Record *record;
+    };
+
+    size_t size() const {
+        return records.size();
+    }
+
+    bool empty() const {
+        return records.empty();
+    }
+
+    LensView operator[](size_t index) const {
+        return LensView(*this, index);
+    }
+
+    std::vector<LensSchema<float>> schemas() const;
+
+    /**
+     * Heap memory held by the archive, including its string pool.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * Incrementally appends a lens to the archive, which becomes visible once it is completed.
+     */
+    void beginLens(std::string_view name);
+    void setDescription(std::string_view description);
+    void setFieldAngle(float fieldAngle);
+    void setEntranceBeamRadius(float entranceBeamRadius);
+    void markStop();
+    void setStopIndex(int stopIndex);
+    void addWavelength(float wavelength);
+    bool setWavelengthWeight(int index, float weight);
+    void addSurface(const Surface<float> &surface, std::string_view glassName, GlassId glassId = GlassCatalog::Air);
+    void endLens();
+
+    /**
+     * Discards the lens that is currently being appended, e.g. after a parse error.
+     */
+    void abortLens();
+
+    /**
+     * Appends all lenses of another archive, re-interning their strings and glasses, and records them as a source.
+     */
+    void append(const LensArchive &other, std::string_view source);
+
+    /**
+     * Appends only the lenses of another archive for which keep returns true.
+     */
+    void append(const LensArchive &other, std::string_view source, const std::function<bool(const LensView &)> &keep);
+
+    const std::vector<Source> &sourceTable() const {
+        return sources;
+    }
+
+    const StringPool &stringPool() const {
+        return strings;
+    }
+
+    const std::vector<ArchivedGlass> &glassTable() const {
+        return glasses;
+    }
+
+private:
+    Surface<float> surface(const ArchivedSurface &surface) const {
+        return Surface<float>(
+            surface.radius,
+            surface.thickness,
+            surface.aperture,
+            surface.checkAperture,
+            glasses[surface.glass].glass
+        );
+    }
+
+    uint32_t internGlass(std::string_view name, GlassId id, const Glass<float> &glass);
+
+    StringPool strings;
+    std::vector<Record> records;
+    std::vector<ArchivedSurface> surfaces;
+    std::vector<WeightedWavelength<float>> wavelengths;
+    std::vector<Source> sources;
+    Record pending;
+
+    std::vector<ArchivedGlass> glasses;
+
+    /**
+     * Index of the most recent glass table entry for each glass name.
+     */
+    std::unordered_map<StringPool::Id, uint32_t> glassIndex;
+};
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Glass.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/Surface.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+namespace lore {
+
+/**
+ * Incremental 64-bit hash of plain values, used to identify content such as lens designs.
+ * Floating point values are hashed by their canonical bit pattern as double, so that -0 and 0 hash alike and all
+ * NaNs hash alike, while any other change of value changes the hash. The hash is stable across runs and platforms
+ * with the same byte order, but not cryptographic.
+ */
+class ContentHasher {
+public:
+    ContentHasher &add(uint64_t value) {
+        state = mix(state ^ mix(value + count++ * 0x9e3779b97f4a7c15ull));
+        return *this;
+    }
+
+    ContentHasher &add(double value) {
+        if (value == 0) {
+            value = 0;
+        } else if (std::isnan(value)) {
+            value = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return add(bits);
+    }
+
+    ContentHasher &add(std::string_view string) {
+        add(uint64_t(string.size()));
+        for (size_t i = 0; i < string.size(); i += 8) {
+            uint64_t word = 0;
+            std::memcpy(&word, string.data() + i, std::min<size_t>(8, string.size() - i));
+            add(word);
+        }
+        return *this;
+    }
+
+    uint64_t value() const {
+        return mix(state ^ count);
+    }
+
+private:
+    /**
+     * Finalizer of SplitMix64, which spreads every input bit over the whole output.
+     */
+    static uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t state = 0x6c6f72656c656e73ull;
+    uint64_t count = 0;
+};
+
+template<typename Float>
+void hashAppend(ContentHasher &hasher, const Glass<Float> &glass) {
+    // only the active member of the union is hashed, the remaining bytes are unspecified
+    hasher.add(uint64_t(glass.type));
+    switch (glass.type) {
+        case Glass<Float>::SELL3T:
+            for (int i = 0; i < 3; i++) {
+                hasher.add(double(glass.sell3t.B[i]));
+                hasher.add(double(glass.sell3t.C[i]));
+            }
+            break;
+        case Glass<Float>::SCHOTT2X4:
+            for (int i = 0; i < 6; i++) {
+                hasher.add(double(glass.schott2x4.A[i]));
+            }
+            break;
+    }
+}
+
+template<typename Float>
+void hashAppend(ContentHasher &hasher, const Surface<Float> &surface) {
+    hasher.add(double(surface.radius));
+    hasher.add(double(surface.thickness));
+    hasher.add(double(surface.aperture));
+    hasher.add(uint64_t(surface.checkAperture));
+    hashAppend(hasher, surface.glass);
+}
+
+template<typename Float>
+void hashAppend(ContentHasher &hasher, const Lens<Float> &lens) {
+    static_assert(std::is_floating_point_v<Float>, "only lenses of plain floating point types can be hashed");
+
+    // lenses of different precision are distinguished, as analyses of them give different results
+    hasher.add(uint64_t(sizeof(Float)));
+    hasher.add(uint64_t(lens.surfaces.size()));
+    for (const auto &surface : lens.surfaces) {
+        hashAppend(hasher, surface);
+    }
+}
+
+/**
+ * Canonical hash of the complete content of a lens, i.e. the geometry, aperture flags and dispersion formula of
+ * every surface. Any change to a surface changes the hash.
+ */
+template<typename Float>
+uint64_t contentHash(const Lens<Float> &lens) {
+    ContentHasher hasher;
+    hashAppend(hasher, lens);
+    return hasher.value();
+}
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <lore/lore.h>
+#include <lore/lens/GlassCatalog.h>
 #include <lore/lens/Lens.h>
 #include <lore/lens/SurfaceSchema.h>
 
@@ -9,6 +10,13 @@
 
 namespace lore {
 
+template<typename Float>
+void SurfaceSchema<Float>::setGlass(const GlassCatalog &catalog, GlassId id) {
+    glassId = id;
+    glassName = catalog.name(id);
+    this->glass = catalog.glass(id).template cast<Float>();
+}
+
 template<typename Float>
 struct WeightedWavelength {
     Float wavelength;
@@ -47,6 +55,26 @@ struct LensSchema {
         return result;
     }
 
+    /**
+     * Converts to a lens whose materials are looked up by glassId in the given catalog, which must be the catalog
+     * the identifiers were issued by.
+     */
+    template<typename LFloat>
+    Lens<LFloat> lens(const GlassCatalog &catalog) const {
+        Lens<LFloat> result;
+        result.surfaces.reserve(surfaces.size());
+        for (const auto &surface : surfaces) {
+            result.surfaces.emplace_back(
+                surface.radius,
+                surface.thickness,
+                surface.aperture,
+                surface.checkAperture,
+                catalog.glass(surface.glassId).template cast<LFloat>()
+            );
+        }
+        return result;
+    }
+
     Float objectHeight() const {
         return surfaces[0].aperture;
     }
@@ -62,7 +62,18 @@ struct Surface {
     }
 
     Float curvature() const {
-        return isFlat() ? 0 : 1 / radius;
+        return isFlat() ? Float(0) : Float(1) / radius;
+    }
+
+    template<typename LFloat>
+    Surface<LFloat> cast() const {
+        return Surface<LFloat>(
+            LFloat(radius),
+            LFloat(thickness),
+            LFloat(aperture),
+            checkAperture,
+            glass.template cast<LFloat>()
+        );
     }
 };
 
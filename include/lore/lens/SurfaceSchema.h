@@ -3,13 +3,28 @@
 #include <lore/lore.h>
 #include <lore/lens/Surface.h>
 
+#include <cstdint>
 #include <string>
 
 namespace lore {
 
+using GlassId = uint32_t;
+struct GlassCatalog;
+
 template<typename Float = float>
 struct SurfaceSchema : public Surface<Float> {
     std::string glassName;
+
+    /**
+     * The material on the right of the surface, as identified by the catalog the lens was read with (0 is air).
+     * The writers persist glassName and glass, so substitutions have to go through setGlass to keep all three in sync.
+     */
+    GlassId glassId = 0;
+
+    /**
+     * Replaces the material by the glass with the given identifier in catalog.
+     */
+    void setGlass(const GlassCatalog &catalog, GlassId id);
 };
 
 }
@@ -2,6 +2,21 @@
 
 #include <ostream>
 #include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * Messages below this level are removed at compile time (0 = debug, 1 = info, 2 = warning, 3 = error).
+ * Defaults to info in release builds and debug otherwise.
+ */
+#ifndef LORE_LOG_LEVEL
+#ifdef NDEBUG
+#define LORE_LOG_LEVEL 1
+#else
+#define LORE_LOG_LEVEL 0
+#endif
+#endif
 
 namespace lore {
 
@@ -13,17 +28,96 @@ struct Logger {
         LOG_ERROR = 3,
     };
 
+    virtual ~Logger() {}
+
+    /**
+     * Returns a stream for a message of the given level. A message ends when the stream is flushed.
+     */
     virtual std::ostream &log(Level level) = 0;
 
     static std::shared_ptr<Logger> shared;
 };
 
+/**
+ * Logger that writes every message when its stream is flushed, which is the default (see Logger::shared).
+ * Messages are collected in per-thread buffers and written under a lock, so that concurrent messages never interleave.
+ * Messages of level warning and above are written to the error stream, all others to the output stream.
+ */
+struct ConsoleLogger : public Logger {
+    /**
+     * Writes to std::cout and std::cerr.
+     */
+    ConsoleLogger();
+    ConsoleLogger(std::ostream &output, std::ostream &error);
+
+    virtual std::ostream &log(Level level) override;
+
+    /**
+     * Writes a completed message.
+     */
+    void write(Level level, std::string_view text);
+
+private:
+    std::ostream &output;
+    std::ostream &error;
+    std::mutex mutex;
+};
+
+/**
+ * Logger that collects messages in per-thread buffers and hands every completed message to a background thread
+ * through a lock-free queue, so that logging threads neither interleave nor block on console output.
+ * Messages of level warning and above are written to the error stream, all others to the output stream.
+ * Every message costs an allocation and a wakeup of the writer, so this only pays off for programs that log heavily
+ * from many threads, which opt in by replacing Logger::shared.
+ */
+struct AsyncLogger : public Logger {
+    /**
+     * Writes to std::cout and std::cerr.
+     */
+    AsyncLogger();
+    AsyncLogger(std::ostream &output, std::ostream &error);
+    ~AsyncLogger();
+
+    virtual std::ostream &log(Level level) override;
+
+    /**
+     * Blocks until all messages completed so far have been written.
+     */
+    void flush();
+
+    struct State;
+
+private:
+    std::unique_ptr<State> state;
+};
+
+/**
+ * Stand-in for std::ostream that discards everything, used for log levels that are compiled out.
+ */
+struct NullStream {
+    template<typename T>
+    const NullStream &operator<<(const T &) const { return *this; }
+    const NullStream &operator<<(std::ostream &(*)(std::ostream &)) const { return *this; }
+};
+
+template<Logger::Level level>
+using LogStream = std::conditional_t<(level >= LORE_LOG_LEVEL), std::ostream &, NullStream>;
+
 namespace log {
 
-static std::ostream &debug() { return Logger::shared->log(Logger::LOG_DEBUG); }
-static std::ostream &info() { return Logger::shared->log(Logger::LOG_INFO); }
-static std::ostream &warning() { return Logger::shared->log(Logger::LOG_WARNING); }
-static std::ostream &error() { return Logger::shared->log(Logger::LOG_ERROR); }
+template<Logger::Level level>
+static LogStream<level> stream() {
+    if constexpr (level >= LORE_LOG_LEVEL) {
+        return Logger::shared->log(level);
+    } else {
+        return NullStream();
+    }
+}
+
+static LogStream<Logger::LOG_DEBUG> debug() { return stream<Logger::LOG_DEBUG>(); }
+static LogStream<Logger::LOG_INFO> info() { return stream<Logger::LOG_INFO>(); }
+static LogStream<Logger::LOG_WARNING> warning() { return stream<Logger::LOG_WARNING>(); }
+static LogStream<Logger::LOG_ERROR> error() { return stream<Logger::LOG_ERROR>(); }
 
 }
 
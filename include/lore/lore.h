@@ -9,3 +9,11 @@
 #define MTL_THREAD
 #define MTL_DEVICE
 #endif
+
+#if defined(__clang__)
+#define LORE_VECTORIZE _Pragma("clang loop vectorize(enable)")
+#elif defined(__GNUC__)
+#define LORE_VECTORIZE _Pragma("GCC ivdep")
+#else
+#define LORE_VECTORIZE
+#endif
@@ -4,7 +4,9 @@
 
 #ifndef __METAL__
 #include <cmath>
+#include <initializer_list>
 #include <iostream>
+#include <type_traits>
 #endif
 
 namespace lore {
@@ -15,6 +17,7 @@ struct math {
 
 template<typename Float>
 struct math<Float, std::enable_if_t<std::is_floating_point<Float>::value>> {
+    using Value = Float;
     using Detached = Float;
 
     static Float sin(Float v) { return std::sin(v); }
@@ -24,21 +27,52 @@ struct math<Float, std::enable_if_t<std::is_floating_point<Float>::value>> {
     static Float detach(Float v) { return v; }
 };
 
-template<typename Float> Float sqr(Float v) { return v * v; }
-template<typename Float> Float sqrt(Float v) { return math<Float>::sqrt(v); }
-template<typename Float> Float copysign(Float mag, Float sgn) { return math<Float>::copysign(mag, sgn); }
-template<typename Float> Float sin(Float v) { return math<Float>::sin(v); }
-template<typename Float> Float cos(Float v) { return math<Float>::cos(v); }
+/**
+ * math<Float>::Value is the type that results of Float arithmetic are stored in. It differs from Float for
+ * expression types (e.g., FADFloat expression templates), which are evaluated before being returned.
+ */
+template<typename Float> typename math<Float>::Value sqr(Float v) { return v * v; }
+template<typename Float> typename math<Float>::Value sqrt(Float v) { return math<Float>::sqrt(v); }
+template<typename Float> typename math<Float>::Value copysign(Float mag, Float sgn) { return math<Float>::copysign(mag, sgn); }
+template<typename Float> typename math<Float>::Value sin(Float v) { return math<Float>::sin(v); }
+template<typename Float> typename math<Float>::Value cos(Float v) { return math<Float>::cos(v); }
 
 template<typename Float>
 typename math<Float>::Detached detach(Float v) { return math<Float>::detach(v); }
 
+/**
+ * Storage layout of Vector<Float, N>.
+ * Vectors of at least three float or double components are padded with zeros to a multiple of the SIMD width and
+ * aligned accordingly, so that component-wise operations compile to full-width vector instructions.
+ */
+template<typename Float, int N, typename = void>
+struct VectorLayout {
+    static constexpr int Width = N;
+    static constexpr int Alignment = alignof(Float);
+};
+
+#if !defined(__METAL__) && !defined(LORE_DISABLE_SIMD_LAYOUT)
+template<typename Float, int N>
+struct VectorLayout<Float, N, std::enable_if_t<
+    (std::is_same<Float, float>::value || std::is_same<Float, double>::value) && (N >= 3)
+>> {
+    static constexpr int Lanes = N <= 4 ? 4 : int(32 / sizeof(Float));
+    static constexpr int Width = (N + Lanes - 1) / Lanes * Lanes;
+    static constexpr int Alignment = Width * sizeof(Float) < 32 ? int(Width * sizeof(Float)) : 32;
+};
+#endif
+
 template<typename Float, int N>
 struct Vector {
-    Float el[N];
+    /**
+     * Number of stored components, including zero padding.
+     */
+    static constexpr int Width = VectorLayout<Float, N>::Width;
+
+    alignas(VectorLayout<Float, N>::Alignment) Float el[Width];
 
     Vector() {
-        for (int i = 0; i < N; i++) {
+        for (int i = 0; i < Width; i++) {
             el[i] = 0;
         }
     }
@@ -47,6 +81,9 @@ struct Vector {
         for (int i = 0; i < N; i++) {
             el[i] = v;
         }
+        for (int i = N; i < Width; i++) {
+            el[i] = 0;
+        }
     }
 
     Vector(std::initializer_list<Float> l) {
@@ -57,6 +94,9 @@ struct Vector {
             el[i] = *it;
             it++;
         }
+        for (int i = N; i < Width; i++) {
+            el[i] = 0;
+        }
     }
 
     MTL_THREAD Float &operator()(int i) {
@@ -113,15 +153,17 @@ MTL_THREAD const Float &name() const { \
     }
 
     MTL_THREAD Vector &operator*=(MTL_THREAD const Float &other) {
-        for (int i = 0; i < N; i++) {
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
             el[i] *= other;
         }
         return *this;
     }
 
     MTL_THREAD Vector &operator*=(MTL_THREAD const Vector &other) {
-        for (int i = 0; i < N; i++) {
-            el[i] *= other(i);
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            el[i] *= other.el[i];
         }
         return *this;
     }
@@ -131,15 +173,31 @@ MTL_THREAD const Float &name() const { \
     }
 
     MTL_THREAD Vector &operator+=(MTL_THREAD const Vector &other) {
-        for (int i = 0; i < N; i++) {
-            (*this)(i) += other(i);
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            el[i] += other.el[i];
         }
         return *this;
     }
 
     MTL_THREAD Vector &operator-=(MTL_THREAD const Vector &other) {
-        for (int i = 0; i < N; i++) {
-            (*this)(i) -= other(i);
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            el[i] -= other.el[i];
+        }
+        return *this;
+    }
+
+    /**
+     * Assigns a * sa + b * sb in a single pass without temporaries.
+     */
+    MTL_THREAD Vector &assignLinearCombination(
+        MTL_THREAD const Vector &a, MTL_THREAD const Float &sa,
+        MTL_THREAD const Vector &b, MTL_THREAD const Float &sb
+    ) {
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            el[i] = a.el[i] * sa + b.el[i] * sb;
         }
         return *this;
     }
@@ -176,14 +234,16 @@ MTL_THREAD const Float &name() const { \
 
     Vector operator-() const {
         Vector copy;
-        for (int i = 0; i < N; i++) {
-            copy(i) = -(*this)(i);
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            copy.el[i] = -el[i];
         }
         return copy;
     }
 
-    friend Vector operator*(MTL_THREAD const Float &lhs, Vector rhs) {
-        return rhs *= lhs;
+    friend Vector operator*(MTL_THREAD const Float &lhs, MTL_THREAD const Vector &rhs) {
+        Vector copy = rhs;
+        return copy *= lhs;
     }
 
     bool operator==(MTL_THREAD const Vector &other) const {
@@ -202,6 +262,7 @@ MTL_THREAD const Float &name() const { \
 
 template<typename Float, int N>
 struct math<Vector<Float, N>> {
+    using Value = Vector<Float, N>;
     using Detached = Vector<typename math<Float>::Detached, N>;
     using Base = Vector<Float, N>;
 
@@ -3,11 +3,148 @@
 #include <lore/lore.h>
 #include <lore/math.h>
 
+#include <string>
+#include <type_traits>
+
 namespace lore {
 namespace optim {
 
 template<typename Float, int N>
-struct FADFloat {
+struct FADFloat;
+
+/**
+ * Base class of all forward-mode autodiff expressions.
+ * Arithmetic on FADFloat values builds a tree of lightweight expression nodes, which caches the values and local
+ * partial derivatives of every node. Gradients are only computed when an expression is assigned to a FADFloat, in a
+ * single loop over all derivative lanes, so that no intermediate gradient vectors are materialized.
+ * @note Expression nodes refer to their FADFloat operands, so they must not outlive the full expression.
+ * Always store results as FADFloat rather than auto.
+ */
+template<typename Derived>
+struct FADExpression {
+    const Derived &derived() const {
+        return static_cast<const Derived &>(*this);
+    }
+};
+
+template<typename T>
+struct IsFADFloat : std::false_type {};
+
+template<typename Float, int N>
+struct IsFADFloat<FADFloat<Float, N>> : std::true_type {};
+
+template<typename T>
+struct IsFADExpression : std::is_base_of<FADExpression<T>, T> {};
+
+/**
+ * FADFloat operands are held by reference, nested expression nodes by value.
+ */
+template<typename E>
+using FADOperand = std::conditional_t<IsFADFloat<E>::value, const E &, const E>;
+
+template<typename L, typename R>
+using EnableIfCompatibleFAD = std::enable_if_t<std::is_same<typename L::Result, typename R::Result>::value>;
+
+template<typename L, typename R>
+struct FADSum : FADExpression<FADSum<L, R>> {
+    using Scalar = typename L::Scalar;
+    using Result = typename L::Result;
+
+    FADOperand<L> lhs;
+    FADOperand<R> rhs;
+    Scalar V;
+
+    FADSum(const L &lhs, const R &rhs)
+    : lhs(lhs), rhs(rhs), V(lhs.value() + rhs.value()) {}
+
+    const Scalar &value() const { return V; }
+    Scalar gradient(int i) const { return lhs.gradient(i) + rhs.gradient(i); }
+};
+
+template<typename L, typename R>
+struct FADDifference : FADExpression<FADDifference<L, R>> {
+    using Scalar = typename L::Scalar;
+    using Result = typename L::Result;
+
+    FADOperand<L> lhs;
+    FADOperand<R> rhs;
+    Scalar V;
+
+    FADDifference(const L &lhs, const R &rhs)
+    : lhs(lhs), rhs(rhs), V(lhs.value() - rhs.value()) {}
+
+    const Scalar &value() const { return V; }
+    Scalar gradient(int i) const { return lhs.gradient(i) - rhs.gradient(i); }
+};
+
+/**
+ * Binary node whose gradient is a * d(lhs) + b * d(rhs), used for products and quotients.
+ */
+template<typename L, typename R>
+struct FADLinear : FADExpression<FADLinear<L, R>> {
+    using Scalar = typename L::Scalar;
+    using Result = typename L::Result;
+
+    FADOperand<L> lhs;
+    FADOperand<R> rhs;
+    Scalar V;
+    Scalar a;
+    Scalar b;
+
+    FADLinear(const L &lhs, const R &rhs, const Scalar &V, const Scalar &a, const Scalar &b)
+    : lhs(lhs), rhs(rhs), V(V), a(a), b(b) {}
+
+    const Scalar &value() const { return V; }
+    Scalar gradient(int i) const { return lhs.gradient(i) * a + rhs.gradient(i) * b; }
+};
+
+/**
+ * Unary node whose gradient is factor * d(operand), used for scaling and elementary functions.
+ */
+template<typename E>
+struct FADChain : FADExpression<FADChain<E>> {
+    using Scalar = typename E::Scalar;
+    using Result = typename E::Result;
+
+    FADOperand<E> operand;
+    Scalar V;
+    Scalar factor;
+
+    FADChain(const E &operand, const Scalar &V, const Scalar &factor)
+    : operand(operand), V(V), factor(factor) {}
+
+    const Scalar &value() const { return V; }
+    Scalar gradient(int i) const { return operand.gradient(i) * factor; }
+};
+
+/**
+ * Unary node that changes the value of its operand but not its gradient, used for adding constants.
+ */
+template<typename E>
+struct FADShift : FADExpression<FADShift<E>> {
+    using Scalar = typename E::Scalar;
+    using Result = typename E::Result;
+
+    FADOperand<E> operand;
+    Scalar V;
+
+    FADShift(const E &operand, const Scalar &V)
+    : operand(operand), V(V) {}
+
+    const Scalar &value() const { return V; }
+    Scalar gradient(int i) const { return operand.gradient(i); }
+};
+
+template<typename Float, int N>
+struct FADFloat : FADExpression<FADFloat<Float, N>> {
+    using Scalar = Float;
+    using Result = FADFloat;
+
+    /**
+     * Number of stored derivative lanes, including SIMD padding.
+     */
+    static constexpr int Width = Vector<Float, N>::Width;
+
     Float V;
     Vector<Float, N> dVd;
 
@@ -17,54 +154,208 @@ struct FADFloat {
     FADFloat(Float V)
         : V(V), dVd() {}
 
+    /**
+     * Converts plain numbers directly, which is needed when Float is itself a FADFloat (nested differentiation).
+     */
+    template<typename A, typename = std::enable_if_t<std::is_arithmetic<A>::value && !std::is_same<A, Float>::value>>
+    FADFloat(A V)
+        : V(Float(V)), dVd() {}
+
     FADFloat(Float V, const Vector<Float, N> &dVd)
         : V(V), dVd(dVd) {}
 
-    FADFloat operator+(const FADFloat &other) const {
-        return FADFloat(V + other.V, dVd + other.dVd);
+    template<typename E, typename = EnableIfCompatibleFAD<E, FADFloat>>
+    FADFloat(const FADExpression<E> &expression) {
+        assign(expression.derived());
     }
 
-    FADFloat operator-(const FADFloat &other) const {
-        return FADFloat(V - other.V, dVd - other.dVd);
+    template<typename E, typename = EnableIfCompatibleFAD<E, FADFloat>>
+    FADFloat &operator=(const FADExpression<E> &expression) {
+        assign(expression.derived());
+        return *this;
     }
 
-    FADFloat operator*(const FADFloat &other) const {
-        return FADFloat(V * other.V, dVd * other.V + other.dVd * V);
+    const Float &value() const { return V; }
+    const Float &gradient(int i) const { return dVd.el[i]; }
+
+    template<typename E, typename = EnableIfCompatibleFAD<E, FADFloat>>
+    FADFloat &operator+=(const FADExpression<E> &expression) {
+        const E &e = expression.derived();
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            dVd.el[i] += e.gradient(i);
+        }
+        V += e.value();
+        return *this;
+    }
+
+    template<typename E, typename = EnableIfCompatibleFAD<E, FADFloat>>
+    FADFloat &operator-=(const FADExpression<E> &expression) {
+        const E &e = expression.derived();
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            dVd.el[i] -= e.gradient(i);
+        }
+        V -= e.value();
+        return *this;
     }
 
-    FADFloat operator/(const FADFloat &other) const {
-        return FADFloat(V / other.V, (dVd * other.V - other.dVd * V) / sqr(other.V));
+    template<typename E, typename = EnableIfCompatibleFAD<E, FADFloat>>
+    FADFloat &operator*=(const FADExpression<E> &expression) {
+        return *this = *this * expression.derived();
     }
 
-    FADFloat operator-() const {
-        return FADFloat(-V, -dVd);
+    template<typename E, typename = EnableIfCompatibleFAD<E, FADFloat>>
+    FADFloat &operator/=(const FADExpression<E> &expression) {
+        return *this = *this / expression.derived();
     }
 
-    FADFloat operator+=(const FADFloat &other) {
-        return (*this = *this + other);
+    FADFloat &operator+=(const Float &other) {
+        V += other;
+        return *this;
     }
 
-    FADFloat operator-=(const FADFloat &other) {
-        return (*this = *this - other);
+    FADFloat &operator-=(const Float &other) {
+        V -= other;
+        return *this;
     }
 
-    FADFloat operator*=(const FADFloat &other) {
-        return (*this = *this * other);
+    FADFloat &operator*=(const Float &other) {
+        V *= other;
+        dVd *= other;
+        return *this;
     }
 
-    FADFloat operator/=(const FADFloat &other) {
-        return (*this = *this / other);
+    FADFloat &operator/=(const Float &other) {
+        return *this *= Float(1) / other;
     }
 
-    bool operator>(const FADFloat &other) const { return V > other.V; }
-    bool operator<(const FADFloat &other) const { return V < other.V; }
-    bool operator==(const FADFloat &other) const { return V == other.V; }
-    bool operator!=(const FADFloat &other) const { return V != other.V; }
+private:
+    /**
+     * Evaluates the gradient of an expression in a single pass. The expression may refer to this value, since every
+     * node only reads the lane that is being written and node values are cached on construction.
+     */
+    template<typename E>
+    void assign(const E &e) {
+        const Float value = e.value();
+        LORE_VECTORIZE
+        for (int i = 0; i < Width; i++) {
+            dVd.el[i] = e.gradient(i);
+        }
+        V = value;
+    }
 };
 
+// expression operators
+
+template<typename L, typename R, typename = EnableIfCompatibleFAD<L, R>>
+FADSum<L, R> operator+(const FADExpression<L> &lhs, const FADExpression<R> &rhs) {
+    return { lhs.derived(), rhs.derived() };
+}
+
+template<typename L, typename R, typename = EnableIfCompatibleFAD<L, R>>
+FADDifference<L, R> operator-(const FADExpression<L> &lhs, const FADExpression<R> &rhs) {
+    return { lhs.derived(), rhs.derived() };
+}
+
+template<typename L, typename R, typename = EnableIfCompatibleFAD<L, R>>
+FADLinear<L, R> operator*(const FADExpression<L> &lhs, const FADExpression<R> &rhs) {
+    const auto &l = lhs.derived();
+    const auto &r = rhs.derived();
+    return { l, r, l.value() * r.value(), r.value(), l.value() };
+}
+
+template<typename L, typename R, typename = EnableIfCompatibleFAD<L, R>>
+FADLinear<L, R> operator/(const FADExpression<L> &lhs, const FADExpression<R> &rhs) {
+    using Scalar = typename L::Scalar;
+    const auto &l = lhs.derived();
+    const auto &r = rhs.derived();
+    const Scalar inverse = Scalar(1) / r.value();
+    const Scalar quotient = l.value() / r.value();
+    return { l, r, quotient, inverse, -quotient * inverse };
+}
+
+template<typename E>
+FADChain<E> operator-(const FADExpression<E> &operand) {
+    using Scalar = typename E::Scalar;
+    const auto &e = operand.derived();
+    return { e, -e.value(), Scalar(-1) };
+}
+
+// scalar operators
+
+template<typename E>
+FADShift<E> operator+(const FADExpression<E> &lhs, const typename E::Scalar &rhs) {
+    return { lhs.derived(), lhs.derived().value() + rhs };
+}
+
+template<typename E>
+FADShift<E> operator+(const typename E::Scalar &lhs, const FADExpression<E> &rhs) {
+    return { rhs.derived(), lhs + rhs.derived().value() };
+}
+
+template<typename E>
+FADShift<E> operator-(const FADExpression<E> &lhs, const typename E::Scalar &rhs) {
+    return { lhs.derived(), lhs.derived().value() - rhs };
+}
+
+template<typename E>
+FADChain<E> operator-(const typename E::Scalar &lhs, const FADExpression<E> &rhs) {
+    using Scalar = typename E::Scalar;
+    return { rhs.derived(), lhs - rhs.derived().value(), Scalar(-1) };
+}
+
+template<typename E>
+FADChain<E> operator*(const FADExpression<E> &lhs, const typename E::Scalar &rhs) {
+    return { lhs.derived(), lhs.derived().value() * rhs, rhs };
+}
+
+template<typename E>
+FADChain<E> operator*(const typename E::Scalar &lhs, const FADExpression<E> &rhs) {
+    return { rhs.derived(), lhs * rhs.derived().value(), lhs };
+}
+
+template<typename E>
+FADChain<E> operator/(const FADExpression<E> &lhs, const typename E::Scalar &rhs) {
+    using Scalar = typename E::Scalar;
+    return { lhs.derived(), lhs.derived().value() / rhs, Scalar(1) / rhs };
+}
+
+template<typename E>
+FADChain<E> operator/(const typename E::Scalar &lhs, const FADExpression<E> &rhs) {
+    using Scalar = typename E::Scalar;
+    const Scalar quotient = lhs / rhs.derived().value();
+    return { rhs.derived(), quotient, -quotient / rhs.derived().value() };
+}
+
+// comparisons only consider values
+
+#define LORE_FAD_COMPARISON(op) \
+template<typename L, typename R, typename = EnableIfCompatibleFAD<L, R>> \
+bool operator op(const FADExpression<L> &lhs, const FADExpression<R> &rhs) { \
+    return lhs.derived().value() op rhs.derived().value(); \
+} \
+template<typename E> \
+bool operator op(const FADExpression<E> &lhs, const typename E::Scalar &rhs) { \
+    return lhs.derived().value() op rhs; \
+} \
+template<typename E> \
+bool operator op(const typename E::Scalar &lhs, const FADExpression<E> &rhs) { \
+    return lhs op rhs.derived().value(); \
+}
+
+LORE_FAD_COMPARISON(<)
+LORE_FAD_COMPARISON(>)
+LORE_FAD_COMPARISON(<=)
+LORE_FAD_COMPARISON(>=)
+LORE_FAD_COMPARISON(==)
+LORE_FAD_COMPARISON(!=)
+
+#undef LORE_FAD_COMPARISON
+
 template<typename Float, int N>
 std::ostream &operator<<(std::ostream &os, optim::FADFloat<Float, N> const &value) {
-    os << "FAD<" << N << ">{ " << std::to_string(value.V) << ", { ";
+    os << "FAD<" << N << ">{ " << value.V << ", { ";
     for (int i = 0; i < N; i++) {
         if (i) os << ", ";
         os << value.dVd(i);
@@ -75,31 +366,44 @@ std::ostream &operator<<(std::ostream &os, optim::FADFloat<Float, N> const &valu
 
 }
 
+/**
+ * Float may itself be a FADFloat, in which case derivatives of derivatives are propagated (forward-over-forward).
+ */
 template<typename Float, int N>
 struct math<optim::FADFloat<Float, N>> {
     using FAD = optim::FADFloat<Float, N>;
-    using Detached = Float;
+    using Value = FAD;
+    using Detached = typename math<Float>::Detached;
 
-    static FAD sin(FAD v) {
-        return {math<Float>::sin(v.V), v.dVd * math<Float>::cos(v.V)};
+    static FAD sin(const FAD &v) {
+        return optim::FADChain<FAD>(v, math<Float>::sin(v.V), math<Float>::cos(v.V));
     }
 
-    static FAD cos(FAD v) {
-        return {math<Float>::cos(v.V), -v.dVd * math<Float>::sin(v.V)};
+    static FAD cos(const FAD &v) {
+        return optim::FADChain<FAD>(v, math<Float>::cos(v.V), -math<Float>::sin(v.V));
     }
 
-    static FAD sqrt(FAD v) {
+    static FAD sqrt(const FAD &v) {
         const Float root = math<Float>::sqrt(v.V);
-        return {root, v.dVd / (2 * root)};
+        return optim::FADChain<FAD>(v, root, Float(0.5) / root);
     }
 
-    static FAD copysign(FAD mag, FAD sgn) {
-        return std::copysign(mag.V, sgn.V);
+    static FAD copysign(const FAD &mag, const FAD &sgn) {
+        const Float value = math<Float>::copysign(mag.V, sgn.V);
+        return optim::FADChain<FAD>(mag, value, value == mag.V ? Float(1) : Float(-1));
     }
 
-    static Float detach(FAD v) {
-        return v.V;
+    static Detached detach(const FAD &v) {
+        return math<Float>::detach(v.V);
     }
 };
 
+/**
+ * Expressions are evaluated into a FADFloat before elementary functions are applied.
+ */
+template<typename E>
+struct math<E, std::enable_if_t<optim::IsFADExpression<E>::value && !optim::IsFADFloat<E>::value>>
+    : math<typename E::Result> {
+};
+
 }
@@ -0,0 +1,552 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/analysis/ResultCache.h>
+#include <lore/lens/Lens.h>
+#include <lore/lens/LensHash.h>
+#include <lore/lens/LensSchema.h>
+#include <lore/rt/ABCD.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace lore {
+namespace optim {
+
+/**
+ * Declarative description of a single merit function term.
+ */
+struct Operand {
+    enum Type {
+        /// RMS spot radius about the centroid for one field point and wavelength.
+        SPOT_RMS,
+        /// Effective focal length for one wavelength.
+        EFL,
+        /// Relative deviation of the real chief ray height from the paraxial image height.
+        DISTORTION,
+        /// Axial thickness of an element at the larger of its two apertures.
+        EDGE_THICKNESS,
+    };
+
+    enum Bound {
+        /// Penalize any deviation from the target.
+        TARGET,
+        /// Penalize only values below the target.
+        MINIMUM,
+        /// Penalize only values above the target.
+        MAXIMUM,
+    };
+
+    Type type;
+    Bound bound = TARGET;
+    double target = 0;
+    double weight = 1;
+
+    /**
+     * Relative field coordinate (SPOT_RMS, DISTORTION).
+     */
+    double field = 0;
+
+    /**
+     * Index into LensSchema::wavelengths (SPOT_RMS, EFL, DISTORTION).
+     */
+    int wavelength = 0;
+
+    /**
+     * Index of the first surface of the element (EDGE_THICKNESS).
+     */
+    int surface = 0;
+
+    /**
+     * Number of pupil samples along each axis; odd values include the chief ray (SPOT_RMS).
+     */
+    int samples = 0;
+
+    static Operand spotRms(double field, int wavelength = 0, int samples = 7, double weight = 1) {
+        Operand result;
+        result.type = SPOT_RMS;
+        result.field = field;
+        result.wavelength = wavelength;
+        result.samples = samples;
+        result.weight = weight;
+        return result;
+    }
+
+    static Operand efl(double target, int wavelength = 0, double weight = 1) {
+        Operand result;
+        result.type = EFL;
+        result.target = target;
+        result.wavelength = wavelength;
+        result.weight = weight;
+        return result;
+    }
+
+    static Operand distortion(double field, double target = 0, int wavelength = 0, double weight = 1) {
+        Operand result;
+        result.type = DISTORTION;
+        result.field = field;
+        result.target = target;
+        result.wavelength = wavelength;
+        result.weight = weight;
+        return result;
+    }
+
+    static Operand edgeThickness(int surface, double minimum, double weight = 1) {
+        Operand result;
+        result.type = EDGE_THICKNESS;
+        result.bound = MINIMUM;
+        result.surface = surface;
+        result.target = minimum;
+        result.weight = weight;
+        return result;
+    }
+};
+
+template<typename Float>
+struct MeritResult {
+    /**
+     * Weighted sum of squared residuals.
+     */
+    Float merit;
+
+    /**
+     * Value of every operand, in the order the operands were added.
+     */
+    std::vector<Float> values;
+
+    /**
+     * Number of distinct rays that were vignetted or failed to trace.
+     */
+    int failedRays = 0;
+};
+
+/**
+ * Flat execution plan compiled from a MeritFunction.
+ * All rays required by the operands are deduplicated (a ray is identified by its wavelength, field and pupil
+ * coordinate), traced once per evaluation and then consumed by a linear list of instructions.
+ */
+struct MeritProgram {
+    struct TracedRay {
+        int wavelength;
+        double field;
+        double px;
+        double py;
+    };
+
+    struct Instruction {
+        Operand::Type type;
+        Operand::Bound bound;
+        double target;
+        double weight;
+        double field;
+
+        /**
+         * Range in rayIndices consumed by this instruction.
+         */
+        int rayBegin;
+        int rayEnd;
+
+        /**
+         * Index into paraxialWavelengths, or -1 if no paraxial data is required.
+         */
+        int paraxial;
+
+        int surface;
+    };
+
+    /**
+     * Scratch buffers of a single evaluation, which can be kept alive to avoid reallocation.
+     */
+    template<typename Float>
+    struct Workspace {
+        std::vector<Vector2<Float>> hits;
+        std::vector<char> valid;
+        std::vector<Matrix2x2<Float>> paraxial;
+    };
+
+    rt::RayGenerator<double> generator;
+    std::vector<double> wavelengths;
+
+    /**
+     * Unique rays, sorted by wavelength, field and pupil coordinate.
+     */
+    std::vector<TracedRay> rays;
+    std::vector<int> rayIndices;
+
+    /**
+     * Wavelength indices for which a paraxial system matrix is required.
+     */
+    std::vector<int> paraxialWavelengths;
+    std::vector<Instruction> instructions;
+
+    template<typename Float>
+    MeritResult<Float> evaluate(const Lens<Float> &lens, bool parallel = true) const {
+        Workspace<Float> workspace;
+        MeritResult<Float> result;
+        evaluate(lens, workspace, result, parallel);
+        return result;
+    }
+
+    /**
+     * Looks up the evaluation in a result cache and only traces the lens on a miss.
+     */
+    template<typename Float>
+    MeritResult<Float> evaluate(const Lens<Float> &lens, ResultCache &cache, bool parallel = true) const {
+        static_assert(std::is_floating_point_v<Float>, "only plain floating point evaluations can be cached");
+
+        ContentHasher query;
+        query.add("merit/1").add(hash());
+        const ResultCache::Key key { contentHash(lens), query.value() };
+        // merit and failed rays precede the operand values
+        const std::vector<double> values = cache.get(key, 2 + instructions.size(), [&]() {
+            const MeritResult<Float> result = evaluate(lens, parallel);
+            std::vector<double> values { double(result.merit), double(result.failedRays) };
+            values.insert(values.end(), result.values.begin(), result.values.end());
+            return values;
+        });
+
+        MeritResult<Float> result;
+        result.merit = Float(values[0]);
+        result.failedRays = int(values[1]);
+        result.values.assign(values.begin() + 2, values.end());
+        return result;
+    }
+
+    /**
+     * Hash of everything that determines the result of an evaluation besides the lens.
+     */
+    uint64_t hash() const {
+        ContentHasher hasher;
+        hasher.add(double(generator.fieldAngle));
+        hasher.add(double(generator.objectHeight));
+        hasher.add(double(generator.objectDistance));
+        hasher.add(double(generator.entranceBeamRadius));
+        hasher.add(double(generator.entrancePupilPosition));
+        hasher.add(double(generator.launchDistance));
+        hasher.add(uint64_t(generator.infinite));
+
+        hasher.add(uint64_t(wavelengths.size()));
+        for (const double wavelength : wavelengths) {
+            hasher.add(wavelength);
+        }
+
+        hasher.add(uint64_t(rays.size()));
+        for (const TracedRay &ray : rays) {
+            hasher.add(uint64_t(ray.wavelength)).add(ray.field).add(ray.px).add(ray.py);
+        }
+
+        hasher.add(uint64_t(rayIndices.size()));
+        for (const int ray : rayIndices) {
+            hasher.add(uint64_t(ray));
+        }
+
+        hasher.add(uint64_t(paraxialWavelengths.size()));
+        for (const int wavelength : paraxialWavelengths) {
+            hasher.add(uint64_t(wavelength));
+        }
+
+        hasher.add(uint64_t(instructions.size()));
+        for (const Instruction &instruction : instructions) {
+            hasher.add(uint64_t(instruction.type)).add(uint64_t(instruction.bound));
+            hasher.add(instruction.target).add(instruction.weight).add(instruction.field);
+            hasher.add(uint64_t(instruction.rayBegin)).add(uint64_t(instruction.rayEnd));
+            hasher.add(uint64_t(instruction.paraxial)).add(uint64_t(instruction.surface));
+        }
+        return hasher.value();
+    }
+
+    /**
+     * Evaluates the program for a lens that is compatible with the schema the program was compiled for.
+     * @param parallel Whether rays are traced in parallel. Disable this when evaluating many lenses concurrently.
+     */
+    template<typename Float>
+    void evaluate(
+        const Lens<Float> &lens,
+        Workspace<Float> &workspace,
+        MeritResult<Float> &result,
+        bool parallel = true
+    ) const {
+        LORE_PROFILE_SCOPE("MeritProgram::evaluate");
+        using Intersector = rt::GeometricalIntersector<Float>;
+
+        const rt::RayGenerator<Float> rayGenerator = generator.template cast<Float>();
+        const Intersector intersector {};
+
+        const int numRays = int(rays.size());
+        workspace.hits.resize(numRays);
+        workspace.valid.resize(numRays);
+
+        auto traceRay = [&](int i) {
+            const TracedRay &spec = rays[i];
+            const rt::SequentialTrace<Float, Intersector> trace { lens, intersector, Float(wavelengths[spec.wavelength]) };
+
+            rt::Ray<Float> ray = rayGenerator(Float(spec.field), Float(spec.px), Float(spec.py));
+            workspace.valid[i] = trace(ray);
+            workspace.hits[i] = Vector2<Float> { ray.origin.x(), ray.origin.y() };
+        };
+
+        if (parallel) {
+            parallel::parallelFor(0, numRays, traceRay, 16);
+        } else {
+            for (int i = 0; i < numRays; i++) {
+                traceRay(i);
+            }
+        }
+
+        workspace.paraxial.resize(paraxialWavelengths.size());
+        for (size_t i = 0; i < paraxialWavelengths.size(); i++) {
+            workspace.paraxial[i] = abcd::full(lens, Float(wavelengths[paraxialWavelengths[i]]));
+        }
+
+        result.failedRays = 0;
+        for (int i = 0; i < numRays; i++) {
+            if (!workspace.valid[i]) {
+                result.failedRays++;
+            }
+        }
+
+        result.merit = Float(0);
+        result.values.resize(instructions.size());
+        for (size_t i = 0; i < instructions.size(); i++) {
+            const Instruction &instruction = instructions[i];
+            const Float value = execute(instruction, lens, workspace, rayGenerator);
+            result.values[i] = value;
+
+            Float residual = Float(0);
+            const Float target = Float(instruction.target);
+            switch (instruction.bound) {
+                case Operand::TARGET:
+                    residual = value - target;
+                    break;
+                case Operand::MINIMUM:
+                    if (value < target) residual = value - target;
+                    break;
+                case Operand::MAXIMUM:
+                    if (value > target) residual = value - target;
+                    break;
+            }
+            result.merit += Float(instruction.weight) * sqr(residual);
+        }
+    }
+
+private:
+    template<typename Float>
+    Float execute(
+        const Instruction &instruction,
+        const Lens<Float> &lens,
+        const Workspace<Float> &workspace,
+        const rt::RayGenerator<Float> &rayGenerator
+    ) const {
+        switch (instruction.type) {
+            case Operand::SPOT_RMS: {
+                int count = 0;
+                Vector2<Float> centroid;
+                for (int i = instruction.rayBegin; i < instruction.rayEnd; i++) {
+                    const int ray = rayIndices[i];
+                    if (workspace.valid[ray]) {
+                        centroid += workspace.hits[ray];
+                        count++;
+                    }
+                }
+                if (count == 0) {
+                    return Float(0);
+                }
+                centroid /= Float(count);
+
+                Float sum = Float(0);
+                for (int i = instruction.rayBegin; i < instruction.rayEnd; i++) {
+                    const int ray = rayIndices[i];
+                    if (workspace.valid[ray]) {
+                        sum += (workspace.hits[ray] - centroid).lengthSquared();
+                    }
+                }
+                if (sum == Float(0)) {
+                    return Float(0);
+                }
+                return sqrt(sum / Float(count));
+            }
+
+            case Operand::EFL: {
+                const Matrix2x2<Float> &matrix = workspace.paraxial[instruction.paraxial];
+                return Float(1) / -matrix(1, 0);
+            }
+
+            case Operand::DISTORTION: {
+                const int chief = rayIndices[instruction.rayBegin];
+                if (instruction.field == 0 || !workspace.valid[chief]) {
+                    return Float(0);
+                }
+
+                // the paraxial chief ray crosses the axis at the entrance pupil, and thus passes the center of the stop
+                const Float field = Float(instruction.field);
+                const Float pupil = rayGenerator.entrancePupilPosition;
+                Float slope;
+                if (rayGenerator.infinite) {
+                    const Float angle = field * rayGenerator.fieldAngle;
+                    slope = lore::sin(angle) / lore::cos(angle);
+                } else {
+                    slope = field * rayGenerator.objectHeight / (rayGenerator.objectDistance + pupil);
+                }
+
+                const Matrix2x2<Float> &matrix = workspace.paraxial[instruction.paraxial];
+                const Float paraxialHeight = (matrix(0, 1) - matrix(0, 0) * pupil) * slope;
+                return (workspace.hits[chief].y() - paraxialHeight) / paraxialHeight;
+            }
+
+            case Operand::EDGE_THICKNESS: {
+                const Surface<Float> &front = lens.surfaces[instruction.surface];
+                const Surface<Float> &back = lens.surfaces[instruction.surface + 1];
+                const Float aperture = front.aperture > back.aperture ? front.aperture : back.aperture;
+                return front.thickness - sag(front, aperture) + sag(back, aperture);
+            }
+        }
+        return Float(0);
+    }
+
+    /**
+     * Sag of a spherical surface at the given height, clamped to a hemisphere.
+     */
+    template<typename Float>
+    static Float sag(const Surface<Float> &surface, Float height) {
+        if (surface.isFlat()) {
+            return Float(0);
+        }
+
+        const Float disc = sqr(surface.radius) - sqr(height);
+        if (disc < Float(0)) {
+            return surface.radius;
+        }
+        const Float root = sqrt(disc);
+        if (surface.radius > Float(0)) {
+            return surface.radius - root;
+        }
+        return surface.radius + root;
+    }
+};
+
+/**
+ * A merit function composed of declarative operands, which is compiled against a LensSchema into a MeritProgram.
+ */
+struct MeritFunction {
+    std::vector<Operand> operands;
+
+    MeritFunction &add(const Operand &operand) {
+        operands.push_back(operand);
+        return *this;
+    }
+
+    template<typename SFloat>
+    MeritProgram compile(const LensSchema<SFloat> &schema) const {
+        using RayKey = std::tuple<int, double, double, double>;
+
+        MeritProgram program;
+        program.generator = rt::RayGenerator<double>(schema);
+        for (const auto &ww : schema.wavelengths) {
+            program.wavelengths.push_back(ww.wavelength);
+        }
+
+        // collect the rays of every operand
+        std::vector<std::vector<RayKey>> operandRays(operands.size());
+        std::map<RayKey, int> uniqueRays;
+        std::map<int, int> paraxialIndex;
+
+        for (size_t i = 0; i < operands.size(); i++) {
+            const Operand &operand = operands[i];
+            validate(operand, schema);
+
+            auto &keys = operandRays[i];
+            if (operand.type == Operand::SPOT_RMS) {
+                for (int iy = 0; iy < operand.samples; iy++) {
+                    for (int ix = 0; ix < operand.samples; ix++) {
+                        const double px = 2 * (ix + 0.5) / operand.samples - 1;
+                        const double py = 2 * (iy + 0.5) / operand.samples - 1;
+                        if (sqr(px) + sqr(py) <= 1) {
+                            keys.emplace_back(operand.wavelength, operand.field, px, py);
+                        }
+                    }
+                }
+            } else if (operand.type == Operand::DISTORTION) {
+                keys.emplace_back(operand.wavelength, operand.field, 0.0, 0.0);
+            }
+
+            for (const RayKey &key : keys) {
+                uniqueRays.emplace(key, -1);
+            }
+
+            if (operand.type == Operand::EFL || operand.type == Operand::DISTORTION) {
+                paraxialIndex.emplace(operand.wavelength, -1);
+            }
+        }
+
+        // assign ray indices in sorted order so that rays of the same wavelength are traced together
+        for (auto &[key, index] : uniqueRays) {
+            index = int(program.rays.size());
+            program.rays.push_back({ std::get<0>(key), std::get<1>(key), std::get<2>(key), std::get<3>(key) });
+        }
+
+        for (auto &[wavelength, index] : paraxialIndex) {
+            index = int(program.paraxialWavelengths.size());
+            program.paraxialWavelengths.push_back(wavelength);
+        }
+
+        // emit instructions
+        for (size_t i = 0; i < operands.size(); i++) {
+            const Operand &operand = operands[i];
+
+            MeritProgram::Instruction instruction;
+            instruction.type = operand.type;
+            instruction.bound = operand.bound;
+            instruction.target = operand.target;
+            instruction.weight = operand.weight;
+            instruction.field = operand.field;
+            instruction.surface = operand.surface;
+            instruction.rayBegin = int(program.rayIndices.size());
+            for (const RayKey &key : operandRays[i]) {
+                program.rayIndices.push_back(uniqueRays[key]);
+            }
+            instruction.rayEnd = int(program.rayIndices.size());
+
+            auto paraxial = paraxialIndex.find(operand.wavelength);
+            instruction.paraxial =
+                (operand.type == Operand::EFL || operand.type == Operand::DISTORTION) ?
+                paraxial->second : -1;
+
+            program.instructions.push_back(instruction);
+        }
+
+        return program;
+    }
+
+private:
+    template<typename SFloat>
+    static void validate(const Operand &operand, const LensSchema<SFloat> &schema) {
+        if (operand.type != Operand::EDGE_THICKNESS) {
+            if (operand.wavelength < 0 || operand.wavelength >= int(schema.wavelengths.size())) {
+                throw std::invalid_argument("operand references unknown wavelength " + std::to_string(operand.wavelength));
+            }
+        }
+
+        if (operand.type == Operand::SPOT_RMS && operand.samples <= 0) {
+            throw std::invalid_argument("spot operand requires at least one pupil sample");
+        }
+
+        if (operand.type == Operand::EDGE_THICKNESS) {
+            if (operand.surface < 1 || operand.surface + 1 >= int(schema.surfaces.size())) {
+                throw std::invalid_argument("operand references unknown surface " + std::to_string(operand.surface));
+            }
+        }
+    }
+};
+
+}
+}
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/parallel/SerialScope.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace lore {
+namespace optim {
+
+/**
+ * Thread-local bump allocator for the gradients of SparseFADFloat values.
+ * Memory is handed out from large blocks and only recycled when the outermost SparseFADScope of the thread ends.
+ */
+template<typename Float>
+struct SparseFADArena {
+    static constexpr size_t BlockSize = size_t(1) << 16;
+
+    struct Block {
+        std::unique_ptr<Float[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;
+    size_t used = 0;
+    int depth = 0;
+
+    Float *allocate(size_t count) {
+        // without a scope, nothing would recycle the memory, and the next scope to end would hand it out again
+        assert(depth > 0 && "SparseFADFloat values must be computed inside a SparseFADScope");
+        if (current < blocks.size() && used + count <= blocks[current].size) {
+            Float *result = blocks[current].data.get() + used;
+            used += count;
+            return result;
+        }
+
+        if (!blocks.empty()) {
+            current++;
+        }
+        while (current < blocks.size() && blocks[current].size < count) {
+            current++;
+        }
+        if (current == blocks.size()) {
+            const size_t size = std::max(BlockSize, count);
+            blocks.push_back({ std::unique_ptr<Float[]>(new Float[size]), size });
+        }
+
+        used = count;
+        return blocks[current].data.get();
+    }
+
+    void reset() {
+        current = 0;
+        used = 0;
+    }
+
+    /**
+     * Number of values currently handed out, for diagnostics.
+     */
+    size_t allocated() const {
+        size_t result = used;
+        for (size_t i = 0; i < current && i < blocks.size(); i++) {
+            result += blocks[i].size;
+        }
+        return result;
+    }
+
+    static SparseFADArena &local() {
+        thread_local SparseFADArena arena;
+        return arena;
+    }
+};
+
+/**
+ * Marks the lifetime of SparseFADFloat values on the current thread.
+ * When the outermost scope ends, all gradients allocated since it began are released at once.
+ * Computations must not move to other threads meanwhile, so the scope also keeps parallelFor serial.
+ */
+template<typename Float>
+struct SparseFADScope {
+    parallel::SerialScope serial;
+
+    SparseFADScope() {
+        SparseFADArena<Float>::local().depth++;
+    }
+
+    ~SparseFADScope() {
+        SparseFADArena<Float> &arena = SparseFADArena<Float>::local();
+        if (--arena.depth == 0) {
+            arena.reset();
+        }
+    }
+
+    SparseFADScope(const SparseFADScope &) = delete;
+    SparseFADScope &operator=(const SparseFADScope &) = delete;
+};
+
+/**
+ * Forward-mode autodiff value with a runtime-sized gradient.
+ * Only the contiguous range [begin, end) of derivative indices that the value actually depends on is stored, so
+ * operations on values that depend on few variables are cheap regardless of the total number of variables. When
+ * variables are numbered in the order in which a ray meets them (e.g., by surface), the gradient of a ray only grows
+ * as the ray passes the surfaces that carry them.
+ *
+ * Gradients are immutable and live in the thread-local SparseFADArena, which keeps the type trivially copyable
+ * (as required by the unions in Glass). Copies share their gradient.
+ * @note Values must be computed inside a SparseFADScope, and not be used after it ends.
+ */
+template<typename Float>
+struct SparseFADFloat {
+    using Arena = SparseFADArena<Float>;
+
+    Float V;
+    int begin;
+    int end;
+    const Float *d;
+
+    SparseFADFloat()
+        : V(), begin(0), end(0), d(nullptr) {}
+
+    SparseFADFloat(Float V)
+        : V(V), begin(0), end(0), d(nullptr) {}
+
+    /**
+     * Returns the independent variable with the given index.
+     */
+    static SparseFADFloat variable(Float V, int index) {
+        static const Float one = 1;
+
+        SparseFADFloat result(V);
+        result.begin = index;
+        result.end = index + 1;
+        result.d = &one;
+        return result;
+    }
+
+    /**
+     * Returns d(this) / d(variable i), which is zero outside of the active range.
+     */
+    Float dVd(int i) const {
+        return i >= begin && i < end ? d[i - begin] : Float(0);
+    }
+
+    int size() const {
+        return end - begin;
+    }
+
+    bool isConstant() const {
+        return begin == end;
+    }
+
+    SparseFADFloat operator-() const {
+        return chain(-V, *this, Float(-1));
+    }
+
+    friend SparseFADFloat operator+(const SparseFADFloat &lhs, const SparseFADFloat &rhs) {
+        return linear(lhs.V + rhs.V, lhs, Float(1), rhs, Float(1));
+    }
+
+    friend SparseFADFloat operator-(const SparseFADFloat &lhs, const SparseFADFloat &rhs) {
+        return linear(lhs.V - rhs.V, lhs, Float(1), rhs, Float(-1));
+    }
+
+    friend SparseFADFloat operator*(const SparseFADFloat &lhs, const SparseFADFloat &rhs) {
+        return linear(lhs.V * rhs.V, lhs, rhs.V, rhs, lhs.V);
+    }
+
+    friend SparseFADFloat operator/(const SparseFADFloat &lhs, const SparseFADFloat &rhs) {
+        const Float inverse = Float(1) / rhs.V;
+        const Float quotient = lhs.V * inverse;
+        return linear(quotient, lhs, inverse, rhs, -quotient * inverse);
+    }
+
+    friend SparseFADFloat operator+(const SparseFADFloat &lhs, const Float &rhs) {
+        return chain(lhs.V + rhs, lhs, Float(1));
+    }
+
+    friend SparseFADFloat operator+(const Float &lhs, const SparseFADFloat &rhs) {
+        return chain(lhs + rhs.V, rhs, Float(1));
+    }
+
+    friend SparseFADFloat operator-(const SparseFADFloat &lhs, const Float &rhs) {
+        return chain(lhs.V - rhs, lhs, Float(1));
+    }
+
+    friend SparseFADFloat operator-(const Float &lhs, const SparseFADFloat &rhs) {
+        return chain(lhs - rhs.V, rhs, Float(-1));
+    }
+
+    friend SparseFADFloat operator*(const SparseFADFloat &lhs, const Float &rhs) {
+        return chain(lhs.V * rhs, lhs, rhs);
+    }
+
+    friend SparseFADFloat operator*(const Float &lhs, const SparseFADFloat &rhs) {
+        return chain(lhs * rhs.V, rhs, lhs);
+    }
+
+    friend SparseFADFloat operator/(const SparseFADFloat &lhs, const Float &rhs) {
+        const Float inverse = Float(1) / rhs;
+        return chain(lhs.V * inverse, lhs, inverse);
+    }
+
+    friend SparseFADFloat operator/(const Float &lhs, const SparseFADFloat &rhs) {
+        const Float quotient = lhs / rhs.V;
+        return chain(quotient, rhs, -quotient / rhs.V);
+    }
+
+    SparseFADFloat &operator+=(const SparseFADFloat &other) { return *this = *this + other; }
+    SparseFADFloat &operator-=(const SparseFADFloat &other) { return *this = *this - other; }
+    SparseFADFloat &operator*=(const SparseFADFloat &other) { return *this = *this * other; }
+    SparseFADFloat &operator/=(const SparseFADFloat &other) { return *this = *this / other; }
+
+    SparseFADFloat &operator+=(const Float &other) { V += other; return *this; }
+    SparseFADFloat &operator-=(const Float &other) { V -= other; return *this; }
+    SparseFADFloat &operator*=(const Float &other) { return *this = *this * other; }
+    SparseFADFloat &operator/=(const Float &other) { return *this = *this / other; }
+
+#define LORE_SPARSE_FAD_COMPARISON(op) \
+    friend bool operator op(const SparseFADFloat &lhs, const SparseFADFloat &rhs) { return lhs.V op rhs.V; } \
+    friend bool operator op(const SparseFADFloat &lhs, const Float &rhs) { return lhs.V op rhs; } \
+    friend bool operator op(const Float &lhs, const SparseFADFloat &rhs) { return lhs op rhs.V; }
+
+    LORE_SPARSE_FAD_COMPARISON(<)
+    LORE_SPARSE_FAD_COMPARISON(>)
+    LORE_SPARSE_FAD_COMPARISON(<=)
+    LORE_SPARSE_FAD_COMPARISON(>=)
+    LORE_SPARSE_FAD_COMPARISON(==)
+    LORE_SPARSE_FAD_COMPARISON(!=)
+
+#undef LORE_SPARSE_FAD_COMPARISON
+
+    /**
+     * Returns a value whose gradient is factor * d(operand).
+     * A factor of one shares the gradient of the operand instead of copying it.
+     */
+    static SparseFADFloat chain(Float V, const SparseFADFloat &operand, Float factor) {
+        SparseFADFloat result(V);
+        if (operand.isConstant() || factor == Float(0)) {
+            return result;
+        }
+
+        result.begin = operand.begin;
+        result.end = operand.end;
+        if (factor == Float(1)) {
+            result.d = operand.d;
+            return result;
+        }
+
+        const int n = operand.size();
+        Float *out = Arena::local().allocate(n);
+        LORE_VECTORIZE
+        for (int i = 0; i < n; i++) {
+            out[i] = factor * operand.d[i];
+        }
+        result.d = out;
+        return result;
+    }
+
+    /**
+     * Returns a value whose gradient is a * d(lhs) + b * d(rhs), stored over the union of both active ranges.
+     */
+    static SparseFADFloat linear(Float V, const SparseFADFloat &lhs, Float a, const SparseFADFloat &rhs, Float b) {
+        if (rhs.isConstant()) {
+            return chain(V, lhs, a);
+        }
+        if (lhs.isConstant()) {
+            return chain(V, rhs, b);
+        }
+
+        SparseFADFloat result(V);
+        result.begin = std::min(lhs.begin, rhs.begin);
+        result.end = std::max(lhs.end, rhs.end);
+
+        const int n = result.size();
+        Float *out = Arena::local().allocate(n);
+        for (int i = 0; i < n; i++) {
+            out[i] = 0;
+        }
+
+        Float *l = out + (lhs.begin - result.begin);
+        const int nl = lhs.size();
+        LORE_VECTORIZE
+        for (int i = 0; i < nl; i++) {
+            l[i] += a * lhs.d[i];
+        }
+
+        Float *r = out + (rhs.begin - result.begin);
+        const int nr = rhs.size();
+        LORE_VECTORIZE
+        for (int i = 0; i < nr; i++) {
+            r[i] += b * rhs.d[i];
+        }
+
+        result.d = out;
+        return result;
+    }
+};
+
+static_assert(std::is_trivially_copyable<SparseFADFloat<double>>::value, "SparseFADFloat must be trivially copyable");
+
+template<typename Float>
+std::ostream &operator<<(std::ostream &os, optim::SparseFADFloat<Float> const &value) {
+    os << "SparseFAD{ " << std::to_string(value.V) << ", [" << value.begin << ", " << value.end << ") { ";
+    for (int i = value.begin; i < value.end; i++) {
+        if (i > value.begin) os << ", ";
+        os << value.dVd(i);
+    }
+    os << " } }";
+    return os;
+}
+
+}
+
+template<typename Float>
+struct math<optim::SparseFADFloat<Float>> {
+    using FAD = optim::SparseFADFloat<Float>;
+    using Value = FAD;
+    using Detached = Float;
+
+    static FAD sin(const FAD &v) {
+        return FAD::chain(math<Float>::sin(v.V), v, math<Float>::cos(v.V));
+    }
+
+    static FAD cos(const FAD &v) {
+        return FAD::chain(math<Float>::cos(v.V), v, -math<Float>::sin(v.V));
+    }
+
+    static FAD sqrt(const FAD &v) {
+        const Float root = math<Float>::sqrt(v.V);
+        return FAD::chain(root, v, Float(0.5) / root);
+    }
+
+    static FAD copysign(const FAD &mag, const FAD &sgn) {
+        const Float value = math<Float>::copysign(mag.V, sgn.V);
+        return FAD::chain(value, mag, value == mag.V ? Float(1) : Float(-1));
+    }
+
+    static Float detach(const FAD &v) {
+        return v.V;
+    }
+};
+
+}
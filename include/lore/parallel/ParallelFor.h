@@ -0,0 +1,75 @@
+#pragma once
+
+#include <lore/lore.h>
+
+#include <lore/parallel/SerialScope.h>
+#include <lore/parallel/TaskScheduler.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace lore {
+namespace parallel {
+
+/**
+ * Number of threads that execute the tasks of parallelFor.
+ */
+inline int threadCount() {
+    return TaskScheduler::shared().concurrency();
+}
+
+/**
+ * Invokes body(i) for every i in [begin, end), distributing chunks of grainSize indices over the threads of the
+ * shared TaskScheduler. The calling thread takes part in the work, so parallelFor may be nested inside tasks.
+ * The first exception thrown by any invocation is rethrown on the calling thread once all tasks have finished.
+ * Inside a SerialScope, all indices are run on the calling thread.
+ */
+template<typename Body>
+void parallelFor(int begin, int end, Body &&body, int grainSize = 1) {
+    const int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+
+    grainSize = std::max(1, grainSize);
+    const int numChunks = (count + grainSize - 1) / grainSize;
+    const int numTasks = std::min(threadCount(), numChunks);
+    if (numTasks <= 1 || SerialScope::active()) {
+        for (int i = begin; i < end; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    std::atomic<int> nextChunk { 0 };
+
+    // one task per thread that pulls chunks until none are left, which balances uneven chunks without a task each
+    auto worker = [&]() {
+        while (true) {
+            const int chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= numChunks) {
+                break;
+            }
+
+            const int chunkBegin = begin + chunk * grainSize;
+            const int chunkEnd = std::min(end, chunkBegin + grainSize);
+            try {
+                for (int i = chunkBegin; i < chunkEnd; i++) {
+                    body(i);
+                }
+            } catch (...) {
+                nextChunk.store(numChunks, std::memory_order_relaxed);
+                throw;
+            }
+        }
+    };
+
+    TaskGroup group;
+    for (int i = 0; i < numTasks; i++) {
+        group.run(worker);
+    }
+    group.wait();
+}
+
+}
+}
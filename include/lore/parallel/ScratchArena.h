@@ -0,0 +1,110 @@
+#pragma once
+
+#include <lore/lore.h>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace lore {
+namespace parallel {
+
+/**
+ * Bump allocator for temporary buffers of a single thread, such as the ray batches of a task.
+ * Memory is handed out from large blocks that are kept when released, so that tasks which repeatedly need scratch
+ * space stop allocating after the first few runs. Every thread has its own arena (see local()), which the thread
+ * first touches itself and thus stays local to it on NUMA systems when workers are pinned.
+ */
+class ScratchArena {
+public:
+    static constexpr size_t DefaultBlockSize = size_t(1) << 20;
+
+    struct Marker {
+        size_t block;
+        size_t offset;
+    };
+
+    /**
+     * Releases everything allocated during its lifetime.
+     */
+    class Scope {
+    public:
+        explicit Scope(ScratchArena &arena)
+        : arena(arena), marker(arena.mark()) {}
+
+        ~Scope() {
+            arena.release(marker);
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        ScratchArena &arena;
+        Marker marker;
+    };
+
+    /**
+     * Arena of the calling thread.
+     */
+    static ScratchArena &local();
+
+    explicit ScratchArena(size_t blockSize = DefaultBlockSize);
+
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * Allocates an array of default-initialized elements, i.e. uninitialized for scalar types.
+     */
+    template<typename T>
+    std::span<T> allocate(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "scratch memory is released without destroying objects");
+        T *data = static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+        std::uninitialized_default_construct_n(data, count);
+        return { data, count };
+    }
+
+    Marker mark() const {
+        return { current, offset };
+    }
+
+    /**
+     * Releases everything allocated after the marker was taken.
+     */
+    void release(Marker marker) {
+        current = marker.block;
+        offset = marker.offset;
+    }
+
+    void reset() {
+        release({ 0, 0 });
+    }
+
+    /**
+     * Total size of all blocks.
+     */
+    size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+
+    /**
+     * Block that is currently allocated from; all later blocks are unused.
+     */
+    size_t current = 0;
+    size_t offset = 0;
+};
+
+}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <lore/lore.h>
+
+namespace lore {
+namespace parallel {
+
+/**
+ * While a SerialScope is alive, parallelFor runs every index on the calling thread instead of distributing them.
+ * Values that are bound to the thread that created them (e.g. optim::SparseFADFloat, whose gradients live in a
+ * thread-local arena) open one, so that code which parallelizes internally stays correct when it computes them.
+ */
+class SerialScope {
+public:
+    SerialScope() {
+        depth()++;
+    }
+
+    ~SerialScope() {
+        depth()--;
+    }
+
+    SerialScope(const SerialScope &) = delete;
+    SerialScope &operator=(const SerialScope &) = delete;
+
+    /**
+     * Whether a SerialScope is alive on the current thread.
+     */
+    static bool active() {
+        return depth() > 0;
+    }
+
+private:
+    static int &depth() {
+        thread_local int depth = 0;
+        return depth;
+    }
+};
+
+}
+}
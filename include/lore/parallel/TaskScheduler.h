@@ -0,0 +1,163 @@
+#pragma once
+
+#include <lore/lore.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace lore {
+namespace parallel {
+
+class TaskGroup;
+
+/**
+ * Persistent pool of worker threads that execute tasks with work stealing.
+ * Every worker owns a deque: tasks spawned on a worker are pushed to and popped from the back of its own deque
+ * (newest first, which keeps nested work cache-hot), while idle workers steal the oldest tasks from the front of
+ * other deques. Tasks spawned on other threads go to a shared injection queue. Threads that wait for a TaskGroup
+ * execute pending tasks instead of blocking, so task groups can be nested and waited on from within tasks.
+ *
+ * Tasks may freely share immutable data such as a Lens. Objects that merely hold references to it, such as
+ * SequentialTrace, are cheap to construct and should be created inside each task rather than shared between tasks,
+ * as intersectors (e.g. ConditionedIntersector) may carry mutable state.
+ */
+class TaskScheduler {
+public:
+    struct Options {
+        /**
+         * Total number of threads that execute tasks, including the thread that waits for them. Zero selects the
+         * number of CPUs available to the process.
+         */
+        int numThreads = 0;
+
+        /**
+         * Whether every worker is pinned to its own CPU out of those available to the process, which keeps the
+         * memory it first touches (such as its ScratchArena) local on NUMA systems.
+         */
+        bool pinThreads = false;
+    };
+
+    /**
+     * Scheduler used by parallelFor. Its number of threads can be set with the LORE_NUM_THREADS environment
+     * variable.
+     */
+    static TaskScheduler &shared();
+
+    /**
+     * Number of CPUs the process may run on, which respects affinity masks set e.g. by taskset or containers.
+     */
+    static int availableCpus();
+
+    TaskScheduler();
+    explicit TaskScheduler(const Options &options);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler &) = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+    /**
+     * Number of threads that execute tasks, including the waiting thread.
+     */
+    int concurrency() const {
+        return int(workers.size()) + 1;
+    }
+
+    /**
+     * Index of the calling thread among the workers of this scheduler, or -1 for other threads.
+     */
+    int workerIndex() const;
+
+private:
+    friend class TaskGroup;
+
+    struct Task {
+        std::function<void()> function;
+        TaskGroup *group;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void submit(Task task);
+    void wait(TaskGroup &group);
+    void wake();
+
+    bool pop(Task &task);
+    bool runOne();
+    void work(int index, int cpu);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex injectionMutex;
+    std::deque<Task> injection;
+
+    /**
+     * Number of tasks in all queues.
+     */
+    std::atomic<int> queued { 0 };
+    std::atomic<bool> stopping { false };
+
+    std::mutex sleepMutex;
+    std::condition_variable sleep;
+};
+
+/**
+ * A set of tasks that can be waited for together.
+ * If tasks throw, the first exception is rethrown by wait() once all tasks have finished.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskScheduler &scheduler = TaskScheduler::shared())
+    : scheduler(scheduler) {}
+
+    /**
+     * Waits for all tasks, discarding their exceptions.
+     */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    template<typename Function>
+    void run(Function &&function) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        scheduler.submit({ std::function<void()>(std::forward<Function>(function)), this });
+    }
+
+    /**
+     * Executes pending tasks of the scheduler until all tasks of this group have finished.
+     */
+    void wait();
+
+    /**
+     * Whether any task has thrown, which long-running tasks can poll to stop early.
+     */
+    bool failed() const {
+        return hasFailed.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class TaskScheduler;
+
+    void finish(std::exception_ptr error);
+
+    TaskScheduler &scheduler;
+    std::atomic<int> pending { 0 };
+    std::atomic<bool> hasFailed { false };
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <lore/lore.h>
+
+#ifndef __METAL__
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lore {
+namespace profiling {
+
+/**
+ * A completed span. Times are nanoseconds since the profiler epoch (the first use of the profiler).
+ */
+struct Event {
+    const char *name;
+    int64_t begin;
+    int64_t end;
+};
+
+struct ThreadEvents {
+    /**
+     * Small sequential number of the recording thread.
+     */
+    int thread;
+    std::vector<Event> events;
+
+    /**
+     * Number of events that were overwritten because the ring buffer of the thread was full.
+     */
+    uint64_t dropped;
+};
+
+inline std::atomic<bool> profilingEnabled { false };
+
+/**
+ * Collects timing spans in thread-local ring buffers.
+ * Recording is disabled by default; disabled spans cost a single relaxed atomic load.
+ */
+struct Profiler {
+    /**
+     * Number of events each thread keeps before overwriting its oldest ones.
+     */
+    static constexpr int Capacity = 1 << 16;
+
+    static void enable(bool enable = true) {
+        profilingEnabled.store(enable, std::memory_order_relaxed);
+    }
+
+    static bool enabled() {
+        return profilingEnabled.load(std::memory_order_relaxed);
+    }
+
+    static int64_t now() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    /**
+     * Appends an event to the ring buffer of the calling thread. The name must outlive the profiler (e.g., a
+     * string literal). The ring buffer is allocated on the first event of a thread, later events never allocate.
+     */
+    static void record(const char *name, int64_t begin, int64_t end);
+
+    /**
+     * Returns the events of all threads, including threads that have exited, in chronological order per thread.
+     * Must not be called while other threads are recording.
+     */
+    static std::vector<ThreadEvents> collect();
+
+    /**
+     * Discards all recorded events.
+     * Must not be called while other threads are recording.
+     */
+    static void clear();
+
+    /**
+     * Writes all recorded events in the Chrome trace event format, which can be opened in chrome://tracing or
+     * Perfetto.
+     */
+    static void writeChromeTrace(std::ostream &os);
+    static bool writeChromeTrace(const std::string &path);
+};
+
+/**
+ * Records the lifetime of the enclosing scope as an event if profiling is enabled when the span begins.
+ */
+struct Span {
+    const char *name;
+    int64_t begin;
+
+    explicit Span(const char *name)
+        : name(name), begin(Profiler::enabled() ? Profiler::now() : -1) {}
+
+    ~Span() {
+        if (begin >= 0) {
+            Profiler::record(name, begin, Profiler::now());
+        }
+    }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+};
+
+}
+}
+#endif
+
+#define LORE_PROFILE_CONCAT_(a, b) a##b
+#define LORE_PROFILE_CONCAT(a, b) LORE_PROFILE_CONCAT_(a, b)
+
+#if defined(__METAL__) || defined(LORE_DISABLE_PROFILING)
+#define LORE_PROFILE_SCOPE(name) ((void)0)
+#else
+/**
+ * Profiles the enclosing scope under the given name, which must be a string literal.
+ */
+#define LORE_PROFILE_SCOPE(name) const ::lore::profiling::Span LORE_PROFILE_CONCAT(loreProfileSpan, __LINE__) { name }
+#endif
@@ -3,6 +3,7 @@
 #include <lore/lore.h>
 #include <lore/math.h>
 #include <lore/lens/Lens.h>
+#include <lore/profiling/Profiler.h>
 
 namespace lore {
 namespace abcd {
@@ -23,15 +24,76 @@ Matrix2x2<Float> propagation(Float t) {
     };
 }
 
+/**
+ * Applies refraction at the surface, from index n1 to n2, and propagation to the next surface to the matrix m,
+ * i.e. propagation(thickness) * refraction(n1, n2, curvature) * m without the products with zero and one.
+ */
+template<typename Float>
+Matrix2x2<Float> transfer(const Matrix2x2<Float> &m, const Surface<Float> &surface, Float n1, Float n2) {
+    const Float power = surface.curvature() * (n1 - n2) / n2;
+    const Float ratio = n1 / n2;
+    const Float c = power * m(0, 0) + ratio * m(1, 0);
+    const Float d = power * m(0, 1) + ratio * m(1, 1);
+    return Matrix2x2<Float> {
+        m(0, 0) + surface.thickness * c, m(0, 1) + surface.thickness * d,
+        c, d
+    };
+}
+
+/**
+ * System matrices of Lanes variants of a lens that share their refractive indices, stored as one array per element
+ * and indexed by lane.
+ */
+template<typename Float, int Lanes>
+struct MatrixLanes {
+    Float a[Lanes], b[Lanes];
+    Float c[Lanes], d[Lanes];
+
+    MatrixLanes() {
+        for (int l = 0; l < Lanes; l++) {
+            a[l] = Float(1); b[l] = Float(0);
+            c[l] = Float(0); d[l] = Float(1);
+        }
+    }
+
+    /**
+     * Applies transfer() to every lane, where the radius and thickness of the surface differ between lanes.
+     * The loop over lanes is branch-free, so that it is vectorized.
+     */
+    void transfer(const Float *radius, const Float *thickness, Float n1, Float n2) {
+        const Float ratio = n1 / n2;
+        LORE_VECTORIZE
+        for (int l = 0; l < Lanes; l++) {
+            // see Surface::curvature
+            const Float curvature = radius[l] == 0 ? Float(0) : Float(1) / radius[l];
+            const Float power = curvature * (n1 - n2) / n2;
+            const Float rc = power * a[l] + ratio * c[l];
+            const Float rd = power * b[l] + ratio * d[l];
+            a[l] += thickness[l] * rc;
+            b[l] += thickness[l] * rd;
+            c[l] = rc;
+            d[l] = rd;
+        }
+    }
+
+    Matrix2x2<Float> operator[](int lane) const {
+        return Matrix2x2<Float> {
+            a[lane], b[lane],
+            c[lane], d[lane]
+        };
+    }
+};
+
 template<typename Float>
 Matrix2x2<Float> full(const Lens<Float> &lens, Float wavelength) {
+    LORE_PROFILE_SCOPE("abcd::full");
+
     Matrix2x2<Float> result = Matrix2x2<Float>::Identity();
     Float n1 = lens.surfaces.front().ior(wavelength);
     for (size_t i = 1; i < lens.surfaces.size(); i++) {
         const auto &surface = lens.surfaces[i];
         const Float n2 = surface.ior(wavelength);
-        result = refraction(n1, n2, surface.curvature()) * result;
-        result = propagation(surface.thickness) * result;
+        result = transfer(result, surface, n1, n2);
         n1 = n2;
     }
     return result;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/lens/CompactLens.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/Ray.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/rt/TraceStatistics.h>
+
+namespace lore {
+namespace rt {
+
+/**
+ * Forward trace through all surfaces of a CompactLens with the GeometricalIntersector.
+ * Produces the same results as SequentialTrace on the original lens, but only touches the hot geometry array and
+ * evaluates no dispersion formulas per ray.
+ */
+template<typename Float>
+struct CompactTrace {
+    const CompactLens<Float> &lens;
+
+    explicit CompactTrace(const CompactLens<Float> &lens)
+    : lens(lens) {}
+
+    bool operator()(Ray<Float> &ray) const {
+        const CompactSurface<Float> *surfaces = lens.geometry.data();
+        const int numSurfaces = lens.size();
+
+        bool completed = true;
+        for (int i = 1; i < numSurfaces; i++) {
+            const CompactSurface<Float> &surface = surfaces[i];
+
+            Float t;
+            if (!GeometricalIntersector<Float>::intersect(ray, surface.radius, t)) {
+                LORE_TRACE_STAT(record(TraceStatistics::INTERSECTOR_MISS, i));
+                completed = false;
+                break;
+            }
+
+            ray.origin = ray(t);
+            if (sqr(ray.origin.x()) + sqr(ray.origin.y()) > surface.apertureSqr) {
+                LORE_TRACE_STAT(record(TraceStatistics::VIGNETTED, i));
+                completed = false;
+                break;
+            }
+
+            const Vector3<Float> normal = TraceUtils<Float>::normal(ray, surface.radius);
+            if (!refract(ray.direction, normal, ray.direction, surface.eta)) {
+                LORE_TRACE_STAT(record(TraceStatistics::TOTAL_INTERNAL_REFLECTION, i));
+                completed = false;
+                break;
+            }
+
+            ray.origin.z() -= surface.thickness;
+        }
+
+        LORE_TRACE_STAT(traced(completed));
+        return completed;
+    }
+};
+
+}
+}
@@ -1,15 +1,30 @@
+#pragma once
+
 #include <lore/lore.h>
 #include <lore/math.h>
 #include <lore/rt/Ray.h>
 #include <lore/lens/Surface.h>
 
+#ifndef __METAL__
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#endif
+
 namespace lore {
 namespace rt {
 
 template<typename Float>
 struct GeometricalIntersector {
     bool operator()(MTL_THREAD const Ray<Float> &ray, MTL_DEVICE const Surface<Float> &surface, MTL_THREAD Float &t) const {
-        if (surface.radius == 0) {
+        return intersect(ray, surface.radius, t);
+    }
+
+    /**
+     * Intersects the ray with a sphere of the given radius (or a plane if it is zero) whose vertex is at the origin.
+     */
+    static bool intersect(MTL_THREAD const Ray<Float> &ray, Float radius, MTL_THREAD Float &t) {
+        if (radius == 0) {
             if (ray.direction.z() == 0) {
                 return false;
             }
@@ -18,8 +33,8 @@ struct GeometricalIntersector {
             return true;
         }
 
-        const Float a = ray.direction.z() * surface.radius - ray.origin.dot(ray.direction); // p/2
-        const Float b = ray.origin.lengthSquared() - Float(2) * ray.origin.z() * surface.radius; // q
+        const Float a = ray.direction.z() * radius - ray.origin.dot(ray.direction); // p/2
+        const Float b = ray.origin.lengthSquared() - Float(2) * ray.origin.z() * radius; // q
         if (b == 0) {
             t = 0;
             return true;
@@ -45,5 +60,66 @@ struct GeometricalIntersector {
     }
 };
 
+#ifndef __METAL__
+// mixed precision relies on retracing in double, which is CPU-only
+
+/**
+ * GeometricalIntersector that additionally estimates how much rounding in Float can affect each intersection.
+ * The estimate is the machine epsilon of Float times the condition number of the quadratic, i.e. the cancellation
+ * in its constant term and in its discriminant. Intersections (and misses) whose estimate exceeds the tolerance
+ * set the flagged member, so that the ray can be retraced in higher precision.
+ */
+template<typename Float>
+struct ConditionedIntersector {
+    /**
+     * Largest acceptable estimated relative error of an intersection.
+     */
+    Float tolerance;
+
+    mutable bool flagged = false;
+
+    explicit ConditionedIntersector(Float tolerance = Float(1e-4))
+    : tolerance(tolerance) {}
+
+    bool operator()(MTL_THREAD const Ray<Float> &ray, MTL_DEVICE const Surface<Float> &surface, MTL_THREAD Float &t) const {
+        const bool hit = GeometricalIntersector<Float>()(ray, surface, t);
+        if (relativeError(ray, surface) > tolerance) {
+            flagged = true;
+        }
+        return hit;
+    }
+
+    static Float relativeError(MTL_THREAD const Ray<Float> &ray, MTL_DEVICE const Surface<Float> &surface) {
+        const Float epsilon = std::numeric_limits<Float>::epsilon();
+        if (surface.radius == 0) {
+            // a single division, which is well-conditioned
+            return epsilon;
+        }
+
+        const Float od = ray.origin.dot(ray.direction);
+        const Float zr = ray.direction.z() * surface.radius;
+        const Float a = zr - od;
+        const Float oo = ray.origin.lengthSquared();
+        const Float zzr = Float(2) * ray.origin.z() * surface.radius;
+        const Float b = oo - zzr;
+        const Float disc = sqr(a) - b;
+
+        const Float scaleB = oo + std::abs(zzr);
+        const Float scaleDisc = sqr(std::abs(zr) + std::abs(od)) + scaleB;
+
+        Float condition = 1;
+        if (b != 0) {
+            condition = std::max(condition, scaleB / std::abs(b));
+        }
+        if (disc != 0) {
+            condition = std::max(condition, scaleDisc / std::abs(disc));
+        } else {
+            return std::numeric_limits<Float>::infinity();
+        }
+        return epsilon * condition;
+    }
+};
+#endif
+
 }
 }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/lens/Lens.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/Ray.h>
+#include <lore/rt/SequentialTrace.h>
+
+namespace lore {
+namespace rt {
+
+/**
+ * Traces rays in single precision and automatically retraces them in double precision if any intersection along
+ * the way was flagged as ill-conditioned by the ConditionedIntersector.
+ */
+struct MixedPrecisionTrace {
+    Lens<float> singleLens;
+    Lens<double> doubleLens;
+    double wavelength;
+
+    /**
+     * Largest acceptable estimated relative error of a single-precision intersection.
+     */
+    float tolerance;
+
+    MixedPrecisionTrace(const Lens<double> &lens, double wavelength, float tolerance = 1e-4f)
+    : singleLens(lens.cast<float>()), doubleLens(lens), wavelength(wavelength), tolerance(tolerance) {}
+
+    /**
+     * Traces the ray through all surfaces, like SequentialTrace.
+     * @param retraced Set to whether the ray had to be retraced in double precision.
+     */
+    bool operator()(Ray<double> &ray, bool *retraced = nullptr) const {
+        const ConditionedIntersector<float> singleIntersector { tolerance };
+        const SequentialTrace<float, ConditionedIntersector<float>> singleTrace {
+            singleLens, singleIntersector, float(wavelength)
+        };
+
+        Ray<float> single = ray.cast<float>();
+        const bool valid = singleTrace(single);
+        if (retraced) {
+            *retraced = singleIntersector.flagged;
+        }
+        if (!singleIntersector.flagged) {
+            ray = single.cast<double>();
+            return valid;
+        }
+
+        const GeometricalIntersector<double> doubleIntersector {};
+        const SequentialTrace<double, GeometricalIntersector<double>> doubleTrace {
+            doubleLens, doubleIntersector, wavelength
+        };
+        return doubleTrace(ray);
+    }
+};
+
+}
+}
@@ -18,6 +18,14 @@ struct Ray {
     Vector3<Float> operator()(Float t) const {
         return origin + t * direction;
     }
+
+    template<typename LFloat>
+    Ray<LFloat> cast() const {
+        return Ray<LFloat>(
+            Vector3<LFloat> { LFloat(origin.x()), LFloat(origin.y()), LFloat(origin.z()) },
+            Vector3<LFloat> { LFloat(direction.x()), LFloat(direction.y()), LFloat(direction.z()) }
+        );
+    }
 };
 
 #ifndef __METAL__
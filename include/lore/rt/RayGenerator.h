@@ -0,0 +1,136 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/rt/ABCD.h>
+#include <lore/rt/Ray.h>
+#include <lore/lens/LensSchema.h>
+
+namespace lore {
+namespace rt {
+
+/**
+ * Generates rays for a relative field coordinate and a normalized entrance pupil coordinate.
+ * Rays are expressed in the coordinate frame of the first real surface, i.e. they can be passed directly to a
+ * SequentialTrace starting at surface 1.
+ * @note The entrance pupil is a disk of radius entranceBeamRadius in the plane of the paraxial entrance pupil, so that
+ * the chief ray (px = py = 0) passes the center of the stop in the paraxial limit. Real rays are not aimed, and the
+ * pupil is located once, at the primary wavelength of the schema.
+ */
+template<typename Float>
+struct RayGenerator {
+    /**
+     * Object distances at or above this value are treated as infinite conjugates, for which the field is measured
+     * as an angle instead of an object height.
+     */
+    static constexpr double InfiniteConjugate = 1e+8;
+
+    /**
+     * Half field angle in radians (infinite conjugates only).
+     */
+    Float fieldAngle;
+
+    /**
+     * Maximum object height (finite conjugates only).
+     */
+    Float objectHeight;
+
+    /**
+     * Distance from the object plane to the first surface (finite conjugates only).
+     */
+    Float objectDistance;
+
+    Float entranceBeamRadius;
+
+    /**
+     * Axial position of the paraxial entrance pupil, i.e. the image of the stop center in object space, relative to
+     * the vertex of the first surface.
+     */
+    Float entrancePupilPosition;
+
+    /**
+     * Axial distance in front of the first surface at which collimated rays are started.
+     */
+    Float launchDistance;
+
+    bool infinite;
+
+    RayGenerator()
+    : fieldAngle(0), objectHeight(0), objectDistance(0), entranceBeamRadius(0), entrancePupilPosition(0),
+      launchDistance(0), infinite(true) {}
+
+    template<typename SFloat>
+    explicit RayGenerator(const LensSchema<SFloat> &schema)
+    : fieldAngle(Float(schema.fieldAngle * M_PI / 180)),
+      objectHeight(Float(schema.objectHeight())),
+      objectDistance(Float(schema.objectDistance())),
+      entranceBeamRadius(Float(schema.entranceBeamRadius)),
+      entrancePupilPosition(Float(entrancePupil(schema))),
+      launchDistance(Float(1)),
+      infinite(schema.objectDistance() >= InfiniteConjugate) {
+        if (schema.surfaces.size() > 1) {
+            const SFloat aperture = schema.surfaces[1].aperture;
+            launchDistance = Float((aperture > schema.entranceBeamRadius ? aperture : schema.entranceBeamRadius) + 1);
+        }
+    }
+
+    /**
+     * @param field Relative field coordinate along y, where 1 corresponds to the full field.
+     * @param px Normalized pupil coordinate along x.
+     * @param py Normalized pupil coordinate along y.
+     */
+    Ray<Float> operator()(Float field, Float px, Float py) const {
+        const Vector3<Float> aim { px * entranceBeamRadius, py * entranceBeamRadius, entrancePupilPosition };
+
+        if (infinite) {
+            const Float angle = field * fieldAngle;
+            const Vector3<Float> direction { Float(0), lore::sin(angle), lore::cos(angle) };
+            const Float distance = (entrancePupilPosition + launchDistance) / direction.z();
+            return Ray<Float>(aim - direction * distance, direction);
+        }
+
+        const Vector3<Float> origin { Float(0), -field * objectHeight, -objectDistance };
+        return Ray<Float>(origin, (aim - origin).normalized());
+    }
+
+    template<typename LFloat>
+    RayGenerator<LFloat> cast() const {
+        RayGenerator<LFloat> result;
+        result.fieldAngle = LFloat(fieldAngle);
+        result.objectHeight = LFloat(objectHeight);
+        result.objectDistance = LFloat(objectDistance);
+        result.entranceBeamRadius = LFloat(entranceBeamRadius);
+        result.entrancePupilPosition = LFloat(entrancePupilPosition);
+        result.launchDistance = LFloat(launchDistance);
+        result.infinite = infinite;
+        return result;
+    }
+
+    /**
+     * Position of the paraxial entrance pupil of a schema relative to the vertex of its first surface.
+     * Stops on the first surface, and stops whose image lies at infinity, leave the pupil at that vertex.
+     */
+    template<typename SFloat>
+    static double entrancePupil(const LensSchema<SFloat> &schema) {
+        const int stop = schema.stopIndex;
+        if (stop <= 1 || stop >= int(schema.surfaces.size()) || schema.wavelengths.empty()) {
+            return 0;
+        }
+
+        const Lens<double> lens = schema.template lens<double>();
+        const double wavelength = double(schema.primaryWavelength());
+        Matrix2x2<double> m = Matrix2x2<double>::Identity();
+        double n1 = lens.surfaces.front().ior(wavelength);
+        for (int i = 1; i < stop; i++) {
+            const double n2 = lens.surfaces[i].ior(wavelength);
+            m = abcd::transfer(m, lens.surfaces[i], n1, n2);
+            n1 = n2;
+        }
+
+        // a ray that crosses the axis at z in object space has height m(0, 1) - m(0, 0) * z per unit slope at the stop
+        return m(0, 0) != 0 ? m(0, 1) / m(0, 0) : 0;
+    }
+};
+
+}
+}
@@ -1,8 +1,15 @@
+#pragma once
+
 #include <lore/lore.h>
 #include <lore/math.h>
 #include <lore/rt/Ray.h>
+#include <lore/rt/TraceStatistics.h>
 #include <lore/lens/Lens.h>
 
+#ifndef __METAL__
+#include <cassert>
+#endif
+
 namespace lore {
 namespace rt {
 
@@ -12,10 +19,26 @@ struct TraceUtils {
     static bool propagate(
         MTL_THREAD Ray<Float> &ray,
         MTL_DEVICE const Surface<Float> &surface,
-        MTL_THREAD const Intersector &intersector
+        MTL_THREAD const Intersector &intersector,
+        [[maybe_unused]] int surfaceIndex = -1
     ) {
         Float t;
+        return propagate(ray, surface, intersector, t, surfaceIndex);
+    }
+
+    /**
+     * Propagates the ray to the surface and stores the distance it traveled in t.
+     */
+    template<typename Intersector>
+    static bool propagate(
+        MTL_THREAD Ray<Float> &ray,
+        MTL_DEVICE const Surface<Float> &surface,
+        MTL_THREAD const Intersector &intersector,
+        MTL_THREAD Float &t,
+        [[maybe_unused]] int surfaceIndex
+    ) {
         if (!intersector(ray, surface, t)) {
+            LORE_TRACE_STAT(record(TraceStatistics::INTERSECTOR_MISS, surfaceIndex));
             return false;
         }
 
@@ -24,6 +47,7 @@ struct TraceUtils {
             const Float rSqr = sqr(ray.origin.x()) + sqr(ray.origin.y());
             if (rSqr > sqr(surface.aperture)) {
                 // hit checked aperture stop
+                LORE_TRACE_STAT(record(TraceStatistics::VIGNETTED, surfaceIndex));
                 return false;
             }
         }
@@ -31,20 +55,133 @@ struct TraceUtils {
         return true;
     }
 
+    /**
+     * Refracts the ray at its intersection with the surface, where eta is the ratio of the refractive indices before
+     * and after the surface.
+     */
+    static bool refract(
+        MTL_THREAD Ray<Float> &ray,
+        MTL_DEVICE const Surface<Float> &surface,
+        Float eta,
+        [[maybe_unused]] int surfaceIndex = -1
+    ) {
+        if (!lore::refract(ray.direction, normal(ray, surface), ray.direction, eta)) {
+            LORE_TRACE_STAT(record(TraceStatistics::TOTAL_INTERNAL_REFLECTION, surfaceIndex));
+            return false;
+        }
+        return true;
+    }
+
     static Vector3<Float> normal(
         MTL_THREAD const Ray<Float> &ray,
         MTL_DEVICE const Surface<Float> &surface
     ) {
-        if (surface.isFlat()) {
+        return normal(ray, surface.radius);
+    }
+
+    static Vector3<Float> normal(
+        MTL_THREAD const Ray<Float> &ray,
+        Float radius
+    ) {
+        if (radius == 0) {
             return Vector3<Float>{0, 0, -copysign(Float(1), ray.direction.z())};
         }
         return -faceforward(
-            (ray.origin - Vector3<Float>{0, 0, surface.radius}).normalized(),
+            (ray.origin - Vector3<Float>{0, 0, radius}).normalized(),
             ray.direction
         );
     }
 };
 
+/**
+ * One ray traced through Lanes variants of a lens whose surfaces differ in radius and thickness, with the steps of
+ * TraceUtils and the GeometricalIntersector. Components are stored as one array per coordinate and indexed by lane,
+ * and every step is a branch-free loop over all lanes, so that it is vectorized. Lanes whose ray failed keep being
+ * computed and are only masked by alive.
+ */
+template<typename Float, int Lanes>
+struct RayLanes {
+    Float ox[Lanes], oy[Lanes], oz[Lanes];
+    Float dx[Lanes], dy[Lanes], dz[Lanes];
+    bool alive[Lanes];
+
+    explicit RayLanes(MTL_THREAD const Ray<Float> &ray) {
+        for (int l = 0; l < Lanes; l++) {
+            ox[l] = ray.origin.x(); oy[l] = ray.origin.y(); oz[l] = ray.origin.z();
+            dx[l] = ray.direction.x(); dy[l] = ray.direction.y(); dz[l] = ray.direction.z();
+            alive[l] = true;
+        }
+    }
+
+    /**
+     * Propagates every lane to the surface, see TraceUtils::propagate and GeometricalIntersector::intersect.
+     * @param radius Radius of the surface in each lane.
+     */
+    void propagate(const Float *radius, Float aperture, bool checkAperture) {
+        const Float apertureSqr = sqr(aperture);
+        LORE_VECTORIZE
+        for (int l = 0; l < Lanes; l++) {
+            const Float R = radius[l];
+            const bool flat = R == 0;
+
+            const Float a = dz[l] * R - (ox[l] * dx[l] + oy[l] * dy[l] + oz[l] * dz[l]);
+            const Float b = ox[l] * ox[l] + oy[l] * oy[l] + oz[l] * oz[l] - Float(2) * oz[l] * R;
+            const Float disc = sqr(a) - b;
+            const Float rad = sqrt(disc < 0 ? Float(0) : disc);
+            const Float nearT = b / (a + rad);
+            const Float sphereT = nearT < 0 ? b / (a - rad) : nearT;
+
+            const bool hit = flat ? dz[l] != 0 : (b == 0 || (disc >= 0 && sphereT >= 0));
+            const Float t = !hit ? Float(0) : flat ? -oz[l] / dz[l] : (b == 0 ? Float(0) : sphereT);
+            ox[l] += t * dx[l];
+            oy[l] += t * dy[l];
+            oz[l] += t * dz[l];
+
+            const bool inside = !checkAperture || !(sqr(ox[l]) + sqr(oy[l]) > apertureSqr);
+            alive[l] = alive[l] && hit && inside;
+        }
+    }
+
+    /**
+     * Refracts every lane at the surface it was propagated to, see TraceUtils::refract and TraceUtils::normal.
+     */
+    void refract(const Float *radius, Float eta) {
+        LORE_VECTORIZE
+        for (int l = 0; l < Lanes; l++) {
+            const Float R = radius[l];
+            const bool flat = R == 0;
+
+            const Float vz = oz[l] - R;
+            const Float inverseLength = Float(1) / sqrt(ox[l] * ox[l] + oy[l] * oy[l] + vz * vz);
+            const Float sx = ox[l] * inverseLength;
+            const Float sy = oy[l] * inverseLength;
+            const Float sz = vz * inverseLength;
+            const Float side = sx * dx[l] + sy * dy[l] + sz * dz[l] > 0 ? Float(-1) : Float(1);
+            const Float nx = flat ? Float(0) : side * sx;
+            const Float ny = flat ? Float(0) : side * sy;
+            const Float nz = flat ? -copysign(Float(1), dz[l]) : side * sz;
+
+            const Float NdotI = nx * dx[l] + ny * dy[l] + nz * dz[l];
+            const Float k = Float(1) - sqr(eta) * (Float(1) - sqr(NdotI));
+            const Float scale = eta * NdotI + sqrt(k < 0 ? Float(0) : k);
+            dx[l] = eta * dx[l] - scale * nx;
+            dy[l] = eta * dy[l] - scale * ny;
+            dz[l] = eta * dz[l] - scale * nz;
+            alive[l] = alive[l] && k >= 0;
+        }
+    }
+
+    /**
+     * Moves every lane into the coordinate frame of the next surface.
+     */
+    void transfer(const Float *thickness) {
+        LORE_VECTORIZE
+        for (int l = 0; l < Lanes; l++) {
+            oz[l] -= thickness[l];
+        }
+    }
+};
+
 template<typename Float, typename Intersector>
 struct SequentialTrace {
     SequentialTrace(
@@ -73,11 +210,21 @@ struct SequentialTrace {
     }
 
     bool operator()(MTL_THREAD Ray<Float> &ray) const {
-        if (firstSurface <= lastSurface) {
-            return forwardTrace(ray);
-        }
+        const NoPath path {};
+        const bool completed = firstSurface <= lastSurface ? forwardTrace(ray, path) : backwardTrace(ray, path);
+        LORE_TRACE_STAT(traced(completed));
+        return completed;
+    }
 
-        return backwardTrace(ray);
+    /**
+     * Traces the ray and adds the optical path length n * t of every segment it travels, from its origin to its
+     * intersection with the last surface, to opticalPath. Directions are expected to be normalized.
+     */
+    bool operator()(MTL_THREAD Ray<Float> &ray, MTL_THREAD Float &opticalPath) const {
+        const PathLength path { opticalPath };
+        const bool completed = firstSurface <= lastSurface ? forwardTrace(ray, path) : backwardTrace(ray, path);
+        LORE_TRACE_STAT(traced(completed));
+        return completed;
     }
 
     void setWavelength(Float wavelength) {
@@ -85,18 +232,35 @@ struct SequentialTrace {
     }
 
 private:
-    bool forwardTrace(MTL_THREAD Ray<Float> &ray) const {
+    /**
+     * Path accumulators, so that tracing without optical path lengths does not pay for them.
+     */
+    struct NoPath {
+        void add(Float, Float) const {}
+    };
+
+    struct PathLength {
+        MTL_THREAD Float &value;
+
+        void add(Float n, Float t) const {
+            value += n * t;
+        }
+    };
+
+    template<typename Path>
+    bool forwardTrace(MTL_THREAD Ray<Float> &ray, MTL_THREAD const Path &path) const {
         Float n1 = lens.surfaces.front().ior(wavelength);
 
         for (int i = firstSurface; i <= lastSurface; i++) {
             const MTL_DEVICE lore::Surface<Float> &surface = lens.surfaces[i];
-            if (!TraceUtils<Float>::propagate(ray, surface, intersector)) {
+            Float t;
+            if (!TraceUtils<Float>::propagate(ray, surface, intersector, t, i)) {
                 return false;
             }
+            path.add(n1, t);
 
-            const Vector3<Float> normal = TraceUtils<Float>::normal(ray, surface);
             const Float n2 = surface.ior(wavelength);
-            if (!refract(ray.direction, normal, ray.direction, n1 / n2)) {
+            if (!TraceUtils<Float>::refract(ray, surface, Float(n1 / n2), i)) {
                 return false;
             }
 
@@ -107,20 +271,22 @@ private:
         return true;
     }
 
-    bool backwardTrace(MTL_THREAD Ray<Float> &ray) const {
+    template<typename Path>
+    bool backwardTrace(MTL_THREAD Ray<Float> &ray, MTL_THREAD const Path &path) const {
         int surfaceIndex = firstSurface;
         Float n2 = lens.surfaces[surfaceIndex].ior(wavelength);
         for (; surfaceIndex >= lastSurface; surfaceIndex--) {
             MTL_DEVICE auto &surface = lens.surfaces[surfaceIndex];
             ray.origin.z() += surface.thickness;
 
-            if (!TraceUtils<Float>::propagate(ray, surface, intersector)) {
+            Float t;
+            if (!TraceUtils<Float>::propagate(ray, surface, intersector, t, surfaceIndex)) {
                 return false;
             }
+            path.add(n2, t);
 
-            const Vector3<Float> normal = TraceUtils<Float>::normal(ray, surface);
             const Float n1 = lens.surfaces[surfaceIndex - 1].ior(wavelength);
-            if (!refract(ray.direction, normal, ray.direction, n2 / n1)) {
+            if (!TraceUtils<Float>::refract(ray, surface, Float(n2 / n1), surfaceIndex)) {
                 return false;
             }
 
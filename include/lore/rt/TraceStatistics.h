@@ -0,0 +1,143 @@
+#pragma once
+
+#include <lore/lore.h>
+
+#ifndef __METAL__
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#endif
+
+#ifndef __METAL__
+namespace lore {
+namespace rt {
+
+/**
+ * Counters of traced rays and of the reasons rays were lost, per surface.
+ * Counting is compiled in only if LORE_ENABLE_TRACE_STATS is defined (see the CMake option of the same name);
+ * otherwise the instrumentation in SequentialTrace expands to nothing.
+ */
+struct TraceStatistics {
+    enum Event {
+        /// The intersector did not find a hit with the surface.
+        INTERSECTOR_MISS,
+        /// The ray hit the surface outside of its checked aperture.
+        VIGNETTED,
+        /// The ray was totally internally reflected at the surface.
+        TOTAL_INTERNAL_REFLECTION,
+    };
+
+    struct SurfaceCounters {
+        uint64_t intersectorMisses = 0;
+        uint64_t vignetted = 0;
+        uint64_t totalInternalReflections = 0;
+
+        uint64_t losses() const {
+            return intersectorMisses + vignetted + totalInternalReflections;
+        }
+
+        void merge(const SurfaceCounters &other) {
+            intersectorMisses += other.intersectorMisses;
+            vignetted += other.vignetted;
+            totalInternalReflections += other.totalInternalReflections;
+        }
+    };
+
+#ifdef LORE_ENABLE_TRACE_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    uint64_t raysTraced = 0;
+    uint64_t raysCompleted = 0;
+
+    /**
+     * Losses indexed by surface, sized to the highest surface at which a ray was lost.
+     */
+    std::vector<SurfaceCounters> surfaces;
+
+    void traced(bool completed) {
+        raysTraced++;
+        if (completed) {
+            raysCompleted++;
+        }
+    }
+
+    /**
+     * Counts a lost ray. Events without a surface index (negative) are only reflected in raysCompleted.
+     */
+    void record(Event event, int surface) {
+        if (surface < 0) {
+            return;
+        }
+        if (surface >= int(surfaces.size())) {
+            surfaces.resize(surface + 1);
+        }
+
+        SurfaceCounters &counters = surfaces[surface];
+        switch (event) {
+            case INTERSECTOR_MISS:
+                counters.intersectorMisses++;
+                break;
+            case VIGNETTED:
+                counters.vignetted++;
+                break;
+            case TOTAL_INTERNAL_REFLECTION:
+                counters.totalInternalReflections++;
+                break;
+        }
+    }
+
+    SurfaceCounters total() const {
+        SurfaceCounters result;
+        for (const SurfaceCounters &counters : surfaces) {
+            result.merge(counters);
+        }
+        return result;
+    }
+
+    void merge(const TraceStatistics &other) {
+        raysTraced += other.raysTraced;
+        raysCompleted += other.raysCompleted;
+        if (other.surfaces.size() > surfaces.size()) {
+            surfaces.resize(other.surfaces.size());
+        }
+        for (size_t i = 0; i < other.surfaces.size(); i++) {
+            surfaces[i].merge(other.surfaces[i]);
+        }
+    }
+
+    void clear() {
+        raysTraced = 0;
+        raysCompleted = 0;
+        surfaces.clear();
+    }
+
+    /**
+     * Counters of the calling thread, which are only ever written by that thread.
+     */
+    static TraceStatistics &local();
+
+    /**
+     * Merges the counters of all threads, including threads that have already exited.
+     * Must not be called while other threads are tracing.
+     */
+    static TraceStatistics collect();
+
+    /**
+     * Clears the counters of all threads.
+     * Must not be called while other threads are tracing.
+     */
+    static void reset();
+};
+
+}
+}
+#endif
+
+#if defined(LORE_ENABLE_TRACE_STATS) && !defined(__METAL__)
+#define LORE_TRACE_STAT(call) (::lore::rt::TraceStatistics::local().call)
+#else
+#define LORE_TRACE_STAT(call) ((void)0)
+#endif
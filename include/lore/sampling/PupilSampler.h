@@ -0,0 +1,284 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+#include <lore/sampling/Random.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace lore {
+namespace sampling {
+
+/**
+ * Normalized entrance pupil coordinates in structure-of-arrays layout, such that a batch of rays can be generated
+ * (e.g. with RayGenerator) with unit-stride loads per coordinate.
+ */
+template<typename Float>
+struct PupilSamples {
+    std::vector<Float> x;
+    std::vector<Float> y;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    bool empty() const {
+        return x.empty();
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+    }
+
+    void reserve(size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+    }
+
+    void push_back(const Vector2<double> &p) {
+        x.push_back(Float(p.x()));
+        y.push_back(Float(p.y()));
+    }
+};
+
+/**
+ * Two-dimensional Sobol sequence with optional nested uniform (Owen) scrambling, implemented with the hash-based
+ * permutation of Burley, "Practical Hash-based Owen Scrambling" (JCGT 2020).
+ * Every prefix of 2^k points is a (0, k, 2)-net, i.e. it has exactly one point in every elementary interval of area
+ * 2^-k, which makes the sequence suitable for progressive refinement. Scrambling preserves this property while
+ * removing the regular structure that aliases with the aberrations of a lens.
+ */
+struct SobolSequence {
+    uint32_t indexSeed = 0;
+    uint32_t xSeed = 0;
+    uint32_t ySeed = 0;
+    bool scrambled = false;
+
+    SobolSequence() = default;
+
+    explicit SobolSequence(uint64_t seed, bool scrambled = true)
+    : scrambled(scrambled) {
+        const Philox::Counter seeds = Philox(seed).block(0, 0);
+        indexSeed = seeds[0];
+        xSeed = seeds[1];
+        ySeed = seeds[2];
+    }
+
+    /**
+     * Returns the sample with the given index in the unit square [0, 1)^2.
+     */
+    Vector2<double> operator()(uint32_t index) const {
+        if (!scrambled) {
+            return { toUnit(reverseBits(index)), toUnit(secondDimension(index)) };
+        }
+
+        index = scramble(index, indexSeed);
+        return {
+            toUnit(scramble(reverseBits(index), xSeed)),
+            toUnit(scramble(secondDimension(index), ySeed))
+        };
+    }
+
+    /**
+     * Returns the sample with the given index mapped to the unit disk with an area-preserving polar mapping.
+     */
+    Vector2<double> disk(uint32_t index) const {
+        const Vector2<double> u = (*this)(index);
+        return polar(u.y(), std::sqrt(u.x()));
+    }
+
+    static uint32_t reverseBits(uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+        x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    /**
+     * Second Sobol dimension (primitive polynomial x + 1), whose generator matrix is the Pascal matrix modulo 2.
+     */
+    static uint32_t secondDimension(uint32_t index) {
+        uint32_t result = 0;
+        for (uint32_t v = 0x80000000u; index != 0; index >>= 1, v ^= v >> 1) {
+            if (index & 1) {
+                result ^= v;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Nested uniform scramble of a fixed-point fraction: a random permutation applied to every subinterval, where the
+     * permutation of a bit depends only on the bits above it.
+     */
+    static uint32_t scramble(uint32_t x, uint32_t seed) {
+        x = reverseBits(x);
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return reverseBits(x);
+    }
+
+    static double toUnit(uint32_t x) {
+        return double(x) * (1.0 / 4294967296.0);
+    }
+};
+
+/**
+ * Distributions of normalized coordinates over the unit entrance pupil, used to estimate spot sizes and encircled
+ * energies. All points of a distribution represent equal pupil areas.
+ */
+struct PupilSampler {
+    enum Type {
+        /**
+         * Square grid clipped to the unit disk, as sampled by the SPOT_RMS operand of a MeritFunction.
+         */
+        GRID,
+
+        /**
+         * Concentric rings with six more points per ring, as used by classic lens design programs. Ring k has 6k
+         * points, but instead of the classic radius k / n it lies at the radius that halves the area represented by
+         * the ring, so that the outermost ring is slightly inside the rim and unweighted averages are not biased
+         * towards it.
+         */
+        HEXAPOLAR,
+
+        /**
+         * Fibonacci (golden angle) spiral, which is nearly uniform for any number of points.
+         */
+        FIBONACCI,
+
+        /**
+         * Owen-scrambled Sobol points, which converge fastest for smooth aberrations and can be extended progressively.
+         */
+        SOBOL
+    };
+
+    Type type = SOBOL;
+    uint64_t seed = 0;
+
+    static PupilSampler grid() {
+        return { GRID };
+    }
+
+    static PupilSampler hexapolar() {
+        return { HEXAPOLAR };
+    }
+
+    static PupilSampler fibonacci() {
+        return { FIBONACCI };
+    }
+
+    static PupilSampler sobol(uint64_t seed = 0) {
+        return { SOBOL, seed };
+    }
+
+    /**
+     * Number of points of a hexapolar pattern with the given number of rings.
+     */
+    static int hexapolarCount(int rings) {
+        return 1 + 3 * rings * (rings + 1);
+    }
+
+    /**
+     * Generates about count points. Fibonacci and Sobol distributions contain exactly count points, while grids and
+     * hexapolar patterns are rounded up to the next complete grid or ring.
+     */
+    template<typename Float = double>
+    PupilSamples<Float> operator()(int count) const {
+        PupilSamples<Float> samples;
+        generate(count, samples);
+        return samples;
+    }
+
+    template<typename Float>
+    void generate(int count, PupilSamples<Float> &samples) const {
+        samples.clear();
+        if (count <= 0) {
+            return;
+        }
+
+        switch (type) {
+            case GRID: {
+                // the fraction of a grid within the disk approaches pi / 4
+                int n = std::max(1, int(std::sqrt(count * 4 / M_PI)));
+                while (gridCount(n) < count) {
+                    n++;
+                }
+
+                samples.reserve(gridCount(n));
+                for (int iy = 0; iy < n; iy++) {
+                    for (int ix = 0; ix < n; ix++) {
+                        const double px = 2 * (ix + 0.5) / n - 1;
+                        const double py = 2 * (iy + 0.5) / n - 1;
+                        if (sqr(px) + sqr(py) <= 1) {
+                            samples.push_back({ px, py });
+                        }
+                    }
+                }
+                break;
+            }
+
+            case HEXAPOLAR: {
+                int rings = 0;
+                while (hexapolarCount(rings) < count) {
+                    rings++;
+                }
+
+                samples.reserve(hexapolarCount(rings));
+                // ring k represents the annulus between 1 + 3k(k - 1) and 1 + 3k(k + 1) points of area
+                const double total = hexapolarCount(rings);
+                samples.push_back({ 0, 0 });
+                for (int ring = 1; ring <= rings; ring++) {
+                    const double radius = std::sqrt((1 + 3 * sqr(double(ring))) / total);
+                    for (int i = 0; i < 6 * ring; i++) {
+                        samples.push_back(polar(double(i) / (6 * ring), radius));
+                    }
+                }
+                break;
+            }
+
+            case FIBONACCI: {
+                // fractional part of the golden ratio, i.e. the golden angle in turns
+                const double golden = 0.5 * (std::sqrt(5.0) - 1);
+                samples.reserve(count);
+                for (int i = 0; i < count; i++) {
+                    const double turns = double(i) * golden;
+                    samples.push_back(polar(turns - std::floor(turns), std::sqrt((i + 0.5) / count)));
+                }
+                break;
+            }
+
+            case SOBOL: {
+                const SobolSequence sequence(seed);
+                samples.reserve(count);
+                for (int i = 0; i < count; i++) {
+                    samples.push_back(sequence.disk(uint32_t(i)));
+                }
+                break;
+            }
+        }
+    }
+
+private:
+    static int gridCount(int n) {
+        int count = 0;
+        for (int iy = 0; iy < n; iy++) {
+            for (int ix = 0; ix < n; ix++) {
+                if (sqr(2 * (ix + 0.5) / n - 1) + sqr(2 * (iy + 0.5) / n - 1) <= 1) {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+};
+
+}
+}
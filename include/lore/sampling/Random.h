@@ -0,0 +1,75 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/math.h>
+
+#include <array>
+#include <cstdint>
+
+namespace lore {
+namespace sampling {
+
+/**
+ * Counter-based Philox4x32-10 random number generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+ * Every output block is a pure function of the key and the counter, so samples can be generated in any order and on
+ * any thread while remaining reproducible.
+ */
+struct Philox {
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    Key key;
+
+    Philox(uint64_t seed = 0)
+    : key { uint32_t(seed), uint32_t(seed >> 32) } {}
+
+    Counter operator()(Counter counter) const {
+        Key k = key;
+        for (int round = 0; round < 10; round++) {
+            if (round > 0) {
+                k[0] += 0x9E3779B9;
+                k[1] += 0xBB67AE85;
+            }
+
+            const uint64_t product0 = uint64_t(0xD2511F53) * counter[0];
+            const uint64_t product1 = uint64_t(0xCD9E8D57) * counter[2];
+            counter = {
+                uint32_t(product1 >> 32) ^ counter[1] ^ k[0],
+                uint32_t(product1),
+                uint32_t(product0 >> 32) ^ counter[3] ^ k[1],
+                uint32_t(product0)
+            };
+        }
+        return counter;
+    }
+
+    /**
+     * Returns four random words for a given sample index and dimension.
+     */
+    Counter block(uint64_t sample, uint32_t dimension) const {
+        return (*this)({ uint32_t(sample), uint32_t(sample >> 32), dimension, 0 });
+    }
+
+    /**
+     * Returns a uniformly distributed number in the open interval (0, 1).
+     */
+    double uniform(uint64_t sample, uint32_t dimension) const {
+        return toUnit(block(sample, dimension)[0]);
+    }
+
+    /**
+     * Returns a standard normal distributed number using the Box-Muller transform.
+     */
+    double normal(uint64_t sample, uint32_t dimension) const {
+        const Counter words = block(sample, dimension);
+        const double radius = std::sqrt(-2 * std::log(toUnit(words[0])));
+        return radius * std::cos(2 * M_PI * toUnit(words[1]));
+    }
+
+    static double toUnit(uint32_t word) {
+        return (double(word) + 0.5) * (1.0 / 4294967296.0);
+    }
+};
+
+}
+}
@@ -0,0 +1,200 @@
+#include <lore/analysis/ResultCache.h>
+#include <lore/logging.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace lore {
+
+namespace {
+
+constexpr char Magic[8] = { 'L', 'O', 'R', 'E', 'C', 'A', 'C', 'H' };
+constexpr uint32_t Version = 1;
+constexpr uint32_t ByteOrderMark = 0x01020304;
+
+/**
+ * Upper bound on the number of values of a single entry, which guards against corrupt files.
+ */
+constexpr uint32_t MaxValues = 1 << 20;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t numEntries;
+};
+
+struct EntryHeader {
+    uint64_t lens;
+    uint64_t query;
+    uint32_t numValues;
+    uint32_t reserved;
+};
+
+}
+
+ResultCache ResultCache::shared;
+
+ResultCache::ResultCache(size_t capacity)
+: maxEntries(capacity) {}
+
+std::optional<std::vector<double>> ResultCache::find(const Key &key) {
+    std::lock_guard lock(mutex);
+    return findLocked(key, std::nullopt);
+}
+
+std::optional<std::vector<double>> ResultCache::find(const Key &key, size_t count) {
+    std::lock_guard lock(mutex);
+    return findLocked(key, count);
+}
+
+std::optional<std::vector<double>> ResultCache::findLocked(const Key &key, std::optional<size_t> count) {
+    const auto it = index.find(key);
+    if (it == index.end() || (count && it->second->values.size() != *count)) {
+        counters.misses++;
+        return std::nullopt;
+    }
+
+    counters.hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->values;
+}
+
+void ResultCache::insert(const Key &key, std::vector<double> values) {
+    std::lock_guard lock(mutex);
+    insertLocked(key, std::move(values));
+}
+
+void ResultCache::insertLocked(const Key &key, std::vector<double> values) {
+    if (maxEntries == 0) {
+        return;
+    }
+
+    const auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->values = std::move(values);
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    if (entries.size() >= maxEntries) {
+        evictLocked();
+    }
+    entries.push_front({ key, std::move(values) });
+    index.emplace(key, entries.begin());
+}
+
+void ResultCache::evictLocked() {
+    index.erase(entries.back().key);
+    entries.pop_back();
+    counters.evictions++;
+}
+
+void ResultCache::clear() {
+    std::lock_guard lock(mutex);
+    entries.clear();
+    index.clear();
+    counters = {};
+}
+
+size_t ResultCache::size() const {
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+size_t ResultCache::capacity() const {
+    std::lock_guard lock(mutex);
+    return maxEntries;
+}
+
+void ResultCache::setCapacity(size_t capacity) {
+    std::lock_guard lock(mutex);
+    maxEntries = capacity;
+    while (entries.size() > maxEntries) {
+        evictLocked();
+    }
+}
+
+ResultCache::Statistics ResultCache::statistics() const {
+    std::lock_guard lock(mutex);
+    return counters;
+}
+
+bool ResultCache::save(const std::string &path) const {
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file { temporaryPath, std::ios::binary };
+
+        std::lock_guard lock(mutex);
+        FileHeader header {};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.byteOrder = ByteOrderMark;
+        header.numEntries = entries.size();
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        // least recently used first, so that loading restores the order
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            const EntryHeader entry { it->key.lens, it->key.query, uint32_t(it->values.size()), 0 };
+            file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            file.write(reinterpret_cast<const char *>(it->values.data()), std::streamsize(it->values.size() * sizeof(double)));
+        }
+
+        if (!file.flush()) {
+            log::warning() << "could not write result cache '" << temporaryPath << "'" << std::flush;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        log::warning() << "could not replace result cache '" << path << "': " << error.message() << std::flush;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+size_t ResultCache::load(const std::string &path) {
+    std::ifstream file { path, std::ios::binary };
+    if (!file) {
+        return 0;
+    }
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version ||
+        header.byteOrder != ByteOrderMark
+    ) {
+        log::warning() << "ignoring incompatible result cache '" << path << "'" << std::flush;
+        return 0;
+    }
+
+    // entries are validated completely before any of them is inserted
+    std::vector<Entry> loaded;
+    for (uint64_t i = 0; i < header.numEntries; i++) {
+        EntryHeader entry;
+        if (!file.read(reinterpret_cast<char *>(&entry), sizeof(entry)) || entry.numValues > MaxValues) {
+            log::warning() << "ignoring corrupt result cache '" << path << "'" << std::flush;
+            return 0;
+        }
+
+        std::vector<double> values(entry.numValues);
+        if (!file.read(reinterpret_cast<char *>(values.data()), std::streamsize(values.size() * sizeof(double)))) {
+            log::warning() << "ignoring truncated result cache '" << path << "'" << std::flush;
+            return 0;
+        }
+        loaded.push_back({ { entry.lens, entry.query }, std::move(values) });
+    }
+
+    std::lock_guard lock(mutex);
+    for (Entry &entry : loaded) {
+        insertLocked(entry.key, std::move(entry.values));
+    }
+    return loaded.size();
+}
+
+}
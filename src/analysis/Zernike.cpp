@@ -0,0 +1,248 @@
+#include <lore/analysis/Zernike.h>
+#include <lore/math.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/profiling/Profiler.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace lore {
+
+namespace {
+
+/**
+ * Replaces the lower triangle of the symmetric n x n matrix a with its Cholesky factor L, such that a = L L^T.
+ * Returns false if a is not positive definite.
+ */
+bool cholesky(std::vector<double> &a, int n) {
+    for (int j = 0; j < n; j++) {
+        double diagonal = a[j * n + j];
+        for (int k = 0; k < j; k++) {
+            diagonal -= sqr(a[j * n + k]);
+        }
+        if (!(diagonal > 0)) {
+            return false;
+        }
+        const double root = std::sqrt(diagonal);
+        a[j * n + j] = root;
+
+        for (int i = j + 1; i < n; i++) {
+            double value = a[i * n + j];
+            for (int k = 0; k < j; k++) {
+                value -= a[i * n + k] * a[j * n + k];
+            }
+            a[i * n + j] = value / root;
+        }
+    }
+    return true;
+}
+
+/**
+ * Solves L L^T x = b in place for the factor computed by cholesky.
+ */
+void substitute(const std::vector<double> &l, int n, double *b) {
+    for (int i = 0; i < n; i++) {
+        double value = b[i];
+        for (int k = 0; k < i; k++) {
+            value -= l[i * n + k] * b[k];
+        }
+        b[i] = value / l[i * n + i];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double value = b[i];
+        for (int k = i + 1; k < n; k++) {
+            value -= l[k * n + i] * b[k];
+        }
+        b[i] = value / l[i * n + i];
+    }
+}
+
+double factorial(int n) {
+    double result = 1;
+    for (int i = 2; i <= n; i++) {
+        result *= i;
+    }
+    return result;
+}
+
+}
+
+namespace zernike {
+
+Index noll(int j) {
+    if (j < 1) {
+        throw std::invalid_argument("Noll indices start at 1");
+    }
+
+    int n = 0;
+    while (j > (n + 1) * (n + 2) / 2) {
+        n++;
+    }
+    const int k = j - n * (n + 1) / 2 - 1;
+    const int m = n % 2 == 0 ? 2 * ((k + 1) / 2) : 2 * (k / 2) + 1;
+    // even indices are cosine terms and odd indices sine terms
+    return { n, m != 0 && j % 2 != 0 ? -m : m };
+}
+
+double radial(int n, int m, double rho) {
+    m = std::abs(m);
+    double result = 0;
+    for (int s = 0; s <= (n - m) / 2; s++) {
+        const double coefficient = factorial(n - s) /
+            (factorial(s) * factorial((n + m) / 2 - s) * factorial((n - m) / 2 - s));
+        result += (s % 2 == 0 ? coefficient : -coefficient) * std::pow(rho, n - 2 * s);
+    }
+    return result;
+}
+
+double evaluate(int j, double x, double y) {
+    const Index index = noll(j);
+    const double rho = std::sqrt(sqr(x) + sqr(y));
+    const double r = radial(index.n, index.m, rho);
+    if (index.m == 0) {
+        return std::sqrt(double(index.n + 1)) * r;
+    }
+
+    const double theta = std::atan2(y, x);
+    const double norm = std::sqrt(2.0 * (index.n + 1));
+    return index.m > 0 ?
+        norm * r * std::cos(index.m * theta) :
+        norm * r * std::sin(-index.m * theta);
+}
+
+}
+
+ZernikeFit::ZernikeFit(int terms, std::span<const double> x, std::span<const double> y)
+: numTerms(terms), x(x.begin(), x.end()), y(y.begin(), y.end()) {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("pupil coordinates differ in length");
+    }
+    factorize();
+}
+
+ZernikeFit::ZernikeFit(int terms, int gridSize)
+: numTerms(terms), gridSize(gridSize) {
+    for (int iy = 0; iy < gridSize; iy++) {
+        for (int ix = 0; ix < gridSize; ix++) {
+            const double px = 2 * (ix + 0.5) / gridSize - 1;
+            const double py = 2 * (iy + 0.5) / gridSize - 1;
+            if (sqr(px) + sqr(py) <= 1) {
+                x.push_back(px);
+                y.push_back(py);
+                gridIndices.push_back(iy * gridSize + ix);
+            }
+        }
+    }
+    factorize();
+}
+
+void ZernikeFit::factorize() {
+    LORE_PROFILE_SCOPE("ZernikeFit::factorize");
+    if (numTerms < 1) {
+        throw std::invalid_argument("Zernike fits require at least one term");
+    }
+
+    const size_t numSamples = samples();
+    basis.resize(numSamples * numTerms);
+    for (size_t i = 0; i < numSamples; i++) {
+        for (int t = 0; t < numTerms; t++) {
+            basis[i * numTerms + t] = zernike::evaluate(t + 1, x[i], y[i]);
+        }
+    }
+
+    std::vector<double> normal(size_t(numTerms) * numTerms);
+    for (size_t i = 0; i < numSamples; i++) {
+        const double *row = &basis[i * numTerms];
+        for (int r = 0; r < numTerms; r++) {
+            for (int c = 0; c <= r; c++) {
+                normal[r * numTerms + c] += row[r] * row[c];
+            }
+        }
+    }
+    if (!cholesky(normal, numTerms)) {
+        throw std::invalid_argument(
+            std::to_string(numSamples) + " samples do not determine " + std::to_string(numTerms) + " Zernike terms");
+    }
+
+    // the projection of sample i is the solution of the normal equations for its row of the basis
+    projection = basis;
+    for (size_t i = 0; i < numSamples; i++) {
+        substitute(normal, numTerms, &projection[i * numTerms]);
+    }
+}
+
+std::vector<double> ZernikeFit::solve(std::span<const double> values, const std::vector<char> &mask) const {
+    std::vector<double> normal(size_t(numTerms) * numTerms), rhs(numTerms);
+    for (size_t i = 0; i < values.size(); i++) {
+        if (!mask[i]) {
+            continue;
+        }
+        const double *row = &basis[i * numTerms];
+        for (int r = 0; r < numTerms; r++) {
+            for (int c = 0; c <= r; c++) {
+                normal[r * numTerms + c] += row[r] * row[c];
+            }
+            rhs[r] += row[r] * values[i];
+        }
+    }
+
+    if (!cholesky(normal, numTerms)) {
+        return std::vector<double>(numTerms, std::numeric_limits<double>::quiet_NaN());
+    }
+    substitute(normal, numTerms, rhs.data());
+    return rhs;
+}
+
+std::vector<double> ZernikeFit::operator()(const Wavefront &wavefront) const {
+    if (gridSize == 0 || wavefront.size != gridSize) {
+        throw std::invalid_argument("wavefront does not match the sample grid of the fit");
+    }
+
+    std::vector<double> values(samples());
+    std::vector<char> mask(samples());
+    bool complete = true;
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = wavefront.opd[gridIndices[i]];
+        mask[i] = !std::isnan(values[i]);
+        complete = complete && mask[i];
+    }
+
+    if (!complete) {
+        // vignetting changes the sample pattern, for which the precomputed projection does not apply
+        return solve(values, mask);
+    }
+
+    std::vector<double> coefficients(numTerms);
+    (*this)(std::span<const double>(values), std::span<double>(coefficients));
+    return coefficients;
+}
+
+std::vector<std::vector<double>> ZernikeFit::operator()(std::span<const Wavefront> wavefronts, bool parallel) const {
+    LORE_PROFILE_SCOPE("ZernikeFit::batch");
+
+    std::vector<std::vector<double>> results(wavefronts.size());
+    auto fit = [&](int i) {
+        results[i] = (*this)(wavefronts[i]);
+    };
+
+    if (parallel) {
+        parallel::parallelFor(0, int(wavefronts.size()), fit);
+    } else {
+        for (int i = 0; i < int(wavefronts.size()); i++) {
+            fit(i);
+        }
+    }
+    return results;
+}
+
+double ZernikeFit::evaluate(std::span<const double> coefficients, double x, double y) {
+    double result = 0;
+    for (size_t t = 0; t < coefficients.size(); t++) {
+        result += coefficients[t] * zernike::evaluate(int(t) + 1, x, y);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,275 @@
+#include <lore/io/BinaryLens.h>
+#include <lore/profiling/Profiler.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LORE_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lore {
+namespace io {
+
+namespace binary {
+
+Glass<float> toGlass(const GlassRecord &record) {
+    switch (record.type) {
+        case Glass<float>::SCHOTT2X4: {
+            LaurentIOR<2, 4, float> ior;
+            for (int i = 0; i < 6; i++) {
+                ior.A[i] = record.coefficients[i];
+            }
+            return Glass<float>(ior);
+        }
+        case Glass<float>::SELL3T:
+        default: {
+            SellmeierIOR<3, float> ior;
+            for (int i = 0; i < 3; i++) {
+                ior.B[i] = record.coefficients[i];
+                ior.C[i] = record.coefficients[3 + i];
+            }
+            return Glass<float>(ior);
+        }
+    }
+}
+
+GlassRecord fromGlass(const Glass<float> &glass, StringRef name) {
+    GlassRecord record {};
+    record.name = name;
+    record.type = uint32_t(glass.type);
+    switch (glass.type) {
+        case Glass<float>::SCHOTT2X4:
+            for (int i = 0; i < 6; i++) {
+                record.coefficients[i] = glass.schott2x4.A[i];
+            }
+            break;
+        case Glass<float>::SELL3T:
+            for (int i = 0; i < 3; i++) {
+                record.coefficients[i] = glass.sell3t.B[i];
+                record.coefficients[3 + i] = glass.sell3t.C[i];
+            }
+            break;
+    }
+    return record;
+}
+
+}
+
+/**
+ * Owns the bytes of a file, either as a read-only mapping or as a heap buffer.
+ */
+struct BinaryLensFile::Storage {
+    const std::byte *data = nullptr;
+    size_t size = 0;
+
+    std::vector<std::byte> buffer;
+    void *mapping = nullptr;
+
+    ~Storage() {
+#ifdef LORE_HAS_MMAP
+        if (mapping) {
+            munmap(mapping, size);
+        }
+#endif
+    }
+};
+
+namespace {
+
+template<typename Record>
+std::span<const Record> table(const std::byte *data, size_t size, uint64_t offset, uint64_t count, const char *name) {
+    if (offset % alignof(Record) != 0) {
+        throw BinaryLensException(std::string("misaligned ") + name + " table");
+    }
+    if (offset > size || count > (size - offset) / sizeof(Record)) {
+        throw BinaryLensException(std::string(name) + " table exceeds the file");
+    }
+    return std::span<const Record>(reinterpret_cast<const Record *>(data + offset), size_t(count));
+}
+
+void checkRange(uint64_t first, uint64_t count, size_t size, const char *what) {
+    if (first > size || count > size - first) {
+        throw BinaryLensException(std::string(what) + " out of range");
+    }
+}
+
+}
+
+BinaryLensFile::BinaryLensFile(std::unique_ptr<Storage> storage)
+: storage(std::move(storage)) {
+    const std::byte *data = this->storage->data;
+    const size_t size = this->storage->size;
+
+    if (size < binary::HeaderSizeV1) {
+        throw BinaryLensException("file is too small for a binary lens header");
+    }
+    if (reinterpret_cast<uintptr_t>(data) % alignof(binary::Header) != 0) {
+        throw BinaryLensException("misaligned buffer");
+    }
+
+    // copied, since version 1 headers are shorter
+    binary::Header header {};
+    std::memcpy(&header, data, binary::HeaderSizeV1);
+    if (std::memcmp(header.magic, binary::Magic, sizeof(header.magic)) != 0) {
+        throw BinaryLensException("not a binary lens file");
+    }
+    if (header.byteOrder != binary::ByteOrderMark) {
+        throw BinaryLensException("binary lens file has a different byte order");
+    }
+    if (header.version < 1 || header.version > binary::Version) {
+        throw BinaryLensException("unsupported binary lens version " + std::to_string(header.version));
+    }
+    if (header.version >= 2) {
+        if (size < sizeof(binary::Header)) {
+            throw BinaryLensException("file is too small for a binary lens header");
+        }
+        std::memcpy(&header, data, sizeof(binary::Header));
+    }
+
+    lenses = table<binary::LensRecord>(data, size, header.lensOffset, header.numLenses, "lens");
+    surfaces = table<binary::SurfaceRecord>(data, size, header.surfaceOffset, header.numSurfaces, "surface");
+    wavelengths = table<binary::WavelengthRecord>(
+        data, size, header.wavelengthOffset, header.numWavelengths, "wavelength");
+    glasses = table<binary::GlassRecord>(data, size, header.glassOffset, header.numGlasses, "glass");
+    strings = table<char>(data, size, header.stringOffset, header.stringSize, "string");
+    if (header.version >= 2) {
+        sources = table<binary::SourceRecord>(data, size, header.sourceOffset, header.numSources, "source");
+    }
+
+    // validate all references once, so that views never need to
+    for (const binary::LensRecord &lens : lenses) {
+        checkRange(lens.name.offset, lens.name.length, strings.size(), "lens name");
+        checkRange(lens.description.offset, lens.description.length, strings.size(), "lens description");
+        checkRange(lens.firstSurface, lens.numSurfaces, surfaces.size(), "surfaces");
+        checkRange(lens.firstWavelength, lens.numWavelengths, wavelengths.size(), "wavelengths");
+        if (lens.stopIndex < 0 || uint32_t(lens.stopIndex) >= lens.numSurfaces) {
+            throw BinaryLensException("stop index out of range");
+        }
+    }
+    for (const binary::SurfaceRecord &surface : surfaces) {
+        if (surface.glass >= glasses.size()) {
+            throw BinaryLensException("glass index out of range");
+        }
+    }
+    for (size_t i = 0; i < sources.size(); i++) {
+        checkRange(sources[i].name.offset, sources[i].name.length, strings.size(), "source name");
+        checkRange(sources[i].firstLens, sources[i].numLenses, lenses.size(), "source lenses");
+        if (i > 0 && sourceName(i) < sourceName(i - 1)) {
+            throw BinaryLensException("source table is not sorted");
+        }
+    }
+    for (const binary::GlassRecord &glass : glasses) {
+        checkRange(glass.name.offset, glass.name.length, strings.size(), "glass name");
+        if (glass.type != Glass<float>::SELL3T && glass.type != Glass<float>::SCHOTT2X4) {
+            throw BinaryLensException("unknown glass type " + std::to_string(glass.type));
+        }
+    }
+}
+
+BinaryLensFile::BinaryLensFile(BinaryLensFile &&) noexcept = default;
+BinaryLensFile &BinaryLensFile::operator=(BinaryLensFile &&) noexcept = default;
+BinaryLensFile::~BinaryLensFile() = default;
+
+BinaryLensFile BinaryLensFile::open(const std::string &path) {
+    LORE_PROFILE_SCOPE("BinaryLensFile::open");
+
+    auto storage = std::make_unique<Storage>();
+#ifdef LORE_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw BinaryLensException("could not open '" + path + "'");
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw BinaryLensException("could not stat '" + path + "'");
+    }
+    storage->size = size_t(status.st_size);
+    if (storage->size > 0) {
+        void *mapping = mmap(nullptr, storage->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw BinaryLensException("could not map '" + path + "'");
+        }
+        storage->mapping = mapping;
+        storage->data = static_cast<const std::byte *>(mapping);
+    }
+    ::close(fd);
+#else
+    std::ifstream file { path, std::ios::binary };
+    if (!file) {
+        throw BinaryLensException("could not open '" + path + "'");
+    }
+    file.seekg(0, std::ios::end);
+    storage->buffer.resize(size_t(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(storage->buffer.data()), std::streamsize(storage->buffer.size()));
+    storage->data = storage->buffer.data();
+    storage->size = storage->buffer.size();
+#endif
+    return BinaryLensFile(std::move(storage));
+}
+
+BinaryLensFile BinaryLensFile::fromBuffer(std::vector<std::byte> buffer) {
+    auto storage = std::make_unique<Storage>();
+    storage->buffer = std::move(buffer);
+    storage->data = storage->buffer.data();
+    storage->size = storage->buffer.size();
+    return BinaryLensFile(std::move(storage));
+}
+
+std::optional<BinaryLensFile::Range> BinaryLensFile::find(std::string_view source) const {
+    const auto it = std::lower_bound(
+        sources.begin(), sources.end(), source,
+        [this](const binary::SourceRecord &record, std::string_view name) { return string(record.name) < name; }
+    );
+    if (it == sources.end() || string(it->name) != source) {
+        return std::nullopt;
+    }
+    return Range { it->firstLens, it->numLenses };
+}
+
+LensSchema<float> BinaryLensFile::LensView::schema(const GlassCatalog *catalog) const {
+    LensSchema<float> result;
+    result.name = std::string(name());
+    result.description = std::string(description());
+    result.fieldAngle = fieldAngle();
+    result.entranceBeamRadius = entranceBeamRadius();
+    result.stopIndex = stopIndex();
+
+    result.surfaces.reserve(record->numSurfaces);
+    for (int i = 0; i < int(record->numSurfaces); i++) {
+        SurfaceSchema<float> schema;
+        static_cast<Surface<float> &>(schema) = surface(i);
+        schema.glassName = std::string(glassName(i));
+        if (catalog) {
+            schema.glassId = catalog->find(schema.glassName).value_or(GlassCatalog::Air);
+        }
+        result.surfaces.push_back(std::move(schema));
+    }
+
+    result.wavelengths.reserve(record->numWavelengths);
+    for (const binary::WavelengthRecord &wavelength : wavelengths()) {
+        result.wavelengths.emplace_back(wavelength.wavelength, wavelength.weight);
+    }
+    return result;
+}
+
+std::vector<LensSchema<float>> BinaryLensFile::schemas(const GlassCatalog *catalog) const {
+    std::vector<LensSchema<float>> result;
+    result.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        result.push_back((*this)[i].schema(catalog));
+    }
+    return result;
+}
+
+}
+}
@@ -1,10 +1,16 @@
 #include <lore/io/LensReader.h>
 #include <lore/lens/GlassCatalog.h>
 #include <lore/logging.h>
+#include <lore/profiling/Profiler.h>
 
+#include <exception>
 #include <iostream>
+#include <optional>
 #include <sstream>
-#include <exception>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace lore {
 namespace io {
@@ -92,7 +98,7 @@ public:
 
     bool next(Token &token) {
         token.type = peek();
-        token.pos = m_pos;
+        token.pos = m_stream.pos();
 
         switch (token.type) {
             case Token::NONE:
@@ -268,22 +274,80 @@ private:
     }
 
     IStreamPosition m_stream;
-    Position m_pos;
 };
 
-struct ParserResult {
+/**
+ * Collects parsed lenses as standalone LensSchema objects.
+ * Receives the same calls as LensArchive, so that the parser can fill either.
+ */
+struct SchemaBuilder {
     std::vector<LensSchema<float>> lenses;
+    LensSchema<float> lens;
+
+    void beginLens(std::string_view name) {
+        lens = LensSchema<float>();
+        lens.name = name;
+        lens.stopIndex = 1;
+    }
+
+    void setDescription(std::string_view description) {
+        lens.description = description;
+    }
+
+    void setFieldAngle(float fieldAngle) {
+        lens.fieldAngle = fieldAngle;
+    }
+
+    void setEntranceBeamRadius(float entranceBeamRadius) {
+        lens.entranceBeamRadius = entranceBeamRadius;
+    }
+
+    void markStop() {
+        lens.stopIndex = int(lens.surfaces.size());
+    }
+
+    void addWavelength(float wavelength) {
+        lens.wavelengths.emplace_back(wavelength, 1.f);
+    }
+
+    bool setWavelengthWeight(int index, float weight) {
+        if (index < 0 || index >= int(lens.wavelengths.size())) {
+            return false;
+        }
+        lens.wavelengths[index].weight = weight;
+        return true;
+    }
+
+    void addSurface(const Surface<float> &surface, std::string_view glassName, GlassId glassId) {
+        SurfaceSchema<float> schema;
+        static_cast<Surface<float> &>(schema) = surface;
+        schema.glassName = glassName;
+        schema.glassId = glassId;
+        lens.surfaces.push_back(std::move(schema));
+    }
+
+    void endLens() {
+        lenses.push_back(std::move(lens));
+    }
+
+    void abortLens() {}
 };
 
+template<typename Builder>
 class Parser {
 public:
     const GlassCatalog &glassCatalog;
 
-    Parser(const GlassCatalog &glassCatalog) : glassCatalog(glassCatalog) {}
+    /**
+     * Receives a copy of every warning and error that is logged, if set.
+     */
+    std::vector<ParseDiagnostic> *diagnostics;
 
-    ParserResult parse(std::istream &is) const {
+    Parser(const GlassCatalog &glassCatalog, std::vector<ParseDiagnostic> *diagnostics = nullptr)
+    : glassCatalog(glassCatalog), diagnostics(diagnostics) {}
+
+    void parse(std::istream &is, Builder &builder) const {
         Tokenizer tokenizer(is);
-        ParserResult result;
 
         while (true) {
             Token token;
@@ -295,13 +359,18 @@ public:
                 log::debug() << token.text << std::flush;
                 continue;
             } else if (token.type != Token::KEYWORD) {
-                log::warning() << "unexpected " << Token::typeToString(token.type) << std::flush;
+                report(ParseDiagnostic::WARNING, token.pos, "unexpected " + Token::typeToString(token.type));
                 continue;
             }
 
             // handle keywords
             if (token.text == "LEN") {
-                result.lenses.push_back(parseLens(tokenizer));
+                try {
+                    parseLens(tokenizer, builder);
+                } catch (...) {
+                    builder.abortLens();
+                    throw;
+                }
             } else if (token.text == "DLRS") {
                 // @todo ??
                 tokenizer.expectInt();
@@ -321,16 +390,25 @@ public:
                 // @todo ??
                 tokenizer.expect(Token::KEYWORD);
             } else {
-                log::warning() << "unknown keyword '" << token.text << "'" << std::flush;
+                report(ParseDiagnostic::WARNING, token.pos, "unknown keyword '" + token.text + "'");
             }
         }
-
-        return result;
     }
 
 private:
-    SurfaceSchema<float> defaultSurface() const {
-        SurfaceSchema<float> surface;
+    void report(ParseDiagnostic::Severity severity, const Position &pos, const std::string &message) const {
+        if (severity == ParseDiagnostic::ERROR) {
+            log::error() << message << std::flush;
+        } else {
+            log::warning() << message << std::flush;
+        }
+        if (diagnostics) {
+            diagnostics->push_back({ severity, pos.line, pos.column, message });
+        }
+    }
+
+    Surface<float> defaultSurface() const {
+        Surface<float> surface;
         surface.checkAperture = false;
         surface.radius = 0;
         surface.aperture = 0;
@@ -339,26 +417,26 @@ private:
         return surface;
     }
 
-    LensSchema<float> parseLens(Tokenizer &tokenizer) const {
-        LensSchema<float> lens;
-        lens.stopIndex = 1;
-
+    void parseLens(Tokenizer &tokenizer, Builder &builder) const {
         tokenizer.expectKeyword("NEW");
-        lens.name = tokenizer.expectString();
+        builder.beginLens(tokenizer.expectString());
         tokenizer.expectFloat(); // EFL
         tokenizer.expectInt(); // num surfaces
 
-        SurfaceSchema<float> surface = defaultSurface();
+        Surface<float> surface = defaultSurface();
+        std::string glassName;
+        GlassId glassId = GlassCatalog::Air;
+        int numWavelengths = 0;
         while (true) {
             const Token token = tokenizer.expect(Token::KEYWORD);
 
             // lens commands
             if (token.text == "EBR") {
-                lens.entranceBeamRadius = tokenizer.expectFloat();
+                builder.setEntranceBeamRadius(tokenizer.expectFloat());
             } else if (token.text == "ANG") {
-                lens.fieldAngle = tokenizer.expectFloat();
+                builder.setFieldAngle(tokenizer.expectFloat());
             } else if (token.text == "DES") {
-                lens.description = tokenizer.expectString();
+                builder.setDescription(tokenizer.expectString());
             } else if (token.text == "UNI") {
                 // @todo ??
                 tokenizer.expectFloat();
@@ -366,12 +444,18 @@ private:
 
             // surface commands
             if (token.text == "AIR") {
-                surface.glassName = "AIR";
+                glassName = "AIR";
+                glassId = GlassCatalog::Air;
                 surface.glass = Glass<float>::air();
             } else if (token.text == "GLA") {
-                const std::string name = tokenizer.expect(Token::KEYWORD).text;
-                surface.glassName = name;
-                surface.glass = glassCatalog.glass(name);
+                const Token name = tokenizer.expect(Token::KEYWORD);
+                const std::optional<GlassId> id = glassCatalog.find(name.text);
+                if (!id) {
+                    report(ParseDiagnostic::ERROR, name.pos, "unknown glass '" + name.text + "'");
+                }
+                glassName = name.text;
+                glassId = id.value_or(GlassCatalog::Air);
+                surface.glass = glassCatalog.glass(glassId);
             } else if (token.text == "RD") {
                 surface.radius = tokenizer.expectFloat();
             } else if (token.text == "TH") {
@@ -385,7 +469,7 @@ private:
                 }
                 surface.aperture = tokenizer.expectFloat();
             } else if (token.text == "AST") {
-                lens.stopIndex = int(lens.surfaces.size());
+                builder.markStop();
             } else if (token.text == "DRW") {
                 // @todo
                 tokenizer.expect(Token::KEYWORD);
@@ -396,46 +480,53 @@ private:
             // wavelength commands
             if (token.text == "WV") {
                 while (tokenizer.peek() == Token::NUMBER) {
-                    WeightedWavelength<float> ww;
-                    ww.wavelength = tokenizer.expectFloat();
-                    ww.weight = 1;
-                    lens.wavelengths.push_back(ww);
+                    builder.addWavelength(tokenizer.expectFloat());
+                    numWavelengths++;
                 }
             } else if (token.text == "WW") {
                 int i = 0;
                 while (tokenizer.peek() == Token::NUMBER) {
-                    if (i >= lens.wavelengths.size()) {
-                        log::warning() << "too many wavelength weights given" << std::flush;
+                    if (i >= numWavelengths) {
+                        report(ParseDiagnostic::WARNING, token.pos, "too many wavelength weights given");
                         break;
                     }
-                    lens.wavelengths[i++].weight = tokenizer.expectFloat();
+                    builder.setWavelengthWeight(i++, tokenizer.expectFloat());
                 }
             } else
 
             // flow commands
             if (token.text == "NXT") {
-                lens.surfaces.push_back(surface);
+                builder.addSurface(surface, glassName, glassId);
                 surface = defaultSurface();
+                glassName.clear();
+                glassId = GlassCatalog::Air;
             } else if (token.text == "END") {
                 tokenizer.expectInt();
-                lens.surfaces.push_back(surface);
-                surface = defaultSurface();
+                builder.addSurface(surface, glassName, glassId);
                 break;
             } else
 
             {
-                log::warning() << "unknown surface command '" << token.text << "'" << std::flush;
+                report(ParseDiagnostic::WARNING, token.pos, "unknown surface command '" + token.text + "'");
             }
         }
 
-        return lens;
+        builder.endLens();
     }
 };
 
-std::vector<LensSchema<float>> LensReader::read(std::istream &is) const {
-    Parser parser{glassCatalog};
-    ParserResult result = parser.parse(is);
-    return result.lenses;
+std::vector<LensSchema<float>> LensReader::read(std::istream &is, std::vector<ParseDiagnostic> *diagnostics) const {
+    LORE_PROFILE_SCOPE("LensReader::read");
+
+    SchemaBuilder builder;
+    Parser<SchemaBuilder>{glassCatalog, diagnostics}.parse(is, builder);
+    return std::move(builder.lenses);
+}
+
+void LensReader::read(std::istream &is, LensArchive &archive, std::vector<ParseDiagnostic> *diagnostics) const {
+    LORE_PROFILE_SCOPE("LensReader::read");
+
+    Parser<LensArchive>{glassCatalog, diagnostics}.parse(is, archive);
 }
 
 }
@@ -0,0 +1,287 @@
+#include <lore/io/LensWriter.h>
+#include <lore/io/BinaryLens.h>
+#include <lore/analysis/Paraxial.h>
+#include <lore/profiling/Profiler.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace lore {
+namespace io {
+
+namespace {
+
+/**
+ * Shortest representation that reads back to the same value.
+ */
+std::string formatFloat(float value) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
+
+void writeString(std::ostream &os, std::string_view text) {
+    os << '"';
+    for (const char chr : text) {
+        switch (chr) {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            default:   os << chr; break;
+        }
+    }
+    os << '"';
+}
+
+float effectiveFocalLength(const LensSchema<float> &lens) {
+    if (lens.surfaces.size() < 2 || lens.wavelengths.empty()) {
+        return 0;
+    }
+    const double efl = ParaxialAnalysis<double>(lens.lens<double>(), lens.primaryWavelength()).efl;
+    return std::isfinite(efl) ? float(efl) : 0.f;
+}
+
+template<typename T>
+void writeTable(std::ostream &os, const std::vector<T> &table) {
+    os.write(reinterpret_cast<const char *>(table.data()), std::streamsize(table.size() * sizeof(T)));
+}
+
+/**
+ * Reason why BinaryLensFile would reject a lens, or an empty string if the lens can be written.
+ */
+std::string binaryProblem(const LensArchive::LensView &lens) {
+    const std::span<const ArchivedSurface> surfaces = lens.surfaces();
+    if (surfaces.empty()) {
+        return "has no surfaces";
+    }
+    if (lens.stopIndex() < 0 || size_t(lens.stopIndex()) >= surfaces.size()) {
+        return "has stop index " + std::to_string(lens.stopIndex()) + " out of range";
+    }
+    for (size_t i = 0; i < surfaces.size(); i++) {
+        const ArchivedSurface &surface = surfaces[i];
+        if (!std::isfinite(surface.radius) || !std::isfinite(surface.thickness) || !std::isfinite(surface.aperture)) {
+            return "has a non-finite dimension in surface " + std::to_string(i);
+        }
+    }
+    return {};
+}
+
+uint64_t align(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+}
+
+void LensWriter::write(std::ostream &os, const LensSchema<float> &lens) const {
+    const int lastSurface = int(lens.surfaces.size()) - 1;
+
+    // the reader only accepts finite numbers, so such a file could not be read back
+    for (int i = 0; i <= lastSurface; i++) {
+        const SurfaceSchema<float> &surface = lens.surfaces[i];
+        if (!std::isfinite(surface.radius) || !std::isfinite(surface.thickness) || !std::isfinite(surface.aperture)) {
+            throw std::invalid_argument(
+                "surface " + std::to_string(i) + " of lens '" + lens.name + "' has a non-finite dimension");
+        }
+    }
+
+    os << "// lore\n";
+    os << "LEN NEW ";
+    writeString(os, lens.name);
+    os << " " << formatFloat(effectiveFocalLength(lens)) << " " << lastSurface << "\n";
+    os << "EBR  " << formatFloat(lens.entranceBeamRadius) << "\n";
+    os << "ANG  " << formatFloat(lens.fieldAngle) << "\n";
+    if (!lens.description.empty()) {
+        os << "DES  ";
+        writeString(os, lens.description);
+        os << "\n";
+    }
+
+    for (int i = 0; i <= lastSurface; i++) {
+        const SurfaceSchema<float> &surface = lens.surfaces[i];
+        os << "// SRF " << i << "\n";
+        if (surface.glassName == "AIR") {
+            os << "AIR\n";
+        } else if (!surface.glassName.empty()) {
+            os << "GLA " << surface.glassName << "\n";
+        }
+        if (surface.radius != 0) {
+            os << "RD   " << formatFloat(surface.radius) << "\n";
+        }
+        os << "TH   " << formatFloat(surface.thickness) << "\n";
+        os << "AP  " << (surface.checkAperture ? "CHK " : "") << formatFloat(surface.aperture) << "\n";
+        if (i == lens.stopIndex) {
+            os << "AST\n";
+        }
+
+        if (i < lastSurface) {
+            os << "NXT\n";
+        }
+    }
+
+    if (!lens.wavelengths.empty()) {
+        os << "WV";
+        for (const WeightedWavelength<float> &wavelength : lens.wavelengths) {
+            os << " " << formatFloat(wavelength.wavelength);
+        }
+        os << "\nWW";
+        for (const WeightedWavelength<float> &wavelength : lens.wavelengths) {
+            os << " " << formatFloat(wavelength.weight);
+        }
+        os << "\n";
+    }
+    os << "END  " << lastSurface << "\n";
+}
+
+void LensWriter::write(std::ostream &os, const std::vector<LensSchema<float>> &lenses) const {
+    for (const LensSchema<float> &lens : lenses) {
+        write(os, lens);
+    }
+}
+
+void LensWriter::writeBinary(std::ostream &os, const LensArchive &archive) const {
+    LORE_PROFILE_SCOPE("LensWriter::writeBinary");
+
+    // strings are copied from the pool in order of their ids, so that interned strings stay shared
+    const StringPool &pool = archive.stringPool();
+    std::vector<char> strings;
+    std::vector<binary::StringRef> stringRefs(pool.size());
+    for (StringPool::Id id = 0; id < StringPool::Id(pool.size()); id++) {
+        const std::string_view string = pool[id];
+        stringRefs[id] = { uint32_t(strings.size()), uint32_t(string.size()) };
+        strings.insert(strings.end(), string.begin(), string.end());
+    }
+
+    std::vector<binary::GlassRecord> glasses;
+    glasses.reserve(archive.glassTable().size());
+    for (const ArchivedGlass &glass : archive.glassTable()) {
+        glasses.push_back(binary::fromGlass(glass.glass, stringRefs[glass.name]));
+    }
+
+    std::vector<binary::LensRecord> lenses;
+    std::vector<binary::SurfaceRecord> surfaces;
+    std::vector<binary::WavelengthRecord> wavelengths;
+    lenses.reserve(archive.size());
+    for (size_t i = 0; i < archive.size(); i++) {
+        const LensArchive::LensView view = archive[i];
+        const LensArchive::Record &record = view.data();
+
+        // checked before anything is written, so that a bundle is either complete and readable or not written at all
+        const std::string problem = binaryProblem(view);
+        if (!problem.empty()) {
+            throw std::invalid_argument("lens '" + std::string(view.name()) + "' " + problem);
+        }
+
+        binary::LensRecord lens {};
+        lens.name = stringRefs[record.name];
+        lens.description = stringRefs[record.description];
+        lens.fieldAngle = record.fieldAngle;
+        lens.entranceBeamRadius = record.entranceBeamRadius;
+        lens.stopIndex = record.stopIndex;
+        lens.firstSurface = uint32_t(surfaces.size());
+        lens.numSurfaces = record.numSurfaces;
+        lens.firstWavelength = uint32_t(wavelengths.size());
+        lens.numWavelengths = record.numWavelengths;
+        lenses.push_back(lens);
+
+        for (const ArchivedSurface &surface : view.surfaces()) {
+            surfaces.push_back({
+                surface.radius,
+                surface.thickness,
+                surface.aperture,
+                uint32_t(surface.glass),
+                surface.checkAperture ? uint32_t(binary::SurfaceRecord::CHECK_APERTURE) : 0u
+            });
+        }
+        for (const WeightedWavelength<float> &wavelength : view.wavelengths()) {
+            wavelengths.push_back({ wavelength.wavelength, wavelength.weight });
+        }
+    }
+
+    std::vector<binary::SourceRecord> sources;
+    sources.reserve(archive.sourceTable().size());
+    for (const LensArchive::Source &source : archive.sourceTable()) {
+        sources.push_back({ stringRefs[source.name], source.firstLens, source.numLenses });
+    }
+    auto sourceName = [&](const binary::SourceRecord &record) {
+        return std::string_view(strings.data() + record.name.offset, record.name.length);
+    };
+    std::stable_sort(sources.begin(), sources.end(), [&](const binary::SourceRecord &a, const binary::SourceRecord &b) {
+        return sourceName(a) < sourceName(b);
+    });
+
+    binary::Header header {};
+    std::memcpy(header.magic, binary::Magic, sizeof(header.magic));
+    header.version = binary::Version;
+    header.byteOrder = binary::ByteOrderMark;
+    header.numLenses = uint32_t(lenses.size());
+    header.numSurfaces = uint32_t(surfaces.size());
+    header.numWavelengths = uint32_t(wavelengths.size());
+    header.numGlasses = uint32_t(glasses.size());
+    header.lensOffset = align(sizeof(header));
+    header.surfaceOffset = align(header.lensOffset + lenses.size() * sizeof(binary::LensRecord));
+    header.wavelengthOffset = align(header.surfaceOffset + surfaces.size() * sizeof(binary::SurfaceRecord));
+    header.glassOffset = align(header.wavelengthOffset + wavelengths.size() * sizeof(binary::WavelengthRecord));
+    header.numSources = uint32_t(sources.size());
+    header.sourceOffset = align(header.glassOffset + glasses.size() * sizeof(binary::GlassRecord));
+    header.stringOffset = align(header.sourceOffset + sources.size() * sizeof(binary::SourceRecord));
+    header.stringSize = strings.size();
+
+    uint64_t position = 0;
+    auto pad = [&](uint64_t offset) {
+        static const char zeros[8] = {};
+        os.write(zeros, std::streamsize(offset - position));
+        position = offset;
+    };
+
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    position = sizeof(header);
+    pad(header.lensOffset);
+    writeTable(os, lenses);
+    position += lenses.size() * sizeof(binary::LensRecord);
+    pad(header.surfaceOffset);
+    writeTable(os, surfaces);
+    position += surfaces.size() * sizeof(binary::SurfaceRecord);
+    pad(header.wavelengthOffset);
+    writeTable(os, wavelengths);
+    position += wavelengths.size() * sizeof(binary::WavelengthRecord);
+    pad(header.glassOffset);
+    writeTable(os, glasses);
+    position += glasses.size() * sizeof(binary::GlassRecord);
+    pad(header.sourceOffset);
+    writeTable(os, sources);
+    position += sources.size() * sizeof(binary::SourceRecord);
+    pad(header.stringOffset);
+    writeTable(os, strings);
+}
+
+bool LensWriter::canWriteBinary(const LensArchive::LensView &lens) {
+    return binaryProblem(lens).empty();
+}
+
+void LensWriter::writeBinary(std::ostream &os, const std::vector<LensSchema<float>> &lenses) const {
+    LensArchive archive;
+    for (const LensSchema<float> &lens : lenses) {
+        archive.beginLens(lens.name);
+        archive.setDescription(lens.description);
+        archive.setFieldAngle(lens.fieldAngle);
+        archive.setEntranceBeamRadius(lens.entranceBeamRadius);
+        for (size_t i = 0; i < lens.wavelengths.size(); i++) {
+            archive.addWavelength(lens.wavelengths[i].wavelength);
+            archive.setWavelengthWeight(int(i), lens.wavelengths[i].weight);
+        }
+        for (const SurfaceSchema<float> &surface : lens.surfaces) {
+            archive.addSurface(surface, surface.glassName, surface.glassId);
+        }
+        archive.setStopIndex(lens.stopIndex);
+        archive.endLens();
+    }
+    writeBinary(os, archive);
+}
+
+}
+}
@@ -1,7 +1,9 @@
 #include <lore/io/LensReader.h>
 #include <lore/lens/GlassCatalog.h>
 #include <lore/logging.h>
+#include <lore/profiling/Profiler.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <exception>
@@ -10,6 +12,28 @@ namespace lore {
 
 GlassCatalog GlassCatalog::shared;
 
+GlassCatalog::GlassCatalog() {
+    Entry air {};
+    air.name = "AIR";
+    air.ior = 1;
+    insert(air, Glass<float>::air());
+}
+
+GlassId GlassCatalog::insert(const Entry &entry, const Glass<float> &glass) {
+    const auto existing = ids.find(entry.name);
+    if (existing != ids.end()) {
+        entries[existing->second] = entry;
+        glasses[existing->second] = glass;
+        return existing->second;
+    }
+
+    const GlassId id = GlassId(entries.size());
+    entries.push_back(entry);
+    glasses.push_back(glass);
+    ids.emplace(entry.name, id);
+    return id;
+}
+
 enum IORType {
     IOR_TYPE_LAURENT = 1,
     IOR_TYPE_SELLMEIER = 2,
@@ -20,7 +44,9 @@ void expectLinebreak(std::ifstream &is) {
         if (!isspace(is.peek())) {
             std::string remainder;
             std::getline(is, remainder);
-            remainder.pop_back();
+            if (!remainder.empty()) {
+                remainder.pop_back();
+            }
             log::warning() << "expected linebreak, but found '" << remainder << "'" << std::flush;
             break;
         }
@@ -37,6 +63,11 @@ std::vector<float> readVector(std::ifstream &is, int multiplier = 1) {
     int numElements;
 
     is >> numElements;
+    if (is.fail() || numElements < 0 || numElements > 1024) {
+        // malformed entry, let the caller resynchronize
+        is.setstate(std::ios::failbit);
+        return result;
+    }
     result.resize(numElements * multiplier);
 
     for (auto &e : result) {
@@ -138,6 +169,8 @@ static inline void trim(std::string &s) {
 }
 
 int GlassCatalog::read(std::ifstream &is) {
+    LORE_PROFILE_SCOPE("GlassCatalog::read");
+
     std::string version, catalogName;
     int numElements;
     is >> version >> numElements;
@@ -162,7 +195,7 @@ int GlassCatalog::read(std::ifstream &is) {
         std::string unk1, unk2;
         is >> unk1 >> unk2;
 
-        entry.glass = readGlass(is);
+        const Glass<float> glass = readGlass(is);
 
         readUnknown3(is);
         readUnknown4(is);
@@ -175,8 +208,7 @@ int GlassCatalog::read(std::ifstream &is) {
 
         expectLinebreak(is);
 
-        list.push_back(entry.name);
-        data[entry.name] = entry;
+        list.push_back(insert(entry, glass));
     }
 
     log::info() << "read " << numElements << " glass definitions from '" << catalogName << "'" << std::flush;
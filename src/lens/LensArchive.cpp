@@ -0,0 +1,235 @@
+#include <lore/lens/LensArchive.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace lore {
+
+namespace {
+
+bool sameGlass(const Glass<float> &a, const Glass<float> &b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    switch (a.type) {
+        case Glass<float>::SELL3T: return a.sell3t == b.sell3t;
+        case Glass<float>::SCHOTT2X4: return a.schott2x4 == b.schott2x4;
+    }
+    return false;
+}
+
+}
+
+StringPool::StringPool() {
+    strings.push_back(std::string_view());
+    index.emplace(std::string_view(), 0);
+}
+
+StringPool::Id StringPool::intern(std::string_view string) {
+    const auto it = index.find(string);
+    if (it != index.end()) {
+        return it->second;
+    }
+
+    const Id id = Id(strings.size());
+    const std::string_view stored = store(string);
+    strings.push_back(stored);
+    index.emplace(stored, id);
+    return id;
+}
+
+std::string_view StringPool::store(std::string_view string) {
+    if (blocks.empty() || used + string.size() > blocks.back().size) {
+        const size_t size = std::max(BlockSize, string.size());
+        blocks.push_back({ std::unique_ptr<char[]>(new char[size]), size });
+        used = 0;
+    }
+
+    char *destination = blocks.back().data.get() + used;
+    std::memcpy(destination, string.data(), string.size());
+    used += string.size();
+    return std::string_view(destination, string.size());
+}
+
+size_t StringPool::memoryUsage() const {
+    size_t result = strings.capacity() * sizeof(std::string_view);
+    for (const Block &block : blocks) {
+        result += block.size;
+    }
+    // approximate node and bucket overhead of the hash map
+    result += index.size() * (sizeof(std::string_view) + sizeof(Id) + 2 * sizeof(void *));
+    result += index.bucket_count() * sizeof(void *);
+    return result;
+}
+
+LensSchema<float> LensArchive::LensView::schema() const {
+    LensSchema<float> result;
+    result.name = std::string(name());
+    result.description = std::string(description());
+    result.fieldAngle = fieldAngle();
+    result.entranceBeamRadius = entranceBeamRadius();
+    result.stopIndex = stopIndex();
+
+    result.surfaces.reserve(record->numSurfaces);
+    for (int i = 0; i < int(record->numSurfaces); i++) {
+        SurfaceSchema<float> schema;
+        static_cast<Surface<float> &>(schema) = surface(i);
+        schema.glassName = std::string(glassName(i));
+        schema.glassId = glassId(i);
+        result.surfaces.push_back(std::move(schema));
+    }
+
+    const std::span<const WeightedWavelength<float>> weighted = wavelengths();
+    result.wavelengths.assign(weighted.begin(), weighted.end());
+    return result;
+}
+
+std::vector<LensSchema<float>> LensArchive::schemas() const {
+    std::vector<LensSchema<float>> result;
+    result.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        result.push_back((*this)[i].schema());
+    }
+    return result;
+}
+
+size_t LensArchive::memoryUsage() const {
+    return strings.memoryUsage()
+        + records.capacity() * sizeof(Record)
+        + surfaces.capacity() * sizeof(ArchivedSurface)
+        + wavelengths.capacity() * sizeof(WeightedWavelength<float>)
+        + glasses.capacity() * sizeof(ArchivedGlass)
+        + sources.capacity() * sizeof(Source)
+        + glassIndex.size() * (sizeof(StringPool::Id) + sizeof(uint32_t) + 2 * sizeof(void *))
+        + glassIndex.bucket_count() * sizeof(void *);
+}
+
+void LensArchive::beginLens(std::string_view name) {
+    abortLens();
+
+    pending = Record();
+    pending.name = strings.intern(name);
+    pending.description = 0;
+    pending.fieldAngle = 0;
+    pending.entranceBeamRadius = 0;
+    pending.stopIndex = 1;
+    pending.firstSurface = uint32_t(surfaces.size());
+    pending.numSurfaces = 0;
+    pending.firstWavelength = uint32_t(wavelengths.size());
+    pending.numWavelengths = 0;
+}
+
+void LensArchive::setDescription(std::string_view description) {
+    pending.description = strings.intern(description);
+}
+
+void LensArchive::setFieldAngle(float fieldAngle) {
+    pending.fieldAngle = fieldAngle;
+}
+
+void LensArchive::setEntranceBeamRadius(float entranceBeamRadius) {
+    pending.entranceBeamRadius = entranceBeamRadius;
+}
+
+void LensArchive::markStop() {
+    pending.stopIndex = int(pending.numSurfaces);
+}
+
+void LensArchive::setStopIndex(int stopIndex) {
+    pending.stopIndex = stopIndex;
+}
+
+void LensArchive::addWavelength(float wavelength) {
+    wavelengths.emplace_back(wavelength, 1.f);
+    pending.numWavelengths++;
+}
+
+bool LensArchive::setWavelengthWeight(int index, float weight) {
+    if (index < 0 || uint32_t(index) >= pending.numWavelengths) {
+        return false;
+    }
+    wavelengths[pending.firstWavelength + index].weight = weight;
+    return true;
+}
+
+void LensArchive::addSurface(const Surface<float> &surface, std::string_view glassName, GlassId glassId) {
+    ArchivedSurface archived;
+    archived.radius = surface.radius;
+    archived.thickness = surface.thickness;
+    archived.aperture = surface.aperture;
+    archived.glass = internGlass(glassName, glassId, surface.glass);
+    archived.checkAperture = surface.checkAperture;
+    surfaces.push_back(archived);
+    pending.numSurfaces++;
+}
+
+uint32_t LensArchive::internGlass(std::string_view name, GlassId id, const Glass<float> &glass) {
+    const StringPool::Id nameId = strings.intern(name);
+    const auto it = glassIndex.find(nameId);
+    if (it != glassIndex.end() && glasses[it->second].id == id && sameGlass(glasses[it->second].glass, glass)) {
+        return it->second;
+    }
+
+    // new name, or a name that was resolved differently before (e.g. by another catalog)
+    const uint32_t index = uint32_t(glasses.size());
+    glasses.push_back({ nameId, id, glass });
+    glassIndex[nameId] = index;
+    return index;
+}
+
+void LensArchive::endLens() {
+    records.push_back(pending);
+}
+
+void LensArchive::append(const LensArchive &other, std::string_view source) {
+    append(other, source, [](const LensView &) { return true; });
+}
+
+void LensArchive::append(
+    const LensArchive &other,
+    std::string_view source,
+    const std::function<bool(const LensView &)> &keep
+) {
+    abortLens();
+
+    const uint32_t firstLens = uint32_t(records.size());
+    surfaces.reserve(surfaces.size() + other.surfaces.size());
+    wavelengths.reserve(wavelengths.size() + other.wavelengths.size());
+    for (size_t i = 0; i < other.size(); i++) {
+        const LensView view = other[i];
+        if (!keep(view)) {
+            continue;
+        }
+        beginLens(view.name());
+        setDescription(view.description());
+        setFieldAngle(view.fieldAngle());
+        setEntranceBeamRadius(view.entranceBeamRadius());
+        setStopIndex(view.stopIndex());
+
+        const std::span<const WeightedWavelength<float>> weighted = view.wavelengths();
+        for (size_t w = 0; w < weighted.size(); w++) {
+            addWavelength(weighted[w].wavelength);
+            setWavelengthWeight(int(w), weighted[w].weight);
+        }
+        for (int s = 0; s < int(view.surfaces().size()); s++) {
+            addSurface(view.surface(s), view.glassName(s), view.glassId(s));
+        }
+        endLens();
+    }
+
+    sources.push_back({ strings.intern(source), firstLens, uint32_t(records.size() - firstLens) });
+}
+
+void LensArchive::abortLens() {
+    // drop surfaces and wavelengths that belong to no completed lens
+    if (records.empty()) {
+        surfaces.clear();
+        wavelengths.clear();
+    } else {
+        const Record &last = records.back();
+        surfaces.resize(last.firstSurface + last.numSurfaces);
+        wavelengths.resize(last.firstWavelength + last.numWavelengths);
+    }
+}
+
+}
@@ -1,51 +1,263 @@
 #include <lore/logging.h>
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 namespace lore {
 
-struct LoggingStringbuf : public std::stringbuf {
+namespace {
+
+struct Message {
+    std::atomic<Message *> next { nullptr };
+    Logger::Level level = Logger::LOG_INFO;
+    std::string text;
+};
+
+/**
+ * Intrusive multi-producer single-consumer queue (Vyukov). Producers never wait for each other or for the
+ * consumer; the consumer always keeps the most recently dequeued node as a stub.
+ */
+struct MessageQueue {
+    std::atomic<Message *> head;
+    Message *tail;
+
+    MessageQueue() {
+        Message *stub = new Message();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    ~MessageQueue() {
+        while (tail) {
+            Message *next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    void push(Message *message) {
+        Message *previous = head.exchange(message, std::memory_order_acq_rel);
+        previous->next.store(message, std::memory_order_release);
+    }
+
+    /**
+     * Moves the oldest message into result, only to be called by the consumer.
+     */
+    bool pop(Message &result) {
+        Message *next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        delete tail;
+        tail = next;
+        result.level = next->level;
+        result.text = std::move(next->text);
+        return true;
+    }
+};
+
+std::atomic<uint64_t> nextLoggerId { 0 };
+
+}
+
+struct AsyncLogger::State {
+    std::ostream &output;
+    std::ostream &error;
+    const uint64_t id = nextLoggerId.fetch_add(1, std::memory_order_relaxed);
+
+    MessageQueue queue;
+    std::atomic<uint64_t> enqueued { 0 };
+    std::atomic<uint64_t> written { 0 };
+
+    /**
+     * Incremented after every enqueued message and on shutdown, the writer sleeps until it changes.
+     */
+    std::atomic<uint64_t> signal { 0 };
+    std::atomic<bool> stopping { false };
+    std::thread writer;
+
+    State(std::ostream &output, std::ostream &error)
+        : output(output), error(error) {
+        writer = std::thread([this]() { run(); });
+    }
+
+    ~State() {
+        stopping.store(true, std::memory_order_release);
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_one();
+        writer.join();
+    }
+
+    void enqueue(Logger::Level level, std::string &&text) {
+        Message *message = new Message();
+        message->level = level;
+        message->text = std::move(text);
+        queue.push(message);
+        enqueued.fetch_add(1, std::memory_order_release);
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_one();
+    }
+
+    void run() {
+        Message message;
+        while (true) {
+            const uint64_t observed = signal.load(std::memory_order_acquire);
+            bool wroteAny = false;
+            while (queue.pop(message)) {
+                std::ostream &stream = message.level >= Logger::LOG_WARNING ? error : output;
+                stream << "[" << "DIWE"[message.level] << "] " << message.text << '\n';
+                written.fetch_add(1, std::memory_order_release);
+                wroteAny = true;
+            }
+            if (wroteAny) {
+                output.flush();
+                error.flush();
+                written.notify_all();
+                continue;
+            }
+
+            if (stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            signal.wait(observed, std::memory_order_acquire);
+        }
+    }
+};
+
+namespace {
+
+/**
+ * Per-thread message buffer of the console logger, which writes its content whenever its stream is flushed.
+ */
+struct ConsoleStringbuf : public std::stringbuf {
+    ConsoleLogger *logger = nullptr;
     Logger::Level level;
-    LoggingStringbuf(Logger::Level level)
+
+    ConsoleStringbuf(Logger::Level level)
         : level(level) {}
 
-    virtual int sync() {
-        std::ostream &stream = level >= Logger::LOG_WARNING ? std::cerr : std::cout;
-        stream << "[" << "DIWE"[level] << "] " << str() << std::endl;
+    virtual int sync() override {
+        logger->write(level, str());
+        str("");
+        return 0;
+    }
+};
+
+struct ConsoleChannel {
+    ConsoleStringbuf stringbuf;
+    std::ostream stream;
+
+    ConsoleChannel(Logger::Level level)
+        : stringbuf(level), stream(&stringbuf) {}
+};
+
+}
+
+ConsoleLogger::ConsoleLogger()
+    : ConsoleLogger(std::cout, std::cerr) {}
+
+ConsoleLogger::ConsoleLogger(std::ostream &output, std::ostream &error)
+    : output(output), error(error) {}
+
+std::ostream &ConsoleLogger::log(Logger::Level level) {
+    // the buffers of a thread are shared by all console loggers, since a message is completed before the thread
+    // starts the next one
+    thread_local ConsoleChannel channels[] = { LOG_DEBUG, LOG_INFO, LOG_WARNING, LOG_ERROR };
+    ConsoleChannel &channel = channels[level];
+    channel.stringbuf.logger = this;
+    return channel.stream;
+}
+
+void ConsoleLogger::write(Logger::Level level, std::string_view text) {
+    std::ostream &stream = level >= LOG_WARNING ? error : output;
+    std::lock_guard lock(mutex);
+    stream << "[" << "DIWE"[level] << "] " << text << std::endl;
+}
+
+namespace {
+
+/**
+ * Per-thread message buffer, which hands its content to the logger whenever its stream is flushed.
+ */
+struct ThreadStringbuf : public std::stringbuf {
+    AsyncLogger::State *state;
+    Logger::Level level;
+
+    ThreadStringbuf(AsyncLogger::State *state, Logger::Level level)
+        : state(state), level(level) {}
+
+    virtual int sync() override {
+        state->enqueue(level, str());
         str("");
         return 0;
     }
 };
 
-struct ConsoleLogger : public Logger {
+struct ThreadChannels {
     struct Channel {
-        std::unique_ptr<LoggingStringbuf> stringbuf;
+        ThreadStringbuf stringbuf;
         std::ostream stream;
 
-        Channel(Level level)
-            : stringbuf(std::make_unique<LoggingStringbuf>(level)),
-              stream(stringbuf.get()) {
-
-        }
+        Channel(AsyncLogger::State *state, Logger::Level level)
+            : stringbuf(state, level), stream(&stringbuf) {}
     };
 
-    Channel debug { LOG_DEBUG };
-    Channel info { LOG_INFO };
-    Channel warning { LOG_WARNING };
-    Channel error { LOG_ERROR };
-
-    virtual std::ostream &log(Logger::Level level) override {
-        switch (level) {
-            case Logger::LOG_DEBUG:   return debug.stream;
-            case Logger::LOG_INFO:    return info.stream;
-            case Logger::LOG_WARNING: return warning.stream;
-            case Logger::LOG_ERROR:   return error.stream;
-        }
-        return error.stream;
-    }
+    Channel debug;
+    Channel info;
+    Channel warning;
+    Channel error;
+
+    ThreadChannels(AsyncLogger::State *state)
+        : debug(state, Logger::LOG_DEBUG),
+          info(state, Logger::LOG_INFO),
+          warning(state, Logger::LOG_WARNING),
+          error(state, Logger::LOG_ERROR) {}
 };
 
+}
+
+AsyncLogger::AsyncLogger()
+    : AsyncLogger(std::cout, std::cerr) {}
+
+AsyncLogger::AsyncLogger(std::ostream &output, std::ostream &error)
+    : state(std::make_unique<State>(output, error)) {}
+
+AsyncLogger::~AsyncLogger() {}
+
+std::ostream &AsyncLogger::log(Logger::Level level) {
+    // loggers are identified by a unique id rather than their address, so that entries of destroyed loggers are
+    // never reused
+    thread_local std::unordered_map<uint64_t, std::unique_ptr<ThreadChannels>> channels;
+    std::unique_ptr<ThreadChannels> &local = channels[state->id];
+    if (!local) {
+        local = std::make_unique<ThreadChannels>(state.get());
+    }
+
+    switch (level) {
+        case Logger::LOG_DEBUG:   return local->debug.stream;
+        case Logger::LOG_INFO:    return local->info.stream;
+        case Logger::LOG_WARNING: return local->warning.stream;
+        case Logger::LOG_ERROR:   return local->error.stream;
+    }
+    return local->error.stream;
+}
+
+void AsyncLogger::flush() {
+    const uint64_t target = state->enqueued.load(std::memory_order_acquire);
+    uint64_t current = state->written.load(std::memory_order_acquire);
+    while (current < target) {
+        state->written.wait(current, std::memory_order_acquire);
+        current = state->written.load(std::memory_order_acquire);
+    }
+}
+
 std::shared_ptr<Logger> Logger::shared = std::make_shared<ConsoleLogger>();
 
 }
@@ -0,0 +1,65 @@
+#include <lore/parallel/ScratchArena.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace lore {
+namespace parallel {
+
+namespace {
+
+size_t alignedOffset(const std::byte *data, size_t offset, size_t alignment) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(data) + offset;
+    const uintptr_t aligned = (address + alignment - 1) / alignment * alignment;
+    return offset + size_t(aligned - address);
+}
+
+}
+
+ScratchArena &ScratchArena::local() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+ScratchArena::ScratchArena(size_t blockSize)
+: blockSize(std::max<size_t>(blockSize, 64)) {}
+
+void *ScratchArena::allocate(size_t bytes, size_t alignment) {
+    if (current < blocks.size()) {
+        const size_t start = alignedOffset(blocks[current].data.get(), offset, alignment);
+        if (start + bytes <= blocks[current].size) {
+            offset = start + bytes;
+            return blocks[current].data.get() + start;
+        }
+    }
+
+    // continue in the first unused block that is large enough, or insert a new one
+    const size_t required = bytes + alignment;
+    const size_t next = current < blocks.size() ? current + 1 : blocks.size();
+    auto fitting = std::find_if(blocks.begin() + next, blocks.end(), [&](const Block &block) {
+        return block.size >= required;
+    });
+    if (fitting == blocks.end()) {
+        const size_t size = std::max(blockSize, required);
+        fitting = blocks.insert(blocks.begin() + next, Block { std::make_unique<std::byte[]>(size), size });
+    } else {
+        std::iter_swap(blocks.begin() + next, fitting);
+    }
+
+    current = next;
+    const size_t start = alignedOffset(blocks[current].data.get(), 0, alignment);
+    offset = start + bytes;
+    return blocks[current].data.get() + start;
+}
+
+size_t ScratchArena::capacity() const {
+    size_t result = 0;
+    for (const Block &block : blocks) {
+        result += block.size;
+    }
+    return result;
+}
+
+}
+}
@@ -0,0 +1,278 @@
+#include <lore/parallel/TaskScheduler.h>
+#include <lore/logging.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace lore {
+namespace parallel {
+
+namespace {
+
+thread_local const TaskScheduler *currentScheduler = nullptr;
+thread_local int currentWorker = -1;
+
+/**
+ * Ids of the CPUs the process may run on.
+ */
+std::vector<int> allowedCpus() {
+    std::vector<int> result;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                result.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (result.empty()) {
+        const int count = std::max(1, int(std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; cpu++) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+void pinCurrentThread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        log::warning() << "could not pin worker thread to cpu " << cpu << std::flush;
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+/**
+ * Small per-thread generator that spreads steal attempts over the victims.
+ */
+uint32_t nextRandom() {
+    thread_local uint32_t state = uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+}
+
+TaskScheduler &TaskScheduler::shared() {
+    static TaskScheduler scheduler([]() {
+        Options options;
+        if (const char *threads = std::getenv("LORE_NUM_THREADS")) {
+            options.numThreads = std::max(0, std::atoi(threads));
+        }
+        return options;
+    }());
+    return scheduler;
+}
+
+int TaskScheduler::availableCpus() {
+    return int(allowedCpus().size());
+}
+
+TaskScheduler::TaskScheduler()
+: TaskScheduler(Options {}) {}
+
+TaskScheduler::TaskScheduler(const Options &options) {
+    const std::vector<int> cpus = allowedCpus();
+    const int numThreads = options.numThreads > 0 ? options.numThreads : int(cpus.size());
+
+    // the thread that waits for tasks counts as the first one and is never pinned
+    workers.reserve(numThreads - 1);
+    for (int i = 1; i < numThreads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < int(workers.size()); i++) {
+        const int cpu = options.pinThreads ? cpus[(i + 1) % cpus.size()] : -1;
+        workers[i]->thread = std::thread([this, i, cpu]() {
+            work(i, cpu);
+        });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    stopping.store(true);
+    wake();
+    for (auto &worker : workers) {
+        worker->thread.join();
+    }
+}
+
+int TaskScheduler::workerIndex() const {
+    return currentScheduler == this ? currentWorker : -1;
+}
+
+void TaskScheduler::submit(Task task) {
+    const int self = workerIndex();
+    if (self >= 0) {
+        Worker &worker = *workers[self];
+        std::lock_guard lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+        queued.fetch_add(1);
+    } else {
+        std::lock_guard lock(injectionMutex);
+        injection.push_back(std::move(task));
+        queued.fetch_add(1);
+    }
+
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    sleep.notify_one();
+}
+
+void TaskScheduler::wake() {
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    sleep.notify_all();
+}
+
+bool TaskScheduler::pop(Task &task) {
+    const int self = workerIndex();
+    if (self >= 0) {
+        Worker &worker = *workers[self];
+        std::lock_guard lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    {
+        std::lock_guard lock(injectionMutex);
+        if (!injection.empty()) {
+            task = std::move(injection.front());
+            injection.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    const int numWorkers = int(workers.size());
+    if (numWorkers == 0) {
+        return false;
+    }
+    const int start = int(nextRandom() % uint32_t(numWorkers));
+    for (int i = 0; i < numWorkers; i++) {
+        const int victim = (start + i) % numWorkers;
+        if (victim == self) {
+            continue;
+        }
+
+        Worker &worker = *workers[victim];
+        std::lock_guard lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::runOne() {
+    Task task;
+    if (!pop(task)) {
+        return false;
+    }
+
+    std::exception_ptr error;
+    try {
+        task.function();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    task.group->finish(error);
+    return true;
+}
+
+void TaskScheduler::wait(TaskGroup &group) {
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+        if (runOne()) {
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        sleep.wait(lock, [&]() {
+            return group.pending.load(std::memory_order_acquire) == 0 || queued.load() > 0;
+        });
+    }
+}
+
+void TaskScheduler::work(int index, int cpu) {
+    currentScheduler = this;
+    currentWorker = index;
+    if (cpu >= 0) {
+        pinCurrentThread(cpu);
+    }
+
+    while (true) {
+        if (runOne()) {
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        sleep.wait(lock, [&]() {
+            return stopping.load() || queued.load() > 0;
+        });
+        if (stopping.load() && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+TaskGroup::~TaskGroup() {
+    scheduler.wait(*this);
+}
+
+void TaskGroup::wait() {
+    scheduler.wait(*this);
+
+    std::exception_ptr result;
+    {
+        std::lock_guard lock(errorMutex);
+        std::swap(result, error);
+    }
+    hasFailed.store(false, std::memory_order_relaxed);
+    if (result) {
+        std::rethrow_exception(result);
+    }
+}
+
+void TaskGroup::finish(std::exception_ptr failure) {
+    if (failure) {
+        std::lock_guard lock(errorMutex);
+        if (!error) {
+            error = failure;
+        }
+        hasFailed.store(true, std::memory_order_relaxed);
+    }
+
+    // the group may be destroyed as soon as the last task is done, so the scheduler is looked up before
+    TaskScheduler &owner = scheduler;
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        owner.wake();
+    }
+}
+
+}
+}
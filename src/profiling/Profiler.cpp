@@ -0,0 +1,156 @@
+#include <lore/profiling/Profiler.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace lore {
+namespace profiling {
+
+namespace {
+
+struct RingBuffer {
+    int thread;
+    std::unique_ptr<Event[]> events { new Event[Profiler::Capacity] };
+    uint64_t count = 0;
+
+    void push(const Event &event) {
+        events[count % Profiler::Capacity] = event;
+        count++;
+    }
+
+    ThreadEvents snapshot() const {
+        ThreadEvents result;
+        result.thread = thread;
+        const uint64_t size = std::min<uint64_t>(count, Profiler::Capacity);
+        result.dropped = count - size;
+        result.events.reserve(size);
+        for (uint64_t i = count - size; i < count; i++) {
+            result.events.push_back(events[i % Profiler::Capacity]);
+        }
+        return result;
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    int nextThread = 0;
+    std::vector<RingBuffer *> live;
+
+    /**
+     * Events of threads that have exited.
+     */
+    std::vector<ThreadEvents> retired;
+
+    static Registry &shared() {
+        static Registry registry;
+        return registry;
+    }
+};
+
+struct ThreadBuffer {
+    RingBuffer buffer;
+
+    ThreadBuffer() {
+        Registry &registry = Registry::shared();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        buffer.thread = registry.nextThread++;
+        registry.live.push_back(&buffer);
+    }
+
+    ~ThreadBuffer() {
+        Registry &registry = Registry::shared();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (buffer.count > 0) {
+            registry.retired.push_back(buffer.snapshot());
+        }
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), &buffer));
+    }
+};
+
+void writeString(std::ostream &os, const char *text) {
+    os << '"';
+    for (const char *c = text; *c; c++) {
+        switch (*c) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            default: os << *c; break;
+        }
+    }
+    os << '"';
+}
+
+}
+
+void Profiler::record(const char *name, int64_t begin, int64_t end) {
+    thread_local ThreadBuffer local;
+    local.buffer.push({ name, begin, end });
+}
+
+std::vector<ThreadEvents> Profiler::collect() {
+    Registry &registry = Registry::shared();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::vector<ThreadEvents> result = registry.retired;
+    for (const RingBuffer *buffer : registry.live) {
+        if (buffer->count > 0) {
+            result.push_back(buffer->snapshot());
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const ThreadEvents &a, const ThreadEvents &b) {
+        return a.thread < b.thread;
+    });
+    return result;
+}
+
+void Profiler::clear() {
+    Registry &registry = Registry::shared();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    registry.retired.clear();
+    for (RingBuffer *buffer : registry.live) {
+        buffer->count = 0;
+    }
+}
+
+void Profiler::writeChromeTrace(std::ostream &os) {
+    const std::vector<ThreadEvents> threads = collect();
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const ThreadEvents &thread : threads) {
+        for (const Event &event : thread.events) {
+            if (!first) os << ",";
+            first = false;
+
+            // timestamps are given in microseconds
+            os << "\n{\"name\":";
+            writeString(os, event.name);
+            os << ",\"cat\":\"lore\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.thread
+               << ",\"ts\":" << double(event.begin) / 1000
+               << ",\"dur\":" << double(event.end - event.begin) / 1000 << "}";
+        }
+    }
+    os << "\n]}\n";
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+bool Profiler::writeChromeTrace(const std::string &path) {
+    std::ofstream file { path };
+    if (!file) {
+        return false;
+    }
+    writeChromeTrace(file);
+    return bool(file);
+}
+
+}
+}
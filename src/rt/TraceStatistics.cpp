@@ -0,0 +1,73 @@
+#include <lore/rt/TraceStatistics.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace lore {
+namespace rt {
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<TraceStatistics *> live;
+
+    /**
+     * Counters of threads that have exited.
+     */
+    TraceStatistics retired;
+
+    static Registry &shared() {
+        static Registry registry;
+        return registry;
+    }
+};
+
+struct ThreadStatistics {
+    TraceStatistics statistics;
+
+    ThreadStatistics() {
+        Registry &registry = Registry::shared();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(&statistics);
+    }
+
+    ~ThreadStatistics() {
+        Registry &registry = Registry::shared();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.retired.merge(statistics);
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), &statistics));
+    }
+};
+
+}
+
+TraceStatistics &TraceStatistics::local() {
+    thread_local ThreadStatistics local;
+    return local.statistics;
+}
+
+TraceStatistics TraceStatistics::collect() {
+    Registry &registry = Registry::shared();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    TraceStatistics result = registry.retired;
+    for (const TraceStatistics *statistics : registry.live) {
+        result.merge(*statistics);
+    }
+    return result;
+}
+
+void TraceStatistics::reset() {
+    Registry &registry = Registry::shared();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    registry.retired.clear();
+    for (TraceStatistics *statistics : registry.live) {
+        statistics->clear();
+    }
+}
+
+}
+}
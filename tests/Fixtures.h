@@ -0,0 +1,60 @@
+#pragma once
+
+#include <lore/lore.h>
+#include <lore/io/LensReader.h>
+#include <lore/lens/GlassCatalog.h>
+#include <lore/lens/LensSchema.h>
+#include <lore/optim/MeritFunction.h>
+
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace lore {
+namespace fixtures {
+
+/**
+ * Reads a glass catalog into GlassCatalog::shared, unless an earlier test case already did.
+ */
+inline void loadGlasses(const std::string &path) {
+    static std::mutex mutex;
+    static std::set<std::string> loaded;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (loaded.insert(path).second) {
+        GlassCatalog::shared.read(path);
+    }
+}
+
+/**
+ * Reads the first lens of a lens file, whose glasses have to be loaded already.
+ */
+inline LensSchema<float> readLens(const std::string &path) {
+    io::LensReader reader;
+    std::ifstream file(path);
+    return reader.read(file).front();
+}
+
+/**
+ * The F/2.8 Tessar, whose glasses are in the obsolete001 catalog.
+ */
+inline LensSchema<float> readTessar() {
+    loadGlasses("data/glass/obsolete001.glc");
+    return readLens("data/lenses/tessar.len");
+}
+
+/**
+ * Merit program for the Tessar: focal length, on-axis and off-axis spot size and distortion.
+ */
+inline optim::MeritProgram tessarProgram(const LensSchema<float> &schema, int samples) {
+    optim::MeritFunction mf;
+    mf.add(optim::Operand::efl(100));
+    mf.add(optim::Operand::spotRms(0, 0, samples));
+    mf.add(optim::Operand::spotRms(0.7, 0, samples));
+    mf.add(optim::Operand::distortion(1));
+    return mf.compile(schema);
+}
+
+}
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Hessian.h>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+TEST_CASE( "Symmetric matrix", "[analysis]" ) {
+    SymmetricMatrix<double> m(3);
+    REQUIRE( m.el.size() == 6 );
+
+    m(0, 0) = 1;
+    m(1, 0) = 2;
+    m(1, 1) = 3;
+    m(2, 0) = 4;
+    m(2, 1) = 5;
+    m(2, 2) = 6;
+    REQUIRE( m(0, 2) == 4 );
+    REQUIRE( m(1, 2) == 5 );
+
+    const std::vector<double> product = m * std::vector<double> { 1, 1, 1 };
+    REQUIRE( product == std::vector<double> { 7, 10, 15 } );
+}
+
+TEST_CASE( "Merit Hessian", "[analysis]" ) {
+    const auto schema = fixtures::readTessar();
+    const auto lens = schema.lens<double>();
+    const auto program = fixtures::tessarProgram(schema, 5);
+
+    auto parameters = LensParameter::enumerate(lens);
+    parameters.resize(7);
+    const int n = int(parameters.size());
+
+    const MeritHessian<3> analysis { lens, program };
+    const SymmetricMatrix<double> hessian = analysis.compute(parameters);
+
+    // reference: central differences of the exact gradient
+    const double h = 1e-5;
+    const double wavelength = program.wavelengths.front();
+    for (int j = 0; j < n; j++) {
+        Lens<double> plus = lens;
+        Lens<double> minus = lens;
+        parameters[j].apply(plus, +h, wavelength);
+        parameters[j].apply(minus, -h, wavelength);
+        const auto gPlus = SensitivityAnalysis<8>(plus, program).compute(parameters).merit;
+        const auto gMinus = SensitivityAnalysis<8>(minus, program).compute(parameters).merit;
+        for (int i = 0; i < n; i++) {
+            const double expected = (gPlus[i] - gMinus[i]) / (2 * h);
+            REQUIRE_THAT( hessian(i, j), WithinAbs(expected, 1e-4 + 1e-4 * std::abs(expected)) );
+        }
+    }
+
+    std::vector<double> v(n);
+    for (int i = 0; i < n; i++) {
+        v[i] = 1.0 / (i + 1);
+    }
+    std::vector<double> gradient;
+    const std::vector<double> hv = analysis.product(parameters, v, &gradient);
+    const std::vector<double> expected = hessian * v;
+    const auto first = SensitivityAnalysis<8>(lens, program).compute(parameters).merit;
+    for (int i = 0; i < n; i++) {
+        REQUIRE_THAT( hv[i], WithinAbs(expected[i], 1e-9 * (1 + std::abs(expected[i]))) );
+        REQUIRE_THAT( gradient[i], WithinAbs(first[i], 1e-9 * (1 + std::abs(first[i]))) );
+    }
+}
+
+TEST_CASE( "Merit Hessian performance", "[.][benchmark]" ) {
+    const auto schema = fixtures::readTessar();
+    const auto lens = schema.lens<double>();
+    const auto program = fixtures::tessarProgram(schema, 5);
+    const auto parameters = LensParameter::enumerate(lens);
+    std::vector<double> v(parameters.size(), 1.0);
+
+    BENCHMARK( "Full Hessian (width 4)" ) {
+        return MeritHessian<4>(lens, program).compute(parameters);
+    };
+
+    BENCHMARK( "Full Hessian (width 8)" ) {
+        return MeritHessian<8>(lens, program).compute(parameters);
+    };
+
+    BENCHMARK( "Hessian-vector product (width 8)" ) {
+        return MeritHessian<8>(lens, program).product(parameters, v);
+    };
+
+    BENCHMARK( "Gradient (width 8)" ) {
+        return SensitivityAnalysis<8>(lens, program).compute(parameters);
+    };
+}
@@ -0,0 +1,152 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/MTF.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+/**
+ * Modulation of an aberration-free circular pupil at the given fraction of the cutoff frequency.
+ */
+static double diffractionLimit(double frequency) {
+    if (frequency >= 1) {
+        return 0;
+    }
+    return 2 / M_PI * (std::acos(frequency) - frequency * std::sqrt(1 - sqr(frequency)));
+}
+
+TEST_CASE( "Modulation transfer functions", "[analysis]" ) {
+    LensSchema<float> schema = fixtures::readTessar();
+    const double wavelength = schema.primaryWavelength();
+    const std::vector<WeightedWavelength<double>> primary { { wavelength, 1 } };
+
+    SECTION( "Diffraction-limited apertures" ) {
+        schema.entranceBeamRadius = 2;
+        const Lens<double> lens = schema.lens<double>();
+        const rt::RayGenerator<double> generator(schema);
+        const MTFAnalysis<double> mtf(lens, generator, schema.stopIndex, primary);
+
+        const double na = WavefrontAnalysis<double>(lens, generator, schema.stopIndex).numericalAperture(wavelength);
+        const double cutoff = 2 * na / (wavelength * 1e-3);
+        std::vector<double> frequencies;
+        for (const double fraction : { 0.0, 0.1, 0.25, 0.5, 0.75, 0.9, 1.1, 1.5, 2.5 }) {
+            frequencies.push_back(fraction * cutoff);
+        }
+
+        const ModulationTransfer axis = mtf(0, frequencies);
+        REQUIRE( axis.frequencies == frequencies );
+        for (size_t k = 0; k < frequencies.size(); k++) {
+            REQUIRE_THAT( axis.sagittal[k], WithinAbs(diffractionLimit(frequencies[k] / cutoff), 0.01) );
+            REQUIRE_THAT( axis.tangential[k], WithinAbs(axis.sagittal[k], 1e-9) );
+        }
+    }
+
+    SECTION( "Geometric and diffraction MTFs agree for large aberrations" ) {
+        const Lens<double> lens = schema.lens<double>();
+        const rt::RayGenerator<double> generator(schema);
+
+        MTFAnalysis<double>::Options options;
+        options.pupilSamples = 256;
+        const ModulationTransfer diffraction = MTFAnalysis<double>(lens, generator, schema.stopIndex, primary,
+            options)(0.7, std::vector<double> { 0, 5, 10, 20 });
+
+        options.method = MTFAnalysis<double>::GEOMETRIC;
+        const ModulationTransfer geometric = MTFAnalysis<double>(lens, generator, schema.stopIndex, primary,
+            options)(0.7, std::vector<double> { 0, 5, 10, 20 });
+
+        REQUIRE( geometric.sagittal[0] == 1 );
+        for (size_t k = 0; k < 4; k++) {
+            REQUIRE_THAT( geometric.sagittal[k], WithinAbs(diffraction.sagittal[k], 0.05) );
+            REQUIRE_THAT( geometric.tangential[k], WithinAbs(diffraction.tangential[k], 0.05) );
+        }
+        REQUIRE( geometric.tangential[1] > geometric.sagittal[1] + 0.5 );
+    }
+
+    SECTION( "Field grids and wavelengths" ) {
+        const std::vector<double> fields { 0, 0.5, 1 };
+        const std::vector<double> frequencies { 0, 10, 20, 40 };
+        for (const auto method : { MTFAnalysis<double>::DIFFRACTION, MTFAnalysis<double>::GEOMETRIC }) {
+            MTFAnalysis<double>::Options options;
+            options.method = method;
+            options.pupilSamples = 32;
+            options.rays = 1024;
+            const auto results = MTFAnalysis<double>(schema, options)(fields, frequencies);
+            REQUIRE( results.size() == fields.size() );
+
+            options.parallel = false;
+            const MTFAnalysis<double> serial(schema, options);
+            for (size_t f = 0; f < fields.size(); f++) {
+                REQUIRE( results[f].field == fields[f] );
+                REQUIRE_THAT( results[f].sagittal[0], WithinAbs(1, 1e-12) );
+                REQUIRE_THAT( results[f].tangential[0], WithinAbs(1, 1e-12) );
+
+                const ModulationTransfer expected = serial(fields[f], frequencies);
+                REQUIRE( results[f].sagittal == expected.sagittal );
+                REQUIRE( results[f].tangential == expected.tangential );
+            }
+
+            // wavelengths without weight do not contribute
+            std::vector<WeightedWavelength<double>> weighted { { wavelength, 1 } };
+            for (size_t w = 1; w < schema.wavelengths.size(); w++) {
+                weighted.push_back({ schema.wavelengths[w].wavelength, 0 });
+            }
+            const Lens<double> lens = schema.lens<double>();
+            const rt::RayGenerator<double> generator(schema);
+            const ModulationTransfer mono = MTFAnalysis<double>(lens, generator, schema.stopIndex, primary,
+                options)(1, frequencies);
+            const ModulationTransfer zeroed = MTFAnalysis<double>(lens, generator, schema.stopIndex, weighted,
+                options)(1, frequencies);
+            for (size_t k = 0; k < frequencies.size(); k++) {
+                REQUIRE_THAT( zeroed.tangential[k], WithinAbs(mono.tangential[k], 1e-12) );
+            }
+        }
+    }
+
+    REQUIRE_THROWS_AS( MTFAnalysis<double>(schema.lens<double>(), rt::RayGenerator<double>(schema), schema.stopIndex,
+        {}), std::invalid_argument );
+
+    // without padding, frequencies between NA / wavelength and the cutoff are above the Nyquist frequency
+    MTFAnalysis<double>::Options unpadded;
+    unpadded.padding = 1;
+    REQUIRE_THROWS_AS( MTFAnalysis<double>(schema, unpadded), std::invalid_argument );
+    unpadded.method = MTFAnalysis<double>::GEOMETRIC;
+    REQUIRE_NOTHROW( MTFAnalysis<double>(schema, unpadded) );
+
+    // spot diagram rays only matter to the geometric method
+    MTFAnalysis<double>::Options rayless;
+    rayless.rays = 0;
+    REQUIRE_NOTHROW( MTFAnalysis<double>(schema, rayless) );
+    rayless.method = MTFAnalysis<double>::GEOMETRIC;
+    REQUIRE_THROWS_AS( MTFAnalysis<double>(schema, rayless), std::invalid_argument );
+}
+
+TEST_CASE( "Modulation transfer function timings", "[.][benchmark]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const std::vector<double> fields { 0, 0.25, 0.5, 0.7, 0.85, 1 };
+    std::vector<double> frequencies;
+    for (int i = 0; i <= 50; i++) {
+        frequencies.push_back(2.0 * i);
+    }
+
+    std::cout << std::setw(12) << "method" << std::setw(12) << "ms" << std::endl;
+    for (const auto method : { MTFAnalysis<double>::DIFFRACTION, MTFAnalysis<double>::GEOMETRIC }) {
+        MTFAnalysis<double>::Options options;
+        options.method = method;
+        options.pupilSamples = 128;
+        const MTFAnalysis<double> mtf(schema, options);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = mtf(fields, frequencies);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::setw(12) << (method == MTFAnalysis<double>::DIFFRACTION ? "diffraction" : "geometric")
+                  << std::setw(12) << elapsed.count() << std::endl;
+    }
+}
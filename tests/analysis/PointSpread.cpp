@@ -0,0 +1,98 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/PointSpread.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+TEST_CASE( "Diffraction point spread functions", "[analysis]" ) {
+    LensSchema<float> schema = fixtures::readTessar();
+    const double wavelength = schema.primaryWavelength();
+
+    // stopped down to a nearly diffraction-limited aperture
+    schema.entranceBeamRadius = 2;
+    PointSpreadAnalysis<double>::Options options;
+    options.pupilSamples = 64;
+    options.padding = 4;
+    const PointSpreadAnalysis<double> analysis(schema, options);
+    const WavefrontAnalysis<double> wavefronts(schema);
+
+    SECTION( "Airy pattern" ) {
+        const PointSpreadFunction psf = analysis(0, wavelength);
+        REQUIRE( psf.size == 256 );
+        REQUIRE( psf.strehl() > 0.99 );
+        REQUIRE( psf.strehl() == psf.peak() );
+
+        // first dark ring at 0.61 wavelength / NA
+        const double na = wavefronts.numericalAperture(wavelength);
+        REQUIRE_THAT( psf.spacing, WithinRel(wavelength * 1e-3 / (2 * na * 4), 1e-12) );
+        const double ring = 0.61 * wavelength * 1e-3 / na / psf.spacing;
+        int minimum = 1;
+        for (int i = 1; i < 8; i++) {
+            if (psf(psf.size / 2 + i, psf.size / 2) < psf(psf.size / 2 + minimum, psf.size / 2)) {
+                minimum = i;
+            }
+        }
+        REQUIRE( std::abs(minimum - ring) <= 1 );
+        REQUIRE( psf(psf.size / 2 + minimum, psf.size / 2) < 0.01 );
+        REQUIRE_THAT( psf(psf.size / 2, psf.size / 2 + minimum), WithinAbs(psf(psf.size / 2 + minimum, psf.size / 2), 1e-6) );
+    }
+
+    SECTION( "Strehl ratios follow the Marechal approximation" ) {
+        for (const double field : { 0.5, 1.0 }) {
+            const Wavefront wavefront = wavefronts(field, wavelength, options.pupilSamples);
+            const PointSpreadFunction psf = analysis(wavefront);
+            REQUIRE( psf.center.y() == wavefront.chief.y() );
+            REQUIRE_THAT( psf.peak(), WithinAbs(std::exp(-sqr(2 * M_PI * wavefront.rms())), 0.01) );
+        }
+    }
+
+    SECTION( "Fields and wavelengths" ) {
+        std::vector<double> wavelengths;
+        for (const auto &weighted : schema.wavelengths) {
+            wavelengths.push_back(weighted.wavelength);
+        }
+        const std::vector<double> fields { 0, 0.7, 1 };
+        const auto psfs = analysis(fields, wavelengths);
+        REQUIRE( psfs.size() == fields.size() * wavelengths.size() );
+
+        PointSpreadAnalysis<double>::Options serial = options;
+        serial.parallel = false;
+        const PointSpreadAnalysis<double> serialAnalysis(schema, serial);
+        for (size_t f = 0; f < fields.size(); f++) {
+            for (size_t w = 0; w < wavelengths.size(); w++) {
+                const PointSpreadFunction &psf = psfs[f * wavelengths.size() + w];
+                REQUIRE( psf.wavelength == wavelengths[w] );
+                REQUIRE( psf.intensity == serialAnalysis(fields[f], wavelengths[w]).intensity );
+            }
+        }
+    }
+
+    options.padding = 0;
+    REQUIRE_THROWS_AS( PointSpreadAnalysis<double>(schema, options), std::invalid_argument );
+}
+
+TEST_CASE( "Point spread function timings", "[.][benchmark]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    std::cout << std::setw(8) << "pupil" << std::setw(8) << "padding" << std::setw(12) << "ms" << std::setw(12)
+              << "strehl" << std::endl;
+    for (const int samples : { 32, 64, 128, 256 }) {
+        PointSpreadAnalysis<double>::Options options;
+        options.pupilSamples = samples;
+        const PointSpreadAnalysis<double> analysis(schema, options);
+
+        const auto start = std::chrono::steady_clock::now();
+        const PointSpreadFunction psf = analysis(0.7, schema.primaryWavelength());
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::setw(8) << samples << std::setw(8) << options.padding << std::setw(12) << elapsed.count()
+                  << std::setw(12) << psf.strehl() << std::endl;
+    }
+}
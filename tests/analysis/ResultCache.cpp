@@ -0,0 +1,194 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Paraxial.h>
+#include <lore/analysis/Petzval.h>
+#include <lore/analysis/ResultCache.h>
+#include <lore/lens/LensHash.h>
+#include <lore/optim/MeritFunction.h>
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+using namespace lore;
+
+TEST_CASE( "Lens content hashing", "[lens]" ) {
+    const Lens<double> lens = fixtures::readTessar().lens<double>();
+    const uint64_t reference = contentHash(lens);
+
+    SECTION( "Hashes depend on content only" ) {
+        const Lens<double> copy = lens;
+        REQUIRE( contentHash(copy) == reference );
+
+        Lens<double> negativeZero = lens;
+        negativeZero.surfaces[3].radius = -0.0;
+        REQUIRE( contentHash(negativeZero) == reference );
+
+        REQUIRE( contentHash(lens.cast<float>()) != reference );
+    }
+
+    SECTION( "Every surface field changes the hash" ) {
+        std::set<uint64_t> hashes { reference };
+        auto modified = [&](auto modify) {
+            Lens<double> variant = lens;
+            modify(variant.surfaces[4]);
+            return hashes.insert(contentHash(variant)).second;
+        };
+
+        REQUIRE( modified([](Surface<double> &surface) { surface.radius *= 1 + 1e-15; }) );
+        REQUIRE( modified([](Surface<double> &surface) { surface.thickness += 1e-9; }) );
+        REQUIRE( modified([](Surface<double> &surface) { surface.aperture += 1; }) );
+        REQUIRE( modified([](Surface<double> &surface) { surface.checkAperture = !surface.checkAperture; }) );
+        REQUIRE( modified([](Surface<double> &surface) { surface.glass = surface.glass.withIndexOffset(1e-6, 0.58); }) );
+        REQUIRE( modified([](Surface<double> &surface) { surface.glass = Glass<double>::air(); }) );
+
+        Lens<double> shorter = lens;
+        shorter.surfaces.pop_back();
+        REQUIRE( hashes.insert(contentHash(shorter)).second );
+    }
+}
+
+TEST_CASE( "Analysis result caching", "[analysis]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const Lens<double> lens = schema.lens<double>();
+    const double wavelength = schema.primaryWavelength();
+
+    SECTION( "Least recently used entries are evicted" ) {
+        ResultCache cache(2);
+        const ResultCache::Key a = ResultCache::key(lens, "test/1", { 1.0 });
+        const ResultCache::Key b = ResultCache::key(lens, "test/1", { 2.0 });
+        const ResultCache::Key c = ResultCache::key(lens, "test/2", { 1.0 });
+
+        cache.insert(a, { 1 });
+        cache.insert(b, { 2 });
+        REQUIRE( cache.find(a) );
+        cache.insert(c, { 3 });
+
+        REQUIRE( cache.size() == 2 );
+        REQUIRE_FALSE( cache.find(b) );
+        REQUIRE( cache.find(a)->front() == 1 );
+        REQUIRE( cache.find(c)->front() == 3 );
+
+        const ResultCache::Statistics statistics = cache.statistics();
+        REQUIRE( statistics.hits == 3 );
+        REQUIRE( statistics.misses == 1 );
+        REQUIRE( statistics.evictions == 1 );
+
+        cache.setCapacity(1);
+        REQUIRE( cache.size() == 1 );
+        REQUIRE( cache.find(c) );
+    }
+
+    SECTION( "Analyses consult the cache" ) {
+        ResultCache cache;
+        const ParaxialAnalysis<double> direct(lens, wavelength);
+        const ParaxialAnalysis<double> first(lens, wavelength, cache);
+        const ParaxialAnalysis<double> second(lens, wavelength, cache);
+        REQUIRE( first.efl == direct.efl );
+        REQUIRE( second.efl == direct.efl );
+        REQUIRE( second.focalShift == direct.focalShift );
+
+        REQUIRE( petzvalRadius(lens, wavelength, cache) == petzvalRadius(lens, wavelength) );
+        REQUIRE( petzvalRadius(lens, wavelength, cache) == petzvalRadius(lens, wavelength) );
+        REQUIRE( cache.statistics().hits == 2 );
+        REQUIRE( cache.statistics().misses == 2 );
+
+        // a modified lens misses and gets its own result
+        Lens<double> modified = lens;
+        modified.surfaces[1].radius *= 1.01;
+        REQUIRE( ParaxialAnalysis<double>(modified, wavelength, cache).efl == ParaxialAnalysis<double>(modified, wavelength).efl );
+        REQUIRE( ParaxialAnalysis<double>(modified, wavelength, cache).efl != direct.efl );
+        REQUIRE( cache.statistics().misses == 3 );
+    }
+
+    SECTION( "Merit evaluations are cached per program" ) {
+        optim::MeritFunction spot;
+        spot.add(optim::Operand::spotRms(0.7, 0, 5));
+        optim::MeritFunction efl;
+        efl.add(optim::Operand::efl(100));
+        const optim::MeritProgram spotProgram = spot.compile(schema);
+        const optim::MeritProgram eflProgram = efl.compile(schema);
+        REQUIRE( spotProgram.hash() != eflProgram.hash() );
+
+        ResultCache cache;
+        const auto direct = spotProgram.evaluate(lens, false);
+        const auto cached = spotProgram.evaluate(lens, cache, false);
+        const auto hit = spotProgram.evaluate(lens, cache, false);
+        REQUIRE( cached.merit == direct.merit );
+        REQUIRE( hit.merit == direct.merit );
+        REQUIRE( hit.values == direct.values );
+        REQUIRE( hit.failedRays == direct.failedRays );
+
+        REQUIRE( eflProgram.evaluate(lens, cache, false).values == eflProgram.evaluate(lens, false).values );
+        REQUIRE( cache.statistics().hits == 1 );
+        REQUIRE( cache.size() == 2 );
+    }
+
+    SECTION( "Entries of the wrong size are recomputed" ) {
+        ResultCache cache;
+        const ParaxialAnalysis<double> direct(lens, wavelength);
+        cache.insert(ResultCache::key(lens, "paraxial/1", { wavelength }), { 1 });
+        REQUIRE( ParaxialAnalysis<double>(lens, wavelength, cache).efl == direct.efl );
+        REQUIRE( ParaxialAnalysis<double>(lens, wavelength, cache).focalShift == direct.focalShift );
+        REQUIRE( cache.statistics().misses == 1 );
+        REQUIRE( cache.statistics().hits == 1 );
+
+        optim::MeritFunction mf;
+        mf.add(optim::Operand::efl(100));
+        mf.add(optim::Operand::spotRms(0, 0, 5));
+        const optim::MeritProgram program = mf.compile(schema);
+        ContentHasher query;
+        query.add("merit/1").add(program.hash());
+        cache.insert({ contentHash(lens), query.value() }, { 0, 0 });
+        REQUIRE( program.evaluate(lens, cache, false).values == program.evaluate(lens, false).values );
+    }
+
+    SECTION( "Caches persist to disk" ) {
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / "lore-test-cache.bin";
+
+        ResultCache cache;
+        const ParaxialAnalysis<double> direct(lens, wavelength, cache);
+        petzvalRadius(lens, wavelength, cache);
+        REQUIRE( cache.save(path.string()) );
+
+        ResultCache restored(1);
+        REQUIRE( restored.load(path.string()) == 2 );
+        REQUIRE( restored.size() == 1 );
+        REQUIRE( ParaxialAnalysis<double>(lens, wavelength, restored).efl == direct.efl );
+
+        {
+            std::ofstream corrupt(path, std::ios::binary | std::ios::trunc);
+            corrupt << "LORECACH garbage";
+        }
+        ResultCache empty;
+        REQUIRE( empty.load(path.string()) == 0 );
+        REQUIRE( empty.load((path.string() + ".missing")) == 0 );
+        REQUIRE( empty.size() == 0 );
+
+        std::filesystem::remove(path);
+    }
+}
+
+TEST_CASE( "Analysis result cache performance", "[.][benchmark]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const Lens<double> lens = schema.lens<double>();
+
+    optim::MeritFunction mf;
+    for (const double field : { 0.0, 0.7, 1.0 }) {
+        mf.add(optim::Operand::spotRms(field, 0, 9));
+    }
+    const optim::MeritProgram program = mf.compile(schema);
+
+    ResultCache cache;
+    BENCHMARK( "Spot evaluation" ) {
+        return program.evaluate(lens, false);
+    };
+
+    BENCHMARK( "Cached spot evaluation" ) {
+        return program.evaluate(lens, cache, false);
+    };
+}
@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Sensitivity.h>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+TEST_CASE( "Sensitivity analysis", "[analysis]" ) {
+    const auto schema = fixtures::readTessar();
+    const auto lens = schema.lens<double>();
+    const auto program = fixtures::tessarProgram(schema, 7);
+
+    const auto parameters = LensParameter::enumerate(lens);
+    REQUIRE( parameters.size() == 19 );
+
+    const SensitivityAnalysis<4> analysis { lens, program };
+    const auto forward = analysis.compute(parameters);
+    const auto reference = analysis.centralDifferences(parameters);
+
+    REQUIRE( forward.numOperands() == 4 );
+    REQUIRE( forward.numParameters() == 19 );
+    for (int operand = 0; operand < forward.numOperands(); operand++) {
+        REQUIRE_THAT( forward.values[operand], WithinRel(reference.values[operand], 1e-12) );
+        for (int parameter = 0; parameter < forward.numParameters(); parameter++) {
+            const double expected = reference(operand, parameter);
+            REQUIRE_THAT( forward(operand, parameter), WithinAbs(expected, 1e-6 + 1e-4 * std::abs(expected)) );
+        }
+    }
+    for (int parameter = 0; parameter < forward.numParameters(); parameter++) {
+        const double expected = reference.merit[parameter];
+        REQUIRE_THAT( forward.merit[parameter], WithinAbs(expected, 1e-6 + 1e-4 * std::abs(expected)) );
+    }
+}
+
+TEST_CASE( "Sparse sensitivity analysis", "[analysis]" ) {
+    const auto schema = fixtures::readTessar();
+    const auto lens = schema.lens<double>();
+    const auto program = fixtures::tessarProgram(schema, 7);
+    const auto parameters = LensParameter::enumerate(lens);
+
+    const SensitivityAnalysis<8> analysis { lens, program };
+    const auto dense = analysis.compute(parameters);
+    const auto sparse = analysis.computeSparse(parameters);
+
+    REQUIRE( sparse.numOperands() == dense.numOperands() );
+    REQUIRE( sparse.numParameters() == dense.numParameters() );
+    for (int operand = 0; operand < dense.numOperands(); operand++) {
+        REQUIRE_THAT( sparse.values[operand], WithinRel(dense.values[operand], 1e-12) );
+        for (int parameter = 0; parameter < dense.numParameters(); parameter++) {
+            REQUIRE_THAT( sparse(operand, parameter), WithinAbs(dense(operand, parameter), 1e-9) );
+        }
+    }
+    for (int parameter = 0; parameter < dense.numParameters(); parameter++) {
+        REQUIRE_THAT( sparse.merit[parameter], WithinAbs(dense.merit[parameter], 1e-9) );
+    }
+}
+
+TEST_CASE( "Sensitivity analysis performance", "[.][benchmark]" ) {
+    const auto schema = fixtures::readTessar();
+    const auto lens = schema.lens<double>();
+    const auto program = fixtures::tessarProgram(schema, 7);
+    const auto parameters = LensParameter::enumerate(lens);
+
+    BENCHMARK( "Forward derivatives (width 8)" ) {
+        return SensitivityAnalysis<8>(lens, program).compute(parameters);
+    };
+
+    BENCHMARK( "Forward derivatives (width 24)" ) {
+        return SensitivityAnalysis<24>(lens, program).compute(parameters);
+    };
+
+    BENCHMARK( "Sparse forward derivatives" ) {
+        return SensitivityAnalysis<8>(lens, program).computeSparse(parameters);
+    };
+
+    BENCHMARK( "Central differences" ) {
+        return SensitivityAnalysis<8>(lens, program).centralDifferences(parameters);
+    };
+}
@@ -0,0 +1,164 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/SpotEstimator.h>
+#include <lore/analysis/Statistics.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/sampling/PupilSampler.h>
+
+#include <iomanip>
+#include <iostream>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+struct SampledSpot {
+    double rms;
+    double transmission;
+
+    /**
+     * Number of independent uniformly distributed rays for which the confidence interval of the RMS radius
+     * reaches the given relative half width, following the same linearization as AdaptiveSpotEstimator.
+     */
+    double raysFor(double relativeTolerance, double quantile = 1.959964) const {
+        return linearizedVariance * sqr(quantile / (2 * sqr(rms) * relativeTolerance));
+    }
+
+    double linearizedVariance;
+};
+
+/**
+ * Spot of a field point from a fixed number of Sobol pupil samples.
+ */
+static SampledSpot sampledSpot(const LensSchema<float> &schema, double field, int count) {
+    using Intersector = rt::GeometricalIntersector<double>;
+    const Lens<double> lens = schema.lens<double>();
+    const rt::RayGenerator<double> generator(schema);
+    const Intersector intersector {};
+    const rt::SequentialTrace<double, Intersector> trace { lens, intersector, double(schema.primaryWavelength()) };
+    const auto samples = sampling::PupilSampler::sobol(99)(count);
+
+    std::vector<Vector2<double>> hits;
+    Vector2<double> centroid;
+    for (size_t i = 0; i < samples.size(); i++) {
+        rt::Ray<double> ray = generator(field, samples.x[i], samples.y[i]);
+        if (trace(ray)) {
+            hits.push_back({ ray.origin.x(), ray.origin.y() });
+            centroid += hits.back();
+        }
+    }
+    centroid /= double(hits.size());
+
+    double sum = 0;
+    for (const auto &hit : hits) {
+        sum += (hit - centroid).lengthSquared();
+    }
+    const double variance = sum / double(hits.size());
+    const double transmission = double(hits.size()) / double(samples.size());
+
+    RunningStatistics linearized;
+    for (const auto &hit : hits) {
+        linearized.add(((hit - centroid).lengthSquared() - variance) / transmission);
+    }
+    for (size_t i = hits.size(); i < samples.size(); i++) {
+        linearized.add(0);
+    }
+    return { std::sqrt(variance), transmission, linearized.variance() };
+}
+
+TEST_CASE( "Adaptive spot estimation", "[analysis]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const Lens<double> lens = schema.lens<double>();
+    const rt::RayGenerator<double> generator(schema);
+    const double wavelength = schema.primaryWavelength();
+
+    const AdaptiveSpotEstimator<double> estimator(lens, generator, wavelength);
+    const std::vector<double> fields { 0.0, 0.5, 0.7, 0.85, 1.0 };
+
+    SECTION( "Estimates agree with densely sampled spots" ) {
+        for (const double field : fields) {
+            const SampledSpot reference = sampledSpot(schema, field, 1 << 17);
+            const SpotEstimate estimate = estimator(field);
+            REQUIRE( estimate.converged );
+            REQUIRE( estimate.halfWidth <= 0.01 * estimate.rms );
+            REQUIRE_THAT( estimate.rms, WithinRel(reference.rms, 0.01) );
+            REQUIRE_THAT( estimate.transmission, WithinAbs(reference.transmission, 0.005) );
+        }
+    }
+
+    SECTION( "Vignetting boundaries are refined" ) {
+        const SpotEstimate full = estimator(1.0);
+        REQUIRE( full.transmission < 1 );
+        REQUIRE( full.strata > 32 );
+
+        const SpotEstimate axis = estimator(0.0);
+        REQUIRE( axis.strata == 32 );
+    }
+
+    SECTION( "Field grids use fewer rays than fixed sampling" ) {
+        const auto estimates = estimator(fields);
+        int total = 0;
+        double fixed = 0;
+        for (size_t i = 0; i < fields.size(); i++) {
+            REQUIRE( estimates[i].rms == estimator(fields[i]).rms );
+            total += estimates[i].rays;
+
+            // a fixed ray count has to suffice for the most difficult field point
+            fixed = std::max(fixed, sampledSpot(schema, fields[i], 1 << 15).raysFor(0.01));
+        }
+        REQUIRE( total < fixed * double(fields.size()) / 4 );
+    }
+
+    SECTION( "Budgets and tolerances" ) {
+        AdaptiveSpotEstimator<double>::Options options;
+        options.relativeTolerance = 1e-6;
+        options.maxRays = 500;
+        const SpotEstimate limited = AdaptiveSpotEstimator<double>(lens, generator, wavelength, options)(0.7);
+        REQUIRE_FALSE( limited.converged );
+        REQUIRE( limited.rays == 500 );
+
+        options.absoluteTolerance = 1e+3;
+        const SpotEstimate coarse = AdaptiveSpotEstimator<double>(lens, generator, wavelength, options)(0.7);
+        REQUIRE( coarse.converged );
+        REQUIRE( coarse.rays == 128 );
+
+        options.initialSamples = 1;
+        REQUIRE_THROWS_AS( AdaptiveSpotEstimator<double>(lens, generator, wavelength, options), std::invalid_argument );
+    }
+}
+
+TEST_CASE( "Adaptive spot estimation ray counts", "[.][benchmark]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const Lens<double> lens = schema.lens<double>();
+    const rt::RayGenerator<double> generator(schema);
+
+    // fixed: independent uniformly distributed rays needed for the same confidence interval
+    std::cout << std::setw(8) << "field" << std::setw(12) << "tolerance" << std::setw(12) << "rms"
+              << std::setw(12) << "error" << std::setw(12) << "rays" << std::setw(12) << "strata"
+              << std::setw(12) << "fixed" << std::endl;
+    for (const double tolerance : { 1e-2, 1e-3 }) {
+        AdaptiveSpotEstimator<double>::Options options;
+        options.relativeTolerance = tolerance;
+        options.maxRays = 1 << 20;
+        const AdaptiveSpotEstimator<double> estimator(lens, generator, schema.primaryWavelength(), options);
+
+        int total = 0;
+        double fixed = 0;
+        for (const double field : { 0.0, 0.25, 0.5, 0.7, 0.85, 1.0 }) {
+            const SampledSpot reference = sampledSpot(schema, field, 1 << 19);
+            const SpotEstimate estimate = estimator(field);
+            total += estimate.rays;
+            fixed = std::max(fixed, reference.raysFor(tolerance));
+            std::cout << std::setw(8) << field << std::setw(12) << tolerance << std::setw(12) << estimate.rms
+                      << std::setw(12) << std::abs(estimate.rms / reference.rms - 1) << std::setw(12) << estimate.rays
+                      << std::setw(12) << estimate.strata << std::setw(12) << int(reference.raysFor(tolerance))
+                      << std::endl;
+        }
+        std::cout << std::setw(8) << "total" << std::setw(12) << tolerance << std::setw(48) << total
+                  << std::setw(12) << int(6 * fixed) << std::endl;
+    }
+}
@@ -0,0 +1,100 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Statistics.h>
+#include <lore/analysis/Tolerancing.h>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+TEST_CASE( "Streaming statistics", "[analysis]" ) {
+    SECTION( "Merging moments" ) {
+        RunningStatistics all, first, second;
+        for (int i = 1; i <= 100; i++) {
+            all.add(i * 0.5);
+            (i <= 30 ? first : second).add(i * 0.5);
+        }
+        first.merge(second);
+        REQUIRE( first.count == 100 );
+        REQUIRE_THAT( first.mean, WithinRel(all.mean, 1e-12) );
+        REQUIRE_THAT( first.variance(), WithinRel(all.variance(), 1e-12) );
+        REQUIRE( first.min == 0.5 );
+        REQUIRE( first.max == 50 );
+    }
+
+    SECTION( "Quantiles" ) {
+        QuantileSketch sketch;
+        for (int i = -500; i <= 1500; i++) {
+            sketch.add(i);
+        }
+        REQUIRE_THAT( sketch.quantile(0.5), WithinRel(500, 1.0 / 128) );
+        REQUIRE_THAT( sketch.quantile(0.9), WithinRel(1300, 1.0 / 128) );
+        REQUIRE_THAT( sketch.quantile(0.1), WithinRel(-300, 1.0 / 128) );
+        REQUIRE( sketch.quantile(0) == -500 );
+        REQUIRE( sketch.quantile(1) == 1500 );
+    }
+}
+
+TEST_CASE( "Monte Carlo tolerancing", "[analysis]" ) {
+    using Float = double;
+
+    fixtures::loadGlasses("data/glass/obsolete001.glc");
+    const auto schema = fixtures::readLens("data/lenses/simple.len");
+    const auto lens = schema.lens<Float>();
+
+    optim::MeritFunction mf;
+    mf.add(optim::Operand::spotRms(0, 0, 5));
+    mf.add(optim::Operand::efl(65));
+    const auto program = mf.compile(schema);
+    const auto nominal = program.evaluate(lens);
+
+    MonteCarloTolerancing<Float>::Options options;
+    options.samples = 200;
+    options.seed = 1234;
+
+    SECTION( "Without tolerances" ) {
+        const MonteCarloTolerancing<Float> tolerancing { lens, program, {} };
+        const auto result = tolerancing.run(options);
+        REQUIRE( result.samples == 200 );
+        REQUIRE( result.yield() == 1 );
+        REQUIRE( result.merit.moments.stddev() == 0 );
+        REQUIRE( result.merit.percentile(50) == nominal.merit );
+        REQUIRE( result.operands[1].percentile(95) == nominal.values[1] );
+    }
+
+    SECTION( "Perturbations" ) {
+        const MonteCarloTolerancing<Float> tolerancing { lens, program, {
+            Tolerance::radius(1, 0.5),
+            Tolerance::thickness(1, 0.2, Tolerance::GAUSSIAN),
+            Tolerance::index(1, 0.001),
+        } };
+
+        Lens<Float> a = lens, b = lens;
+        const sampling::Philox rng { options.seed };
+        tolerancing.perturb(rng, 5, a);
+        tolerancing.perturb(rng, 5, b);
+        REQUIRE( a.surfaces[1].radius == b.surfaces[1].radius );
+        REQUIRE( std::abs(a.surfaces[1].radius - 50) <= 0.5 );
+        REQUIRE( std::abs(a.surfaces[1].thickness - 8) <= 0.2 );
+        REQUIRE( std::abs(a.surfaces[1].ior(0.58756) - lens.surfaces[1].ior(0.58756)) <= 0.001 + 1e-9 );
+        REQUIRE( a.surfaces[2].radius == lens.surfaces[2].radius );
+
+        const auto result = tolerancing.run(options);
+        REQUIRE( result.merit.moments.stddev() > 0 );
+        REQUIRE( result.merit.percentile(10) <= result.merit.percentile(50) );
+        REQUIRE( result.merit.percentile(50) <= result.merit.percentile(90) );
+
+        options.maximumMerit = result.merit.percentile(50);
+        const auto repeated = tolerancing.run(options);
+        REQUIRE( repeated.merit.moments.mean == result.merit.moments.mean );
+        REQUIRE( repeated.yield() > 0.3 );
+        REQUIRE( repeated.yield() < 0.7 );
+    }
+
+    SECTION( "Invalid tolerances" ) {
+        REQUIRE_THROWS_AS( MonteCarloTolerancing<Float>(lens, program, { Tolerance::radius(17, 1) }), std::invalid_argument );
+    }
+}
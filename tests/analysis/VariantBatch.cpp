@@ -0,0 +1,102 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Paraxial.h>
+#include <lore/analysis/VariantBatch.h>
+#include <lore/optim/MeritFunction.h>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+template<typename Float>
+static void checkVariantBatch() {
+    const double tolerance = sizeof(Float) == 4 ? 1e-5 : 1e-12;
+
+    const LensSchema<float> schema = fixtures::readTessar();
+    const Lens<Float> base = schema.lens<Float>();
+    const Float wavelength = Float(schema.primaryWavelength());
+
+    VariantBatch<Float> batch(base, {
+        { LensParameter::RADIUS, 1 },
+        { LensParameter::THICKNESS, 5 },
+        { LensParameter::RADIUS, 7 },
+        { LensParameter::THICKNESS, 1 },
+    });
+
+    // not a multiple of the lane count, so that the last chunk is partial
+    const int numVariants = 3 * VariantBatch<Float>::Lanes + 3;
+    for (int v = 0; v < numVariants; v++) {
+        batch.add({ Float(0.1) * Float(v % 5), Float(-0.05) * Float(v % 7), Float(0.2) * Float(v % 3), Float(0.01) * Float(v) });
+    }
+    REQUIRE( batch.size() == size_t(numVariants) );
+
+    SECTION( "Variants apply their deltas" ) {
+        const Lens<Float> variant = batch.variant(9);
+        REQUIRE( variant.surfaces[1].radius == base.surfaces[1].radius + batch.delta(9, 0) );
+        REQUIRE( variant.surfaces[5].thickness == base.surfaces[5].thickness + batch.delta(9, 1) );
+        REQUIRE( variant.surfaces[2].radius == base.surfaces[2].radius );
+        REQUIRE( batch.deltas(3).size() == size_t(numVariants) );
+    }
+
+    SECTION( "Paraxial analysis matches individual lenses" ) {
+        for (const bool parallel : { false, true }) {
+            const auto results = batch.paraxial(wavelength, parallel);
+            for (int v = 0; v < numVariants; v++) {
+                const ParaxialAnalysis<Float> expected(batch.variant(v), wavelength);
+                REQUIRE_THAT( double(results.efl[v]), WithinRel(double(expected.efl), tolerance) );
+                REQUIRE_THAT( double(results.focalShift[v]), WithinRel(double(expected.focalShift), tolerance) );
+            }
+        }
+    }
+
+    SECTION( "Spot sizes match the merit function" ) {
+        for (const double field : { 0.0, 0.7, 1.0 }) {
+            optim::MeritFunction mf;
+            mf.add(optim::Operand::spotRms(field, 0, 7));
+            const optim::MeritProgram program = mf.compile(schema);
+
+            const auto results = batch.spotRms(program.generator.cast<Float>(), Float(field), wavelength, 7);
+            for (int v = 0; v < numVariants; v++) {
+                const Float expected = program.evaluate(batch.variant(v), false).values[0];
+                REQUIRE( expected > 0 );
+                REQUIRE_THAT( double(results[v]), WithinRel(double(expected), tolerance) );
+            }
+        }
+    }
+
+    SECTION( "Vignetting is tracked per variant" ) {
+        // a thickness that pushes the rays of some variants outside a checked aperture
+        VariantBatch<Float> vignetting(base, { { LensParameter::THICKNESS, 2 } });
+        for (int v = 0; v < numVariants; v++) {
+            vignetting.add({ Float(v % 2 == 0 ? 0 : 40) });
+        }
+
+        optim::MeritFunction mf;
+        mf.add(optim::Operand::spotRms(1.0, 0, 5));
+        const optim::MeritProgram program = mf.compile(schema);
+        const auto results = vignetting.spotRms(program.generator.cast<Float>(), Float(1), wavelength, 5);
+        const int baseFailures = program.evaluate(base, false).failedRays;
+        for (int v = 0; v < numVariants; v++) {
+            const auto expected = program.evaluate(vignetting.variant(v), false);
+            REQUIRE( (expected.failedRays > baseFailures) == (v % 2 == 1) );
+            REQUIRE_THAT( double(results[v]), WithinRel(double(expected.values[0]), tolerance) );
+        }
+    }
+
+    SECTION( "Invalid parameters are rejected" ) {
+        REQUIRE_THROWS_AS( VariantBatch<Float>(base, { { LensParameter::INDEX, 1 } }), std::invalid_argument );
+        REQUIRE_THROWS_AS( VariantBatch<Float>(base, { { LensParameter::RADIUS, 99 } }), std::invalid_argument );
+        REQUIRE_THROWS_AS( batch.add({ Float(1) }), std::invalid_argument );
+    }
+}
+
+TEST_CASE( "Variant batches in single precision", "[analysis]" ) {
+    checkVariantBatch<float>();
+}
+
+TEST_CASE( "Variant batches in double precision", "[analysis]" ) {
+    checkVariantBatch<double>();
+}
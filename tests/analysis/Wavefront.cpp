@@ -0,0 +1,100 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Wavefront.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/SequentialTrace.h>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+TEST_CASE( "Wavefront aberrations", "[analysis]" ) {
+    LensSchema<float> schema = fixtures::readTessar();
+    const double wavelength = schema.primaryWavelength();
+    const Lens<double> lens = schema.lens<double>();
+    const rt::RayGenerator<double> generator(schema);
+    const WavefrontAnalysis<double> analysis(lens, generator, schema.stopIndex);
+
+    SECTION( "Pupils and apertures" ) {
+        const double pupil = analysis.exitPupilPosition(wavelength);
+        REQUIRE( pupil < 0 );
+
+        // F/2.8
+        REQUIRE_THAT( analysis.numericalAperture(wavelength), WithinAbs(1 / (2 * 2.8), 0.005) );
+    }
+
+    SECTION( "Wavefront slopes match transverse ray aberrations" ) {
+        const int n = 200;
+        const Wavefront wavefront = analysis(0, wavelength, n);
+        REQUIRE( wavefront.transmission() == 1 );
+        REQUIRE( wavefront.chief.y() == 0 );
+        REQUIRE( wavefront.opd[(n / 2) * n + n / 2] < 1e-3 );
+
+        // the pupil edge lies at the radius of the marginal ray in the exit pupil
+        const double radius = wavefront.referenceRadius * std::tan(std::asin(wavefront.numericalAperture));
+        const double spacing = 2.0 / n;
+
+        const rt::GeometricalIntersector<double> intersector {};
+        const rt::SequentialTrace<double, rt::GeometricalIntersector<double>> trace { lens, intersector, wavelength };
+        for (const int ix : { 130, 150, 170, 190 }) {
+            const int index = (n / 2) * n + ix;
+            const double slope = (wavefront.opd[index + 1] - wavefront.opd[index - 1]) / (2 * spacing);
+            const double aberration = wavefront.referenceRadius * slope * wavelength * 1e-3 / radius;
+
+            rt::Ray<double> ray = generator(0, 2 * (ix + 0.5) / n - 1, 2 * (n / 2 + 0.5) / n - 1);
+            REQUIRE( trace(ray) );
+            REQUIRE_THAT( aberration, WithinAbs(ray.origin.x(), 0.01 * std::abs(ray.origin.x()) + 1e-4) );
+        }
+    }
+
+    SECTION( "Defocus" ) {
+        schema.entranceBeamRadius = 2;
+        const rt::RayGenerator<double> narrow(schema);
+        Lens<double> defocused = lens;
+        const double shift = 0.05;
+        defocused.surfaces[lens.surfaces.size() - 2].thickness += shift;
+
+        const int n = 33;
+        const Wavefront focused = WavefrontAnalysis<double>(lens, narrow, schema.stopIndex)(0, wavelength, n);
+        const Wavefront moved = WavefrontAnalysis<double>(defocused, narrow, schema.stopIndex)(0, wavelength, n);
+        REQUIRE( focused.rms() < 0.01 );
+
+        // defocus by shift adds shift (1 - cos u) rho^2 waves in the pupil
+        const double na = focused.numericalAperture;
+        for (const int ix : { 20, 26, 32 }) {
+            const double rho = 2 * (ix + 0.5) / n - 1;
+            const int index = (n / 2) * n + ix;
+            const int center = (n / 2) * n + n / 2;
+            const double added = (moved.opd[index] - moved.opd[center]) - (focused.opd[index] - focused.opd[center]);
+            REQUIRE_THAT( -added, WithinRel(shift * (1 - std::sqrt(1 - sqr(na))) * sqr(rho) / (wavelength * 1e-3), 0.01) );
+        }
+    }
+
+    SECTION( "Symmetry and vignetting" ) {
+        const int n = 32;
+        const Wavefront axis = analysis(0, wavelength, n, false);
+        for (int iy = 0; iy < n; iy++) {
+            for (int ix = 0; ix < n; ix++) {
+                const double value = axis.opd[iy * n + ix];
+                if (!std::isnan(value)) {
+                    REQUIRE_THAT( axis.opd[iy * n + (n - 1 - ix)], WithinAbs(value, 1e-9) );
+                    REQUIRE_THAT( axis.opd[ix * n + iy], WithinAbs(value, 1e-9) );
+                }
+            }
+        }
+
+        const Wavefront field = analysis(1, wavelength, n);
+        REQUIRE( field.transmission() < 1 );
+        REQUIRE( field.transmission() > 0 );
+        REQUIRE( field.chief.y() > 0 );
+
+        const Wavefront serial = analysis(1, wavelength, n, false);
+        for (int i = 0; i < n * n; i++) {
+            REQUIRE( serial.valid(i) == field.valid(i) );
+            REQUIRE( (!field.valid(i) || serial.opd[i] == field.opd[i]) );
+        }
+    }
+}
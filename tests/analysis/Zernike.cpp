@@ -0,0 +1,221 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Zernike.h>
+#include <lore/sampling/PupilSampler.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+/**
+ * Wavefront grid sampled from Zernike coefficients.
+ */
+static Wavefront synthetic(const std::vector<double> &coefficients, int size) {
+    Wavefront result;
+    result.size = size;
+    result.opd.assign(size_t(size) * size, std::numeric_limits<double>::quiet_NaN());
+    for (int iy = 0; iy < size; iy++) {
+        for (int ix = 0; ix < size; ix++) {
+            const double x = 2 * (ix + 0.5) / size - 1;
+            const double y = 2 * (iy + 0.5) / size - 1;
+            if (sqr(x) + sqr(y) <= 1) {
+                result.opd[iy * size + ix] = ZernikeFit::evaluate(coefficients, x, y);
+            }
+        }
+    }
+    return result;
+}
+
+TEST_CASE( "Zernike polynomials", "[analysis]" ) {
+    SECTION( "Noll indices" ) {
+        const int expected[][2] = {
+            { 0, 0 }, { 1, 1 }, { 1, -1 }, { 2, 0 }, { 2, -2 }, { 2, 2 },
+            { 3, -1 }, { 3, 1 }, { 3, -3 }, { 3, 3 }, { 4, 0 }, { 4, 2 }, { 4, -2 }
+        };
+        for (int j = 1; j <= 13; j++) {
+            const zernike::Index index = zernike::noll(j);
+            REQUIRE( index.n == expected[j - 1][0] );
+            REQUIRE( index.m == expected[j - 1][1] );
+        }
+        REQUIRE_THROWS_AS( zernike::noll(0), std::invalid_argument );
+    }
+
+    SECTION( "Closed forms" ) {
+        const double x = 0.3, y = -0.5;
+        const double r2 = sqr(x) + sqr(y);
+        REQUIRE_THAT( zernike::evaluate(1, x, y), WithinAbs(1, 1e-14) );
+        REQUIRE_THAT( zernike::evaluate(2, x, y), WithinAbs(2 * x, 1e-14) );
+        REQUIRE_THAT( zernike::evaluate(3, x, y), WithinAbs(2 * y, 1e-14) );
+        REQUIRE_THAT( zernike::evaluate(4, x, y), WithinAbs(std::sqrt(3) * (2 * r2 - 1), 1e-14) );
+        REQUIRE_THAT( zernike::evaluate(7, x, y), WithinAbs(std::sqrt(8) * (3 * r2 - 2) * y, 1e-14) );
+        REQUIRE_THAT( zernike::evaluate(11, x, y), WithinAbs(std::sqrt(5) * (6 * sqr(r2) - 6 * r2 + 1), 1e-14) );
+    }
+
+    SECTION( "Orthonormality over the unit disk" ) {
+        const int size = 256;
+        const int terms = 15;
+        std::vector<double> products(terms * terms);
+        int count = 0;
+        for (int iy = 0; iy < size; iy++) {
+            for (int ix = 0; ix < size; ix++) {
+                const double x = 2 * (ix + 0.5) / size - 1;
+                const double y = 2 * (iy + 0.5) / size - 1;
+                if (sqr(x) + sqr(y) <= 1) {
+                    count++;
+                    for (int i = 0; i < terms; i++) {
+                        for (int j = 0; j < terms; j++) {
+                            products[i * terms + j] += zernike::evaluate(i + 1, x, y) * zernike::evaluate(j + 1, x, y);
+                        }
+                    }
+                }
+            }
+        }
+        for (int i = 0; i < terms; i++) {
+            for (int j = 0; j < terms; j++) {
+                REQUIRE_THAT( products[i * terms + j] / count, WithinAbs(i == j ? 1 : 0, 0.01) );
+            }
+        }
+    }
+}
+
+TEST_CASE( "Zernike fitting", "[analysis]" ) {
+    const std::vector<double> coefficients {
+        0.1, -0.3, 0.2, 0.5, 0.05, -0.02, 0.15, 0.01, -0.04, 0.03, -0.25, 0.02, 0.01, -0.01, 0.005
+    };
+    const int size = 32;
+    const ZernikeFit fit(int(coefficients.size()), size);
+
+    SECTION( "Polynomials within the basis are recovered exactly" ) {
+        const std::vector<double> fitted = fit(synthetic(coefficients, size));
+        REQUIRE( fitted.size() == coefficients.size() );
+        for (size_t t = 0; t < coefficients.size(); t++) {
+            REQUIRE_THAT( fitted[t], WithinAbs(coefficients[t], 1e-10) );
+        }
+
+        // vignetted samples are left out of the fit
+        Wavefront vignetted = synthetic(coefficients, size);
+        for (int i = 0; i < size * size; i++) {
+            if (i / size > 3 * size / 4) {
+                vignetted.opd[i] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+        const std::vector<double> partial = fit(vignetted);
+        for (size_t t = 0; t < coefficients.size(); t++) {
+            REQUIRE_THAT( partial[t], WithinAbs(coefficients[t], 1e-10) );
+        }
+    }
+
+    SECTION( "Arbitrary sample patterns and value types" ) {
+        const auto samples = sampling::PupilSampler::sobol(5)(512);
+        const ZernikeFit scattered(int(coefficients.size()), samples.x, samples.y);
+        REQUIRE( scattered.samples() == 512 );
+
+        std::vector<float> values(samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            values[i] = float(ZernikeFit::evaluate(coefficients, samples.x[i], samples.y[i]));
+        }
+        std::vector<float> fitted(coefficients.size());
+        scattered(std::span<const float>(values), std::span<float>(fitted));
+        for (size_t t = 0; t < coefficients.size(); t++) {
+            REQUIRE_THAT( fitted[t], WithinAbs(coefficients[t], 1e-5) );
+        }
+
+        REQUIRE_THROWS_AS( scattered(synthetic(coefficients, size)), std::invalid_argument );
+        REQUIRE_THROWS_AS( fit(synthetic(coefficients, size + 1)), std::invalid_argument );
+        REQUIRE_THROWS_AS( ZernikeFit(36, 4), std::invalid_argument );
+    }
+
+    SECTION( "Defocus of a lens" ) {
+        LensSchema<float> schema = fixtures::readTessar();
+        schema.entranceBeamRadius = 2;
+        const double wavelength = schema.primaryWavelength();
+        const Lens<double> lens = schema.lens<double>();
+        const rt::RayGenerator<double> generator(schema);
+        Lens<double> defocused = lens;
+        const double shift = 0.05;
+        defocused.surfaces[lens.surfaces.size() - 2].thickness += shift;
+
+        const auto focused = fit(WavefrontAnalysis<double>(lens, generator, schema.stopIndex)(0, wavelength, size));
+        const auto moved = fit(WavefrontAnalysis<double>(defocused, generator, schema.stopIndex)(0, wavelength, size));
+
+        // shift (1 - cos u) rho^2 waves of defocus have a Z4 coefficient of half that over sqrt(3)
+        const double na = WavefrontAnalysis<double>(lens, generator, schema.stopIndex).numericalAperture(wavelength);
+        const double peak = shift * (1 - std::sqrt(1 - sqr(na))) / (wavelength * 1e-3);
+        REQUIRE_THAT( focused[3] - moved[3], WithinRel(peak / (2 * std::sqrt(3)), 0.01) );
+        for (const int t : { 1, 2, 4, 5, 6, 7 }) {
+            REQUIRE_THAT( moved[t], WithinAbs(0, 1e-6) );
+        }
+    }
+
+    SECTION( "Field and wavelength batches" ) {
+        const LensSchema<float> schema = fixtures::readTessar();
+        const WavefrontAnalysis<double> analysis(schema);
+        std::vector<Wavefront> wavefronts;
+        for (const double field : { 0.0, 0.5, 0.7, 1.0 }) {
+            for (const auto &weighted : schema.wavelengths) {
+                wavefronts.push_back(analysis(field, weighted.wavelength, size));
+            }
+        }
+
+        const auto fitted = fit(wavefronts);
+        const auto serial = fit(wavefronts, false);
+        REQUIRE( fitted.size() == wavefronts.size() );
+        for (size_t i = 0; i < wavefronts.size(); i++) {
+            REQUIRE( fitted[i] == serial[i] );
+            REQUIRE( fitted[i] == fit(wavefronts[i]) );
+        }
+
+        // on axis, only rotationally symmetric terms remain
+        for (size_t t = 0; t < coefficients.size(); t++) {
+            const zernike::Index index = zernike::noll(int(t) + 1);
+            // the square grid is not orthogonal to cos 4 theta for rotationally symmetric wavefronts
+            if (index.m != 0 && std::abs(index.m) != 4) {
+                REQUIRE_THAT( fitted[0][t], WithinAbs(0, 1e-6) );
+            }
+        }
+        REQUIRE( std::abs(fitted[0][10]) > 0.1 );
+    }
+}
+
+TEST_CASE( "Zernike fitting throughput", "[.][benchmark]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const WavefrontAnalysis<double> analysis(schema);
+
+    std::cout << std::setw(8) << "grid" << std::setw(8) << "terms" << std::setw(14) << "factorize ms"
+              << std::setw(14) << "fit us" << std::setw(14) << "solve us" << std::endl;
+    for (const int size : { 32, 64, 128 }) {
+        for (const int terms : { 15, 37 }) {
+            auto start = std::chrono::steady_clock::now();
+            const ZernikeFit fit(terms, size);
+            const std::chrono::duration<double, std::milli> factorize = std::chrono::steady_clock::now() - start;
+
+            const Wavefront axis = analysis(0, schema.primaryWavelength(), size);
+            const Wavefront field = analysis(1, schema.primaryWavelength(), size);
+            const int repetitions = 100;
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; i++) {
+                fit(axis);
+            }
+            const std::chrono::duration<double, std::micro> projected = std::chrono::steady_clock::now() - start;
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; i++) {
+                fit(field);
+            }
+            const std::chrono::duration<double, std::micro> solved = std::chrono::steady_clock::now() - start;
+
+            std::cout << std::setw(8) << size << std::setw(8) << terms << std::setw(14) << factorize.count()
+                      << std::setw(14) << projected.count() / repetitions << std::setw(14)
+                      << solved.count() / repetitions << std::endl;
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <lore/lore.h>
+#include <lore/fourier/FFT.h>
+#include <lore/sampling/Random.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+using Complex = std::complex<double>;
+
+static std::vector<Complex> randomSequence(int n, uint64_t seed) {
+    sampling::Philox philox(seed);
+    std::vector<Complex> result(n);
+    for (int i = 0; i < n; i++) {
+        const auto block = philox.block(i, 0);
+        result[i] = Complex(double(block[0]) / 0xffffffffu - 0.5, double(block[1]) / 0xffffffffu - 0.5);
+    }
+    return result;
+}
+
+static std::vector<Complex> naiveDFT(const std::vector<Complex> &in, fourier::Direction direction) {
+    const int n = int(in.size());
+    const double sign = direction == fourier::Direction::FORWARD ? -1 : 1;
+    std::vector<Complex> out(n);
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            out[k] += in[j] * std::polar(1.0, sign * 2 * M_PI * double((int64_t(j) * k) % n) / n);
+        }
+    }
+    return out;
+}
+
+static double maxError(const std::vector<Complex> &a, const std::vector<Complex> &b) {
+    double result = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        result = std::max(result, std::abs(a[i] - b[i]));
+    }
+    return result;
+}
+
+TEST_CASE( "One-dimensional FFT", "[fourier]" ) {
+    SECTION( "Mixed radix lengths agree with the DFT" ) {
+        for (const int n : { 1, 2, 3, 4, 5, 7, 8, 12, 16, 30, 64, 97, 128, 360 }) {
+            const fourier::FFT<double> fft(n);
+            const std::vector<Complex> in = randomSequence(n, n);
+            for (const auto direction : { fourier::Direction::FORWARD, fourier::Direction::INVERSE }) {
+                std::vector<Complex> out(n);
+                fft(in.data(), out.data(), direction);
+                REQUIRE( maxError(out, naiveDFT(in, direction)) < 1e-12 * n );
+            }
+        }
+    }
+
+    SECTION( "Round trips and Parseval's theorem" ) {
+        const int n = 240;
+        const fourier::FFT<double> fft(n);
+        const std::vector<Complex> in = randomSequence(n, 1);
+        std::vector<Complex> data = in;
+
+        fft(data.data(), fourier::Direction::FORWARD);
+        double energy = 0, spectrum = 0;
+        for (int i = 0; i < n; i++) {
+            energy += std::norm(in[i]);
+            spectrum += std::norm(data[i]);
+        }
+        REQUIRE_THAT( spectrum, WithinRel(n * energy, 1e-12) );
+
+        fft(data.data(), fourier::Direction::INVERSE);
+        for (auto &value : data) {
+            value /= double(n);
+        }
+        REQUIRE( maxError(data, in) < 1e-14 );
+    }
+
+    SECTION( "Strided input" ) {
+        const int n = 12;
+        const fourier::FFT<double> fft(n);
+        const std::vector<Complex> interleaved = randomSequence(3 * n, 2);
+        std::vector<Complex> in(n), out(n);
+        for (int i = 0; i < n; i++) {
+            in[i] = interleaved[3 * i];
+        }
+        fft(interleaved.data(), out.data(), fourier::Direction::FORWARD, 3);
+        REQUIRE( maxError(out, naiveDFT(in, fourier::Direction::FORWARD)) < 1e-12 );
+    }
+
+    REQUIRE_THROWS_AS( fourier::FFT<double>(0), std::invalid_argument );
+}
+
+TEST_CASE( "Two-dimensional FFT", "[fourier]" ) {
+    SECTION( "Rectangular arrays agree with row and column DFTs" ) {
+        const int rows = 40, columns = 36;
+        const std::vector<Complex> in = randomSequence(rows * columns, 3);
+
+        std::vector<Complex> expected(in.size());
+        for (int r = 0; r < rows; r++) {
+            const std::vector<Complex> row(in.begin() + r * columns, in.begin() + (r + 1) * columns);
+            const std::vector<Complex> transformed = naiveDFT(row, fourier::Direction::FORWARD);
+            std::copy(transformed.begin(), transformed.end(), expected.begin() + r * columns);
+        }
+        for (int c = 0; c < columns; c++) {
+            std::vector<Complex> column(rows);
+            for (int r = 0; r < rows; r++) {
+                column[r] = expected[r * columns + c];
+            }
+            column = naiveDFT(column, fourier::Direction::FORWARD);
+            for (int r = 0; r < rows; r++) {
+                expected[r * columns + c] = column[r];
+            }
+        }
+
+        const fourier::FFT2D<double> fft(rows, columns);
+        std::vector<Complex> data = in;
+        fft(data, fourier::Direction::FORWARD);
+        REQUIRE( maxError(data, expected) < 1e-10 );
+
+        std::vector<Complex> serial = in;
+        fft(serial, fourier::Direction::FORWARD, false);
+        REQUIRE( serial == data );
+    }
+
+    SECTION( "Blocked transposes" ) {
+        const int rows = 70, columns = 45;
+        const std::vector<Complex> in = randomSequence(rows * columns, 4);
+        std::vector<Complex> out(in.size());
+        fourier::FFT2D<double>::transpose(in.data(), out.data(), rows, columns);
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < columns; c++) {
+                REQUIRE( out[c * rows + r] == in[r * columns + c] );
+            }
+        }
+    }
+
+    SECTION( "Shifted spectra are centered" ) {
+        std::vector<int> data { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+        fourier::fftshift(data, 3, 4);
+        REQUIRE( data[1 * 4 + 2] == 0 );
+        REQUIRE( data == std::vector<int> { 10, 11, 8, 9, 2, 3, 0, 1, 6, 7, 4, 5 } );
+    }
+}
+
+TEST_CASE( "Two-dimensional FFT throughput", "[.][benchmark]" ) {
+    std::cout << std::setw(8) << "size" << std::setw(12) << "serial ms" << std::setw(12) << "parallel ms" << std::endl;
+    for (const int n : { 128, 256, 512, 1024 }) {
+        const fourier::FFT2D<double> fft(n, n);
+        std::vector<Complex> data = randomSequence(n * n, 5);
+
+        auto time = [&](bool parallel) {
+            const int repetitions = std::max(1, (1 << 22) / (n * n));
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; i++) {
+                fft(data, fourier::Direction::FORWARD, parallel);
+            }
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            return elapsed.count() / repetitions;
+        };
+        std::cout << std::setw(8) << n << std::setw(12) << time(false) << std::setw(12) << time(true) << std::endl;
+    }
+}
@@ -4,6 +4,9 @@
 #include <lore/io/LensReader.h>
 
 #include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 TEST_CASE( "Lens reading", "[io]" ) {
     std::ifstream file("data/lenses/tessar.len");
@@ -48,3 +51,109 @@ TEST_CASE( "Lens reading", "[io]" ) {
         REQUIRE( lens.surfaces[4].radius == -83.8f );
     }
 }
+
+TEST_CASE( "Lens archive reading", "[io]" ) {
+    const std::vector<std::string> files {
+        "data/lenses/tessar.len", "data/lenses/dgauss.len", "data/lenses/sonnar.len", "data/lenses/tessar2.len"
+    };
+
+    lore::io::LensReader reader;
+    lore::LensArchive archive;
+    std::vector<lore::LensSchema<float>> expected;
+    for (const std::string &path : files) {
+        std::ifstream schemaFile(path);
+        for (auto &schema : reader.read(schemaFile)) {
+            expected.push_back(std::move(schema));
+        }
+
+        std::ifstream archiveFile(path);
+        reader.read(archiveFile, archive);
+    }
+
+    REQUIRE( archive.size() == expected.size() );
+
+    SECTION( "Views match schemas" ) {
+        for (size_t i = 0; i < archive.size(); i++) {
+            const auto view = archive[i];
+            const auto &schema = expected[i];
+            REQUIRE( view.name() == schema.name );
+            REQUIRE( view.description() == schema.description );
+            REQUIRE( view.stopIndex() == schema.stopIndex );
+            REQUIRE( view.entranceBeamRadius() == schema.entranceBeamRadius );
+            REQUIRE( view.wavelengths().size() == schema.wavelengths.size() );
+            REQUIRE( view.surfaces().size() == schema.surfaces.size() );
+            for (size_t j = 0; j < schema.surfaces.size(); j++) {
+                REQUIRE( view.surfaces()[j].radius == schema.surfaces[j].radius );
+                REQUIRE( view.surfaces()[j].thickness == schema.surfaces[j].thickness );
+                REQUIRE( bool(view.surfaces()[j].checkAperture) == schema.surfaces[j].checkAperture );
+                REQUIRE( view.surface(int(j)).ior(0.5876f) == schema.surfaces[j].ior(0.5876f) );
+                REQUIRE( view.glassName(int(j)) == schema.surfaces[j].glassName );
+            }
+
+            const auto converted = view.schema();
+            REQUIRE( converted.name == schema.name );
+            REQUIRE( converted.surfaces.size() == schema.surfaces.size() );
+            REQUIRE( converted.surfaces.back().glassName == schema.surfaces.back().glassName );
+            REQUIRE( converted.wavelengths.back().weight == schema.wavelengths.back().weight );
+        }
+    }
+
+    SECTION( "Strings are interned" ) {
+        size_t numSurfaces = 0;
+        for (const auto &schema : expected) {
+            numSurfaces += schema.surfaces.size();
+        }
+        REQUIRE( archive.stringPool().size() < numSurfaces / 2 );
+        REQUIRE( archive.glassTable().size() < numSurfaces / 2 );
+
+        // every occurrence of a name refers to the same characters
+        const char *air = nullptr;
+        for (size_t i = 0; i < archive.size(); i++) {
+            for (int j = 0; j < int(archive[i].surfaces().size()); j++) {
+                if (archive[i].glassName(j) == "AIR") {
+                    if (!air) {
+                        air = archive[i].glassName(j).data();
+                    }
+                    REQUIRE( archive[i].glassName(j).data() == air );
+                }
+            }
+        }
+        REQUIRE( air != nullptr );
+    }
+
+    SECTION( "Failed lenses are discarded" ) {
+        std::istringstream broken("LEN NEW \"broken\" 1.0 3\nRD 10.0 NXT RD 1.0 TH");
+        REQUIRE_THROWS( reader.read(broken, archive) );
+        REQUIRE( archive.size() == expected.size() );
+        REQUIRE( archive[archive.size() - 1].surfaces().size() == expected.back().surfaces.size() );
+    }
+}
+
+TEST_CASE( "Lens reading diagnostics", "[io]" ) {
+    const lore::GlassCatalog catalog;
+    const lore::io::LensReader reader { catalog };
+    std::istringstream stream(
+        "LEN NEW \"diagnostics\" 1.0 2\n"
+        "AIR\n"
+        "TH 1.0 NXT\n"
+        "  GLA NOSUCHGLASS\n"
+        "RD 10.0 TH 2.0 FOO NXT\n"
+        "AIR RD -10.0\n"
+        "WV 0.5876\n"
+        "END 2\n"
+    );
+
+    std::vector<lore::io::ParseDiagnostic> diagnostics;
+    const auto lenses = reader.read(stream, &diagnostics);
+    REQUIRE( lenses.size() == 1 );
+    REQUIRE( lenses[0].surfaces[1].glassId == lore::GlassCatalog::Air );
+
+    REQUIRE( diagnostics.size() == 2 );
+    REQUIRE( diagnostics[0].severity == lore::io::ParseDiagnostic::ERROR );
+    REQUIRE( diagnostics[0].line == 4 );
+    REQUIRE( diagnostics[0].column == 7 );
+    REQUIRE( diagnostics[0].message.find("NOSUCHGLASS") != std::string::npos );
+    REQUIRE( diagnostics[1].severity == lore::io::ParseDiagnostic::WARNING );
+    REQUIRE( diagnostics[1].line == 5 );
+    REQUIRE( diagnostics[1].message.find("FOO") != std::string::npos );
+}
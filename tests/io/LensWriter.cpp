@@ -0,0 +1,264 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <lore/lore.h>
+#include <lore/io/BinaryLens.h>
+#include <lore/io/LensReader.h>
+#include <lore/io/LensWriter.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace lore;
+
+namespace {
+
+std::vector<LensSchema<float>> readShippedLenses(const GlassCatalog &catalog) {
+    io::LensReader reader { catalog };
+    std::vector<LensSchema<float>> result;
+    for (const char *name : { "tessar", "dgauss", "sonnar", "fisheye", "canon-zoom-long" }) {
+        std::ifstream file(std::string("data/lenses/") + name + ".len");
+        for (auto &lens : reader.read(file)) {
+            result.push_back(std::move(lens));
+        }
+    }
+    return result;
+}
+
+void requireEqual(const LensSchema<float> &actual, const LensSchema<float> &expected) {
+    REQUIRE( actual.name == expected.name );
+    REQUIRE( actual.description == expected.description );
+    REQUIRE( actual.fieldAngle == expected.fieldAngle );
+    REQUIRE( actual.entranceBeamRadius == expected.entranceBeamRadius );
+    REQUIRE( actual.stopIndex == expected.stopIndex );
+
+    REQUIRE( actual.wavelengths.size() == expected.wavelengths.size() );
+    for (size_t i = 0; i < expected.wavelengths.size(); i++) {
+        REQUIRE( actual.wavelengths[i].wavelength == expected.wavelengths[i].wavelength );
+        REQUIRE( actual.wavelengths[i].weight == expected.wavelengths[i].weight );
+    }
+
+    REQUIRE( actual.surfaces.size() == expected.surfaces.size() );
+    for (size_t i = 0; i < expected.surfaces.size(); i++) {
+        REQUIRE( actual.surfaces[i].radius == expected.surfaces[i].radius );
+        REQUIRE( actual.surfaces[i].thickness == expected.surfaces[i].thickness );
+        REQUIRE( actual.surfaces[i].aperture == expected.surfaces[i].aperture );
+        REQUIRE( actual.surfaces[i].checkAperture == expected.surfaces[i].checkAperture );
+        REQUIRE( actual.surfaces[i].glassName == expected.surfaces[i].glassName );
+        REQUIRE( actual.surfaces[i].glassId == expected.surfaces[i].glassId );
+        REQUIRE( actual.surfaces[i].ior(0.5876f) == expected.surfaces[i].ior(0.5876f) );
+    }
+}
+
+std::vector<std::byte> toBytes(const std::string &string) {
+    std::vector<std::byte> result(string.size());
+    std::memcpy(result.data(), string.data(), string.size());
+    return result;
+}
+
+}
+
+TEST_CASE( "Lens writing", "[io]" ) {
+    GlassCatalog catalog;
+    catalog.read("data/glass/obsolete001.glc");
+    const std::vector<LensSchema<float>> lenses = readShippedLenses(catalog);
+    REQUIRE( lenses.size() == 5 );
+
+    const io::LensWriter writer;
+
+    SECTION( "Text round trip" ) {
+        std::stringstream stream;
+        writer.write(stream, lenses);
+
+        const auto reread = io::LensReader(catalog).read(stream);
+        REQUIRE( reread.size() == lenses.size() );
+        for (size_t i = 0; i < lenses.size(); i++) {
+            requireEqual(reread[i], lenses[i]);
+        }
+    }
+
+    SECTION( "Binary round trip" ) {
+        std::ostringstream stream;
+        writer.writeBinary(stream, lenses);
+
+        const io::BinaryLensFile file = io::BinaryLensFile::fromBuffer(toBytes(stream.str()));
+        REQUIRE( file.size() == lenses.size() );
+        const auto reread = file.schemas(&catalog);
+        for (size_t i = 0; i < lenses.size(); i++) {
+            requireEqual(reread[i], lenses[i]);
+        }
+
+        const auto view = file[0];
+        REQUIRE( view.name() == lenses[0].name );
+        REQUIRE( view.glassName(1) == lenses[0].surfaces[1].glassName );
+        REQUIRE( view.lens<double>().surfaces[4].radius == double(lenses[0].surfaces[4].radius) );
+    }
+
+    SECTION( "Memory mapped files" ) {
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / "lore-test-lenses.lbin";
+        {
+            std::ofstream output(path, std::ios::binary);
+            writer.writeBinary(output, lenses);
+        }
+
+        {
+            const io::BinaryLensFile file = io::BinaryLensFile::open(path.string());
+            REQUIRE( file.size() == lenses.size() );
+            requireEqual(file[2].schema(&catalog), lenses[2]);
+        }
+        std::filesystem::remove(path);
+    }
+
+    SECTION( "Corrupt files are rejected" ) {
+        std::ostringstream stream;
+        writer.writeBinary(stream, lenses);
+        const std::string bytes = stream.str();
+
+        REQUIRE_THROWS_AS( io::BinaryLensFile::fromBuffer(toBytes(bytes.substr(0, 40))), io::BinaryLensException );
+        REQUIRE_THROWS_AS(
+            io::BinaryLensFile::fromBuffer(toBytes(bytes.substr(0, bytes.size() / 2))),
+            io::BinaryLensException
+        );
+
+        std::string wrongMagic = bytes;
+        wrongMagic[0] = 'X';
+        REQUIRE_THROWS_AS( io::BinaryLensFile::fromBuffer(toBytes(wrongMagic)), io::BinaryLensException );
+
+        std::string wrongVersion = bytes;
+        wrongVersion[8] = 99;
+        REQUIRE_THROWS_AS( io::BinaryLensFile::fromBuffer(toBytes(wrongVersion)), io::BinaryLensException );
+
+        io::binary::Header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        for (const int32_t stopIndex : { -1, int32_t(lenses[0].surfaces.size()) }) {
+            std::string wrongStop = bytes;
+            std::memcpy(&wrongStop[header.lensOffset + offsetof(io::binary::LensRecord, stopIndex)],
+                &stopIndex, sizeof(stopIndex));
+            REQUIRE_THROWS_AS( io::BinaryLensFile::fromBuffer(toBytes(wrongStop)), io::BinaryLensException );
+        }
+    }
+
+    SECTION( "Non-finite dimensions are rejected" ) {
+        LensSchema<float> lens = lenses[0];
+        lens.surfaces[2].radius = std::numeric_limits<float>::infinity();
+        std::ostringstream stream;
+        REQUIRE_THROWS_AS( writer.write(stream, lens), std::invalid_argument );
+
+        lens = lenses[0];
+        lens.surfaces[3].thickness = std::numeric_limits<float>::quiet_NaN();
+        REQUIRE_THROWS_AS( writer.write(stream, lens), std::invalid_argument );
+        REQUIRE_THROWS_AS( writer.writeBinary(stream, { lens }), std::invalid_argument );
+    }
+
+    SECTION( "Lenses the binary reader rejects are not written" ) {
+        // cut down to its first surface, the Tessar keeps a stop index behind it
+        LensSchema<float> lens = lenses[0];
+        lens.surfaces.resize(1);
+        std::ostringstream stream;
+        REQUIRE_THROWS_AS( writer.writeBinary(stream, { lenses[1], lens }), std::invalid_argument );
+        REQUIRE( stream.str().empty() );
+
+        lens = lenses[0];
+        lens.stopIndex = -1;
+        REQUIRE_THROWS_AS( writer.writeBinary(stream, { lens }), std::invalid_argument );
+
+        lens.surfaces.clear();
+        lens.stopIndex = 0;
+        REQUIRE_THROWS_AS( writer.writeBinary(stream, { lens }), std::invalid_argument );
+        REQUIRE( stream.str().empty() );
+    }
+}
+
+TEST_CASE( "Lens bundles", "[io]" ) {
+    GlassCatalog catalog;
+    catalog.read("data/glass/obsolete001.glc");
+    const io::LensReader reader { catalog };
+
+    // sources are appended out of order to check that the index is sorted
+    LensArchive bundle;
+    size_t numLenses = 0;
+    for (const char *name : { "tessar", "dgauss", "canon-zoom-long" }) {
+        LensArchive archive;
+        std::ifstream file(std::string("data/lenses/") + name + ".len");
+        reader.read(file, archive);
+        numLenses += archive.size();
+        bundle.append(archive, std::string("lenses/") + name + ".len");
+    }
+    REQUIRE( bundle.size() == numLenses );
+    REQUIRE( bundle.sourceTable().size() == 3 );
+    REQUIRE( bundle[0].name() == "F/2.8 20deg TESSAR USP2724992" );
+
+    std::ostringstream stream;
+    io::LensWriter().writeBinary(stream, bundle);
+    const io::BinaryLensFile file = io::BinaryLensFile::fromBuffer(toBytes(stream.str()));
+    REQUIRE( file.size() == numLenses );
+    REQUIRE( file.numSources() == 3 );
+    REQUIRE( file.sourceName(0) == "lenses/canon-zoom-long.len" );
+    REQUIRE( file.sourceName(2) == "lenses/tessar.len" );
+
+    for (size_t i = 0; i < bundle.sourceTable().size(); i++) {
+        const LensArchive::Source &source = bundle.sourceTable()[i];
+        const auto range = file.find(bundle.stringPool()[source.name]);
+        REQUIRE( range );
+        REQUIRE( range->first == source.firstLens );
+        REQUIRE( range->count == source.numLenses );
+        for (size_t j = 0; j < range->count; j++) {
+            REQUIRE( file[range->first + j].name() == bundle[source.firstLens + j].name() );
+            REQUIRE( file[range->first + j].surfaces().size() == bundle[source.firstLens + j].surfaces().size() );
+        }
+    }
+    REQUIRE_FALSE( file.find("lenses/missing.len") );
+    REQUIRE_FALSE( file.find("lenses/a.len") );
+}
+
+TEST_CASE( "Bundles of invalid designs", "[io]" ) {
+    GlassCatalog catalog;
+    catalog.read("data/glass/obsolete001.glc");
+    const io::LensReader reader { catalog };
+
+    // what lore-ingest --keep-invalid bundles: the parser accepts a single surface, leaving the stop behind it
+    LensArchive archive;
+    std::ifstream file("data/lenses/tessar.len");
+    reader.read(file, archive);
+    std::istringstream single(
+        "LEN NEW \"Single\" 0 0\n"
+        "EBR 10.0\n"
+        "AIR\n"
+        "TH 1.0e+20\n"
+        "AP 1.0e+19\n"
+        "WV 0.58756\n"
+        "END 0\n"
+    );
+    reader.read(single, archive);
+    REQUIRE( archive.size() == 2 );
+    REQUIRE( archive[1].surfaces().size() == 1 );
+    REQUIRE_FALSE( io::LensWriter::canWriteBinary(archive[1]) );
+
+    LensArchive bundle;
+    bundle.append(archive, "lenses/invalid.len", io::LensWriter::canWriteBinary);
+    REQUIRE( bundle.size() == 1 );
+    REQUIRE( bundle.sourceTable()[0].numLenses == 1 );
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "lore-test-invalid.lbin";
+    {
+        std::ofstream output(path, std::ios::binary);
+        io::LensWriter().writeBinary(output, bundle);
+    }
+    {
+        const io::BinaryLensFile reopened = io::BinaryLensFile::open(path.string());
+        REQUIRE( reopened.size() == 1 );
+        REQUIRE( reopened[0].name() == archive[0].name() );
+        REQUIRE( reopened.find("lenses/invalid.len") );
+    }
+    std::filesystem::remove(path);
+
+    std::ostringstream stream;
+    REQUIRE_THROWS_AS( io::LensWriter().writeBinary(stream, archive), std::invalid_argument );
+}
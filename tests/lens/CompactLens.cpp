@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/lens/CompactLens.h>
+#include <lore/rt/CompactTrace.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+
+
+using namespace lore;
+
+TEST_CASE( "Compact lens", "[lens]" ) {
+    using Float = float;
+
+    const auto schema = fixtures::readTessar();
+    const Lens<Float> lens = schema.lens<Float>();
+
+    SECTION( "Conversion round trip" ) {
+        const CompactLens<Float> compact { lens, 0.5876f };
+        REQUIRE( compact.size() == int(lens.surfaces.size()) );
+        REQUIRE( compact.hotBytes() < lens.surfaces.size() * sizeof(Surface<Float>) / 2 );
+
+        const Lens<Float> restored = compact.lens();
+        REQUIRE( restored.surfaces.size() == lens.surfaces.size() );
+        for (size_t i = 0; i < lens.surfaces.size(); i++) {
+            REQUIRE( restored.surfaces[i].radius == lens.surfaces[i].radius );
+            REQUIRE( restored.surfaces[i].thickness == lens.surfaces[i].thickness );
+            REQUIRE( restored.surfaces[i].aperture == lens.surfaces[i].aperture );
+            REQUIRE( restored.surfaces[i].checkAperture == lens.surfaces[i].checkAperture );
+            REQUIRE( restored.surfaces[i].ior(0.5876f) == lens.surfaces[i].ior(0.5876f) );
+        }
+    }
+
+    SECTION( "Traces like SequentialTrace" ) {
+        const rt::GeometricalIntersector<Float> intersector {};
+        const rt::RayGenerator<Float> generator { schema };
+        CompactLens<Float> compact { lens, 0.5876f };
+
+        for (const Float wavelength : { 0.5876f, 0.4861f }) {
+            compact.setWavelength(wavelength);
+            const rt::SequentialTrace<Float, rt::GeometricalIntersector<Float>> reference { lens, intersector, wavelength };
+            const rt::CompactTrace<Float> trace { compact };
+
+            int numValid = 0;
+            for (const Float field : { 0.f, 0.7f, 1.f, 1.5f }) {
+                for (int i = -10; i <= 10; i++) {
+                    rt::Ray<Float> expected = generator(field, 0.3f, i / 8.f);
+                    rt::Ray<Float> actual = expected;
+                    const bool valid = reference(expected);
+                    REQUIRE( trace(actual) == valid );
+                    if (valid) {
+                        numValid++;
+                        REQUIRE( actual.origin.x() == expected.origin.x() );
+                        REQUIRE( actual.origin.y() == expected.origin.y() );
+                        REQUIRE( actual.direction.y() == expected.direction.y() );
+                    }
+                }
+            }
+            REQUIRE( numValid > 0 );
+            REQUIRE( numValid < 4 * 21 );
+        }
+    }
+}
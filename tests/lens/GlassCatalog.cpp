@@ -1,9 +1,20 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 
 #include <lore/lore.h>
+#include <lore/io/BinaryLens.h>
+#include <lore/io/LensReader.h>
+#include <lore/io/LensWriter.h>
 #include <lore/lens/GlassCatalog.h>
 
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
 using namespace lore;
 using namespace Catch::Matchers;
 
@@ -22,3 +33,90 @@ TEST_CASE( "Reading glass catalogs", "[autodiff]" ) {
         REQUIRE_THAT( catalog.glass("H_BACD6").ior(0.58f), WithinAbs(1.61395f, 1e-5) );
     }
 }
+
+TEST_CASE( "Glass identifiers", "[lens]" ) {
+    GlassCatalog catalog;
+    REQUIRE( catalog.size() == 1 );
+    REQUIRE( catalog.name(GlassCatalog::Air) == "AIR" );
+    REQUIRE( catalog.glass(GlassCatalog::Air).isAir() );
+
+    std::ifstream file { "data/glass/schott.glc" };
+    REQUIRE( catalog.read(file) == 141 );
+    REQUIRE( catalog.size() == 142 );
+
+    const GlassId bk7 = catalog.id("N-BK7");
+    REQUIRE( bk7 != GlassCatalog::Air );
+    REQUIRE( catalog.name(bk7) == "N-BK7" );
+    REQUIRE( catalog.glass(bk7).ior(0.38f) == catalog.glass("N-BK7").ior(0.38f) );
+    REQUIRE( catalog.byCatalog.begin()->second.size() == 141 );
+
+    SECTION( "Unknown glasses" ) {
+        REQUIRE( !catalog.find("UNOBTAINIUM").has_value() );
+        REQUIRE( catalog.id("UNOBTAINIUM") == GlassCatalog::Air );
+    }
+
+    SECTION( "Identifiers survive re-reading" ) {
+        std::ifstream again { "data/glass/schott.glc" };
+        catalog.read(again);
+        REQUIRE( catalog.size() == 142 );
+        REQUIRE( catalog.id("N-BK7") == bk7 );
+    }
+}
+
+TEST_CASE( "Glass substitution", "[lens]" ) {
+    GlassCatalog catalog;
+    catalog.read("data/glass/obsolete001.glc");
+    io::LensReader reader { catalog };
+    std::ifstream file("data/lenses/tessar.len");
+    auto schema = reader.read(file).front();
+
+    const Lens<float> original = schema.lens<float>();
+    const Lens<float> resolved = schema.lens<float>(catalog);
+    for (size_t i = 0; i < original.surfaces.size(); i++) {
+        REQUIRE( catalog.name(schema.surfaces[i].glassId) == (schema.surfaces[i].glassName.empty() ? "AIR" : schema.surfaces[i].glassName) );
+        REQUIRE( resolved.surfaces[i].ior(0.5876f) == original.surfaces[i].ior(0.5876f) );
+    }
+
+    const GlassId substitute = catalog.id("H_BACD6");
+    schema.surfaces[1].setGlass(catalog, substitute);
+    const Lens<float> substituted = schema.lens<float>(catalog);
+    REQUIRE( substituted.surfaces[1].ior(0.5876f) == catalog.glass(substitute).ior(0.5876f) );
+    REQUIRE( substituted.surfaces[1].ior(0.5876f) != original.surfaces[1].ior(0.5876f) );
+    REQUIRE( substituted.surfaces[2].ior(0.5876f) == original.surfaces[2].ior(0.5876f) );
+    REQUIRE( schema.lens<float>().surfaces[1].ior(0.5876f) == substituted.surfaces[1].ior(0.5876f) );
+
+    SECTION( "Substitutions are written" ) {
+        const io::LensWriter writer;
+        std::stringstream text;
+        writer.write(text, schema);
+        const auto reread = reader.read(text).front();
+        REQUIRE( reread.surfaces[1].glassName == "H_BACD6" );
+        REQUIRE( reread.surfaces[1].glassId == substitute );
+        REQUIRE( reread.lens<float>().surfaces[1].ior(0.5876f) == substituted.surfaces[1].ior(0.5876f) );
+
+        std::ostringstream binary;
+        writer.writeBinary(binary, std::vector<LensSchema<float>> { schema });
+        const std::string bytes = binary.str();
+        std::vector<std::byte> buffer(bytes.size());
+        std::memcpy(buffer.data(), bytes.data(), bytes.size());
+        const auto file = io::BinaryLensFile::fromBuffer(std::move(buffer));
+        const auto decoded = file[0].schema(&catalog);
+        REQUIRE( decoded.surfaces[1].glassId == substitute );
+        REQUIRE( decoded.lens<float>().surfaces[1].ior(0.5876f) == substituted.surfaces[1].ior(0.5876f) );
+    }
+}
+
+TEST_CASE( "Glass lookup performance", "[.][benchmark]" ) {
+    GlassCatalog catalog;
+    catalog.read("data/glass/obsolete001.glc");
+
+    const std::string name = "H_BACD6";
+    const GlassId substitute = catalog.id(name);
+    BENCHMARK( "Glass lookup by name" ) {
+        return catalog.glass(name);
+    };
+
+    BENCHMARK( "Glass lookup by id" ) {
+        return catalog.glass(substitute);
+    };
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <lore/logging.h>
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace lore;
+
+TEST_CASE( "Asynchronous logging", "[logging]" ) {
+    std::ostringstream output;
+    std::ostringstream error;
+
+    {
+        AsyncLogger logger { output, error };
+
+        const int numThreads = 4;
+        const int numMessages = 500;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; t++) {
+            threads.emplace_back([&logger, t]() {
+                for (int i = 0; i < numMessages; i++) {
+                    logger.log(Logger::LOG_INFO) << "thread " << t << " message " << i << std::flush;
+                }
+                logger.log(Logger::LOG_WARNING) << "thread " << t << " done" << std::flush;
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        logger.flush();
+
+        std::istringstream lines(output.str());
+        std::set<std::string> messages;
+        std::string line;
+        while (std::getline(lines, line)) {
+            messages.insert(line);
+        }
+        REQUIRE( messages.size() == numThreads * numMessages );
+        REQUIRE( messages.count("[I] thread 0 message 0") == 1 );
+        REQUIRE( messages.count("[I] thread 3 message 499") == 1 );
+
+        logger.log(Logger::LOG_ERROR) << "pending" << std::flush;
+    }
+
+    // destroying the logger writes all pending messages
+    const std::string errors = error.str();
+    REQUIRE( errors.find("[W] thread 2 done\n") != std::string::npos );
+    REQUIRE( errors.find("[E] pending\n") != std::string::npos );
+}
+
+TEST_CASE( "Synchronous logging", "[logging]" ) {
+    REQUIRE( dynamic_cast<ConsoleLogger *>(Logger::shared.get()) );
+
+    std::ostringstream output;
+    std::ostringstream error;
+    ConsoleLogger logger { output, error };
+
+    const int numThreads = 4;
+    const int numMessages = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&logger, t]() {
+            for (int i = 0; i < numMessages; i++) {
+                logger.log(Logger::LOG_INFO) << "thread " << t << " message " << i << std::flush;
+            }
+            logger.log(Logger::LOG_WARNING) << "thread " << t << " done" << std::flush;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // messages are written by the time their stream is flushed
+    std::istringstream lines(output.str());
+    std::set<std::string> messages;
+    std::string line;
+    while (std::getline(lines, line)) {
+        messages.insert(line);
+    }
+    REQUIRE( messages.size() == numThreads * numMessages );
+    REQUIRE( messages.count("[I] thread 1 message 250") == 1 );
+    REQUIRE( error.str().find("[W] thread 3 done\n") != std::string::npos );
+}
+
+TEST_CASE( "Compile-time log levels", "[logging]" ) {
+    REQUIRE( std::is_same<LogStream<Logger::LOG_ERROR>, std::ostream &>::value );
+    REQUIRE( std::is_same<LogStream<Logger::LOG_DEBUG>, std::ostream &>::value == (LORE_LOG_LEVEL <= 0) );
+
+    const NullStream discard;
+    discard << "ignored " << 42 << std::flush;
+}
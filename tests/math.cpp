@@ -1,10 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 
 #include <lore/lore.h>
 #include <lore/lens/Surface.h>
 #include <lore/rt/GeometricalIntersector.h>
 
+#include <vector>
+
 using namespace lore;
 using namespace Catch::Matchers;
 
@@ -33,6 +36,19 @@ TEST_CASE( "Vector math", "[math]" ) {
         REQUIRE( b.y() == 0.f );
         REQUIRE( b.z() == 0.8f );
     }
+
+    SECTION( "SIMD layout" ) {
+        REQUIRE( Vector3<float>::Width == 4 );
+        REQUIRE( alignof(Vector3<float>) == 16 );
+        REQUIRE( alignof(Vector3<double>) == 32 );
+        REQUIRE( lore::Vector<double, 30>::Width == 32 );
+        REQUIRE( lore::Vector<double, 2>::Width == 2 );
+
+        Vector3<float> a { 1, 2, 3 };
+        a = -(a * 2.f + Vector3<float>(1.f)) / 2.f;
+        REQUIRE( a.el[3] == 0 );
+        REQUIRE( a == Vector3<float> { -1.5f, -2.5f, -3.5f } );
+    }
 }
 
 TEST_CASE( "Matrix math", "[math]" ) {
@@ -52,3 +68,50 @@ TEST_CASE( "Matrix math", "[math]" ) {
         REQUIRE( a * b == expected );
     }
 }
+
+template<typename Float>
+static std::vector<Vector3<Float>> benchmarkDirections(int count) {
+    std::vector<Vector3<Float>> result;
+    for (int i = 0; i < count; i++) {
+        result.push_back(Vector3<Float> { Float(0.01 * (i % 17)), Float(-0.02 * (i % 11)), Float(1) }.normalized());
+    }
+    return result;
+}
+
+template<typename Float>
+static void benchmarkVectorMath(const std::string &type) {
+    const auto directions = benchmarkDirections<Float>(1024);
+    const Vector3<Float> normal = Vector3<Float> { Float(0.1), Float(0.2), Float(-1) }.normalized();
+
+    BENCHMARK( "dot<" + type + ">" ) {
+        Float sum = 0;
+        for (const auto &d : directions) {
+            sum += d.dot(normal);
+        }
+        return sum;
+    };
+
+    BENCHMARK( "normalized<" + type + ">" ) {
+        Vector3<Float> sum;
+        for (const auto &d : directions) {
+            sum += (d + normal).normalized();
+        }
+        return sum;
+    };
+
+    BENCHMARK( "refract<" + type + ">" ) {
+        Vector3<Float> sum;
+        Vector3<Float> result;
+        for (const auto &d : directions) {
+            if (refract(d, normal, result, Float(1) / Float(1.5))) {
+                sum += result;
+            }
+        }
+        return sum;
+    };
+}
+
+TEST_CASE( "Vector math performance", "[.][benchmark]" ) {
+    benchmarkVectorMath<float>("float");
+    benchmarkVectorMath<double>("double");
+}
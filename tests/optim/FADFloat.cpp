@@ -1,8 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 
 #include <lore/lore.h>
 #include <lore/optim/FADFloat.h>
 
+#include <cmath>
+#include <string>
+#include <vector>
+
 using namespace lore;
 using namespace lore::optim;
 
@@ -80,3 +85,147 @@ TEST_CASE( "Autodiff functions", "[autodiff]" ) {
     REQUIRE( result.V == 55 );
     REQUIRE( result.dVd(0) == 5 );
 }
+
+TEST_CASE( "Autodiff expressions", "[autodiff]" ) {
+    using Float = FADFloat<double, 2>;
+
+    SECTION( "Scalar operands" ) {
+        Float x { 3, { 1, 0 } };
+        Float y = 2 * x + 1;
+        Float z = 1 / (x - 1) - x / 4;
+        REQUIRE( y.V == 7 );
+        REQUIRE( y.dVd(0) == 2 );
+        REQUIRE( z.V == 0.5 - 0.75 );
+        REQUIRE( z.dVd(0) == -0.25 - 0.25 );
+        REQUIRE( (x > 2) );
+        REQUIRE( (1 < x * x) );
+    }
+
+    SECTION( "Aliasing" ) {
+        Float x { 3, { 1, 0 } };
+        Float y { 2, { 0, 1 } };
+        x = x * x + y;
+        REQUIRE( x.V == 11 );
+        REQUIRE( x.dVd(0) == 6 );
+        REQUIRE( x.dVd(1) == 1 );
+
+        x /= x;
+        REQUIRE( x.V == 1 );
+        REQUIRE( x.dVd(0) == 0 );
+        REQUIRE( x.dVd(1) == 0 );
+    }
+
+    SECTION( "Compound assignment" ) {
+        Float x { 2, { 1, 0 } };
+        Float y { 5, { 0, 1 } };
+        x *= y - 1;
+        x += y * 2;
+        x -= 3;
+        REQUIRE( x.V == 15 );
+        REQUIRE( x.dVd(0) == 4 );
+        REQUIRE( x.dVd(1) == 4 );
+    }
+
+    SECTION( "Elementary functions of expressions" ) {
+        Float x { 3, { 1, 0 } };
+        Float y { 4, { 0, 1 } };
+        Float r = sqrt(sqr(x) + sqr(y));
+        REQUIRE( r.V == 5 );
+        REQUIRE( std::abs(r.dVd(0) - 0.6) < 1e-12 );
+        REQUIRE( std::abs(r.dVd(1) - 0.8) < 1e-12 );
+        REQUIRE( detach(x * y) == 12 );
+    }
+}
+
+TEST_CASE( "Nested autodiff", "[autodiff]" ) {
+    using Inner = FADFloat<double, 2>;
+    using Float = FADFloat<Inner, 2>;
+
+    // f(x, y) = x^2 y + sqrt(x y) at (2, 8)
+    Float x = 2;
+    x.V.dVd(0) = 1;
+    x.dVd(0) = 1;
+    Float y = 8;
+    y.V.dVd(1) = 1;
+    y.dVd(1) = 1;
+
+    const Float f = sqr(x) * y + sqrt(x * y);
+    REQUIRE( detach(f) == 36 );
+
+    // gradient in either lane
+    REQUIRE( f.V.dVd(0) == 33 );
+    REQUIRE( f.dVd(0).V == 33 );
+    REQUIRE( f.V.dVd(1) == 4.25 );
+    REQUIRE( f.dVd(1).V == 4.25 );
+
+    // Hessian
+    REQUIRE( std::abs(f.dVd(0).dVd(0) - (16 - 0.25)) < 1e-12 );
+    REQUIRE( std::abs(f.dVd(0).dVd(1) - (4 + 0.0625)) < 1e-12 );
+    REQUIRE( std::abs(f.dVd(1).dVd(0) - (4 + 0.0625)) < 1e-12 );
+    REQUIRE( std::abs(f.dVd(1).dVd(1) - -0.015625) < 1e-12 );
+
+    // copysign keeps first and second derivatives
+    const Float g = copysign(sqr(x), Float(-1));
+    REQUIRE( detach(g) == -4 );
+    REQUIRE( g.dVd(0).V == -4 );
+    REQUIRE( g.dVd(0).dVd(0) == -2 );
+}
+
+template<int N>
+static void benchmarkAutodiff() {
+    using Float = FADFloat<double, N>;
+
+    std::vector<Float> values;
+    for (int i = 0; i < 256; i++) {
+        Float value { 1 + 0.01 * i };
+        value.dVd(i % N) = 1;
+        values.push_back(value);
+    }
+
+    BENCHMARK( "FADFloat<double, " + std::to_string(N) + "> operator*" ) {
+        Float product { 1 };
+        for (const auto &value : values) {
+            product = product * value;
+        }
+        return product;
+    };
+
+    BENCHMARK( "FADFloat<double, " + std::to_string(N) + "> operator/" ) {
+        Float quotient { 1 };
+        for (const auto &value : values) {
+            quotient = quotient / value;
+        }
+        return quotient;
+    };
+}
+
+template<int N>
+static void benchmarkAutodiffExpressions() {
+    using Float = FADFloat<double, N>;
+
+    std::vector<Float> values;
+    for (int i = 0; i < 256; i++) {
+        Float value { 1 + 0.01 * i };
+        value.dVd(i % N) = 1;
+        values.push_back(value);
+    }
+
+    BENCHMARK( "FADFloat<double, " + std::to_string(N) + "> intersection expression" ) {
+        Float sum { 0 };
+        for (size_t i = 2; i < values.size(); i++) {
+            const Float &a = values[i - 2];
+            const Float &b = values[i - 1];
+            const Float &rad = values[i];
+            const Float disc = a * a - b * rad;
+            const Float t = b / (a + rad) - disc * Float(0.5);
+            sum += t * t;
+        }
+        return sum;
+    };
+}
+
+TEST_CASE( "Autodiff performance", "[.][benchmark]" ) {
+    benchmarkAutodiffExpressions<30>();
+    benchmarkAutodiff<4>();
+    benchmarkAutodiff<30>();
+}
@@ -0,0 +1,172 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/analysis/Paraxial.h>
+#include <lore/optim/FADFloat.h>
+#include <lore/optim/MeritFunction.h>
+#include <lore/optim/SparseFADFloat.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+static LensSchema<float> readSimpleLens() {
+    fixtures::loadGlasses("data/glass/obsolete001.glc");
+    return fixtures::readLens("data/lenses/simple.len");
+}
+
+TEST_CASE( "Merit function compilation", "[optim]" ) {
+    const auto schema = readSimpleLens();
+
+    SECTION( "Rays are shared between operands" ) {
+        optim::MeritFunction spotOnly;
+        spotOnly.add(optim::Operand::spotRms(0.7, 0, 5));
+        const auto reference = spotOnly.compile(schema);
+
+        optim::MeritFunction mf;
+        mf.add(optim::Operand::spotRms(0.7, 0, 5));
+        mf.add(optim::Operand::spotRms(0.7, 0, 5));
+        mf.add(optim::Operand::distortion(0.7));
+        const auto program = mf.compile(schema);
+
+        REQUIRE( program.instructions.size() == 3 );
+        REQUIRE( program.rays.size() == reference.rays.size() );
+    }
+
+    SECTION( "Rays are grouped by wavelength" ) {
+        optim::MeritFunction mf;
+        mf.add(optim::Operand::spotRms(1, 2, 3));
+        mf.add(optim::Operand::spotRms(0, 0, 3));
+        mf.add(optim::Operand::spotRms(1, 1, 3));
+        const auto program = mf.compile(schema);
+
+        for (size_t i = 1; i < program.rays.size(); i++) {
+            REQUIRE( program.rays[i - 1].wavelength <= program.rays[i].wavelength );
+        }
+    }
+
+    SECTION( "Invalid operands are rejected" ) {
+        optim::MeritFunction mf;
+        mf.add(optim::Operand::efl(50, 7));
+        REQUIRE_THROWS_AS( mf.compile(schema), std::invalid_argument );
+    }
+}
+
+TEST_CASE( "Merit function evaluation", "[optim]" ) {
+    const auto schema = readSimpleLens();
+
+    optim::MeritFunction mf;
+    mf.add(optim::Operand::efl(60));
+    mf.add(optim::Operand::spotRms(0, 0, 9));
+    mf.add(optim::Operand::spotRms(0.7, 1, 9));
+    mf.add(optim::Operand::distortion(1));
+    mf.add(optim::Operand::edgeThickness(1, 100));
+    const auto program = mf.compile(schema);
+
+    SECTION( "Double precision" ) {
+        const auto lens = schema.lens<double>();
+        const auto result = program.evaluate(lens);
+        const auto serial = program.evaluate(lens, false);
+
+        // the rim of the off-axis pupil is vignetted by the checked aperture of the first surface
+        REQUIRE( result.failedRays < int(program.rays.size()) / 10 );
+        REQUIRE_THAT( result.values[0], WithinRel(ParaxialAnalysis<double>(lens, schema.primaryWavelength()).efl, 1e-9) );
+        REQUIRE( result.values[1] > 0 );
+        REQUIRE( result.values[2] > 0 );
+        REQUIRE( std::abs(result.values[3]) < 0.1 );
+
+        // R1 = 50, R2 = -100, aperture 20 and center thickness 8
+        const double edge = 8 - (50 - std::sqrt(50.0 * 50 - 400)) + (-100 + std::sqrt(100.0 * 100 - 400));
+        REQUIRE_THAT( result.values[4], WithinRel(edge, 1e-9) );
+
+        double merit = 0;
+        merit += (result.values[0] - 60) * (result.values[0] - 60);
+        merit += result.values[1] * result.values[1];
+        merit += result.values[2] * result.values[2];
+        merit += result.values[3] * result.values[3];
+        merit += (result.values[4] - 100) * (result.values[4] - 100);
+        REQUIRE_THAT( result.merit, WithinRel(merit, 1e-9) );
+
+        for (size_t i = 0; i < result.values.size(); i++) {
+            REQUIRE( result.values[i] == serial.values[i] );
+        }
+    }
+
+    SECTION( "Single precision" ) {
+        const auto reference = program.evaluate(schema.lens<double>());
+        const auto result = program.evaluate(schema.lens<float>());
+        for (size_t i = 0; i < result.values.size(); i++) {
+            REQUIRE_THAT( result.values[i], WithinAbs(reference.values[i], 1e-3) );
+        }
+    }
+
+    SECTION( "Forward derivatives" ) {
+        using Float = optim::FADFloat<double, 1>;
+
+        auto lens = schema.lens<Float>();
+        lens.surfaces[1].radius.dVd(0) = 1;
+        const auto result = program.evaluate(lens);
+
+        const double h = 1e-4;
+        auto lensPlus = schema.lens<double>();
+        auto lensMinus = schema.lens<double>();
+        lensPlus.surfaces[1].radius += h;
+        lensMinus.surfaces[1].radius -= h;
+        const auto plus = program.evaluate(lensPlus);
+        const auto minus = program.evaluate(lensMinus);
+
+        for (size_t i = 0; i < result.values.size(); i++) {
+            const double derivative = (plus.values[i] - minus.values[i]) / (2 * h);
+            REQUIRE_THAT( result.values[i].dVd(0), WithinAbs(derivative, 1e-5 * (1 + std::abs(derivative))) );
+        }
+    }
+
+    SECTION( "Sparse derivatives with default arguments" ) {
+        using Float = optim::SparseFADFloat<double>;
+        const optim::SparseFADScope<double> scope;
+
+        auto lens = schema.lens<Float>();
+        lens.surfaces[1].radius = Float::variable(lens.surfaces[1].radius.V, 0);
+        const auto result = program.evaluate(lens);
+
+        auto dense = schema.lens<optim::FADFloat<double, 1>>();
+        dense.surfaces[1].radius.dVd(0) = 1;
+        const auto reference = program.evaluate(dense);
+
+        REQUIRE( optim::SparseFADArena<double>::local().allocated() > 0 );
+        for (size_t i = 0; i < result.values.size(); i++) {
+            REQUIRE_THAT( result.values[i].V, WithinRel(reference.values[i].V, 1e-12) );
+            REQUIRE_THAT( result.values[i].dVd(0), WithinAbs(reference.values[i].dVd(0), 1e-9) );
+        }
+    }
+}
+
+TEST_CASE( "Chief rays pass the center of the stop", "[optim]" ) {
+    // the stop of the Tessar lies between its second and third element
+    const auto schema = fixtures::readTessar();
+    const auto lens = schema.lens<double>();
+    const rt::RayGenerator<double> generator { schema };
+    REQUIRE( generator.entrancePupilPosition > 0 );
+
+    const rt::GeometricalIntersector<double> intersector {};
+    const rt::SequentialTrace<double, rt::GeometricalIntersector<double>> toStop {
+        lens, intersector, double(schema.primaryWavelength()), 1, schema.stopIndex
+    };
+    for (const double field : { 0.1, 0.5, 1.0 }) {
+        rt::Ray<double> chief = generator(field, 0, 0);
+        REQUIRE( toStop(chief) );
+        INFO( "field " << field << ", height " << chief.origin.y() );
+        REQUIRE( std::abs(chief.origin.y()) < 0.02 * lens.surfaces[schema.stopIndex].aperture );
+    }
+
+    // the Tessar is well corrected for distortion
+    optim::MeritFunction mf;
+    mf.add(optim::Operand::distortion(1));
+    const auto result = mf.compile(schema).evaluate(lens);
+    REQUIRE( std::abs(result.values[0]) < 0.01 );
+}
@@ -0,0 +1,108 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <lore/lore.h>
+#include <lore/optim/FADFloat.h>
+#include <lore/optim/SparseFADFloat.h>
+#include <lore/parallel/ParallelFor.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace lore;
+using namespace lore::optim;
+
+TEST_CASE( "Sparse autodiff", "[autodiff]" ) {
+    using Float = SparseFADFloat<double>;
+    const SparseFADScope<double> scope;
+
+    SECTION( "Constants carry no gradient" ) {
+        const Float c = Float(2) * Float(3) + 1;
+        REQUIRE( c.V == 7 );
+        REQUIRE( c.isConstant() );
+        REQUIRE( c.dVd(0) == 0 );
+    }
+
+    SECTION( "Active range" ) {
+        const Float x = Float::variable(3, 2);
+        const Float y = Float::variable(4, 5);
+
+        const Float shifted = x + 1;
+        REQUIRE( shifted.begin == 2 );
+        REQUIRE( shifted.end == 3 );
+        REQUIRE( shifted.d == x.d );
+
+        const Float z = x * y;
+        REQUIRE( z.V == 12 );
+        REQUIRE( z.begin == 2 );
+        REQUIRE( z.end == 6 );
+        REQUIRE( z.dVd(1) == 0 );
+        REQUIRE( z.dVd(2) == 4 );
+        REQUIRE( z.dVd(3) == 0 );
+        REQUIRE( z.dVd(5) == 3 );
+        REQUIRE( z.dVd(6) == 0 );
+    }
+
+    SECTION( "Agrees with dense autodiff" ) {
+        using Dense = FADFloat<double, 3>;
+        const Dense a { 0.7, { 1, 0, 0 } };
+        const Dense b { 1.3, { 0, 1, 0 } };
+        const Dense c { -2.1, { 0, 0, 1 } };
+        const Dense dense = sqrt(sqr(a) + sqr(b)) * cos(c) / (b - a) - sin(a * c);
+
+        const Float x = Float::variable(0.7, 0);
+        const Float y = Float::variable(1.3, 1);
+        const Float z = Float::variable(-2.1, 2);
+        const Float sparse = sqrt(sqr(x) + sqr(y)) * cos(z) / (y - x) - sin(x * z);
+
+        REQUIRE( std::abs(sparse.V - dense.V) < 1e-14 );
+        for (int i = 0; i < 3; i++) {
+            REQUIRE( std::abs(sparse.dVd(i) - dense.dVd(i)) < 1e-14 );
+        }
+    }
+
+    SECTION( "Sign transfer" ) {
+        const Float x = Float::variable(2, 0);
+        const Float y = copysign(x, Float(-1));
+        REQUIRE( y.V == -2 );
+        REQUIRE( y.dVd(0) == -1 );
+        REQUIRE( copysign(x, Float(1)).d == x.d );
+    }
+}
+
+TEST_CASE( "Sparse autodiff arena", "[autodiff]" ) {
+    using Float = SparseFADFloat<double>;
+    auto &arena = SparseFADArena<double>::local();
+
+    {
+        const SparseFADScope<double> scope;
+        Float sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum += Float::variable(i, i) * 2;
+        }
+        REQUIRE( sum.size() == 1000 );
+        REQUIRE( sum.dVd(999) == 2 );
+        REQUIRE( arena.allocated() > 0 );
+    }
+
+    REQUIRE( arena.allocated() == 0 );
+}
+
+TEST_CASE( "Sparse autodiff stays on its thread", "[autodiff]" ) {
+    using Float = SparseFADFloat<double>;
+    const std::thread::id caller = std::this_thread::get_id();
+
+    const SparseFADScope<double> scope;
+    std::vector<Float> values(64);
+    std::vector<std::thread::id> threads(values.size());
+    parallel::parallelFor(0, int(values.size()), [&](int i) {
+        values[i] = Float::variable(i, i) * 3 + Float::variable(1, 0);
+        threads[i] = std::this_thread::get_id();
+    });
+
+    for (size_t i = 1; i < values.size(); i++) {
+        REQUIRE( threads[i] == caller );
+        REQUIRE( values[i].dVd(int(i)) == 3 );
+        REQUIRE( values[i].dVd(0) == 1 );
+    }
+}
@@ -0,0 +1,255 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/parallel/ParallelFor.h>
+#include <lore/parallel/ScratchArena.h>
+#include <lore/parallel/TaskScheduler.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/SequentialTrace.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+using namespace lore;
+using namespace lore::parallel;
+
+TEST_CASE( "Parallel for", "[parallel]" ) {
+    SECTION( "Every index is visited exactly once" ) {
+        for (const int grainSize : { 1, 7, 64, 1000 }) {
+            std::vector<std::atomic<int>> visits(1000);
+            parallelFor(-500, 500, [&](int i) {
+                visits[i + 500].fetch_add(1);
+            }, grainSize);
+            for (const auto &count : visits) {
+                REQUIRE( count.load() == 1 );
+            }
+        }
+    }
+
+    SECTION( "Empty ranges do nothing" ) {
+        bool called = false;
+        parallelFor(5, 5, [&](int) { called = true; });
+        parallelFor(5, 0, [&](int) { called = true; });
+        REQUIRE_FALSE( called );
+    }
+
+    SECTION( "Exceptions are rethrown on the calling thread" ) {
+        REQUIRE_THROWS_AS( parallelFor(0, 1000, [](int i) {
+            if (i == 321) {
+                throw std::runtime_error("failed");
+            }
+        }, 4), std::runtime_error );
+    }
+
+    SECTION( "Loops can be nested" ) {
+        std::atomic<int> sum { 0 };
+        parallelFor(0, 16, [&](int) {
+            parallelFor(0, 100, [&](int j) {
+                sum.fetch_add(j);
+            }, 8);
+        });
+        REQUIRE( sum.load() == 16 * 4950 );
+    }
+}
+
+TEST_CASE( "Task groups", "[parallel]" ) {
+    // more threads than cores, so that stealing and sleeping are exercised on any machine
+    TaskScheduler scheduler({ .numThreads = 4 });
+    REQUIRE( scheduler.concurrency() == 4 );
+    REQUIRE( scheduler.workerIndex() == -1 );
+    REQUIRE( TaskScheduler::availableCpus() >= 1 );
+
+    SECTION( "All tasks run before wait returns" ) {
+        std::atomic<int> count { 0 };
+        TaskGroup group(scheduler);
+        for (int i = 0; i < 1000; i++) {
+            group.run([&]() { count.fetch_add(1); });
+        }
+        group.wait();
+        REQUIRE( count.load() == 1000 );
+
+        // groups can be reused after waiting
+        group.run([&]() { count.fetch_add(1); });
+        group.wait();
+        REQUIRE( count.load() == 1001 );
+    }
+
+    SECTION( "Tasks spawn and wait for nested groups" ) {
+        std::atomic<int> leaves { 0 };
+        std::atomic<int> onWorkers { 0 };
+        TaskGroup outer(scheduler);
+        for (int i = 0; i < 8; i++) {
+            outer.run([&]() {
+                TaskGroup inner(scheduler);
+                for (int j = 0; j < 8; j++) {
+                    inner.run([&]() {
+                        if (scheduler.workerIndex() >= 0) {
+                            onWorkers.fetch_add(1);
+                        }
+                        leaves.fetch_add(1);
+                    });
+                }
+                inner.wait();
+            });
+        }
+        outer.wait();
+        REQUIRE( leaves.load() == 64 );
+        REQUIRE( onWorkers.load() <= 64 );
+    }
+
+    SECTION( "The first exception is rethrown once all tasks have finished" ) {
+        std::atomic<int> finished { 0 };
+        TaskGroup group(scheduler);
+        for (int i = 0; i < 100; i++) {
+            group.run([&, i]() {
+                finished.fetch_add(1);
+                if (i % 10 == 3) {
+                    throw std::invalid_argument("task failed");
+                }
+            });
+        }
+        REQUIRE_THROWS_AS( group.wait(), std::invalid_argument );
+        REQUIRE( finished.load() == 100 );
+        REQUIRE_FALSE( group.failed() );
+
+        // the error has been consumed by the first wait
+        group.wait();
+    }
+}
+
+TEST_CASE( "Scratch arenas", "[parallel]" ) {
+    ScratchArena arena(1024);
+
+    SECTION( "Allocations are aligned and disjoint" ) {
+        auto bytes = arena.allocate<uint8_t>(3);
+        auto doubles = arena.allocate<double>(10);
+        void *wide = arena.allocate(100, 64);
+        REQUIRE( reinterpret_cast<uintptr_t>(doubles.data()) % alignof(double) == 0 );
+        REQUIRE( reinterpret_cast<uintptr_t>(wide) % 64 == 0 );
+        REQUIRE( reinterpret_cast<uint8_t *>(doubles.data()) >= bytes.data() + bytes.size() );
+        REQUIRE( reinterpret_cast<uint8_t *>(wide) >= reinterpret_cast<uint8_t *>(doubles.data() + doubles.size()) );
+    }
+
+    SECTION( "Released memory is reused" ) {
+        const ScratchArena::Marker marker = arena.mark();
+        void *first = arena.allocate(100);
+        arena.release(marker);
+        REQUIRE( arena.allocate(100) == first );
+
+        // allocations larger than a block get a block of their own, and repeated scopes stop allocating
+        size_t capacity = 0;
+        for (int i = 0; i < 10; i++) {
+            ScratchArena::Scope scope(arena);
+            auto large = arena.allocate<float>(4096);
+            arena.allocate<float>(100);
+            REQUIRE( large.size() == 4096 );
+            if (i == 0) {
+                capacity = arena.capacity();
+            }
+        }
+        REQUIRE( capacity >= 1024 + 4096 * sizeof(float) );
+        REQUIRE( arena.capacity() == capacity );
+
+        arena.reset();
+        REQUIRE( arena.allocate(100) == first );
+    }
+
+    SECTION( "Every thread has its own arena" ) {
+        std::vector<int> last(64);
+        parallelFor(0, 64, [&](int i) {
+            ScratchArena &local = ScratchArena::local();
+            ScratchArena::Scope scope(local);
+            auto values = local.allocate<int>(256);
+            std::iota(values.begin(), values.end(), i);
+            last[i] = values.back();
+        });
+        for (int i = 0; i < 64; i++) {
+            REQUIRE( last[i] == i + 255 );
+        }
+    }
+}
+
+TEST_CASE( "Tracing a shared lens from tasks", "[parallel]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const Lens<double> lens = schema.lens<double>();
+    const double wavelength = schema.primaryWavelength();
+    const double radius = schema.entranceBeamRadius;
+
+    const int numRays = 2000;
+    auto makeRay = [&](int i) {
+        const double y = radius * (2 * double(i) / (numRays - 1) - 1);
+        return rt::Ray<double> { { 0, y, 0 }, { 0, 0, 1 } };
+    };
+
+    std::vector<rt::Ray<double>> expected(numRays);
+    std::vector<bool> expectedValid(numRays);
+    {
+        rt::GeometricalIntersector<double> intersector;
+        rt::SequentialTrace trace(lens, intersector, wavelength);
+        for (int i = 0; i < numRays; i++) {
+            expected[i] = makeRay(i);
+            expectedValid[i] = trace(expected[i]);
+        }
+    }
+
+    TaskScheduler scheduler({ .numThreads = 4 });
+    std::vector<rt::Ray<double>> rays(numRays);
+    std::vector<int> valid(numRays);
+    TaskGroup group(scheduler);
+    for (int begin = 0; begin < numRays; begin += 100) {
+        group.run([&, begin]() {
+            // only the lens is shared, everything with state is created per task
+            rt::GeometricalIntersector<double> intersector;
+            rt::SequentialTrace trace(lens, intersector, wavelength);
+            for (int i = begin; i < begin + 100; i++) {
+                rays[i] = makeRay(i);
+                valid[i] = trace(rays[i]);
+            }
+        });
+    }
+    group.wait();
+
+    for (int i = 0; i < numRays; i++) {
+        REQUIRE( bool(valid[i]) == expectedValid[i] );
+        if (expectedValid[i]) {
+            REQUIRE( rays[i].origin == expected[i].origin );
+            REQUIRE( rays[i].direction == expected[i].direction );
+        }
+    }
+}
+
+TEST_CASE( "Task scheduler performance", "[.][benchmark]" ) {
+    std::vector<double> values(1 << 16, 1.0);
+
+    BENCHMARK( "Sequential loop" ) {
+        double sum = 0;
+        for (double value : values) {
+            sum += std::sqrt(value);
+        }
+        return sum;
+    };
+
+    BENCHMARK( "parallelFor, grain size 1024" ) {
+        parallelFor(0, int(values.size()), [&](int i) {
+            values[i] = std::sqrt(values[i]);
+        }, 1024);
+        return values.back();
+    };
+
+    BENCHMARK( "Empty task group with 64 tasks" ) {
+        std::atomic<int> count { 0 };
+        TaskGroup group;
+        for (int i = 0; i < 64; i++) {
+            group.run([&]() { count.fetch_add(1, std::memory_order_relaxed); });
+        }
+        group.wait();
+        return count.load();
+    };
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/lens/GlassCatalog.h>
+#include <lore/profiling/Profiler.h>
+#include <lore/rt/ABCD.h>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace lore;
+using profiling::Profiler;
+
+static int countEvents(const std::vector<profiling::ThreadEvents> &threads, const char *name) {
+    int count = 0;
+    for (const auto &thread : threads) {
+        for (const auto &event : thread.events) {
+            if (std::strcmp(event.name, name) == 0) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+TEST_CASE( "Profiling spans", "[profiling]" ) {
+    Profiler::clear();
+
+    SECTION( "Disabled spans are not recorded" ) {
+        Profiler::enable(false);
+        {
+            LORE_PROFILE_SCOPE("disabled");
+        }
+        REQUIRE( countEvents(Profiler::collect(), "disabled") == 0 );
+    }
+
+    SECTION( "Nested spans and threads" ) {
+        Profiler::enable();
+        {
+            LORE_PROFILE_SCOPE("outer");
+            {
+                LORE_PROFILE_SCOPE("inner");
+            }
+            std::thread worker([]() {
+                LORE_PROFILE_SCOPE("worker");
+            });
+            worker.join();
+        }
+        Profiler::enable(false);
+
+        const auto threads = Profiler::collect();
+        REQUIRE( countEvents(threads, "outer") == 1 );
+        REQUIRE( countEvents(threads, "inner") == 1 );
+        REQUIRE( countEvents(threads, "worker") == 1 );
+
+        // events are recorded when spans end, so the inner span precedes the outer one
+        for (const auto &thread : threads) {
+            if (thread.events.size() == 2) {
+                const auto &inner = thread.events[0];
+                const auto &outer = thread.events[1];
+                REQUIRE( std::strcmp(inner.name, "inner") == 0 );
+                REQUIRE( outer.begin <= inner.begin );
+                REQUIRE( inner.end <= outer.end );
+            }
+        }
+    }
+
+    SECTION( "Ring buffer" ) {
+        Profiler::enable();
+        for (int i = 0; i < Profiler::Capacity + 10; i++) {
+            LORE_PROFILE_SCOPE("ring");
+        }
+        Profiler::enable(false);
+
+        const auto threads = Profiler::collect();
+        REQUIRE( countEvents(threads, "ring") == Profiler::Capacity );
+        uint64_t dropped = 0;
+        for (const auto &thread : threads) {
+            dropped += thread.dropped;
+        }
+        REQUIRE( dropped == 10 );
+    }
+
+    SECTION( "Instrumented library functions and Chrome trace export" ) {
+        fixtures::loadGlasses("data/glass/obsolete001.glc");
+        Profiler::enable();
+        // a local catalog, since the shared one is only read by the first test that needs it
+        GlassCatalog catalog;
+        catalog.read("data/glass/obsolete001.glc");
+        const auto lens = fixtures::readLens("data/lenses/simple.len").lens<double>();
+        abcd::full(lens, 0.5876);
+        Profiler::enable(false);
+
+        const auto threads = Profiler::collect();
+        REQUIRE( countEvents(threads, "GlassCatalog::read") == 1 );
+        REQUIRE( countEvents(threads, "LensReader::read") == 1 );
+        REQUIRE( countEvents(threads, "abcd::full") == 1 );
+
+        std::ostringstream trace;
+        Profiler::writeChromeTrace(trace);
+        const std::string json = trace.str();
+        REQUIRE( json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0 );
+        REQUIRE( json.find("\"name\":\"LensReader::read\",\"cat\":\"lore\",\"ph\":\"X\"") != std::string::npos );
+        REQUIRE( json.find("e+") == std::string::npos );
+    }
+
+    Profiler::clear();
+}
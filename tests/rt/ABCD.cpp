@@ -33,3 +33,21 @@ TEST_CASE( "Ray transfer matrices", "[rt]" ) {
     REQUIRE_THAT( result(1, 0), WithinRel(-0.0130186, 1e-5) );
     REQUIRE_THAT( result(1, 1), WithinRel(0.995882, 1e-5) );
 }
+
+TEST_CASE( "Ray transfer matrices of lanes", "[rt]" ) {
+    const Glass<double> glass = Glass<double>::constantIOR(1.7);
+    const double radii[4] = { 60, 0, -45, 120 };
+    const double thicknesses[4] = { 5, 2, 8, 0.5 };
+
+    abcd::MatrixLanes<double, 4> lanes;
+    lanes.transfer(radii, thicknesses, 1.0, 1.7);
+    for (int l = 0; l < 4; l++) {
+        const Surface<double> surface(radii[l], thicknesses[l], 20, true, glass);
+        const Matrix2x2<double> expected = abcd::transfer(Matrix2x2<double>::Identity(), surface, 1.0, 1.7);
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 2; j++) {
+                REQUIRE_THAT( lanes[l](i, j), WithinAbs(expected(i, j), 1e-15) );
+            }
+        }
+    }
+}
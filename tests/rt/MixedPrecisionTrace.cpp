@@ -0,0 +1,73 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/lens/Lens.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/MixedPrecisionTrace.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+
+#include <cmath>
+
+using namespace lore;
+
+TEST_CASE( "Mixed precision tracing", "[rt]" ) {
+    SECTION( "Grazing intersections are flagged" ) {
+        const Surface<float> surface { 10, 0, 10, false, Glass<float>::air() };
+        const rt::ConditionedIntersector<float> intersector { 1e-4f };
+        float t;
+
+        const rt::Ray<float> paraxial { Vector3<float> { 0, 1, -1 }, Vector3<float> { 0, 0, 1 } };
+        REQUIRE( intersector(paraxial, surface, t) );
+        REQUIRE( !intersector.flagged );
+
+        const rt::Ray<float> grazing { Vector3<float> { 0, 9.999f, -1 }, Vector3<float> { 0, 0, 1 } };
+        REQUIRE( intersector(grazing, surface, t) );
+        REQUIRE( intersector.flagged );
+
+        const Surface<float> flat { 0, 0, 10, false, Glass<float>::air() };
+        REQUIRE( rt::ConditionedIntersector<float>::relativeError(grazing, flat) < 1e-6f );
+    }
+
+    SECTION( "Rays agree with double precision" ) {
+        const auto schema = fixtures::readTessar();
+        const Lens<double> lens = schema.lens<double>();
+        const double wavelength = 0.5876;
+
+        const rt::GeometricalIntersector<double> doubleIntersector {};
+        const rt::SequentialTrace<double, rt::GeometricalIntersector<double>> doubleTrace {
+            lens, doubleIntersector, wavelength
+        };
+        const Lens<float> singleLens = lens.cast<float>();
+        const rt::GeometricalIntersector<float> singleIntersector {};
+        const rt::SequentialTrace<float, rt::GeometricalIntersector<float>> singleTrace {
+            singleLens, singleIntersector, float(wavelength)
+        };
+        const rt::MixedPrecisionTrace mixedTrace { lens, wavelength };
+
+        const rt::RayGenerator<double> generator { schema };
+        int numValid = 0;
+        for (const double field : { 0.0, 0.7, 1.0 }) {
+            for (int i = -8; i <= 8; i++) {
+                rt::Ray<double> reference = generator(field, 0, i / 8.0);
+                rt::Ray<float> single = reference.cast<float>();
+                rt::Ray<double> mixed = reference;
+
+                const bool valid = doubleTrace(reference);
+                REQUIRE( mixedTrace(mixed) == valid );
+                if (!valid || !singleTrace(single)) {
+                    continue;
+                }
+                numValid++;
+
+                const double singleError = std::abs(double(single.origin.y()) - reference.origin.y());
+                const double mixedError = std::abs(mixed.origin.y() - reference.origin.y());
+                REQUIRE( mixedError <= singleError );
+                REQUIRE( mixedError < 1e-3 );
+            }
+        }
+        REQUIRE( numValid > 0 );
+    }
+}
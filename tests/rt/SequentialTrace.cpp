@@ -130,3 +130,34 @@ TEST_CASE( "Inverse sequential tracing", "[rt]" ) {
     REQUIRE_THAT( ray.origin.y(), WithinAbs(-48.04033, 1e-5) );
     REQUIRE_THAT( ray.origin.z(), WithinAbs(6.87721, 1e-5) );
 }
+
+TEST_CASE( "Optical path lengths", "[rt]" ) {
+    using Float = double;
+
+    // plane-parallel plate between two air gaps
+    const Glass<Float> air = Glass<Float>::constantIOR(1);
+    const Glass<Float> glass = Glass<Float>::constantIOR(1.5);
+    Lens<Float> lens;
+    lens.surfaces = {
+        { 0, 10, 20, false, air },
+        { 0, 5, 20, false, glass },
+        { 0, 20, 20, false, air },
+        { 0, 0, 20, false, air }
+    };
+
+    rt::GeometricalIntersector<Float> intersector {};
+    const rt::SequentialTrace trace { lens, intersector, Float(0.587560) };
+
+    for (const Float angle : { 0.0, 0.1, 0.3 }) {
+        rt::Ray<Float> ray;
+        ray.origin = { 0, 0, -10 };
+        ray.direction = { 0, std::sin(angle), std::cos(angle) };
+
+        Float path = 1;
+        REQUIRE( trace(ray, path) );
+
+        const Float inside = std::asin(std::sin(angle) / 1.5);
+        REQUIRE_THAT( path, WithinRel(1 + 30 / std::cos(angle) + 1.5 * 5 / std::cos(inside), 1e-12) );
+        REQUIRE_THAT( ray.origin.y(), WithinRel(30 * std::tan(angle) + 5 * std::tan(inside), 1e-12) );
+    }
+}
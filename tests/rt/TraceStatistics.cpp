@@ -0,0 +1,77 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <lore/lore.h>
+#include <lore/lens/Lens.h>
+#include <lore/io/LensReader.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/rt/TraceStatistics.h>
+
+#include <cstdint>
+#include <fstream>
+#include <thread>
+
+using namespace lore;
+
+TEST_CASE( "Trace statistics", "[rt]" ) {
+    using rt::TraceStatistics;
+
+    SECTION( "Counters of all threads are merged" ) {
+        TraceStatistics::reset();
+
+        std::thread worker([]() {
+            TraceStatistics::local().traced(true);
+            TraceStatistics::local().record(TraceStatistics::VIGNETTED, 3);
+        });
+        worker.join();
+
+        TraceStatistics::local().traced(false);
+        TraceStatistics::local().record(TraceStatistics::TOTAL_INTERNAL_REFLECTION, 1);
+
+        const TraceStatistics statistics = TraceStatistics::collect();
+        REQUIRE( statistics.raysTraced == 2 );
+        REQUIRE( statistics.raysCompleted == 1 );
+        REQUIRE( statistics.surfaces.size() == 4 );
+        REQUIRE( statistics.surfaces[3].vignetted == 1 );
+        REQUIRE( statistics.surfaces[1].totalInternalReflections == 1 );
+        REQUIRE( statistics.total().losses() == 2 );
+
+        TraceStatistics::reset();
+        REQUIRE( TraceStatistics::collect().raysTraced == 0 );
+    }
+
+    SECTION( "Sequential trace" ) {
+        using Float = double;
+
+        io::LensReader reader;
+        std::ifstream file("data/lenses/simple.len");
+        const auto lens = reader.read(file).front().lens<Float>();
+
+        TraceStatistics::reset();
+
+        const rt::GeometricalIntersector<Float> intersector {};
+        const rt::SequentialTrace<Float, rt::GeometricalIntersector<Float>> trace { lens, intersector, 0.5876 };
+        const int numRays = 256;
+        int completed = 0;
+        for (int i = 0; i < numRays; i++) {
+            // parallel rays whose height ranges from the axis to well outside of the lens
+            rt::Ray<Float> ray {
+                Vector3<Float> { 0, lens.surfaces[1].aperture * 4 * i / numRays, -1 },
+                Vector3<Float> { 0, 0, 1 }
+            };
+            if (trace(ray)) {
+                completed++;
+            }
+        }
+
+        const TraceStatistics statistics = TraceStatistics::collect();
+        if (TraceStatistics::enabled) {
+            REQUIRE( statistics.raysTraced == uint64_t(numRays) );
+            REQUIRE( statistics.raysCompleted == uint64_t(completed) );
+            REQUIRE( statistics.total().losses() == uint64_t(numRays - completed) );
+            REQUIRE( completed < numRays );
+        } else {
+            REQUIRE( statistics.raysTraced == 0 );
+        }
+    }
+}
@@ -0,0 +1,192 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Fixtures.h"
+
+#include <lore/lore.h>
+#include <lore/optim/MeritFunction.h>
+#include <lore/rt/GeometricalIntersector.h>
+#include <lore/rt/RayGenerator.h>
+#include <lore/rt/SequentialTrace.h>
+#include <lore/sampling/PupilSampler.h>
+
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+/**
+ * RMS spot radius about the centroid for equally weighted pupil samples.
+ */
+static double spotRms(const LensSchema<float> &schema, const sampling::PupilSamples<double> &samples, double field) {
+    using Intersector = rt::GeometricalIntersector<double>;
+    const Lens<double> lens = schema.lens<double>();
+    const rt::RayGenerator<double> generator(schema);
+    const Intersector intersector {};
+    const rt::SequentialTrace<double, Intersector> trace { lens, intersector, double(schema.primaryWavelength()) };
+
+    std::vector<Vector2<double>> hits;
+    for (size_t i = 0; i < samples.size(); i++) {
+        rt::Ray<double> ray = generator(field, samples.x[i], samples.y[i]);
+        if (trace(ray)) {
+            hits.push_back({ ray.origin.x(), ray.origin.y() });
+        }
+    }
+
+    Vector2<double> centroid;
+    for (const auto &hit : hits) {
+        centroid += hit;
+    }
+    centroid /= double(hits.size());
+
+    double sum = 0;
+    for (const auto &hit : hits) {
+        sum += (hit - centroid).lengthSquared();
+    }
+    return std::sqrt(sum / double(hits.size()));
+}
+
+TEST_CASE( "Sobol sequence", "[sampling]" ) {
+    SECTION( "Unscrambled points" ) {
+        const sampling::SobolSequence sobol;
+        const double expected[][2] = { { 0, 0 }, { 0.5, 0.5 }, { 0.25, 0.75 }, { 0.75, 0.25 }, { 0.125, 0.625 } };
+        for (int i = 0; i < 5; i++) {
+            REQUIRE( sobol(i).x() == expected[i][0] );
+            REQUIRE( sobol(i).y() == expected[i][1] );
+        }
+    }
+
+    SECTION( "Scrambled prefixes are (0, k, 2)-nets" ) {
+        for (const uint64_t seed : { 0, 1, 12345 }) {
+            const sampling::SobolSequence sobol(seed);
+            const int k = 8;
+            for (int a = 0; a <= k; a++) {
+                const int columns = 1 << a;
+                const int rows = 1 << (k - a);
+                std::set<int> cells;
+                for (int i = 0; i < (1 << k); i++) {
+                    const Vector2<double> p = sobol(i);
+                    REQUIRE( p.x() >= 0 );
+                    REQUIRE( p.x() < 1 );
+                    cells.insert(int(p.x() * columns) * rows + int(p.y() * rows));
+                }
+                REQUIRE( cells.size() == size_t(1 << k) );
+            }
+        }
+    }
+
+    SECTION( "Seeds are reproducible and decorrelated" ) {
+        REQUIRE( sampling::SobolSequence(7)(100).x() == sampling::SobolSequence(7)(100).x() );
+        REQUIRE( sampling::SobolSequence(7)(100).x() != sampling::SobolSequence(8)(100).x() );
+    }
+}
+
+TEST_CASE( "Pupil samplers", "[sampling]" ) {
+    const sampling::PupilSampler samplers[] = {
+        sampling::PupilSampler::grid(),
+        sampling::PupilSampler::hexapolar(),
+        sampling::PupilSampler::fibonacci(),
+        sampling::PupilSampler::sobol(3)
+    };
+
+    SECTION( "Samples cover the unit disk uniformly" ) {
+        for (const auto &sampler : samplers) {
+            const auto samples = sampler(1000);
+            REQUIRE( samples.size() >= 1000 );
+            REQUIRE( samples.y.size() == samples.size() );
+
+            // the second moment of the uniform unit disk is 1 / 2
+            double x = 0, y = 0, r2 = 0;
+            for (size_t i = 0; i < samples.size(); i++) {
+                const double ri = sqr(samples.x[i]) + sqr(samples.y[i]);
+                REQUIRE( ri <= 1 + 1e-12 );
+                x += samples.x[i];
+                y += samples.y[i];
+                r2 += ri;
+            }
+            REQUIRE_THAT( x / samples.size(), WithinAbs(0, 0.01) );
+            REQUIRE_THAT( y / samples.size(), WithinAbs(0, 0.01) );
+            REQUIRE_THAT( r2 / samples.size(), WithinAbs(0.5, 0.01) );
+        }
+    }
+
+    SECTION( "Sample counts" ) {
+        sampling::PupilSamples<float> samples;
+        sampling::PupilSampler::fibonacci().generate(123, samples);
+        REQUIRE( samples.size() == 123 );
+        sampling::PupilSampler::sobol().generate(123, samples);
+        REQUIRE( samples.size() == 123 );
+        REQUIRE( sampling::PupilSampler::hexapolarCount(3) == 37 );
+        sampling::PupilSampler::hexapolar().generate(37, samples);
+        REQUIRE( samples.size() == 37 );
+        sampling::PupilSampler::hexapolar().generate(38, samples);
+        REQUIRE( samples.size() == 61 );
+        sampling::PupilSampler::grid().generate(0, samples);
+        REQUIRE( samples.empty() );
+    }
+
+    SECTION( "Grids match the spot operand" ) {
+        const LensSchema<float> schema = fixtures::readTessar();
+        for (const double field : { 0.0, 0.7, 1.0 }) {
+            optim::MeritFunction mf;
+            mf.add(optim::Operand::spotRms(field, 0, 7));
+            const double expected = mf.compile(schema).evaluate(schema.lens<double>(), false).values[0];
+
+            // a 7 x 7 grid has 37 points within the pupil
+            const auto samples = sampling::PupilSampler::grid()(37);
+            REQUIRE( samples.size() == 37 );
+            REQUIRE_THAT( spotRms(schema, samples, field), WithinRel(expected, 1e-12) );
+        }
+    }
+
+    SECTION( "Low-discrepancy samplers converge with few rays" ) {
+        const LensSchema<float> schema = fixtures::readTessar();
+        const double reference = spotRms(schema, sampling::PupilSampler::sobol(1)(1 << 16), 0.7);
+
+        auto error = [&](const sampling::PupilSampler &sampler, int count) {
+            return std::abs(spotRms(schema, sampler(count), 0.7) / reference - 1);
+        };
+        REQUIRE( error(sampling::PupilSampler::sobol(), 256) < 0.01 );
+        REQUIRE( error(sampling::PupilSampler::fibonacci(), 256) < 0.01 );
+    }
+}
+
+TEST_CASE( "Pupil sampler convergence", "[.][benchmark]" ) {
+    const LensSchema<float> schema = fixtures::readTessar();
+    const std::pair<const char *, sampling::PupilSampler> samplers[] = {
+        { "grid", sampling::PupilSampler::grid() },
+        { "hexapolar", sampling::PupilSampler::hexapolar() },
+        { "fibonacci", sampling::PupilSampler::fibonacci() },
+        { "sobol", sampling::PupilSampler::sobol() }
+    };
+
+    // smallest number of rays from which on the RMS spot radius stays within the given relative accuracy
+    std::cout << std::setw(8) << "field" << std::setw(12) << "accuracy";
+    for (const auto &[name, sampler] : samplers) {
+        std::cout << std::setw(12) << name;
+    }
+    std::cout << std::endl;
+
+    for (const double field : { 0.0, 0.7, 1.0 }) {
+        const double reference = spotRms(schema, sampling::PupilSampler::sobol(1)(1 << 18), field);
+        for (const double accuracy : { 1e-2, 1e-3 }) {
+            std::cout << std::setw(8) << field << std::setw(12) << accuracy;
+            for (const auto &[name, sampler] : samplers) {
+                int converged = -1;
+                for (int count = 8; count <= 1 << 16; count = count * 5 / 4 + 1) {
+                    const auto samples = sampler(count);
+                    const double error = std::abs(spotRms(schema, samples, field) / reference - 1);
+                    if (error > accuracy) {
+                        converged = -1;
+                    } else if (converged < 0) {
+                        converged = int(samples.size());
+                    }
+                }
+                std::cout << std::setw(12) << (converged < 0 ? std::string("-") : std::to_string(converged));
+            }
+            std::cout << std::endl;
+        }
+    }
+}
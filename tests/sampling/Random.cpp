@@ -0,0 +1,45 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <lore/lore.h>
+#include <lore/sampling/Random.h>
+
+using namespace lore;
+using namespace Catch::Matchers;
+
+TEST_CASE( "Counter-based random numbers", "[sampling]" ) {
+    SECTION( "Philox known answer" ) {
+        const sampling::Philox rng { 0 };
+        const auto result = rng({ 0, 0, 0, 0 });
+        REQUIRE( result[0] == 0x6627e8d5 );
+        REQUIRE( result[1] == 0xe169c58d );
+        REQUIRE( result[2] == 0xbc57ac4c );
+        REQUIRE( result[3] == 0x9b00dbd8 );
+    }
+
+    SECTION( "Uniform numbers" ) {
+        const sampling::Philox rng { 42 };
+        double sum = 0;
+        for (int i = 0; i < 10000; i++) {
+            const double u = rng.uniform(i, 3);
+            REQUIRE( u > 0 );
+            REQUIRE( u < 1 );
+            sum += u;
+        }
+        REQUIRE_THAT( sum / 10000, WithinAbs(0.5, 0.01) );
+        REQUIRE( rng.uniform(17, 3) == rng.uniform(17, 3) );
+        REQUIRE( rng.uniform(17, 3) != rng.uniform(17, 4) );
+    }
+
+    SECTION( "Normal numbers" ) {
+        const sampling::Philox rng { 7 };
+        double sum = 0, sumSqr = 0;
+        for (int i = 0; i < 20000; i++) {
+            const double n = rng.normal(i, 0);
+            sum += n;
+            sumSqr += n * n;
+        }
+        REQUIRE_THAT( sum / 20000, WithinAbs(0, 0.03) );
+        REQUIRE_THAT( sumSqr / 20000, WithinAbs(1, 0.03) );
+    }
+}
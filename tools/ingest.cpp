@@ -0,0 +1,230 @@
+#include <lore/lore.h>
+#include <lore/io/LensReader.h>
+#include <lore/io/LensWriter.h>
+#include <lore/lens/GlassCatalog.h>
+#include <lore/lens/LensArchive.h>
+#include <lore/logging.h>
+#include <lore/parallel/ParallelFor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef LORE_DATA_DIR
+#define LORE_DATA_DIR "data"
+#endif
+
+using namespace lore;
+namespace fs = std::filesystem;
+
+/**
+ * Outcome of ingesting a single file.
+ */
+struct FileResult {
+    LensArchive archive;
+    std::vector<io::ParseDiagnostic> diagnostics;
+
+    bool hasErrors() const {
+        return std::any_of(diagnostics.begin(), diagnostics.end(), [](const io::ParseDiagnostic &diagnostic) {
+            return diagnostic.severity == io::ParseDiagnostic::ERROR;
+        });
+    }
+};
+
+static void report(
+    std::vector<io::ParseDiagnostic> &diagnostics,
+    io::ParseDiagnostic::Severity severity,
+    const std::string &message
+) {
+    diagnostics.push_back({ severity, 0, 0, message });
+}
+
+/**
+ * Checks the parts of a design that the parser accepts but later analysis cannot.
+ */
+static void validate(const LensArchive::LensView &lens, std::vector<io::ParseDiagnostic> &diagnostics) {
+    const std::string prefix = "lens '" + std::string(lens.name()) + "': ";
+    const int numSurfaces = int(lens.surfaces().size());
+    if (numSurfaces < 2) {
+        report(diagnostics, io::ParseDiagnostic::ERROR, prefix + "fewer than two surfaces");
+    }
+    if (lens.stopIndex() < 0 || lens.stopIndex() >= numSurfaces) {
+        report(diagnostics, io::ParseDiagnostic::ERROR, prefix + "aperture stop out of range");
+    }
+    if (lens.wavelengths().empty()) {
+        report(diagnostics, io::ParseDiagnostic::WARNING, prefix + "no wavelengths");
+    }
+    for (int i = 0; i < numSurfaces; i++) {
+        const ArchivedSurface &surface = lens.surfaces()[i];
+        if (!std::isfinite(surface.radius) || std::isnan(surface.thickness) || !std::isfinite(surface.aperture)) {
+            report(diagnostics, io::ParseDiagnostic::ERROR,
+                prefix + "surface " + std::to_string(i) + " has non-finite geometry");
+        }
+    }
+}
+
+static std::vector<fs::path> findFiles(const fs::path &directory, const std::string &extension) {
+    std::vector<fs::path> result;
+    for (const auto &entry : fs::recursive_directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == extension) {
+            result.push_back(entry.path());
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static void printUsage() {
+    std::cerr
+        << "usage: lore-ingest [options] <input directory> <output bundle>\n"
+        << "  --glass <dir>         directory of glass catalogs (default: " << LORE_DATA_DIR << "/glass)\n"
+        << "  --extension <ext>     extension of lens files (default: .len)\n"
+        << "  --keep-invalid        also bundle designs with errors (unknown glasses are replaced by air),\n"
+        << "                        except those the bundle format cannot hold, such as an out of range stop\n"
+        << "  --strict              exit with status 1 if any design has errors\n"
+        << "  --quiet               only print the summary\n";
+}
+
+int main(int argc, char **argv) {
+    fs::path glassDirectory = fs::path(LORE_DATA_DIR) / "glass";
+    std::string extension = ".len";
+    bool keepInvalid = false;
+    bool strict = false;
+    bool quiet = false;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (argument == "--glass" && hasValue) {
+            glassDirectory = argv[++i];
+        } else if (argument == "--extension" && hasValue) {
+            extension = argv[++i];
+        } else if (argument == "--keep-invalid") {
+            keepInvalid = true;
+        } else if (argument == "--strict") {
+            strict = true;
+        } else if (argument == "--quiet") {
+            quiet = true;
+        } else if (argument == "--help") {
+            printUsage();
+            return 0;
+        } else if (!argument.empty() && argument[0] == '-') {
+            printUsage();
+            return 2;
+        } else {
+            positional.push_back(argument);
+        }
+    }
+    if (positional.size() != 2) {
+        printUsage();
+        return 2;
+    }
+    const fs::path inputDirectory = positional[0];
+    const fs::path outputPath = positional[1];
+
+    if (!fs::is_directory(inputDirectory)) {
+        std::cerr << "input directory '" << inputDirectory.string() << "' not found" << std::endl;
+        return 2;
+    }
+    if (!fs::is_directory(glassDirectory)) {
+        std::cerr << "glass directory '" << glassDirectory.string() << "' not found" << std::endl;
+        return 2;
+    }
+
+    // every problem is reported through diagnostics, which also carry the file name
+    static std::ostream discard(nullptr);
+    Logger::shared = std::make_shared<AsyncLogger>(discard, discard);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    GlassCatalog catalog;
+    for (const fs::path &path : findFiles(glassDirectory, ".glc")) {
+        catalog.read(path.string());
+    }
+
+    const std::vector<fs::path> files = findFiles(inputDirectory, extension);
+    std::vector<FileResult> results(files.size());
+
+    // the catalog and reader are only read from, so all tasks share them
+    const io::LensReader reader { catalog };
+    parallel::parallelFor(0, int(files.size()), [&](int i) {
+        FileResult &result = results[i];
+        try {
+            std::ifstream file { files[i], std::ios::binary };
+            if (!file) {
+                throw std::runtime_error("could not open file");
+            }
+            reader.read(file, result.archive, &result.diagnostics);
+        } catch (const std::exception &e) {
+            report(result.diagnostics, io::ParseDiagnostic::ERROR, e.what());
+        }
+
+        for (size_t lens = 0; lens < result.archive.size(); lens++) {
+            validate(result.archive[lens], result.diagnostics);
+        }
+    });
+
+    // merged in path order, so that bundles are reproducible
+    LensArchive bundle;
+    size_t numWarnings = 0;
+    size_t numErrors = 0;
+    size_t numRejected = 0;
+    size_t numLeftOut = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        const FileResult &result = results[i];
+        const std::string source = fs::relative(files[i], inputDirectory).generic_string();
+
+        for (const io::ParseDiagnostic &diagnostic : result.diagnostics) {
+            const bool isError = diagnostic.severity == io::ParseDiagnostic::ERROR;
+            (isError ? numErrors : numWarnings)++;
+            if (!quiet) {
+                std::cerr << source;
+                if (diagnostic.line > 0) {
+                    std::cerr << ":" << diagnostic.line << ":" << diagnostic.column;
+                }
+                std::cerr << ": " << (isError ? "error" : "warning") << ": " << diagnostic.message << "\n";
+            }
+        }
+
+        if (result.hasErrors() && !keepInvalid) {
+            numRejected++;
+            continue;
+        }
+        // a single such lens would make the whole bundle unreadable, so they are left out even with --keep-invalid
+        const size_t numBundled = bundle.size();
+        bundle.append(result.archive, source, io::LensWriter::canWriteBinary);
+        numLeftOut += result.archive.size() - (bundle.size() - numBundled);
+    }
+
+    // written next to the destination first, so that readers never see a partial bundle
+    const fs::path temporaryPath = outputPath.string() + ".tmp";
+    {
+        std::ofstream output { temporaryPath, std::ios::binary };
+        io::LensWriter().writeBinary(output, bundle);
+        if (!output) {
+            std::cerr << "could not write '" << temporaryPath.string() << "'" << std::endl;
+            return 2;
+        }
+    }
+    fs::rename(temporaryPath, outputPath);
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout
+        << "ingested " << files.size() << " files (" << numRejected << " rejected, "
+        << numLeftOut << " lenses left out) with "
+        << bundle.size() << " lenses into '" << outputPath.string() << "' ("
+        << fs::file_size(outputPath) << " bytes) in " << seconds << " s using "
+        << parallel::threadCount() << " threads; " << numErrors << " errors, " << numWarnings << " warnings"
+        << std::endl;
+
+    return strict && numErrors > 0 ? 1 : 0;
+}